@@ -0,0 +1,149 @@
+/**
+ * @file crc_bench.c
+ * @brief Check and timing of the CRC engine of the ingenia protocol bus
+ *        (IPB) against the byte-wise CRC-CCITT of ipb_crcccitt.c
+ *
+ * @note Random buffers of every size up to an extended frame are first
+ *  checked, whole and split in two updates, against update_crc_ccitt.
+ *  Both are then timed on the same buffers for a frame header and an
+ *  extended frame. Build and run from the repository root:
+ *
+ *  gcc -O2 -I. bench/crc_bench.c ipb_crc.c ipb_crcccitt.c -o crc_bench
+ *  ./crc_bench [iterations]
+ *
+ *  Add -DIPB_CRC_NO_SIMD or -DIPB_CRC_SLICE_BY_8=0 to check and time the
+ *  table engines alone.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+/** ipb_checksum.h does not include the size_t definition */
+#include <stddef.h>
+#include <stdint.h>
+#include "ipb_crc.h"
+#include "ipb_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/** Largest buffer checked, an extended frame */
+#define CRC_BENCH_MAX_SZ_BY     1024U
+
+/** Default number of timed iterations */
+#define CRC_BENCH_DFLT_ITER     200000UL
+
+/** Sizes timed, frame header and extended frame without its CRC */
+static const uint16_t pu16TimedSzBy[] = { 12U, 1018U };
+
+/** Random buffers */
+static uint8_t pu8Buf[CRC_BENCH_MAX_SZ_BY];
+
+/** Keeps the timed results alive */
+static volatile uint16_t u16Sink;
+
+static uint64_t BenchNowNs(void)
+{
+    struct timespec tTs;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &tTs);
+
+    return ((uint64_t)tTs.tv_sec * 1000000000ULL) + (uint64_t)tTs.tv_nsec;
+}
+
+static uint16_t BenchRefCrc(const uint8_t* pu8Data, uint16_t u16SzBy)
+{
+    uint16_t u16Crc = IPB_CRC_START;
+
+    for (uint16_t u16Idx = 0U; u16Idx < u16SzBy; ++u16Idx)
+    {
+        u16Crc = update_crc_ccitt(u16Crc, pu8Data[u16Idx]);
+    }
+
+    return u16Crc;
+}
+
+/**
+ * Checks every size and split point of random buffers
+ *
+ * @retval number of mismatches
+ */
+static uint32_t BenchCheck(void)
+{
+    uint32_t u32Err = 0UL;
+
+    for (uint16_t u16Round = 0U; u16Round < 16U; ++u16Round)
+    {
+        for (uint16_t u16Idx = 0U; u16Idx < CRC_BENCH_MAX_SZ_BY; ++u16Idx)
+        {
+            pu8Buf[u16Idx] = (uint8_t)rand();
+        }
+
+        for (uint16_t u16SzBy = 0U; u16SzBy <= CRC_BENCH_MAX_SZ_BY; ++u16SzBy)
+        {
+            uint16_t u16Ref = BenchRefCrc(pu8Buf, u16SzBy);
+            uint16_t u16Split = (u16SzBy > 0U) ? (uint16_t)((uint16_t)rand() % u16SzBy) : 0U;
+            uint16_t u16Crc = Ipb_CrcUpdate(IPB_CRC_START, pu8Buf, u16SzBy);
+
+            if (u16Crc != u16Ref)
+            {
+                u32Err++;
+            }
+
+            /** Chained updates, as the frame header and data are */
+            u16Crc = Ipb_CrcUpdate(IPB_CRC_START, pu8Buf, u16Split);
+            u16Crc = Ipb_CrcUpdate(u16Crc, &pu8Buf[u16Split], (uint16_t)(u16SzBy - u16Split));
+            if (u16Crc != u16Ref)
+            {
+                u32Err++;
+            }
+        }
+    }
+
+    return u32Err;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t u32Iter = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : CRC_BENCH_DFLT_ITER;
+    uint32_t u32Err;
+
+    Ipb_CrcInit();
+    srand(1U);
+    u32Err = BenchCheck();
+    printf("mismatches %lu\n", (unsigned long)u32Err);
+
+    printf("bytes  engine ns  byte-wise ns\n");
+    for (size_t szIdx = 0U; szIdx < (sizeof(pu16TimedSzBy) / sizeof(pu16TimedSzBy[0])); ++szIdx)
+    {
+        uint16_t u16SzBy = pu16TimedSzBy[szIdx];
+        uint64_t u64Start;
+        double dEngine;
+        double dRef;
+
+        u64Start = BenchNowNs();
+        for (uint32_t u32Idx = 0UL; u32Idx < u32Iter; ++u32Idx)
+        {
+            /** The buffer changes each time, the result can not be hoisted */
+            pu8Buf[0] = (uint8_t)u32Idx;
+            u16Sink = Ipb_CrcUpdate(IPB_CRC_START, pu8Buf, u16SzBy);
+        }
+        dEngine = (double)(BenchNowNs() - u64Start) / (double)u32Iter;
+
+        u64Start = BenchNowNs();
+        for (uint32_t u32Idx = 0UL; u32Idx < u32Iter; ++u32Idx)
+        {
+            pu8Buf[0] = (uint8_t)u32Idx;
+            u16Sink = BenchRefCrc(pu8Buf, u16SzBy);
+        }
+        dRef = (double)(BenchNowNs() - u64Start) / (double)u32Iter;
+
+        printf("%5u  %9.1f  %12.1f\n", (unsigned)u16SzBy, dEngine, dRef);
+    }
+
+    return (u32Err == 0UL) ? 0 : 1;
+}
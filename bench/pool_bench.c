@@ -0,0 +1,191 @@
+/**
+ * @file pool_bench.c
+ * @brief Contention benchmark of the frame and message pool of the
+ *        ingenia protocol bus (IPB)
+ *
+ * @note From 1 to 32 threads borrow and return a frame and a message in
+ *  a loop, first through the lock-free pool, then through the same loop
+ *  behind a mutex. Each object carries the identification of its
+ *  borrower while held, so an object handed out twice is counted as a
+ *  duplicate. Build and run from the repository root:
+ *
+ *  gcc -O2 -pthread -DIPB_POOL_MSG_NUM=64U -DIPB_POOL_CFG_FRM_NUM=64U -I. \
+ *      bench/pool_bench.c ipb_pool.c ipb.c ipb_intf.c ipb_frame.c ipb_crc.c \
+ *      ipb_usr.c ipb_port.c ipb_linux.c -o pool_bench
+ *  ./pool_bench [iterations per thread]
+ *
+ *  Add -fsanitize=thread to check the pool with ThreadSanitizer. Figures
+ *  only show contention when run on as many cores as threads.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_pool.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+/** Max number of threads */
+#define POOL_BENCH_MAX_THREADS  32U
+
+/** Default number of iterations per thread */
+#define POOL_BENCH_DFLT_ITER    200000UL
+
+/** Thread context */
+typedef struct
+{
+    /** Borrower identification, never 0 */
+    uint16_t u16Id;
+    /** Number of iterations */
+    uint32_t u32Iter;
+    /** Use the mutex baseline instead of the lock-free pool */
+    bool isLocked;
+    /** Objects found held by another thread */
+    uint32_t u32Dup;
+    /** Iterations without an object, pool exhausted */
+    uint32_t u32Miss;
+} TBenchThread;
+
+/** Baseline lock */
+static pthread_mutex_t tLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Start barrier */
+static pthread_barrier_t tStart;
+
+static uint64_t BenchNowNs(void)
+{
+    struct timespec tTs;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &tTs);
+
+    return ((uint64_t)tTs.tv_sec * 1000000000ULL) + (uint64_t)tTs.tv_nsec;
+}
+
+static void* BenchThread(void* pvArg)
+{
+    TBenchThread* ptThread = (TBenchThread*)pvArg;
+
+    (void)pthread_barrier_wait(&tStart);
+
+    for (uint32_t u32Idx = 0UL; u32Idx < ptThread->u32Iter; ++u32Idx)
+    {
+        Ipb_TFrame* ptFrame;
+        Ipb_TMsg* ptMsg;
+
+        if (ptThread->isLocked != false)
+        {
+            (void)pthread_mutex_lock(&tLock);
+        }
+        ptFrame = Ipb_PoolAlloc((uint16_t)IPB_FRAME_TOTAL_CFG_SIZE);
+        ptMsg = Ipb_PoolMsgAlloc();
+        if (ptThread->isLocked != false)
+        {
+            (void)pthread_mutex_unlock(&tLock);
+        }
+
+        /** Mark as held, a mark of another thread means a double hand out */
+        if (ptFrame != NULL)
+        {
+            ptFrame->pu16Buf[0] = ptThread->u16Id;
+        }
+        if (ptMsg != NULL)
+        {
+            ptMsg->u16Addr = ptThread->u16Id;
+        }
+        if (((ptFrame != NULL) && (ptFrame->pu16Buf[0] != ptThread->u16Id))
+            || ((ptMsg != NULL) && (ptMsg->u16Addr != ptThread->u16Id)))
+        {
+            ptThread->u32Dup++;
+        }
+        if ((ptFrame == NULL) || (ptMsg == NULL))
+        {
+            ptThread->u32Miss++;
+        }
+
+        if (ptThread->isLocked != false)
+        {
+            (void)pthread_mutex_lock(&tLock);
+        }
+        if (ptFrame != NULL)
+        {
+            Ipb_PoolFree(ptFrame);
+        }
+        if (ptMsg != NULL)
+        {
+            Ipb_PoolMsgFree(ptMsg);
+        }
+        if (ptThread->isLocked != false)
+        {
+            (void)pthread_mutex_unlock(&tLock);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Runs a round
+ *
+ * @retval nanoseconds per alloc/free pair of frame and message
+ */
+static double BenchRound(uint16_t u16Threads, uint32_t u32Iter, bool isLocked, uint32_t* pu32Dup,
+                         uint32_t* pu32Miss)
+{
+    pthread_t ptTid[POOL_BENCH_MAX_THREADS];
+    TBenchThread ptThread[POOL_BENCH_MAX_THREADS];
+    uint64_t u64Start;
+    uint64_t u64Ns;
+
+    (void)pthread_barrier_init(&tStart, NULL, (unsigned)u16Threads + 1U);
+    for (uint16_t u16Idx = 0U; u16Idx < u16Threads; ++u16Idx)
+    {
+        ptThread[u16Idx].u16Id = (uint16_t)(u16Idx + 1U);
+        ptThread[u16Idx].u32Iter = u32Iter;
+        ptThread[u16Idx].isLocked = isLocked;
+        ptThread[u16Idx].u32Dup = 0UL;
+        ptThread[u16Idx].u32Miss = 0UL;
+        (void)pthread_create(&ptTid[u16Idx], NULL, BenchThread, &ptThread[u16Idx]);
+    }
+
+    u64Start = BenchNowNs();
+    (void)pthread_barrier_wait(&tStart);
+    for (uint16_t u16Idx = 0U; u16Idx < u16Threads; ++u16Idx)
+    {
+        (void)pthread_join(ptTid[u16Idx], NULL);
+        *pu32Dup += ptThread[u16Idx].u32Dup;
+        *pu32Miss += ptThread[u16Idx].u32Miss;
+    }
+    u64Ns = BenchNowNs() - u64Start;
+    (void)pthread_barrier_destroy(&tStart);
+
+    /** Wall time over all pairs, the cost a pair adds to the whole */
+    return (double)u64Ns / ((double)u32Iter * (double)u16Threads);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t u32Iter = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : POOL_BENCH_DFLT_ITER;
+    uint32_t u32Dup = 0UL;
+    uint32_t u32Miss = 0UL;
+
+    printf("threads  lock-free ns/pair  mutex ns/pair\n");
+    for (uint16_t u16Threads = 1U; u16Threads <= POOL_BENCH_MAX_THREADS; u16Threads = (uint16_t)(u16Threads * 2U))
+    {
+        double dFree = BenchRound(u16Threads, u32Iter, false, &u32Dup, &u32Miss);
+        double dLocked = BenchRound(u16Threads, u32Iter, true, &u32Dup, &u32Miss);
+
+        printf("%7u  %17.1f  %13.1f\n", (unsigned)u16Threads, dFree, dLocked);
+    }
+
+    printf("duplicates %lu, exhausted %lu, in use %u %u %u, high water %u %u %u\n",
+           (unsigned long)u32Dup, (unsigned long)u32Miss,
+           Ipb_PoolGetInUse(IPB_POOL_CFG), Ipb_PoolGetInUse(IPB_POOL_EXT), Ipb_PoolGetInUse(IPB_POOL_MSG),
+           Ipb_PoolGetHighWater(IPB_POOL_CFG), Ipb_PoolGetHighWater(IPB_POOL_EXT),
+           Ipb_PoolGetHighWater(IPB_POOL_MSG));
+
+    return (u32Dup == 0UL) ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file rxring_bench.c
+ * @brief Decoding cost of monitoring frames through the circular
+ *        reception buffer of the ingenia protocol bus (IPB), against the
+ *        copying parser
+ *
+ * @note Extended frames of the max size are written into a 64 KiB ring
+ *  the way an OS read does and decoded in place, then fed to the parser
+ *  from a receive buffer. Each path is timed without touching the data
+ *  and with a consumer summing it. Build and run from the repository
+ *  root:
+ *
+ *  gcc -O2 -I. bench/rxring_bench.c ipb_rxring.c ipb_parser.c ipb_frame.c \
+ *      ipb_crc.c -o rxring_bench
+ *  ./rxring_bench [frames]
+ *
+ *  Figures are with the data hot in cache, as it is when the frame was
+ *  just received.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_rxring.h"
+#include "ipb_parser.h"
+#include "ipb_crc.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Size of the ring buffer in bytes, power of 2 */
+#define RXRING_BENCH_SZ_BY      65536UL
+
+/** Default number of frames */
+#define RXRING_BENCH_DFLT_FRM   500000UL
+
+/** Sum the data of each frame */
+static bool isSum;
+
+/** Keeps the sums alive */
+static volatile uint32_t u32Sink;
+
+static uint64_t BenchNowNs(void)
+{
+    struct timespec tTs;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &tTs);
+
+    return ((uint64_t)tTs.tv_sec * 1000000000ULL) + (uint64_t)tTs.tv_nsec;
+}
+
+static uint32_t BenchSum(const uint8_t* pu8Buf, uint32_t u32SzBy)
+{
+    uint32_t u32Sum = 0UL;
+
+    for (uint32_t u32Idx = 0UL; (u32Idx + 1UL) < u32SzBy; u32Idx += 2UL)
+    {
+        uint16_t u16Word;
+
+        memcpy((void*)&u16Word, (const void*)&pu8Buf[u32Idx], sizeof(u16Word));
+        u32Sum += u16Word;
+    }
+
+    return u32Sum;
+}
+
+static void BenchOnFrame(void* pvCtx, const Ipb_TFrame* ptFrame)
+{
+    (void)pvCtx;
+
+    if (isSum != false)
+    {
+        u32Sink += BenchSum((const uint8_t*)&ptFrame->pu16Buf[IPB_FRAME_TOTAL_CFG_SIZE],
+                            (uint32_t)(ptFrame->u16Sz - IPB_FRAME_TOTAL_CFG_SIZE) * sizeof(uint16_t));
+    }
+}
+
+/**
+ * Decodes frames in place
+ *
+ * @retval nanoseconds per frame
+ */
+static double BenchRing(const Ipb_TFrame* ptFrame, uint32_t u32SzBy, uint32_t u32Frames)
+{
+    static uint8_t pu8Buf[RXRING_BENCH_SZ_BY];
+    Ipb_TRxRing tRing;
+    uint64_t u64Start;
+
+    (void)Ipb_RxRingInit(&tRing, pu8Buf, RXRING_BENCH_SZ_BY);
+
+    u64Start = BenchNowNs();
+    for (uint32_t u32Idx = 0UL; u32Idx < u32Frames; ++u32Idx)
+    {
+        Ipb_TFrameView tView;
+        uint8_t* pu8Dst;
+        uint32_t u32Space = Ipb_RxRingSpace(&tRing, &pu8Dst);
+        uint32_t u32First = (u32Space < u32SzBy) ? u32Space : u32SzBy;
+
+        /** A read may end at the buffer end, the rest goes at its start */
+        memcpy((void*)pu8Dst, (const void*)ptFrame->pu16Buf, u32First);
+        Ipb_RxRingCommit(&tRing, u32First);
+        if (u32First < u32SzBy)
+        {
+            (void)Ipb_RxRingSpace(&tRing, &pu8Dst);
+            memcpy((void*)pu8Dst, (const void*)((const uint8_t*)ptFrame->pu16Buf + u32First), u32SzBy - u32First);
+            Ipb_RxRingCommit(&tRing, u32SzBy - u32First);
+        }
+
+        while (Ipb_RxRingNext(&tRing, &tView) != false)
+        {
+            if (isSum != false)
+            {
+                for (uint16_t u16Seg = 0U; u16Seg < tView.u16DataCnt; ++u16Seg)
+                {
+                    u32Sink += BenchSum(tView.ptData[u16Seg].pu8Buf, tView.ptData[u16Seg].u16SzBy);
+                }
+            }
+            Ipb_RxRingRelease(&tRing, &tView);
+        }
+    }
+
+    return (double)(BenchNowNs() - u64Start) / (double)u32Frames;
+}
+
+/**
+ * Decodes frames with the copying parser
+ *
+ * @retval nanoseconds per frame
+ */
+static double BenchParser(const Ipb_TFrame* ptFrame, uint32_t u32SzBy, uint32_t u32Frames)
+{
+    static uint8_t pu8Rx[IPB_FRM_MAX_DATA_SZ * sizeof(uint16_t)];
+    Ipb_TParser tParser;
+    uint64_t u64Start;
+
+    Ipb_ParserInit(&tParser, BenchOnFrame, NULL);
+
+    u64Start = BenchNowNs();
+    for (uint32_t u32Idx = 0UL; u32Idx < u32Frames; ++u32Idx)
+    {
+        /** The same read into a linear receive buffer */
+        memcpy((void*)pu8Rx, (const void*)ptFrame->pu16Buf, u32SzBy);
+        Ipb_ParserFeed(&tParser, pu8Rx, (uint16_t)u32SzBy);
+    }
+
+    return (double)(BenchNowNs() - u64Start) / (double)u32Frames;
+}
+
+int main(int argc, char** argv)
+{
+    static Ipb_TFrame tFrame;
+    static uint16_t pu16Data[IPB_MAX_DATA_SZ];
+    uint32_t u32Frames = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : RXRING_BENCH_DFLT_FRM;
+    uint32_t u32SzBy;
+
+    Ipb_CrcInit();
+    for (uint16_t u16Idx = 0U; u16Idx < IPB_MAX_DATA_SZ; ++u16Idx)
+    {
+        pu16Data[u16Idx] = u16Idx;
+    }
+    (void)Ipb_FrameCreate(&tFrame, 1U, 0x200U, IPB_REP_ACK, pu16Data,
+                          (uint16_t)(IPB_FRM_MAX_DATA_SZ - IPB_FRAME_TOTAL_CFG_SIZE), true);
+    u32SzBy = (uint32_t)Ipb_FrameGetEncodedSz(tFrame.pu16Buf) * sizeof(uint16_t);
+
+    printf("%lu byte frames  ring view ns  copying parser ns\n", (unsigned long)u32SzBy);
+    for (uint16_t u16Pass = 0U; u16Pass < 2U; ++u16Pass)
+    {
+        double dRing;
+        double dParser;
+
+        isSum = (u16Pass != 0U);
+        dRing = BenchRing(&tFrame, u32SzBy, u32Frames);
+        dParser = BenchParser(&tFrame, u32SzBy, u32Frames);
+        printf("%-16s  %12.1f  %17.1f\n", (isSum != false) ? "data summed" : "data untouched", dRing, dParser);
+    }
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file wait_bench.c
+ * @brief Latency and CPU of the wait strategies of blocking requests of
+ *        the ingenia protocol bus (IPB)
+ *
+ * @note A blocking requester reads a register over the serial port
+ *  opened on a pty, answered by a stand-in drive thread on the master
+ *  side after a fixed delay. For each strategy the p50 and p99 round
+ *  trip and the CPU of the requesting thread are reported. Build and run
+ *  from the repository root:
+ *
+ *  gcc -O2 -pthread -I. bench/wait_bench.c ipb.c ipb_intf.c ipb_frame.c \
+ *      ipb_crc.c ipb_parser.c ipb_pool.c ipb_port.c ipb_usr.c ipb_linux.c \
+ *      ipb_serial.c -o wait_bench
+ *  ./wait_bench
+ *
+ *  The stand-in drive shares the cores with the requester, run it on a
+ *  host with at least two.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb.h"
+#include "ipb_serial.h"
+#include "ipb_parser.h"
+#include "ipb_crc.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/** Number of requests with an immediate reply */
+#define WAIT_BENCH_FAST_NUM     5000U
+
+/** Number of requests with a delayed reply */
+#define WAIT_BENCH_SLOW_NUM     500U
+
+/** Request timeout in milliseconds */
+#define WAIT_BENCH_TIMEOUT_MS   100UL
+
+/** Master side of the pty */
+static int32_t i32Master;
+
+/** Time in microseconds the stand-in drive takes to answer */
+static uint32_t u32DelayUs;
+
+/** Round trips in microseconds */
+static uint32_t pu32Lat[WAIT_BENCH_FAST_NUM];
+
+static void BenchOnRequest(void* pvCtx, const Ipb_TFrame* ptFrame)
+{
+    uint16_t pu16Out[IPB_FRAME_TOTAL_CFG_SIZE];
+    uint16_t pu16Data[IPB_FRM_CONFIG_SZ];
+    int32_t i32Sz;
+
+    (void)pvCtx;
+
+    Ipb_FrameGetConfigData(ptFrame, pu16Data);
+    pu16Data[0]++;
+    if (u32DelayUs != 0UL)
+    {
+        struct timespec tTs = { 0, (long)u32DelayUs * 1000L };
+
+        (void)nanosleep(&tTs, NULL);
+    }
+
+    i32Sz = Ipb_FrameEncode(pu16Out, IPB_FRAME_TOTAL_CFG_SIZE, Ipb_FrameGetSubNode(ptFrame),
+                            Ipb_FrameGetAddr(ptFrame), IPB_REP_ACK, pu16Data, IPB_FRM_CONFIG_SZ);
+    if (i32Sz > 0L)
+    {
+        (void)write(i32Master, pu16Out, (size_t)i32Sz * sizeof(uint16_t));
+    }
+}
+
+static void* BenchDrive(void* pvArg)
+{
+    Ipb_TParser tParser;
+    uint8_t pu8Buf[256];
+    ssize_t szRd;
+
+    (void)pvArg;
+    Ipb_ParserInit(&tParser, BenchOnRequest, NULL);
+
+    while ((szRd = read(i32Master, pu8Buf, sizeof(pu8Buf))) > 0)
+    {
+        Ipb_ParserFeed(&tParser, pu8Buf, (uint16_t)szRd);
+    }
+
+    return NULL;
+}
+
+static int BenchCmpU32(const void* pvA, const void* pvB)
+{
+    uint32_t u32A = *(const uint32_t*)pvA;
+    uint32_t u32B = *(const uint32_t*)pvB;
+
+    return (u32A > u32B) - (u32A < u32B);
+}
+
+static double BenchThreadCpuS(void)
+{
+    struct rusage tUsage;
+
+    (void)getrusage(RUSAGE_THREAD, &tUsage);
+
+    return (double)(tUsage.ru_utime.tv_sec + tUsage.ru_stime.tv_sec)
+           + ((double)(tUsage.ru_utime.tv_usec + tUsage.ru_stime.tv_usec) / 1e6);
+}
+
+int main(void)
+{
+    static const char* const ppcWait[] = { "spin", "sleep", "adaptive" };
+    static const uint32_t pu32Delay[] = { 0UL, 2000UL };
+    static Ipb_TSerial tSerial;
+    static Ipb_TInst tInst;
+    pthread_t tDrive;
+    uint32_t u32Bad = 0UL;
+
+    Ipb_CrcInit();
+    i32Master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((i32Master < 0L) || (grantpt(i32Master) != 0) || (unlockpt(i32Master) != 0)
+        || (Ipb_SerialOpen(&tSerial, 0U, ptsname(i32Master), 0UL) != 0L))
+    {
+        printf("pty not available\n");
+        return 1;
+    }
+    (void)pthread_create(&tDrive, NULL, BenchDrive, NULL);
+    Ipb_InitId(&tInst, UART_BASED, IPB_BLOCKING, 0U);
+
+    for (size_t szDelay = 0U; szDelay < (sizeof(pu32Delay) / sizeof(pu32Delay[0])); ++szDelay)
+    {
+        uint32_t u32Num = (pu32Delay[szDelay] == 0UL) ? WAIT_BENCH_FAST_NUM : WAIT_BENCH_SLOW_NUM;
+
+        u32DelayUs = pu32Delay[szDelay];
+        for (uint16_t u16Wait = 0U; u16Wait < (uint16_t)(sizeof(ppcWait) / sizeof(ppcWait[0])); ++u16Wait)
+        {
+            double dCpu;
+            uint32_t u32StartUs;
+            double dWall;
+
+            Ipb_SetWait(&tInst, (Ipb_EWait)u16Wait, IPB_DFLT_SPIN_US);
+            dCpu = BenchThreadCpuS();
+            u32StartUs = Ipb_GetMicros();
+            for (uint32_t u32Idx = 0UL; u32Idx < u32Num; ++u32Idx)
+            {
+                Ipb_TMsg tMsg = { 1U, 0x011U, IPB_REQ_READ, IPB_FRM_CONFIG_SZ, { (uint16_t)u32Idx }, IPB_STANDBY };
+                uint32_t u32ReqUs = Ipb_GetMicros();
+
+                (void)Ipb_Write(&tInst, &tMsg, WAIT_BENCH_TIMEOUT_MS);
+                if ((Ipb_Read(&tInst, &tMsg, WAIT_BENCH_TIMEOUT_MS) != IPB_SUCCESS)
+                    || (tMsg.pu16Data[0] != (uint16_t)(u32Idx + 1UL)))
+                {
+                    u32Bad++;
+                }
+                pu32Lat[u32Idx] = Ipb_GetMicros() - u32ReqUs;
+            }
+            dWall = (double)(Ipb_GetMicros() - u32StartUs) / 1e6;
+            dCpu = BenchThreadCpuS() - dCpu;
+
+            qsort(pu32Lat, u32Num, sizeof(pu32Lat[0]), BenchCmpU32);
+            printf("reply delay %4lu us  %-8s p50 %5lu us  p99 %5lu us  cpu %5.1f %%\n",
+                   (unsigned long)u32DelayUs, ppcWait[u16Wait], (unsigned long)pu32Lat[u32Num / 2U],
+                   (unsigned long)pu32Lat[(u32Num * 99U) / 100U], (100.0 * dCpu) / dWall);
+        }
+    }
+
+    printf("failed requests %lu\n", (unsigned long)u32Bad);
+    Ipb_SerialClose(&tSerial);
+
+    return (u32Bad == 0UL) ? 0 : 1;
+}
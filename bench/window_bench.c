@@ -0,0 +1,247 @@
+/**
+ * @file window_bench.c
+ * @brief Throughput of the sliding window mode of the ingenia protocol
+ *        bus (IPB) against the window size
+ *
+ * @note Reads are sent over the UDP port to a stand-in drive thread on
+ *  127.0.0.1 that answers each request after a fixed delay, 1 ms by
+ *  default, serving several requests at once. For each window size the
+ *  reads per second and the CPU of the process are reported; the
+ *  submitter waits with Ipb_WindowWait while no slot is free. Build and
+ *  run from the repository root:
+ *
+ *  gcc -O2 -pthread -I. bench/window_bench.c ipb_window.c ipb.c ipb_intf.c \
+ *      ipb_frame.c ipb_crc.c ipb_parser.c ipb_pool.c ipb_port.c ipb_usr.c \
+ *      ipb_linux.c ipb_udp.c -o window_bench
+ *  ./window_bench [reply delay in us]
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb.h"
+#include "ipb_udp.h"
+#include "ipb_window.h"
+#include "ipb_crc.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/** Number of reads of each window size */
+#define WINDOW_BENCH_REQ_NUM    2000UL
+
+/** Default time in microseconds the stand-in drive takes to answer */
+#define WINDOW_BENCH_DFLT_DELAY 1000UL
+
+/** Number of replies the stand-in drive holds, power of 2 */
+#define WINDOW_BENCH_QUEUE_SZ   256U
+
+/** Request timeout in milliseconds */
+#define WINDOW_BENCH_TIMEOUT_MS 100UL
+
+/** Reply waiting for its delay */
+typedef struct
+{
+    /** Time in microseconds the reply is sent */
+    uint64_t u64DueUs;
+    /** Encoded reply */
+    uint16_t pu16Buf[IPB_FRAME_TOTAL_CFG_SIZE];
+    /** Requester address */
+    struct sockaddr_in tPeer;
+} TBenchReply;
+
+/** Stand-in drive socket */
+static int32_t i32Sock;
+
+/** Time in microseconds the stand-in drive takes to answer */
+static uint32_t u32DelayUs;
+
+/** Replies waiting, in due order */
+static TBenchReply ptReply[WINDOW_BENCH_QUEUE_SZ];
+static uint32_t u32ReplyHead;
+static uint32_t u32ReplyTail;
+
+/** Reads completed with an ACK reply */
+static uint32_t u32Ok;
+
+static uint64_t BenchNowUs(void)
+{
+    struct timespec tTs;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &tTs);
+
+    return ((uint64_t)tTs.tv_sec * 1000000ULL) + ((uint64_t)tTs.tv_nsec / 1000ULL);
+}
+
+static void BenchQueueReply(const uint16_t* pu16Req, const struct sockaddr_in* ptPeer)
+{
+    TBenchReply* ptRep = &ptReply[u32ReplyTail % WINDOW_BENCH_QUEUE_SZ];
+    Ipb_TFrame tFrame;
+    uint16_t pu16Data[IPB_FRM_CONFIG_SZ];
+
+    memcpy((void*)tFrame.pu16Buf, (const void*)pu16Req, IPB_FRM_CFG_SZ_BY);
+    Ipb_FrameGetConfigData(&tFrame, pu16Data);
+    pu16Data[0]++;
+    (void)Ipb_FrameEncode(ptRep->pu16Buf, IPB_FRAME_TOTAL_CFG_SIZE, Ipb_FrameGetSubNode(&tFrame),
+                          Ipb_FrameGetAddr(&tFrame), IPB_REP_ACK, pu16Data, IPB_FRM_CONFIG_SZ);
+    ptRep->tPeer = *ptPeer;
+    ptRep->u64DueUs = BenchNowUs() + u32DelayUs;
+    u32ReplyTail++;
+}
+
+static void* BenchDrive(void* pvArg)
+{
+    uint16_t pu16Req[IPB_FRM_MAX_DATA_SZ];
+
+    (void)pvArg;
+
+    for (;;)
+    {
+        struct pollfd tPoll = { i32Sock, POLLIN, 0 };
+        struct timespec tTimeout = { 1, 0 };
+        uint64_t u64NowUs;
+
+        /** Sleep until a request arrives or the oldest reply is due */
+        if (u32ReplyHead != u32ReplyTail)
+        {
+            int64_t i64LeftUs = (int64_t)ptReply[u32ReplyHead % WINDOW_BENCH_QUEUE_SZ].u64DueUs
+                                - (int64_t)BenchNowUs();
+
+            i64LeftUs = (i64LeftUs > 0LL) ? i64LeftUs : 0LL;
+            tTimeout.tv_sec = (time_t)(i64LeftUs / 1000000LL);
+            tTimeout.tv_nsec = (long)((i64LeftUs % 1000000LL) * 1000LL);
+        }
+
+        if (ppoll(&tPoll, 1U, &tTimeout, NULL) > 0)
+        {
+            struct sockaddr_in tPeer;
+            socklen_t tPeerSz = sizeof(tPeer);
+            ssize_t szRd = recvfrom(i32Sock, pu16Req, sizeof(pu16Req), 0, (struct sockaddr*)&tPeer, &tPeerSz);
+
+            if (szRd <= 0)
+            {
+                break;
+            }
+            if ((szRd >= (ssize_t)IPB_FRM_CFG_SZ_BY)
+                && ((u32ReplyTail - u32ReplyHead) < WINDOW_BENCH_QUEUE_SZ))
+            {
+                BenchQueueReply(pu16Req, &tPeer);
+            }
+        }
+
+        u64NowUs = BenchNowUs();
+        while ((u32ReplyHead != u32ReplyTail)
+               && (ptReply[u32ReplyHead % WINDOW_BENCH_QUEUE_SZ].u64DueUs <= u64NowUs))
+        {
+            TBenchReply* ptRep = &ptReply[u32ReplyHead % WINDOW_BENCH_QUEUE_SZ];
+
+            (void)sendto(i32Sock, ptRep->pu16Buf, IPB_FRM_CFG_SZ_BY, 0, (const struct sockaddr*)&ptRep->tPeer,
+                         sizeof(ptRep->tPeer));
+            u32ReplyHead++;
+        }
+    }
+
+    return NULL;
+}
+
+static void BenchOnDone(void* pvCtx, Ipb_TMsg* ptMsg)
+{
+    (void)pvCtx;
+
+    if ((ptMsg->eStatus == IPB_SUCCESS) && (ptMsg->u16Cmd == IPB_REP_ACK))
+    {
+        u32Ok++;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static const uint16_t pu16Win[] = { 1U, 2U, 4U, 8U, 16U };
+    static Ipb_TUdp tUdp;
+    static Ipb_TInst tInst;
+    static Ipb_TWindow tWindow;
+    static Ipb_TMsg ptMsg[IPB_WINDOW_MAX_SZ];
+    struct sockaddr_in tAddr;
+    socklen_t tAddrSz = sizeof(tAddr);
+    pthread_t tDrive;
+    uint32_t u32Bad = 0UL;
+
+    u32DelayUs = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : WINDOW_BENCH_DFLT_DELAY;
+    Ipb_CrcInit();
+
+    memset((void*)&tAddr, 0, sizeof(tAddr));
+    tAddr.sin_family = AF_INET;
+    tAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    i32Sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((i32Sock < 0L) || (bind(i32Sock, (const struct sockaddr*)&tAddr, sizeof(tAddr)) != 0)
+        || (getsockname(i32Sock, (struct sockaddr*)&tAddr, &tAddrSz) != 0)
+        || (Ipb_UdpOpen(&tUdp, 0U, "127.0.0.1", ntohs(tAddr.sin_port)) != 0L))
+    {
+        printf("udp not available\n");
+        return 1;
+    }
+    (void)pthread_create(&tDrive, NULL, BenchDrive, NULL);
+    Ipb_InitId(&tInst, ETHERNET_BASED, IPB_NON_BLOCKING, 0U);
+
+    printf("reply delay %lu us\nwindow  req/s  cpu %%\n", (unsigned long)u32DelayUs);
+    for (size_t szWin = 0U; szWin < (sizeof(pu16Win) / sizeof(pu16Win[0])); ++szWin)
+    {
+        uint32_t u32Sent = 0UL;
+        uint64_t u64StartUs = BenchNowUs();
+        clock_t tCpu = clock();
+        double dWall;
+
+        u32Ok = 0UL;
+        Ipb_WindowInit(&tWindow, &tInst, pu16Win[szWin], WINDOW_BENCH_TIMEOUT_MS, BenchOnDone, NULL);
+        while ((u32Sent < WINDOW_BENCH_REQ_NUM) || (tWindow.u16Pend > 0U))
+        {
+            for (uint16_t u16Idx = 0U; (u16Idx < pu16Win[szWin]) && (u32Sent < WINDOW_BENCH_REQ_NUM); ++u16Idx)
+            {
+                Ipb_TMsg* ptReq = &ptMsg[u16Idx];
+
+                if ((ptReq->eStatus != IPB_READ_ANSWER) && (ptReq->eStatus != IPB_WRITE_ANSWER))
+                {
+                    /** Each slot reads its own register, replies match in any order */
+                    ptReq->u16SubNode = 1U;
+                    ptReq->u16Addr = (uint16_t)(0x010U + u16Idx);
+                    ptReq->u16Cmd = IPB_REQ_READ;
+                    ptReq->u16Size = IPB_FRM_CONFIG_SZ;
+                    ptReq->pu16Data[0] = (uint16_t)u32Sent;
+                    if (Ipb_WindowSubmit(&tWindow, ptReq) != IPB_SUCCESS)
+                    {
+                        break;
+                    }
+                    u32Sent++;
+                }
+            }
+
+            if (Ipb_WindowPoll(&tWindow) == 0U)
+            {
+                Ipb_WindowWait(&tWindow);
+            }
+        }
+
+        dWall = (double)(BenchNowUs() - u64StartUs) / 1e6;
+        printf("%6u  %5.0f  %5.1f\n", (unsigned)pu16Win[szWin], (double)WINDOW_BENCH_REQ_NUM / dWall,
+               (100.0 * (double)(clock() - tCpu)) / ((double)CLOCKS_PER_SEC * dWall));
+        u32Bad += WINDOW_BENCH_REQ_NUM - u32Ok;
+    }
+
+    printf("failed requests %lu\n", (unsigned long)u32Bad);
+    Ipb_UdpClose(&tUdp);
+
+    return (u32Bad == 0UL) ? 0 : 1;
+}
@@ -8,16 +8,73 @@
  */
 
 #include "ipb.h"
+#include "ipb_crc.h"
 #include <stdint.h>
 #include <string.h>
 
+/**
+ * Progresses a write request with a single non blocking step
+ *
+ * @retval status of the request
+ */
+static Ipb_EStatus
+Ipb_WriteStep(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg);
+
+/**
+ * Progresses a read request with a single non blocking step
+ *
+ * @retval status of the request
+ */
+static Ipb_EStatus
+Ipb_ReadStep(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg);
+
+/**
+ * Waits for received data according to the instance wait strategy
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[in] u32StartUs
+ *  Start of the request in microseconds
+ * @param[in] u32LeftMs
+ *  Time left until the request timeout
+ */
+static void
+Ipb_WaitData(Ipb_TInst* ptInst, uint32_t u32StartUs, uint32_t u32LeftMs);
+
+/**
+ * Queues an asynchronous request
+ *
+ * @retval IPB_SUCCESS if queued, IPB_STANDBY if queue is full
+ */
+static Ipb_EStatus
+Ipb_AsyncQueue(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+               void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx, bool isRead);
+
+/**
+ * Sends the cyclic frame with the setpoint values of the message
+ *
+ * @retval IPB_SUCCESS if sent, IPB_ERROR otherwise
+ */
+static Ipb_EStatus
+Ipb_CyclicWrite(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg);
+
 void Ipb_Init(Ipb_TInst* ptInst, Ipb_EIntf eIntf, Ipb_EMode eMode)
+{
+    Ipb_InitId(ptInst, eIntf, eMode, (uint16_t)0U);
+}
+
+void Ipb_InitId(Ipb_TInst* ptInst, Ipb_EIntf eIntf, Ipb_EMode eMode, uint16_t u16Id)
 {
     ptInst->eIntf = eIntf;
     ptInst->isCyclic = false;
     ptInst->eMode = eMode;
+    ptInst->eWait = IPB_WAIT_ADAPTIVE;
+    ptInst->u32SpinUs = IPB_DFLT_SPIN_US;
+    ptInst->ptCyclic = NULL;
+    ptInst->u16AsyncHead = (uint16_t)0U;
+    ptInst->u16AsyncCnt = (uint16_t)0U;
 
-    Ipb_IntfInit(&ptInst->tIntf, eIntf, 0);
+    Ipb_IntfInit(&ptInst->tIntf, eIntf, u16Id);
 }
 
 void Ipb_Deinit(Ipb_TInst* ptInst)
@@ -25,70 +82,393 @@ void Ipb_Deinit(Ipb_TInst* ptInst)
     ptInst->eIntf = UART_BASED;
     ptInst->isCyclic = false;
     ptInst->eMode = IPB_BLOCKING;
+    ptInst->ptCyclic = NULL;
+    ptInst->u16AsyncCnt = (uint16_t)0U;
     Ipb_IntfDeinit(&ptInst->tIntf);
 }
 
+void Ipb_SetWait(Ipb_TInst* ptInst, Ipb_EWait eWait, uint32_t u32SpinUs)
+{
+    ptInst->eWait = eWait;
+    ptInst->u32SpinUs = u32SpinUs;
+}
+
 Ipb_EStatus Ipb_Write(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout)
 {
-    ptMsg->eStatus = IPB_ERROR;
+    if (ptInst->eMode == IPB_BLOCKING)
+    {
+        uint32_t u32Millis = Ipb_GetMillis();
+        do
+        {
+            ptMsg->eStatus = Ipb_WriteStep(ptInst, ptMsg);
 
-    if (ptInst->isCyclic == false)
+        } while ((ptMsg->eStatus != IPB_ERROR) && (ptMsg->eStatus != IPB_SUCCESS)
+                && ((Ipb_GetMillis() - u32Millis) < u32Timeout));
+
+        if ((ptMsg->eStatus != IPB_ERROR) && (ptMsg->eStatus != IPB_SUCCESS))
+        {
+            /** Timed out, next request starts from stand by */
+            Ipb_IntfReset(&ptInst->tIntf);
+        }
+    }
+    else
+    {
+        /** No blocking mode */
+        ptMsg->eStatus = Ipb_WriteStep(ptInst, ptMsg);
+    }
+
+    return ptMsg->eStatus;
+}
+
+Ipb_EStatus Ipb_Read(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout)
+{
+    if (ptInst->eMode == IPB_BLOCKING)
     {
-        if (ptInst->eMode == IPB_BLOCKING)
+        uint32_t u32Millis = Ipb_GetMillis();
+        uint32_t u32StartUs = Ipb_GetMicros();
+        uint32_t u32Elapsed;
+        do
         {
-            uint32_t u32Millis = Ipb_GetMillis();
-            do
+            ptMsg->eStatus = Ipb_ReadStep(ptInst, ptMsg);
+            u32Elapsed = Ipb_GetMillis() - u32Millis;
+
+            /** Standby only needs another step, other states wait for data */
+            if ((ptMsg->eStatus == IPB_READ_REQUEST) || (ptMsg->eStatus == IPB_READ_ANSWER))
             {
-                ptMsg->eStatus = ptInst->tIntf.Write(&ptInst->tIntf, &ptMsg->u16SubNode, &ptMsg->u16Addr,
-                                                     &ptMsg->u16Cmd, ptMsg->pu16Data, ptMsg->u16Size);
+                if (u32Elapsed < u32Timeout)
+                {
+                    Ipb_WaitData(ptInst, u32StartUs, (u32Timeout - u32Elapsed));
+                    u32Elapsed = Ipb_GetMillis() - u32Millis;
+                }
+            }
 
-            } while ((ptMsg->eStatus != IPB_ERROR) && (ptMsg->eStatus != IPB_SUCCESS)
-                    && ((Ipb_GetMillis() - u32Millis) < u32Timeout));
-        }
-        else
+        } while ((ptMsg->eStatus != IPB_ERROR) && (ptMsg->eStatus != IPB_SUCCESS)
+                && (u32Elapsed < u32Timeout));
+
+        if ((ptMsg->eStatus != IPB_ERROR) && (ptMsg->eStatus != IPB_SUCCESS))
         {
-            /** No blocking mode */
-            ptMsg->eStatus = ptInst->tIntf.Write(&ptInst->tIntf, &ptMsg->u16SubNode, &ptMsg->u16Addr,
-                                                 &ptMsg->u16Cmd, ptMsg->pu16Data, ptMsg->u16Size);
+            /** Timed out, a rx frame borrowed for the reply goes back to the pool */
+            Ipb_IntfReset(&ptInst->tIntf);
         }
     }
     else
     {
-        /* Cyclic mode */
+        /** No blocking mode */
+        ptMsg->eStatus = Ipb_ReadStep(ptInst, ptMsg);
     }
 
     return ptMsg->eStatus;
 }
 
-Ipb_EStatus Ipb_Read(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout)
+Ipb_EStatus Ipb_WriteAsync(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+                           void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx)
 {
-    ptMsg->eStatus = IPB_ERROR;
+    return Ipb_AsyncQueue(ptInst, ptMsg, u32Timeout, OnDone, pvCtx, false);
+}
 
-    if (ptInst->isCyclic == false)
+Ipb_EStatus Ipb_ReadAsync(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+                          void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx)
+{
+    return Ipb_AsyncQueue(ptInst, ptMsg, u32Timeout, OnDone, pvCtx, true);
+}
+
+uint16_t Ipb_Poll(Ipb_TInst* ptInst, uint16_t u16Budget)
+{
+    uint16_t u16Done = (uint16_t)0U;
+
+    while ((u16Budget > (uint16_t)0U) && (ptInst->u16AsyncCnt > (uint16_t)0U))
+    {
+        Ipb_TAsyncReq* ptReq = &ptInst->ptAsync[ptInst->u16AsyncHead];
+        Ipb_TMsg* ptMsg = ptReq->ptMsg;
+
+        if (ptReq->isStarted == false)
+        {
+            ptReq->isStarted = true;
+            ptReq->u32Millis = Ipb_GetMillis();
+        }
+
+        u16Budget--;
+        if (ptReq->isRead != false)
+        {
+            ptMsg->eStatus = Ipb_ReadStep(ptInst, ptMsg);
+        }
+        else
+        {
+            ptMsg->eStatus = Ipb_WriteStep(ptInst, ptMsg);
+        }
+
+        if ((ptMsg->eStatus != IPB_ERROR) && (ptMsg->eStatus != IPB_SUCCESS))
+        {
+            if ((Ipb_GetMillis() - ptReq->u32Millis) < ptReq->u32Timeout)
+            {
+                /** Standby needs another step, other states wait for data */
+                if (ptMsg->eStatus != IPB_STANDBY)
+                {
+                    break;
+                }
+                continue;
+            }
+            ptMsg->eStatus = IPB_ERROR;
+            Ipb_IntfReset(&ptInst->tIntf);
+        }
+
+        /** Dequeued first, the callback may queue new requests */
+        ptInst->u16AsyncHead = (uint16_t)((ptInst->u16AsyncHead + 1U) % IPB_ASYNC_MAX_NUM);
+        ptInst->u16AsyncCnt--;
+        u16Done++;
+        if (ptReq->OnDone != NULL)
+        {
+            ptReq->OnDone(ptReq->pvCtx, ptMsg);
+        }
+    }
+
+    return u16Done;
+}
+
+uint16_t Ipb_GetPending(const Ipb_TInst* ptInst)
+{
+    return ptInst->u16AsyncCnt;
+}
+
+Ipb_EStatus Ipb_WriteBatch(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint16_t u16MsgCnt, uint16_t* pu16Buf,
+                           uint16_t u16BufSz, uint32_t u32Timeout)
+{
+    Ipb_EStatus eRet = IPB_SUCCESS;
+    uint16_t u16BufIdx = (uint16_t)0U;
+    uint16_t u16SentIdx = (uint16_t)0U;
+    uint16_t u16Idx;
+
+    /** Encode all requests back to back */
+    for (u16Idx = (uint16_t)0U; u16Idx < u16MsgCnt; ++u16Idx)
+    {
+        int32_t i32Sz = Ipb_FrameEncode(&pu16Buf[u16BufIdx], (u16BufSz - u16BufIdx),
+                                        ptMsg[u16Idx].u16SubNode, ptMsg[u16Idx].u16Addr,
+                                        ptMsg[u16Idx].u16Cmd, ptMsg[u16Idx].pu16Data,
+                                        ptMsg[u16Idx].u16Size);
+        if (i32Sz < 0L)
+        {
+            eRet = IPB_ERROR;
+            break;
+        }
+        u16BufIdx += (uint16_t)i32Sz;
+    }
+
+    /** Transmission sizes in bytes take 16 bits, bigger batches are split at frame boundaries */
+    while ((eRet == IPB_SUCCESS) && (u16SentIdx < u16BufIdx))
     {
-        if (ptInst->eMode == IPB_BLOCKING)
+        uint16_t u16EndIdx = u16SentIdx;
+
+        while (u16EndIdx < u16BufIdx)
+        {
+            uint16_t u16FrmSz = Ipb_FrameGetEncodedSz(&pu16Buf[u16EndIdx]);
+
+            if ((u16EndIdx > u16SentIdx)
+                && (((uint32_t)u16EndIdx - u16SentIdx + u16FrmSz) > IPB_INTF_SEND_MAX_SZ))
+            {
+                break;
+            }
+            u16EndIdx += u16FrmSz;
+        }
+
+        eRet = ptInst->tIntf.Send(&ptInst->tIntf, &pu16Buf[u16SentIdx], (u16EndIdx - u16SentIdx));
+        u16SentIdx = u16EndIdx;
+    }
+
+    for (u16Idx = (uint16_t)0U; u16Idx < u16MsgCnt; ++u16Idx)
+    {
+        ptMsg[u16Idx].eStatus = eRet;
+    }
+
+    if ((eRet == IPB_SUCCESS) && (ptInst->eMode == IPB_BLOCKING))
+    {
+        /** Replies arrive in request order */
+        uint32_t u32Millis = Ipb_GetMillis();
+
+        for (u16Idx = (uint16_t)0U; u16Idx < u16MsgCnt; ++u16Idx)
         {
-            uint32_t u32Millis = Ipb_GetMillis();
-            do
+            uint32_t u32Elapsed = Ipb_GetMillis() - u32Millis;
+
+            if ((u32Elapsed >= u32Timeout)
+                || (Ipb_Read(ptInst, &ptMsg[u16Idx], (u32Timeout - u32Elapsed)) != IPB_SUCCESS))
             {
-                ptMsg->eStatus = ptInst->tIntf.Read(&ptInst->tIntf, &ptMsg->u16SubNode, &ptMsg->u16Addr,
-                                                    &ptMsg->u16Cmd, ptMsg->pu16Data, &ptMsg->u16Size);
+                ptMsg[u16Idx].eStatus = IPB_ERROR;
+                eRet = IPB_ERROR;
+            }
+        }
+    }
 
-            } while ((ptMsg->eStatus != IPB_ERROR) && (ptMsg->eStatus != IPB_SUCCESS)
-                    && ((Ipb_GetMillis() - u32Millis) < u32Timeout));
+    return eRet;
+}
+
+Ipb_EStatus Ipb_CyclicStart(Ipb_TInst* ptInst, Ipb_TCyclic* ptCyclic, uint16_t u16SubNode, uint16_t u16Addr,
+                            uint16_t u16TxSz, uint16_t u16RxSz)
+{
+    Ipb_EStatus eRet = IPB_ERROR;
+    Ipb_TFrameDesc tDesc;
+
+    while (1)
+    {
+        if ((u16TxSz > (uint16_t)IPB_MAX_DATA_SZ) || (u16RxSz > (uint16_t)IPB_MAX_DATA_SZ)
+            || ((IPB_FRAME_TOTAL_CFG_SIZE + (uint32_t)u16TxSz) > (uint32_t)IPB_FRM_MAX_DATA_SZ))
+        {
+            break;
+        }
+
+        ptCyclic->u16SubNode = u16SubNode;
+        ptCyclic->u16Addr = u16Addr;
+        ptCyclic->u16TxSz = u16TxSz;
+        ptCyclic->u16RxSz = u16RxSz;
+
+        /** Header and config data do not change, extended values are not copied */
+        memset((void*)ptCyclic->pu16Frm, 0, sizeof(ptCyclic->pu16Frm));
+        if (Ipb_FrameCreateDesc(&tDesc, u16SubNode, u16Addr, IPB_REQ_WRITE, NULL, ptCyclic->u16TxSz) != 0L)
+        {
+            break;
+        }
+        memcpy((void*)ptCyclic->pu16Frm, (const void*)tDesc.pu16Cfg, sizeof(tDesc.pu16Cfg));
+        ptCyclic->u16HeadCrc = Ipb_CrcUpdate(IPB_CRC_START, (const uint8_t*)ptCyclic->pu16Frm,
+                                             (IPB_FRM_HEAD_SZ * sizeof(uint16_t)));
+
+        if (ptCyclic->u16TxSz > (uint16_t)IPB_FRM_CONFIG_SZ)
+        {
+            /** Crc only covers header and config data, it is constant */
+            ptCyclic->u16DataIdx = (uint16_t)IPB_FRAME_TOTAL_CFG_SIZE;
+            ptCyclic->u16FrmSz = (uint16_t)IPB_FRAME_TOTAL_CFG_SIZE + ptCyclic->u16TxSz;
         }
         else
         {
-            /** No blocking mode */
-            ptMsg->eStatus = ptInst->tIntf.Read(&ptInst->tIntf, &ptMsg->u16SubNode, &ptMsg->u16Addr,
-                                                &ptMsg->u16Cmd, ptMsg->pu16Data, &ptMsg->u16Size);
+            /** Values go into config data, crc is completed each cycle */
+            ptCyclic->u16DataIdx = (uint16_t)IPB_FRM_HEAD_SZ;
+            ptCyclic->u16FrmSz = (uint16_t)IPB_FRAME_TOTAL_CFG_SIZE;
         }
+
+        ptInst->ptCyclic = ptCyclic;
+        ptInst->isCyclic = true;
+        eRet = IPB_SUCCESS;
+        break;
+    }
+
+    return eRet;
+}
+
+void Ipb_CyclicStop(Ipb_TInst* ptInst)
+{
+    ptInst->isCyclic = false;
+    ptInst->ptCyclic = NULL;
+}
+
+static Ipb_EStatus Ipb_WriteStep(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg)
+{
+    Ipb_EStatus eRet;
+
+    if (ptInst->isCyclic == false)
+    {
+        eRet = ptInst->tIntf.Write(&ptInst->tIntf, &ptMsg->u16SubNode, &ptMsg->u16Addr,
+                                   &ptMsg->u16Cmd, ptMsg->pu16Data, ptMsg->u16Size);
     }
     else
     {
         /* Cyclic mode */
+        eRet = Ipb_CyclicWrite(ptInst, ptMsg);
     }
 
-    return ptMsg->eStatus;
+    return eRet;
 }
 
+static Ipb_EStatus Ipb_ReadStep(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg)
+{
+    Ipb_EStatus eRet = ptInst->tIntf.Read(&ptInst->tIntf, &ptMsg->u16SubNode, &ptMsg->u16Addr,
+                                          &ptMsg->u16Cmd, ptMsg->pu16Data, &ptMsg->u16Size);
+
+    if ((ptInst->isCyclic != false) && (eRet == IPB_SUCCESS))
+    {
+        /* Cyclic mode */
+        const Ipb_TCyclic* ptCyclic = ptInst->ptCyclic;
+        uint16_t u16Sz = (ptCyclic->u16RxSz > (uint16_t)IPB_FRM_CONFIG_SZ) ? ptCyclic->u16RxSz
+                                                                            : (uint16_t)IPB_FRM_CONFIG_SZ;
+
+        /** Feedback must hold the values of all the keys */
+        if ((ptMsg->u16SubNode != ptCyclic->u16SubNode) || (ptMsg->u16Addr != ptCyclic->u16Addr)
+            || (ptMsg->u16Size != u16Sz))
+        {
+            eRet = IPB_ERROR;
+        }
+        else
+        {
+            ptMsg->u16Size = ptCyclic->u16RxSz;
+        }
+    }
+
+    return eRet;
+}
+
+static void Ipb_WaitData(Ipb_TInst* ptInst, uint32_t u32StartUs, uint32_t u32LeftMs)
+{
+    bool isWait = (ptInst->eWait == IPB_WAIT_SLEEP);
+
+    if (ptInst->eWait == IPB_WAIT_ADAPTIVE)
+    {
+        /** Fast replies are caught spinning, slow ones do not burn the cpu */
+        isWait = ((Ipb_GetMicros() - u32StartUs) >= ptInst->u32SpinUs);
+    }
+
+    if (isWait != false)
+    {
+        /** Long timeouts are waited in slices to bound the microsecond value */
+        if (u32LeftMs > IPB_DFLT_TIMEOUT)
+        {
+            u32LeftMs = IPB_DFLT_TIMEOUT;
+        }
+        (void)Ipb_IntfWait(ptInst->tIntf.u16Id, (u32LeftMs * (uint32_t)1000UL));
+    }
+}
+
+static Ipb_EStatus Ipb_AsyncQueue(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+                                  void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx, bool isRead)
+{
+    Ipb_EStatus eRet = IPB_STANDBY;
+
+    if (ptInst->u16AsyncCnt < (uint16_t)IPB_ASYNC_MAX_NUM)
+    {
+        Ipb_TAsyncReq* ptReq = &ptInst->ptAsync[(ptInst->u16AsyncHead + ptInst->u16AsyncCnt) % IPB_ASYNC_MAX_NUM];
+
+        ptReq->ptMsg = ptMsg;
+        ptReq->OnDone = OnDone;
+        ptReq->pvCtx = pvCtx;
+        ptReq->u32Timeout = u32Timeout;
+        ptReq->u32Millis = (uint32_t)0UL;
+        ptReq->isRead = isRead;
+        ptReq->isStarted = false;
+        ptMsg->eStatus = (isRead != false) ? IPB_READ_REQUEST : IPB_WRITE_REQUEST;
+        ptInst->u16AsyncCnt++;
+        eRet = IPB_SUCCESS;
+    }
+
+    return eRet;
+}
+
+static Ipb_EStatus Ipb_CyclicWrite(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg)
+{
+    Ipb_EStatus eRet = IPB_ERROR;
+    Ipb_TCyclic* ptCyclic = ptInst->ptCyclic;
+
+    if (ptMsg->u16Size == ptCyclic->u16TxSz)
+    {
+        memcpy((void*)&ptCyclic->pu16Frm[ptCyclic->u16DataIdx], (const void*)ptMsg->pu16Data,
+               (ptCyclic->u16TxSz * sizeof(uint16_t)));
+
+        if (ptCyclic->u16DataIdx == (uint16_t)IPB_FRM_HEAD_SZ)
+        {
+            ptCyclic->pu16Frm[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ] =
+                        Ipb_CrcUpdate(ptCyclic->u16HeadCrc, (const uint8_t*)&ptCyclic->pu16Frm[IPB_FRM_HEAD_SZ],
+                                      (IPB_FRM_CONFIG_SZ * sizeof(uint16_t)));
+        }
+
+        ptMsg->u16SubNode = ptCyclic->u16SubNode;
+        ptMsg->u16Addr = ptCyclic->u16Addr;
+        ptMsg->u16Cmd = IPB_REQ_WRITE;
+        eRet = ptInst->tIntf.Send(&ptInst->tIntf, ptCyclic->pu16Frm, ptCyclic->u16FrmSz);
+    }
+
+    return eRet;
+}
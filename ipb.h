@@ -15,6 +15,11 @@
 
 #define IPB_DFLT_TIMEOUT (uint32_t)1000UL
 
+/** Default time in microseconds blocking requests spin before waiting */
+#ifndef IPB_DFLT_SPIN_US
+#define IPB_DFLT_SPIN_US (uint32_t)50UL
+#endif
+
 typedef enum
 {
     /* Blocking mode, each request block until response */
@@ -23,6 +28,63 @@ typedef enum
     IPB_NON_BLOCKING
 } Ipb_EMode;
 
+typedef enum
+{
+    /* Spin on the interface until reply or timeout */
+    IPB_WAIT_SPIN = 0,
+    /* Wait for received data between interface steps */
+    IPB_WAIT_SLEEP,
+    /* Spin for a budget, then wait for received data */
+    IPB_WAIT_ADAPTIVE
+} Ipb_EWait;
+
+/** Cyclic (process data) exchange */
+typedef struct
+{
+    /** Subnode of the cyclic frames */
+    uint16_t u16SubNode;
+    /** Address of the cyclic frames */
+    uint16_t u16Addr;
+    /** Size in words of the values sent each cycle (setpoints) */
+    uint16_t u16TxSz;
+    /** Size in words of the values received each cycle (feedbacks) */
+    uint16_t u16RxSz;
+    /** Crc of the frame header, seed of the config frame crc */
+    uint16_t u16HeadCrc;
+    /** Index of the values into the frame */
+    uint16_t u16DataIdx;
+    /** Size of the frame in words */
+    uint16_t u16FrmSz;
+    /** Frame template, only the values change each cycle */
+    uint16_t pu16Frm[IPB_FRM_MAX_DATA_SZ];
+} Ipb_TCyclic;
+
+/** Max number of asynchronous requests queued on an instance */
+#ifndef IPB_ASYNC_MAX_NUM
+#define IPB_ASYNC_MAX_NUM       8U
+#endif
+
+struct Ipb_TMsg;
+
+/** Asynchronous request */
+typedef struct
+{
+    /** Message, request to be send or loaded with reply */
+    struct Ipb_TMsg* ptMsg;
+    /** Completion callback, may be NULL */
+    void (*OnDone)(void* pvCtx, struct Ipb_TMsg* ptMsg);
+    /** User context of the callback */
+    void* pvCtx;
+    /** Max time in milliseconds from start to completion */
+    uint32_t u32Timeout;
+    /** Start time in milliseconds */
+    uint32_t u32Millis;
+    /** Request is a read if true, a write otherwise */
+    bool isRead;
+    /** Request has been started */
+    bool isStarted;
+} Ipb_TAsyncReq;
+
 /** Motion control but instance */
 typedef struct
 {
@@ -34,10 +96,22 @@ typedef struct
     Ipb_TIntf tIntf;
     /** Transmission mode */
     Ipb_EMode eMode;
+    /** Wait strategy of blocking requests */
+    Ipb_EWait eWait;
+    /** Time in microseconds blocking requests spin in adaptive strategy */
+    uint32_t u32SpinUs;
+    /** Cyclic exchange, NULL if not configured */
+    Ipb_TCyclic* ptCyclic;
+    /** Asynchronous requests, served in order */
+    Ipb_TAsyncReq ptAsync[IPB_ASYNC_MAX_NUM];
+    /** Oldest asynchronous request */
+    uint16_t u16AsyncHead;
+    /** Number of asynchronous requests */
+    uint16_t u16AsyncCnt;
 } Ipb_TInst;
 
 /** Frame data struct */
-typedef struct
+typedef struct Ipb_TMsg
 {
     /** Subnode data */
     uint16_t u16SubNode;
@@ -57,6 +131,39 @@ typedef struct
 void Ipb_Init(Ipb_TInst* ptInst, Ipb_EIntf eIntf, Ipb_EMode eMode);
 void Ipb_Deinit(Ipb_TInst* ptInst);
 
+/**
+ * Initialises an instance with its own identification, used when
+ * several instances coexist
+ *
+ * @param[out] ptInst
+ *  Specifies the target instance
+ * @param[in] eIntf
+ *  Interface type
+ * @param[in] eMode
+ *  Transmission mode
+ * @param[in] u16Id
+ *  Identification passed to the user functions (see ipb_usr.h)
+ */
+void
+Ipb_InitId(Ipb_TInst* ptInst, Ipb_EIntf eIntf, Ipb_EMode eMode, uint16_t u16Id);
+
+/**
+ * Sets how blocking requests wait for the reply
+ *
+ * @note Waits use Ipb_IntfWait, that returns at once on platforms
+ *  without a wait primitive, so any strategy behaves as spinning there.
+ *  Default is IPB_WAIT_ADAPTIVE with IPB_DFLT_SPIN_US.
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[in] eWait
+ *  Wait strategy
+ * @param[in] u32SpinUs
+ *  Time in microseconds to spin before waiting, used by IPB_WAIT_ADAPTIVE
+ */
+void
+Ipb_SetWait(Ipb_TInst* ptInst, Ipb_EWait eWait, uint32_t u32SpinUs);
+
 /**
  * Generic write function
  *
@@ -83,4 +190,144 @@ Ipb_Write(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout);
 Ipb_EStatus
 Ipb_Read(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout);
 
+/**
+ * Batch write function, requests are encoded back to back into a
+ * single buffer and sent with one transmission
+ *
+ * @note In blocking mode replies are read in order into each message,
+ *  in non blocking mode replies must be collected with Ipb_Read.
+ *  Batches bigger than IPB_INTF_SEND_MAX_SZ words are sent with several
+ *  transmissions, split at frame boundaries.
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[in/out] ptMsg
+ *  Array of requests to be send and load with replies
+ * @param[in] u16MsgCnt
+ *  Number of requests
+ * @param[in] pu16Buf
+ *  Transmission buffer
+ * @param[in] u16BufSz
+ *  Size of the transmission buffer in words
+ * @param[in] u32Timeout
+ *  Timeout duration for the whole batch
+ *
+ * @retval IPB_SUCCESS if all requests succeed, IPB_ERROR otherwise
+ */
+Ipb_EStatus
+Ipb_WriteBatch(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint16_t u16MsgCnt, uint16_t* pu16Buf,
+               uint16_t u16BufSz, uint32_t u32Timeout);
+
+/**
+ * Asynchronous write function, queues the request and returns
+ *
+ * @note Requests of an instance are served in order by Ipb_Poll, so a
+ *  transaction is an Ipb_WriteAsync followed by an Ipb_ReadAsync.
+ *  Message must remain valid until completed.
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[in/out] ptMsg
+ *  Request to be send
+ * @param[in] u32Timeout
+ *  Timeout duration, from the start of the request
+ * @param[in] OnDone
+ *  Callback called on completion with the final status in ptMsg, may
+ *  be NULL
+ * @param[in] pvCtx
+ *  User context passed to the callback
+ *
+ * @retval IPB_SUCCESS if queued, IPB_STANDBY if queue is full
+ */
+Ipb_EStatus
+Ipb_WriteAsync(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+               void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx);
+
+/**
+ * Asynchronous read function, queues the request and returns
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[in/out] ptMsg
+ *  Message to be loaded with reply
+ * @param[in] u32Timeout
+ *  Timeout duration, from the start of the request
+ * @param[in] OnDone
+ *  Callback called on completion with the final status in ptMsg, may
+ *  be NULL
+ * @param[in] pvCtx
+ *  User context passed to the callback
+ *
+ * @retval IPB_SUCCESS if queued, IPB_STANDBY if queue is full
+ */
+Ipb_EStatus
+Ipb_ReadAsync(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+              void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx);
+
+/**
+ * Drives the asynchronous requests of an instance
+ *
+ * @note Never blocks, each step is a non blocking call to the
+ *  interface. Callbacks are called from here and may queue new
+ *  requests.
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[in] u16Budget
+ *  Max number of interface steps
+ *
+ * @retval number of completed requests
+ */
+uint16_t
+Ipb_Poll(Ipb_TInst* ptInst, uint16_t u16Budget);
+
+/**
+ * Gets the number of asynchronous requests not yet completed
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ *
+ * @retval number of requests
+ */
+uint16_t
+Ipb_GetPending(const Ipb_TInst* ptInst);
+
+/**
+ * Configures and starts the cyclic mode of an instance
+ *
+ * @note Frame template and the constant part of its crc are built
+ *  once. Afterwards Ipb_Write only copies the setpoint values into the
+ *  template and sends it, Ipb_Read receives the feedback values. The
+ *  caller owns the layout of the values in pu16Data, which must match
+ *  the one configured on the drive; only their total sizes are known
+ *  here.
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[out] ptCyclic
+ *  Cyclic exchange, must remain valid while the mode is active
+ * @param[in] u16SubNode
+ *  Subnode of the cyclic frames
+ * @param[in] u16Addr
+ *  Address of the cyclic frames
+ * @param[in] u16TxSz
+ *  Size in words of the values sent each cycle
+ * @param[in] u16RxSz
+ *  Size in words of the values received each cycle
+ *
+ * @retval IPB_SUCCESS if success, IPB_ERROR if values do not fit a frame
+ */
+Ipb_EStatus
+Ipb_CyclicStart(Ipb_TInst* ptInst, Ipb_TCyclic* ptCyclic, uint16_t u16SubNode, uint16_t u16Addr,
+                uint16_t u16TxSz, uint16_t u16RxSz);
+
+/**
+ * Stops the cyclic mode of an instance
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ */
+void
+Ipb_CyclicStop(Ipb_TInst* ptInst);
+
 #endif /* IPB_H */
@@ -0,0 +1,792 @@
+/**
+ * @file ipb_co.hpp
+ * @brief This file contains the C++20 coroutine front end of the
+ *        ingenia protocol bus (IPB)
+ *
+ * @note Transactions are awaited from ipb::Task coroutines:
+ *
+ *  ipb::Task Configure(ipb::Bus& tBus)
+ *  {
+ *      auto tMode = tBus.read(1U, 0x11U);
+ *      if (co_await tMode == IPB_SUCCESS) { ... tMode.data()[0] ... }
+ *      auto tA = tBus.write(1U, 0x20U, pu16Val, 1U);
+ *      auto tB = tOther.write(1U, 0x20U, pu16Val, 1U);
+ *      co_await ipb::all(tA, tB);
+ *  }
+ *
+ *  Coroutines resume from Bus::poll, called by the application loop.
+ *  Frames are taken from a fixed block pool, operations live inside the
+ *  frame, so nothing is allocated from the heap. A bus and its coroutines
+ *  run on the thread calling poll, the frame pool is shared by every
+ *  thread.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_CO_HPP
+#define IPB_CO_HPP
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <span>
+#include <type_traits>
+
+extern "C"
+{
+#include "ipb.h"
+}
+
+/** Size in bytes of each coroutine frame block */
+#ifndef IPB_CO_FRAME_SZ
+#define IPB_CO_FRAME_SZ         8192U
+#endif
+
+/** Number of coroutine frame blocks */
+#ifndef IPB_CO_FRAME_NUM
+#define IPB_CO_FRAME_NUM        64U
+#endif
+
+namespace ipb
+{
+
+class Bus;
+
+class Op;
+
+/** Coroutine waiting for a set of operations */
+struct Join
+{
+    /** Number of operations not yet completed */
+    std::size_t szPend;
+    /** Coroutine resumed when all are completed */
+    std::coroutine_handle<> tHandle;
+    /** Operations waited for */
+    std::span<Op* const> tOps;
+    /** Slot of the waiting ipb::Task pointing to this join, nullptr if none */
+    Join** pptSlot;
+};
+
+/**
+ * Fixed block pool of coroutine frames, lock free so tasks may be created
+ * and destroyed from any thread. Free blocks are linked by index, the head
+ * carries a tag bumped on each change to tell apart a head popped and
+ * pushed back in between (ABA).
+ */
+class FramePool
+{
+public:
+    FramePool() noexcept
+    {
+        for (uint32_t u32Idx = 0U; u32Idx < IPB_CO_FRAME_NUM; ++u32Idx)
+        {
+            pu32Next[u32Idx].store(u32Idx + 2U, std::memory_order_relaxed);
+        }
+        pu32Next[IPB_CO_FRAME_NUM - 1U].store(0U, std::memory_order_relaxed);
+        u64Head.store(1U, std::memory_order_release);
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * Borrows a block
+     *
+     * @param[in] szSize
+     *  Size in bytes of the frame
+     *
+     * @retval pointer to block if success, nullptr if the frame does not
+     *  fit or the pool is exhausted
+     *
+     * @note Not inlined, GCC would otherwise warn about deleting a static
+     *  object when frames are returned to the pool
+     */
+    [[gnu::noinline]] void* alloc(std::size_t szSize) noexcept
+    {
+        void* pvBlk = nullptr;
+        uint64_t u64Old = u64Head.load(std::memory_order_acquire);
+
+        while ((szSize <= sizeof(TBlock)) && (static_cast<uint32_t>(u64Old) != 0U))
+        {
+            uint32_t u32Idx = static_cast<uint32_t>(u64Old) - 1U;
+            uint64_t u64New = (((u64Old >> 32U) + 1U) << 32U) | pu32Next[u32Idx].load(std::memory_order_relaxed);
+
+            if (u64Head.compare_exchange_weak(u64Old, u64New, std::memory_order_acquire,
+                                              std::memory_order_acquire) != false)
+            {
+                pvBlk = static_cast<void*>(&ptBlk[u32Idx]);
+                break;
+            }
+        }
+
+        return pvBlk;
+    }
+
+    /**
+     * Returns a block
+     *
+     * @param[in] pvBlk
+     *  Block borrowed with alloc
+     */
+    void free(void* pvBlk) noexcept
+    {
+        uint32_t u32Idx = static_cast<uint32_t>(static_cast<TBlock*>(pvBlk) - ptBlk);
+        uint64_t u64Old = u64Head.load(std::memory_order_relaxed);
+        uint64_t u64New;
+
+        do
+        {
+            pu32Next[u32Idx].store(static_cast<uint32_t>(u64Old), std::memory_order_relaxed);
+            u64New = (((u64Old >> 32U) + 1U) << 32U) | (u32Idx + 1U);
+        } while (u64Head.compare_exchange_weak(u64Old, u64New, std::memory_order_release,
+                                               std::memory_order_relaxed) == false);
+    }
+
+    /** Pool shared by every ipb::Task */
+    static FramePool& instance() noexcept
+    {
+        static FramePool tPool;
+
+        return tPool;
+    }
+
+private:
+    /** Frame block */
+    struct TBlock
+    {
+        alignas(std::max_align_t) unsigned char pu8Buf[IPB_CO_FRAME_SZ];
+    };
+
+    /** Blocks storage */
+    TBlock ptBlk[IPB_CO_FRAME_NUM];
+    /** Index plus one of the next free block of each block, 0 ends the list */
+    std::atomic<uint32_t> pu32Next[IPB_CO_FRAME_NUM];
+    /** Tag in the upper half, index plus one of the first free block in the lower one */
+    std::atomic<uint64_t> u64Head;
+};
+
+/** Coroutine returning nothing, starts running when called */
+class Task
+{
+public:
+    struct promise_type
+    {
+        /** Coroutine awaiting this one, resumed on completion */
+        std::coroutine_handle<> tCont;
+        /** Operations being awaited, cancelled if the task is destroyed */
+        Join* ptWait = nullptr;
+
+        static void* operator new(std::size_t szSize) noexcept
+        {
+            return FramePool::instance().alloc(szSize);
+        }
+
+        static void operator delete(void* pvBlk) noexcept
+        {
+            FramePool::instance().free(pvBlk);
+        }
+
+        /** Frame pool exhausted, the returned task is not valid */
+        static Task get_return_object_on_allocation_failure() noexcept
+        {
+            return Task(nullptr);
+        }
+
+        Task get_return_object() noexcept
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct TFinal
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> tSelf) noexcept
+                {
+                    std::coroutine_handle<> tCont = tSelf.promise().tCont;
+
+                    return (tCont) ? tCont : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            return TFinal {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+
+    Task(Task&& tOther) noexcept : tHandle(tOther.tHandle)
+    {
+        tOther.tHandle = nullptr;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+
+    /** Frame is released, operations still awaited are cancelled first */
+    ~Task();
+
+    /** Indicates if the frame could be allocated */
+    bool valid() const noexcept
+    {
+        return static_cast<bool>(tHandle);
+    }
+
+    /** Indicates if the coroutine has finished */
+    bool done() const noexcept
+    {
+        return (!tHandle || tHandle.done());
+    }
+
+    /** A coroutine awaiting a task resumes when it finishes */
+    auto operator co_await() const noexcept
+    {
+        struct TAwait
+        {
+            std::coroutine_handle<promise_type> tHandle;
+
+            bool await_ready() const noexcept
+            {
+                return (!tHandle || tHandle.done());
+            }
+
+            void await_suspend(std::coroutine_handle<> tCaller) const noexcept
+            {
+                tHandle.promise().tCont = tCaller;
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+
+        return TAwait { tHandle };
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> tNew) noexcept : tHandle(tNew)
+    {
+    }
+
+    std::coroutine_handle<promise_type> tHandle;
+};
+
+/** Lets a waiting ipb::Task know its join, so it can be cancelled */
+template <class TPromise>
+void track(std::coroutine_handle<TPromise> tCaller, Join& tJoin) noexcept
+{
+    tJoin.pptSlot = nullptr;
+    if constexpr (std::is_same_v<TPromise, Task::promise_type>)
+    {
+        tCaller.promise().ptWait = &tJoin;
+        tJoin.pptSlot = &tCaller.promise().ptWait;
+    }
+}
+
+/** Counterpart of track once the waiting coroutine resumes */
+inline void untrack(const Join& tJoin) noexcept
+{
+    if (tJoin.pptSlot != nullptr)
+    {
+        *tJoin.pptSlot = nullptr;
+    }
+}
+
+/**
+ * Register transaction of a bus: request written and reply read, the way
+ * Ipb_Write followed by Ipb_Read does. Created by Bus::read and Bus::write,
+ * it must stay in place until completed.
+ */
+class Op
+{
+public:
+    Op(const Op&) = delete;
+    Op& operator=(const Op&) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template <class TPromise>
+    void await_suspend(std::coroutine_handle<TPromise> tCaller) noexcept
+    {
+        tJoin.szPend = 1U;
+        tJoin.tHandle = tCaller;
+        tJoin.tOps = std::span<Op* const>(&ptSelf, 1U);
+        track(tCaller, tJoin);
+        start(&tJoin);
+    }
+
+    /** Final status, IPB_SUCCESS or IPB_ERROR */
+    Ipb_EStatus await_resume() const noexcept
+    {
+        untrack(tJoin);
+        return tMsg.eStatus;
+    }
+
+    /** Final status, IPB_SUCCESS or IPB_ERROR */
+    Ipb_EStatus status() const noexcept
+    {
+        return tMsg.eStatus;
+    }
+
+    /** Reply data */
+    const uint16_t* data() const noexcept
+    {
+        return tMsg.pu16Data;
+    }
+
+    /** Reply data size in words */
+    uint16_t size() const noexcept
+    {
+        return tMsg.u16Size;
+    }
+
+    /** Reply message */
+    const Ipb_TMsg& msg() const noexcept
+    {
+        return tMsg;
+    }
+
+    /** Queues the transaction on its bus, completion decrements ptJoin */
+    void start(Join* ptNewJoin) noexcept;
+
+private:
+    friend class Bus;
+    friend class Task;
+
+    /** Drops the transaction from its bus, its coroutine is being destroyed */
+    void cancel() noexcept;
+
+    Op(Bus& tNewBus, uint16_t u16SubNode, uint16_t u16Addr, uint16_t u16Cmd, const uint16_t* pu16Data,
+       uint16_t u16Size) noexcept : tBus(tNewBus)
+    {
+        tMsg.u16SubNode = u16SubNode;
+        tMsg.u16Addr = u16Addr;
+        tMsg.u16Cmd = u16Cmd;
+        tMsg.u16Size = 0U;
+        tMsg.eStatus = IPB_STANDBY;
+        if (u16Size > static_cast<uint16_t>(IPB_MAX_DATA_SZ))
+        {
+            /** Does not fit a frame, completed with IPB_ERROR when started */
+            isRejected = true;
+        }
+        else
+        {
+            tMsg.u16Size = u16Size;
+            for (uint16_t u16Idx = 0U; u16Idx < u16Size; ++u16Idx)
+            {
+                tMsg.pu16Data[u16Idx] = pu16Data[u16Idx];
+            }
+        }
+    }
+
+    /** Bus of the transaction */
+    Bus& tBus;
+    /** Request, loaded with the reply */
+    Ipb_TMsg tMsg;
+    /** Coroutine waiting for the transaction */
+    Join* ptJoin = nullptr;
+    /** Own join when awaited alone */
+    Join tJoin {};
+    /** Operation set of tJoin */
+    Op* const ptSelf = this;
+    /** Next transaction of the bus queue */
+    Op* ptNext = nullptr;
+    /** Request data does not fit a frame */
+    bool isRejected = false;
+};
+
+/**
+ * Coroutine front end of an instance, one transaction on the wire at a
+ * time, further ones wait in order
+ */
+class Bus
+{
+public:
+    /**
+     * @param[in] tNewInst
+     *  Instance, its requests must only be issued through this bus
+     * @param[in] u32NewTimeout
+     *  Timeout duration of each write and read of a transaction
+     */
+    explicit Bus(Ipb_TInst& tNewInst, uint32_t u32NewTimeout = IPB_DFLT_TIMEOUT) noexcept
+        : tInst(tNewInst), u32Timeout(u32NewTimeout)
+    {
+    }
+
+    Bus(const Bus&) = delete;
+    Bus& operator=(const Bus&) = delete;
+
+    /** Register read transaction */
+    Op read(uint16_t u16SubNode, uint16_t u16Addr) noexcept
+    {
+        return Op(*this, u16SubNode, u16Addr, static_cast<uint16_t>(IPB_REQ_READ), nullptr, 0U);
+    }
+
+    /** Register write transaction, data is copied, bigger than IPB_MAX_DATA_SZ completes with IPB_ERROR */
+    Op write(uint16_t u16SubNode, uint16_t u16Addr, const uint16_t* pu16Data, uint16_t u16Size) noexcept
+    {
+        return Op(*this, u16SubNode, u16Addr, static_cast<uint16_t>(IPB_REQ_WRITE), pu16Data, u16Size);
+    }
+
+    /**
+     * Drives the instance and resumes the coroutines whose transactions
+     * completed
+     *
+     * @param[in] u16Budget
+     *  Max number of interface steps
+     *
+     * @retval number of completed transactions
+     */
+    uint16_t poll(uint16_t u16Budget = 8U) noexcept
+    {
+        uint16_t u16Done = 0U;
+
+        (void)Ipb_Poll(&tInst, u16Budget);
+
+        /** Resumed outside Ipb_Poll, coroutines may start new transactions */
+        while (ptDoneHead != nullptr)
+        {
+            Op* ptOp = ptDoneHead;
+
+            ptDoneHead = ptOp->ptNext;
+            if (ptDoneHead == nullptr)
+            {
+                ptDoneTail = nullptr;
+            }
+            ++u16Done;
+
+            if (--ptOp->ptJoin->szPend == 0U)
+            {
+                ptOp->ptJoin->tHandle.resume();
+            }
+        }
+
+        return u16Done;
+    }
+
+    /** Indicates if there is no transaction in progress */
+    bool idle() const noexcept
+    {
+        return ((isWire == false) && (ptDoneHead == nullptr));
+    }
+
+private:
+    friend class Op;
+
+    /** Queues a transaction, started right away if the bus is free */
+    void start(Op* ptOp) noexcept
+    {
+        ptOp->ptNext = nullptr;
+        if (isWire == false)
+        {
+            issue(ptOp);
+        }
+        else if (ptWaitTail == nullptr)
+        {
+            ptWaitHead = ptOp;
+            ptWaitTail = ptOp;
+        }
+        else
+        {
+            ptWaitTail->ptNext = ptOp;
+            ptWaitTail = ptOp;
+        }
+    }
+
+    /** Puts a transaction on the wire, completed at once if rejected or not queued */
+    void issue(Op* ptOp) noexcept
+    {
+        ptCur = ptOp;
+        isWire = true;
+        copy(tWire, ptOp->tMsg);
+        if ((ptOp->isRejected != false)
+            || (Ipb_WriteAsync(&tInst, &tWire, u32Timeout, OnWrite, static_cast<void*>(this)) != IPB_SUCCESS))
+        {
+            tWire.eStatus = IPB_ERROR;
+            finish();
+        }
+    }
+
+    /** Completes the current transaction, unless cancelled, and starts the next one */
+    void finish() noexcept
+    {
+        Op* ptOp = ptCur;
+
+        if (ptOp != nullptr)
+        {
+            copy(ptOp->tMsg, tWire);
+            ptOp->ptNext = nullptr;
+            if (ptDoneTail == nullptr)
+            {
+                ptDoneHead = ptOp;
+            }
+            else
+            {
+                ptDoneTail->ptNext = ptOp;
+            }
+            ptDoneTail = ptOp;
+        }
+
+        ptCur = nullptr;
+        isWire = false;
+        if (ptWaitHead != nullptr)
+        {
+            Op* ptNextOp = ptWaitHead;
+
+            ptWaitHead = ptNextOp->ptNext;
+            if (ptWaitHead == nullptr)
+            {
+                ptWaitTail = nullptr;
+            }
+            issue(ptNextOp);
+        }
+    }
+
+    /**
+     * Drops a transaction, one on the wire still runs to completion but
+     * its reply is discarded
+     */
+    void cancel(Op* ptOp) noexcept
+    {
+        if (ptOp == ptCur)
+        {
+            ptCur = nullptr;
+        }
+        else if (unlink(ptWaitHead, ptWaitTail, ptOp) == false)
+        {
+            (void)unlink(ptDoneHead, ptDoneTail, ptOp);
+        }
+    }
+
+    /** Removes a transaction from a queue, false if not there */
+    static bool unlink(Op*& ptHead, Op*& ptTail, Op* ptOp) noexcept
+    {
+        bool isFound = false;
+        Op* ptPrev = nullptr;
+
+        for (Op* ptIt = ptHead; ptIt != nullptr; ptIt = ptIt->ptNext)
+        {
+            if (ptIt == ptOp)
+            {
+                if (ptPrev == nullptr)
+                {
+                    ptHead = ptOp->ptNext;
+                }
+                else
+                {
+                    ptPrev->ptNext = ptOp->ptNext;
+                }
+                if (ptTail == ptOp)
+                {
+                    ptTail = ptPrev;
+                }
+                isFound = true;
+                break;
+            }
+            ptPrev = ptIt;
+        }
+
+        return isFound;
+    }
+
+    /** Copies a message, data up to its size */
+    static void copy(Ipb_TMsg& tDst, const Ipb_TMsg& tSrc) noexcept
+    {
+        uint16_t u16Size = (tSrc.u16Size < static_cast<uint16_t>(IPB_MAX_DATA_SZ))
+                               ? tSrc.u16Size : static_cast<uint16_t>(IPB_MAX_DATA_SZ);
+
+        tDst.u16SubNode = tSrc.u16SubNode;
+        tDst.u16Addr = tSrc.u16Addr;
+        tDst.u16Cmd = tSrc.u16Cmd;
+        tDst.u16Size = u16Size;
+        tDst.eStatus = tSrc.eStatus;
+        for (uint16_t u16Idx = 0U; u16Idx < u16Size; ++u16Idx)
+        {
+            tDst.pu16Data[u16Idx] = tSrc.pu16Data[u16Idx];
+        }
+    }
+
+    static void OnWrite(void* pvCtx, Ipb_TMsg* ptMsg)
+    {
+        Bus* ptBus = static_cast<Bus*>(pvCtx);
+
+        if ((ptMsg->eStatus != IPB_SUCCESS)
+            || (Ipb_ReadAsync(&ptBus->tInst, ptMsg, ptBus->u32Timeout, OnRead, pvCtx) != IPB_SUCCESS))
+        {
+            ptMsg->eStatus = IPB_ERROR;
+            ptBus->finish();
+        }
+    }
+
+    static void OnRead(void* pvCtx, Ipb_TMsg*)
+    {
+        static_cast<Bus*>(pvCtx)->finish();
+    }
+
+    /** Instance */
+    Ipb_TInst& tInst;
+    /** Timeout duration of each write and read */
+    uint32_t u32Timeout;
+    /**
+     * Message on the wire, the instance never points into a coroutine frame
+     * that may be destroyed before the reply arrives
+     */
+    Ipb_TMsg tWire;
+    /** Transaction on the wire, nullptr if cancelled or none */
+    Op* ptCur = nullptr;
+    /** A transaction is on the wire */
+    bool isWire = false;
+    /** Transactions waiting for the bus */
+    Op* ptWaitHead = nullptr;
+    Op* ptWaitTail = nullptr;
+    /** Completed transactions not yet resumed */
+    Op* ptDoneHead = nullptr;
+    Op* ptDoneTail = nullptr;
+};
+
+inline void Op::start(Join* ptNewJoin) noexcept
+{
+    ptJoin = ptNewJoin;
+    tMsg.eStatus = IPB_STANDBY;
+    tBus.start(this);
+}
+
+inline void Op::cancel() noexcept
+{
+    tBus.cancel(this);
+}
+
+inline Task::~Task()
+{
+    if (tHandle)
+    {
+        Join* ptWait = tHandle.promise().ptWait;
+
+        if (ptWait != nullptr)
+        {
+            for (Op* ptOp : ptWait->tOps)
+            {
+                ptOp->cancel();
+            }
+        }
+        tHandle.destroy();
+    }
+}
+
+/** Awaits a set of transactions, possibly of different buses */
+class All
+{
+public:
+    explicit All(std::span<Op* const> tNewOps) noexcept : tOps(tNewOps)
+    {
+    }
+
+    All(const All&) = delete;
+    All& operator=(const All&) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return tOps.empty();
+    }
+
+    template <class TPromise>
+    void await_suspend(std::coroutine_handle<TPromise> tCaller) noexcept
+    {
+        tJoin.szPend = tOps.size();
+        tJoin.tHandle = tCaller;
+        tJoin.tOps = tOps;
+        track(tCaller, tJoin);
+        for (Op* ptOp : tOps)
+        {
+            ptOp->start(&tJoin);
+        }
+    }
+
+    /** Indicates if every transaction succeeded */
+    bool await_resume() const noexcept
+    {
+        bool isOk = true;
+
+        untrack(tJoin);
+        for (const Op* ptOp : tOps)
+        {
+            isOk = isOk && (ptOp->status() == IPB_SUCCESS);
+        }
+
+        return isOk;
+    }
+
+private:
+    /** Transactions */
+    std::span<Op* const> tOps;
+    /** Coroutine waiting for them */
+    Join tJoin {};
+};
+
+/** Storage of the transactions of a fixed size set */
+template <std::size_t N>
+struct AllOfOps
+{
+    Op* ptOps[N];
+};
+
+/** Awaits a fixed size set of transactions */
+template <std::size_t N>
+class AllOf : private AllOfOps<N>, public All
+{
+public:
+    /** Storage is a base, so it is initialised before All takes it */
+    template <class... TOps>
+    explicit AllOf(TOps&... tNewOps) noexcept
+        : AllOfOps<N> { { &tNewOps... } }, All(std::span<Op* const>(this->ptOps))
+    {
+    }
+
+    AllOf(const AllOf&) = delete;
+    AllOf& operator=(const AllOf&) = delete;
+};
+
+/** Awaits the given transactions, e.g. co_await ipb::all(tA, tB, tC) */
+template <class... TOps>
+AllOf<sizeof...(TOps)> all(TOps&... tOps) noexcept
+{
+    return AllOf<sizeof...(TOps)>(tOps...);
+}
+
+/** Awaits a range of transactions, e.g. hundreds of them across buses */
+inline All all(std::span<Op* const> tOps) noexcept
+{
+    return All(tOps);
+}
+
+} /* namespace ipb */
+
+#endif /* IPB_CO_HPP */
@@ -0,0 +1,54 @@
+/**
+ * @file ipb_crc.h
+ * @brief This file contains the CRC engine used by the
+ *        ingenia protocol bus (IPB) frames
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_CRC_H
+#define IPB_CRC_H
+
+#include <stdint.h>
+
+/** Initial value of the frame CRC (CRC-CCITT XMODEM) */
+#define IPB_CRC_START           (uint16_t)0x0000U
+
+/**
+ * Uses eight lookup tables (4 KiB of constant data) to process eight bytes
+ * per iteration. Set to 0 on memory constrained targets to keep a single
+ * 512 bytes table.
+ */
+#ifndef IPB_CRC_SLICE_BY_8
+#define IPB_CRC_SLICE_BY_8      1
+#endif
+
+/**
+ * Selects the fastest CRC implementation for the running CPU.
+ *
+ * @note Carry-less multiply folding (PCLMULQDQ on x86-64, PMULL on
+ *  AArch64) is used for large buffers when available, lookup tables
+ *  otherwise. The first update makes the selection if not done before,
+ *  calling it once at start up keeps the cpu detection out of the
+ *  first frame. It may be called from any thread.
+ */
+void
+Ipb_CrcInit(void);
+
+/**
+ * Updates a CRC-CCITT (XMODEM) value with a block of bytes.
+ *
+ * @param[in] u16Crc
+ *  Current CRC value, IPB_CRC_START for a new calculation
+ * @param[in] pu8Buf
+ *  Pointer to the data
+ * @param[in] u16SzBy
+ *  Size of the data in bytes
+ *
+ * @retval updated CRC value
+ */
+uint16_t
+Ipb_CrcUpdate(uint16_t u16Crc, const uint8_t* pu8Buf, uint16_t u16SzBy);
+
+#endif /* IPB_CRC_H */
@@ -0,0 +1,733 @@
+/**
+ * @file ipb_fleet.c
+ * @brief This file contains a fleet of simulated ingenia protocol bus
+ *        (IPB) drives reachable over UDP and pty links on Linux hosts
+ *
+ * @note All the drives of a fleet are served from one epoll loop. UDP
+ *  requests are timestamped by the kernel on arrival, so response times
+ *  include the time requests wait for the loop, which is where a fleet
+ *  saturates first. Replies held for the drive latency are sent when a
+ *  timer expires, each drive serving one request at a time.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_fleet.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <termios.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <arpa/inet.h>
+
+/**
+ * Adds a drive link to the epoll set of its fleet
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+static int32_t
+Ipb_FleetAttach(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode);
+
+/**
+ * Initialises the fields shared by all link kinds
+ */
+static void
+Ipb_FleetNodeInit(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode, Ipb_EFleetLink eLink);
+
+/**
+ * Reads the requests received by a drive
+ *
+ * @param[in] ptNode
+ *  Drive instance
+ * @param[in] u64NowNs
+ *  Time in nanoseconds the loop woke up
+ */
+static void
+Ipb_FleetReceive(Ipb_TFleetNode* ptNode, uint64_t u64NowNs);
+
+/**
+ * Answers a request parsed by a drive
+ */
+static void
+Ipb_FleetServe(void* pvCtx, const Ipb_TFrame* ptFrame);
+
+/**
+ * Transmits the reply of a drive and accounts its response time
+ */
+static void
+Ipb_FleetSend(Ipb_TFleetNode* ptNode);
+
+/**
+ * Writes a whole reply into a pty link, waiting for room if needed
+ *
+ * @retval true if the whole reply was written
+ */
+static bool
+Ipb_FleetWrite(int32_t i32Fd, const uint8_t* pu8Buf, size_t szBy);
+
+/**
+ * Transmits the pending replies already due and arms the timer for the
+ * next one
+ *
+ * @retval number of transmitted replies
+ */
+static uint16_t
+Ipb_FleetFlush(Ipb_TFleet* ptFleet);
+
+/**
+ * Gets the time in nanoseconds, CLOCK_REALTIME as kernel timestamps
+ */
+static uint64_t
+Ipb_FleetNowNs(void);
+
+int32_t Ipb_FleetInit(Ipb_TFleet* ptFleet, uint32_t u32LatencyUs)
+{
+    int32_t i32Ret = 0L;
+    struct epoll_event tEv;
+
+    ptFleet->u32LatencyUs = u32LatencyUs;
+    ptFleet->u16NodeCnt = (uint16_t)0U;
+    ptFleet->u16PendHead = (uint16_t)0U;
+    ptFleet->u16PendCnt = (uint16_t)0U;
+    ptFleet->i32Timer = -1L;
+
+    while (1)
+    {
+        ptFleet->i32Ep = epoll_create1(EPOLL_CLOEXEC);
+        if (ptFleet->i32Ep < 0L)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        ptFleet->i32Timer = timerfd_create(CLOCK_REALTIME, (TFD_NONBLOCK | TFD_CLOEXEC));
+        if (ptFleet->i32Timer < 0L)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        /** Timer events carry no drive */
+        memset((void*)&tEv, 0, sizeof(tEv));
+        tEv.events = EPOLLIN;
+        tEv.data.ptr = NULL;
+        if (epoll_ctl(ptFleet->i32Ep, EPOLL_CTL_ADD, ptFleet->i32Timer, &tEv) != 0)
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        break;
+    }
+
+    if (i32Ret != 0L)
+    {
+        Ipb_FleetDeinit(ptFleet);
+    }
+
+    return i32Ret;
+}
+
+void Ipb_FleetDeinit(Ipb_TFleet* ptFleet)
+{
+    for (uint16_t u16Idx = 0U; u16Idx < ptFleet->u16NodeCnt; ++u16Idx)
+    {
+        Ipb_TFleetNode* ptNode = ptFleet->ptNode[u16Idx];
+
+        if (ptNode->i32Fd >= 0L)
+        {
+            (void)close(ptNode->i32Fd);
+            ptNode->i32Fd = -1L;
+        }
+        if (ptNode->i32PtyFd >= 0L)
+        {
+            (void)close(ptNode->i32PtyFd);
+            ptNode->i32PtyFd = -1L;
+        }
+    }
+    ptFleet->u16NodeCnt = (uint16_t)0U;
+    ptFleet->u16PendCnt = (uint16_t)0U;
+
+    if (ptFleet->i32Timer >= 0L)
+    {
+        (void)close(ptFleet->i32Timer);
+        ptFleet->i32Timer = -1L;
+    }
+    if (ptFleet->i32Ep >= 0L)
+    {
+        (void)close(ptFleet->i32Ep);
+        ptFleet->i32Ep = -1L;
+    }
+}
+
+int32_t Ipb_FleetAddUdp(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode, const char* szAddr, uint16_t u16Port)
+{
+    int32_t i32Ret = 0L;
+    struct sockaddr_in tAddr;
+    socklen_t tAddrSz = sizeof(tAddr);
+    int iOn = 1;
+
+    Ipb_FleetNodeInit(ptFleet, ptNode, IPB_FLEET_UDP);
+
+    while (1)
+    {
+        if (ptFleet->u16NodeCnt == IPB_FLEET_MAX_NODE)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        memset((void*)&tAddr, 0, sizeof(tAddr));
+        tAddr.sin_family = AF_INET;
+        tAddr.sin_port = htons(u16Port);
+        if (inet_pton(AF_INET, szAddr, &tAddr.sin_addr) != 1)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        ptNode->i32Fd = socket(AF_INET, (SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC), 0);
+        if (ptNode->i32Fd < 0L)
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        /** Arrival time of each request, taken by the kernel */
+        (void)setsockopt(ptNode->i32Fd, SOL_SOCKET, SO_TIMESTAMPNS, &iOn, sizeof(iOn));
+
+        if ((bind(ptNode->i32Fd, (const struct sockaddr*)&tAddr, sizeof(tAddr)) != 0)
+            || (getsockname(ptNode->i32Fd, (struct sockaddr*)&tAddr, &tAddrSz) != 0))
+        {
+            i32Ret = -4L;
+            break;
+        }
+        ptNode->u16Port = ntohs(tAddr.sin_port);
+
+        if (Ipb_FleetAttach(ptFleet, ptNode) != 0L)
+        {
+            i32Ret = -5L;
+            break;
+        }
+
+        break;
+    }
+
+    if ((i32Ret != 0L) && (ptNode->i32Fd >= 0L))
+    {
+        (void)close(ptNode->i32Fd);
+        ptNode->i32Fd = -1L;
+    }
+
+    return i32Ret;
+}
+
+int32_t Ipb_FleetAddPty(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode)
+{
+    int32_t i32Ret = 0L;
+    struct termios tTio;
+
+    Ipb_FleetNodeInit(ptFleet, ptNode, IPB_FLEET_PTY);
+
+    while (1)
+    {
+        if (ptFleet->u16NodeCnt == IPB_FLEET_MAX_NODE)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        ptNode->i32Fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (ptNode->i32Fd < 0L)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        if ((grantpt(ptNode->i32Fd) != 0) || (unlockpt(ptNode->i32Fd) != 0)
+            || (ptsname_r(ptNode->i32Fd, ptNode->szPty, sizeof(ptNode->szPty)) != 0))
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        /** Raw from the start, the line discipline would echo requests back */
+        ptNode->i32PtyFd = open(ptNode->szPty, (O_RDWR | O_NOCTTY | O_CLOEXEC));
+        if ((ptNode->i32PtyFd < 0L) || (tcgetattr(ptNode->i32PtyFd, &tTio) != 0))
+        {
+            i32Ret = -4L;
+            break;
+        }
+        cfmakeraw(&tTio);
+        if (tcsetattr(ptNode->i32PtyFd, TCSANOW, &tTio) != 0)
+        {
+            i32Ret = -5L;
+            break;
+        }
+
+        if (Ipb_FleetAttach(ptFleet, ptNode) != 0L)
+        {
+            i32Ret = -6L;
+            break;
+        }
+
+        break;
+    }
+
+    if (i32Ret != 0L)
+    {
+        if (ptNode->i32PtyFd >= 0L)
+        {
+            (void)close(ptNode->i32PtyFd);
+            ptNode->i32PtyFd = -1L;
+        }
+        if (ptNode->i32Fd >= 0L)
+        {
+            (void)close(ptNode->i32Fd);
+            ptNode->i32Fd = -1L;
+        }
+    }
+
+    return i32Ret;
+}
+
+bool Ipb_FleetSetDict(Ipb_TFleetNode* ptNode, uint16_t u16SubNode, TIpbDictInst* ptDict)
+{
+    bool isSet = false;
+
+    if (u16SubNode < IPB_SIM_NODE_NUM)
+    {
+        ptNode->ptDict[u16SubNode] = ptDict;
+        isSet = true;
+    }
+
+    return isSet;
+}
+
+int32_t Ipb_FleetRun(Ipb_TFleet* ptFleet, uint32_t u32TimeoutMs)
+{
+    int32_t i32Ret = 0L;
+    struct epoll_event ptEv[IPB_FLEET_EVENTS];
+    uint32_t u32Before = (uint32_t)0UL;
+    int iEvCnt;
+
+    for (uint16_t u16Idx = 0U; u16Idx < ptFleet->u16NodeCnt; ++u16Idx)
+    {
+        u32Before += ptFleet->ptNode[u16Idx]->tStats.u32Requests;
+    }
+
+    iEvCnt = epoll_wait(ptFleet->i32Ep, ptEv, (int)IPB_FLEET_EVENTS, (int)u32TimeoutMs);
+    if (iEvCnt < 0)
+    {
+        i32Ret = (errno == EINTR) ? 0L : -1L;
+    }
+    else
+    {
+        uint64_t u64NowNs = Ipb_FleetNowNs();
+
+        for (int iIdx = 0; iIdx < iEvCnt; ++iIdx)
+        {
+            if (ptEv[iIdx].data.ptr == NULL)
+            {
+                uint64_t u64Expired;
+
+                (void)!read(ptFleet->i32Timer, &u64Expired, sizeof(u64Expired));
+            }
+            else
+            {
+                Ipb_FleetReceive((Ipb_TFleetNode*)ptEv[iIdx].data.ptr, u64NowNs);
+            }
+        }
+
+        (void)Ipb_FleetFlush(ptFleet);
+
+        for (uint16_t u16Idx = 0U; u16Idx < ptFleet->u16NodeCnt; ++u16Idx)
+        {
+            i32Ret += (int32_t)ptFleet->ptNode[u16Idx]->tStats.u32Requests;
+        }
+        i32Ret -= (int32_t)u32Before;
+    }
+
+    return i32Ret;
+}
+
+uint32_t Ipb_FleetPercentile(const Ipb_TFleetStats* ptStats, uint16_t u16Pct)
+{
+    uint32_t u32Us = (uint32_t)0UL;
+    uint64_t u64Target = (((uint64_t)ptStats->u32Requests * u16Pct) + 99ULL) / 100ULL;
+    uint64_t u64Cnt = (uint64_t)0ULL;
+
+    if (u64Target > (uint64_t)0ULL)
+    {
+        for (uint16_t u16Bkt = 0U; u16Bkt < IPB_FLEET_HIST_NUM; ++u16Bkt)
+        {
+            u64Cnt += ptStats->pu32Hist[u16Bkt];
+            if (u64Cnt >= u64Target)
+            {
+                u32Us = (uint32_t)1UL << u16Bkt;
+                break;
+            }
+        }
+
+        if ((u32Us == (uint32_t)0UL) || (u32Us > ptStats->u32MaxUs))
+        {
+            u32Us = ptStats->u32MaxUs;
+        }
+    }
+
+    return u32Us;
+}
+
+void Ipb_FleetResetStats(Ipb_TFleet* ptFleet)
+{
+    for (uint16_t u16Idx = 0U; u16Idx < ptFleet->u16NodeCnt; ++u16Idx)
+    {
+        memset((void*)&ptFleet->ptNode[u16Idx]->tStats, 0, sizeof(Ipb_TFleetStats));
+        ptFleet->ptNode[u16Idx]->tParser.u32CrcErr = (uint32_t)0UL;
+    }
+}
+
+void Ipb_FleetReport(Ipb_TFleet* ptFleet, FILE* ptFile, uint32_t u32ElapsedMs)
+{
+    Ipb_TFleetStats tAll;
+    uint32_t u32CrcErr = (uint32_t)0UL;
+    double dSec = (double)((u32ElapsedMs != (uint32_t)0UL) ? u32ElapsedMs : 1UL) / 1000.0;
+
+    memset((void*)&tAll, 0, sizeof(tAll));
+
+    (void)fprintf(ptFile, "%5s %4s %-16s %10s %9s %8s %8s %8s %8s %6s %6s %6s\n", "drive", "link", "address",
+                  "requests", "req/s", "mean us", "p50 us", "p99 us", "max us", "busy", "crc", "tx err");
+
+    for (uint16_t u16Idx = 0U; u16Idx < ptFleet->u16NodeCnt; ++u16Idx)
+    {
+        const Ipb_TFleetNode* ptNode = ptFleet->ptNode[u16Idx];
+        const Ipb_TFleetStats* ptStats = &ptNode->tStats;
+        char szAddr[sizeof(ptNode->szPty)];
+
+        if (ptNode->eLink == IPB_FLEET_UDP)
+        {
+            (void)snprintf(szAddr, sizeof(szAddr), "udp:%u", ptNode->u16Port);
+        }
+        else
+        {
+            (void)snprintf(szAddr, sizeof(szAddr), "%s", ptNode->szPty);
+        }
+
+        (void)fprintf(ptFile, "%5u %4s %-16s %10u %9.0f %8.1f %8u %8u %8u %6u %6u %6u\n", ptNode->u16Idx,
+                      (ptNode->eLink == IPB_FLEET_UDP) ? "udp" : "pty", szAddr, ptStats->u32Requests,
+                      (double)ptStats->u32Requests / dSec,
+                      (ptStats->u32Requests != (uint32_t)0UL)
+                          ? ((double)ptStats->u64SumUs / (double)ptStats->u32Requests) : 0.0,
+                      Ipb_FleetPercentile(ptStats, (uint16_t)50U), Ipb_FleetPercentile(ptStats, (uint16_t)99U),
+                      ptStats->u32MaxUs, ptStats->u32Busy, ptNode->tParser.u32CrcErr, ptStats->u32TxErr);
+
+        tAll.u32Requests += ptStats->u32Requests;
+        tAll.u32Busy += ptStats->u32Busy;
+        tAll.u32TxErr += ptStats->u32TxErr;
+        tAll.u64SumUs += ptStats->u64SumUs;
+        if (ptStats->u32MaxUs > tAll.u32MaxUs)
+        {
+            tAll.u32MaxUs = ptStats->u32MaxUs;
+        }
+        for (uint16_t u16Bkt = 0U; u16Bkt < IPB_FLEET_HIST_NUM; ++u16Bkt)
+        {
+            tAll.pu32Hist[u16Bkt] += ptStats->pu32Hist[u16Bkt];
+        }
+        u32CrcErr += ptNode->tParser.u32CrcErr;
+    }
+
+    (void)fprintf(ptFile, "%5s %4s %-16u %10u %9.0f %8.1f %8u %8u %8u %6u %6u %6u\n", "all", "", ptFleet->u16NodeCnt,
+                  tAll.u32Requests, (double)tAll.u32Requests / dSec,
+                  (tAll.u32Requests != (uint32_t)0UL) ? ((double)tAll.u64SumUs / (double)tAll.u32Requests) : 0.0,
+                  Ipb_FleetPercentile(&tAll, (uint16_t)50U), Ipb_FleetPercentile(&tAll, (uint16_t)99U),
+                  tAll.u32MaxUs, tAll.u32Busy, u32CrcErr, tAll.u32TxErr);
+
+    /** Distribution of the whole fleet */
+    for (uint16_t u16Bkt = 0U; u16Bkt < IPB_FLEET_HIST_NUM; ++u16Bkt)
+    {
+        if (tAll.pu32Hist[u16Bkt] != (uint32_t)0UL)
+        {
+            (void)fprintf(ptFile, "  < %8lu us %10u %6.2f%%\n", (unsigned long)(1UL << u16Bkt),
+                          tAll.pu32Hist[u16Bkt], (100.0 * tAll.pu32Hist[u16Bkt]) / (double)tAll.u32Requests);
+        }
+    }
+}
+
+static int32_t Ipb_FleetAttach(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode)
+{
+    int32_t i32Ret = 0L;
+    struct epoll_event tEv;
+
+    memset((void*)&tEv, 0, sizeof(tEv));
+    tEv.events = EPOLLIN;
+    tEv.data.ptr = (void*)ptNode;
+    if (epoll_ctl(ptFleet->i32Ep, EPOLL_CTL_ADD, ptNode->i32Fd, &tEv) != 0)
+    {
+        i32Ret = -1L;
+    }
+    else
+    {
+        ptNode->u16Idx = ptFleet->u16NodeCnt;
+        ptFleet->ptNode[ptFleet->u16NodeCnt] = ptNode;
+        ptFleet->u16NodeCnt++;
+    }
+
+    return i32Ret;
+}
+
+static void Ipb_FleetNodeInit(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode, Ipb_EFleetLink eLink)
+{
+    ptNode->ptFleet = ptFleet;
+    ptNode->eLink = eLink;
+    ptNode->i32Fd = -1L;
+    ptNode->i32PtyFd = -1L;
+    ptNode->szPty[0] = '\0';
+    ptNode->u16Port = (uint16_t)0U;
+    for (uint16_t u16Node = 0U; u16Node < IPB_SIM_NODE_NUM; ++u16Node)
+    {
+        ptNode->ptDict[u16Node] = NULL;
+    }
+    Ipb_ParserInit(&ptNode->tParser, &Ipb_FleetServe, (void*)ptNode);
+    ptNode->isPending = false;
+    memset((void*)&ptNode->tStats, 0, sizeof(ptNode->tStats));
+}
+
+static void Ipb_FleetReceive(Ipb_TFleetNode* ptNode, uint64_t u64NowNs)
+{
+    uint8_t pu8Buf[IPB_FRM_MAX_DATA_SZ * sizeof(uint16_t)];
+
+    for (uint16_t u16Rd = 0U; u16Rd < IPB_FLEET_BUDGET; ++u16Rd)
+    {
+        ssize_t szRd;
+
+        if (ptNode->eLink == IPB_FLEET_UDP)
+        {
+            union
+            {
+                struct cmsghdr tAlign;
+                uint8_t pu8Buf[CMSG_SPACE(sizeof(struct timespec))];
+            } tCtl;
+            struct iovec tVec = { (void*)pu8Buf, sizeof(pu8Buf) };
+            struct msghdr tMsg;
+            struct cmsghdr* ptCmsg;
+
+            memset((void*)&tMsg, 0, sizeof(tMsg));
+            /** Sender only becomes the peer if the request is accepted */
+            tMsg.msg_name = (void*)&ptNode->tRxPeer;
+            tMsg.msg_namelen = sizeof(ptNode->tRxPeer);
+            tMsg.msg_iov = &tVec;
+            tMsg.msg_iovlen = 1U;
+            tMsg.msg_control = tCtl.pu8Buf;
+            tMsg.msg_controllen = sizeof(tCtl.pu8Buf);
+
+            szRd = recvmsg(ptNode->i32Fd, &tMsg, MSG_DONTWAIT);
+            if (szRd <= 0)
+            {
+                break;
+            }
+
+            ptNode->u64RxNs = u64NowNs;
+            for (ptCmsg = CMSG_FIRSTHDR(&tMsg); ptCmsg != NULL; ptCmsg = CMSG_NXTHDR(&tMsg, ptCmsg))
+            {
+                if ((ptCmsg->cmsg_level == SOL_SOCKET) && (ptCmsg->cmsg_type == SCM_TIMESTAMPNS))
+                {
+                    struct timespec tTs;
+
+                    memcpy((void*)&tTs, (const void*)CMSG_DATA(ptCmsg), sizeof(tTs));
+                    ptNode->u64RxNs = ((uint64_t)tTs.tv_sec * 1000000000ULL) + (uint64_t)tTs.tv_nsec;
+                }
+            }
+
+            /** Each datagram holds one frame */
+            Ipb_ParserReset(&ptNode->tParser);
+            Ipb_ParserFeed(&ptNode->tParser, pu8Buf, (uint16_t)szRd);
+        }
+        else
+        {
+            szRd = read(ptNode->i32Fd, pu8Buf, sizeof(pu8Buf));
+            if (szRd <= 0)
+            {
+                break;
+            }
+
+            ptNode->u64RxNs = u64NowNs;
+            Ipb_ParserFeed(&ptNode->tParser, pu8Buf, (uint16_t)szRd);
+        }
+    }
+}
+
+static void Ipb_FleetServe(void* pvCtx, const Ipb_TFrame* ptFrame)
+{
+    Ipb_TFleetNode* ptNode = (Ipb_TFleetNode*)pvCtx;
+    Ipb_TFleet* ptFleet = ptNode->ptFleet;
+    int32_t i32Sz;
+
+    while (1)
+    {
+        /** A drive answers one request at a time */
+        if (ptNode->isPending != false)
+        {
+            ptNode->tStats.u32Busy++;
+            break;
+        }
+
+        i32Sz = Ipb_SimAnswer(ptNode->ptDict, &ptFleet->tMsg, ptFrame, ptNode->pu16Reply, IPB_FRM_MAX_DATA_SZ);
+        if (i32Sz <= 0L)
+        {
+            break;
+        }
+        ptNode->u16ReplySz = (uint16_t)i32Sz;
+        ptNode->tPeer = ptNode->tRxPeer;
+        ptNode->u64ReqNs = ptNode->u64RxNs;
+
+        if (ptFleet->u32LatencyUs == (uint32_t)0UL)
+        {
+            Ipb_FleetSend(ptNode);
+            break;
+        }
+
+        ptNode->u64DueNs = ptNode->u64ReqNs + ((uint64_t)ptFleet->u32LatencyUs * 1000ULL);
+        ptNode->isPending = true;
+        ptFleet->ptPending[(ptFleet->u16PendHead + ptFleet->u16PendCnt) % IPB_FLEET_MAX_NODE] = ptNode;
+        ptFleet->u16PendCnt++;
+        break;
+    }
+}
+
+static void Ipb_FleetSend(Ipb_TFleetNode* ptNode)
+{
+    Ipb_TFleetStats* ptStats = &ptNode->tStats;
+    size_t szBy = (size_t)ptNode->u16ReplySz * sizeof(uint16_t);
+    bool isSent;
+    uint64_t u64Us;
+    uint16_t u16Bkt = 0U;
+
+    if (ptNode->eLink == IPB_FLEET_UDP)
+    {
+        isSent = (sendto(ptNode->i32Fd, (const void*)ptNode->pu16Reply, szBy, (MSG_DONTWAIT | MSG_NOSIGNAL),
+                         (const struct sockaddr*)&ptNode->tPeer, sizeof(ptNode->tPeer)) == (ssize_t)szBy);
+    }
+    else
+    {
+        isSent = Ipb_FleetWrite(ptNode->i32Fd, (const uint8_t*)ptNode->pu16Reply, szBy);
+    }
+    if (isSent == false)
+    {
+        ptStats->u32TxErr++;
+    }
+
+    u64Us = Ipb_FleetNowNs();
+    u64Us = (u64Us > ptNode->u64ReqNs) ? ((u64Us - ptNode->u64ReqNs) / 1000ULL) : 0ULL;
+    if (u64Us > (uint64_t)UINT32_MAX)
+    {
+        u64Us = (uint64_t)UINT32_MAX;
+    }
+
+    while ((u16Bkt < (IPB_FLEET_HIST_NUM - 1U)) && ((u64Us >> u16Bkt) != 0ULL))
+    {
+        u16Bkt++;
+    }
+
+    ptStats->u32Requests++;
+    ptStats->u64SumUs += u64Us;
+    if ((uint32_t)u64Us > ptStats->u32MaxUs)
+    {
+        ptStats->u32MaxUs = (uint32_t)u64Us;
+    }
+    ptStats->pu32Hist[u16Bkt]++;
+}
+
+static bool Ipb_FleetWrite(int32_t i32Fd, const uint8_t* pu8Buf, size_t szBy)
+{
+    size_t szDone = (size_t)0U;
+
+    while (szDone < szBy)
+    {
+        ssize_t szWr = write(i32Fd, (const void*)&pu8Buf[szDone], (szBy - szDone));
+
+        if (szWr > 0)
+        {
+            szDone += (size_t)szWr;
+        }
+        else if ((szWr < 0) && (errno == EINTR))
+        {
+            /** Nothing */
+        }
+        else if ((szWr < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            /** Link full, the host is not reading its port */
+            struct pollfd tPoll = { i32Fd, POLLOUT, 0 };
+
+            if (poll(&tPoll, 1U, (int)IPB_FLEET_TX_WAIT_MS) <= 0)
+            {
+                break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return (szDone == szBy);
+}
+
+static uint16_t Ipb_FleetFlush(Ipb_TFleet* ptFleet)
+{
+    uint16_t u16Sent = (uint16_t)0U;
+
+    if (ptFleet->u16PendCnt > (uint16_t)0U)
+    {
+        uint64_t u64NowNs = Ipb_FleetNowNs();
+
+        while (ptFleet->u16PendCnt > (uint16_t)0U)
+        {
+            Ipb_TFleetNode* ptNode = ptFleet->ptPending[ptFleet->u16PendHead];
+
+            if (ptNode->u64DueNs > u64NowNs)
+            {
+                struct itimerspec tIts;
+
+                memset((void*)&tIts, 0, sizeof(tIts));
+                tIts.it_value.tv_sec = (time_t)(ptNode->u64DueNs / 1000000000ULL);
+                tIts.it_value.tv_nsec = (long)(ptNode->u64DueNs % 1000000000ULL);
+                (void)timerfd_settime(ptFleet->i32Timer, TFD_TIMER_ABSTIME, &tIts, NULL);
+                break;
+            }
+
+            ptNode->isPending = false;
+            Ipb_FleetSend(ptNode);
+            ptFleet->u16PendHead = (ptFleet->u16PendHead + 1U) % IPB_FLEET_MAX_NODE;
+            ptFleet->u16PendCnt--;
+            u16Sent++;
+        }
+    }
+
+    return u16Sent;
+}
+
+static uint64_t Ipb_FleetNowNs(void)
+{
+    struct timespec tTs;
+
+    (void)clock_gettime(CLOCK_REALTIME, &tTs);
+
+    return ((uint64_t)tTs.tv_sec * 1000000000ULL) + (uint64_t)tTs.tv_nsec;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,261 @@
+/**
+ * @file ipb_fleet.h
+ * @brief This file contains a fleet of simulated ingenia protocol bus
+ *        (IPB) drives reachable over UDP and pty links on Linux hosts
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_FLEET_H
+#define IPB_FLEET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <netinet/in.h>
+#include "ipb_sim.h"
+
+/** Max number of drives of a fleet */
+#ifndef IPB_FLEET_MAX_NODE
+#define IPB_FLEET_MAX_NODE      4096U
+#endif
+
+/** Max number of events handled with a single wait */
+#ifndef IPB_FLEET_EVENTS
+#define IPB_FLEET_EVENTS        256U
+#endif
+
+/** Max time in milliseconds a pty reply waits for room in the link */
+#ifndef IPB_FLEET_TX_WAIT_MS
+#define IPB_FLEET_TX_WAIT_MS    100U
+#endif
+
+/** Max number of reads of a drive link each time it gets data */
+#ifndef IPB_FLEET_BUDGET
+#define IPB_FLEET_BUDGET        8U
+#endif
+
+/**
+ * Number of response time buckets, bucket 0 holds times under 1 us and
+ * bucket n times from 2^(n-1) to 2^n - 1 us, the last one the rest
+ */
+#define IPB_FLEET_HIST_NUM      24U
+
+/** Drive link kinds */
+typedef enum
+{
+    /** UDP socket, one frame per datagram */
+    IPB_FLEET_UDP,
+    /** Master side of a pty pair, byte stream */
+    IPB_FLEET_PTY
+} Ipb_EFleetLink;
+
+/** Drive statistics */
+typedef struct
+{
+    /** Number of requests answered */
+    uint32_t u32Requests;
+    /** Number of requests dropped because the drive was busy */
+    uint32_t u32Busy;
+    /** Number of replies that could not be transmitted whole */
+    uint32_t u32TxErr;
+    /** Sum of response times in microseconds */
+    uint64_t u64SumUs;
+    /** Max response time in microseconds */
+    uint32_t u32MaxUs;
+    /** Response time histogram */
+    uint32_t pu32Hist[IPB_FLEET_HIST_NUM];
+} Ipb_TFleetStats;
+
+typedef struct Ipb_TFleet Ipb_TFleet;
+
+/** Simulated drive of a fleet */
+typedef struct
+{
+    /** Fleet of the drive */
+    Ipb_TFleet* ptFleet;
+    /** Link kind */
+    Ipb_EFleetLink eLink;
+    /** Link descriptor, -1 if closed */
+    int32_t i32Fd;
+    /** Slave side of the pty, kept open so the link never hangs up */
+    int32_t i32PtyFd;
+    /** Path of the pty slave side, opened by the host as a serial port */
+    char szPty[64];
+    /** UDP port of the drive */
+    uint16_t u16Port;
+    /** Index in the fleet */
+    uint16_t u16Idx;
+    /** Dictionary of each internal network node, NULL if none */
+    TIpbDictInst* ptDict[IPB_SIM_NODE_NUM];
+    /** Request parser */
+    Ipb_TParser tParser;
+    /** Address of the UDP request being parsed */
+    struct sockaddr_in tRxPeer;
+    /** Time in nanoseconds the request being parsed arrived, CLOCK_REALTIME */
+    uint64_t u64RxNs;
+    /** Address of the UDP request answered, the reply goes back to it */
+    struct sockaddr_in tPeer;
+    /** Time in nanoseconds the request answered arrived, CLOCK_REALTIME */
+    uint64_t u64ReqNs;
+    /** Time in nanoseconds the pending reply is due */
+    uint64_t u64DueNs;
+    /** Reply waiting for the drive latency */
+    bool isPending;
+    /** Reply frame */
+    uint16_t pu16Reply[IPB_FRM_MAX_DATA_SZ];
+    /** Size of the reply frame in words */
+    uint16_t u16ReplySz;
+    /** Statistics */
+    Ipb_TFleetStats tStats;
+} Ipb_TFleetNode;
+
+/** Fleet instance, served by a single thread */
+struct Ipb_TFleet
+{
+    /** Epoll instance */
+    int32_t i32Ep;
+    /** Timer expiring when the oldest pending reply is due */
+    int32_t i32Timer;
+    /** Time in microseconds drives take to answer a request */
+    uint32_t u32LatencyUs;
+    /** Drives */
+    Ipb_TFleetNode* ptNode[IPB_FLEET_MAX_NODE];
+    /** Number of drives */
+    uint16_t u16NodeCnt;
+    /** Drives with a pending reply, in arrival order */
+    Ipb_TFleetNode* ptPending[IPB_FLEET_MAX_NODE];
+    /** Oldest pending reply */
+    uint16_t u16PendHead;
+    /** Number of pending replies */
+    uint16_t u16PendCnt;
+    /** Work message shared by all drives */
+    Ipb_TMsg tMsg;
+};
+
+/**
+ * Initialises a fleet
+ *
+ * @note Each drive takes one descriptor, two for pty links, so big
+ *  fleets need a higher RLIMIT_NOFILE. Fleets are independent, more
+ *  threads serve more drives with a fleet each.
+ *
+ * @param[out] ptFleet
+ *  Fleet instance
+ * @param[in] u32LatencyUs
+ *  Time in microseconds drives take to answer a request, 0 answers at once
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_FleetInit(Ipb_TFleet* ptFleet, uint32_t u32LatencyUs);
+
+/**
+ * Closes all the drives of a fleet and the fleet itself
+ *
+ * @param[in] ptFleet
+ *  Fleet instance
+ */
+void
+Ipb_FleetDeinit(Ipb_TFleet* ptFleet);
+
+/**
+ * Adds a drive listening on a UDP port, reachable with Ipb_UdpOpen
+ *
+ * @param[in] ptFleet
+ *  Fleet instance
+ * @param[out] ptNode
+ *  Drive instance, must remain valid while the fleet is used
+ * @param[in] szAddr
+ *  IPv4 address to listen to, e.g. "127.0.0.1"
+ * @param[in] u16Port
+ *  UDP port, 0 takes a free one, see u16Port of the drive
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_FleetAddUdp(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode, const char* szAddr, uint16_t u16Port);
+
+/**
+ * Adds a drive behind a pty pair, reachable with Ipb_SerialOpen on the
+ * path held by szPty of the drive
+ *
+ * @param[in] ptFleet
+ *  Fleet instance
+ * @param[out] ptNode
+ *  Drive instance, must remain valid while the fleet is used
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_FleetAddPty(Ipb_TFleet* ptFleet, Ipb_TFleetNode* ptNode);
+
+/**
+ * Sets the dictionary answering the requests of an internal network
+ * node of a drive, see Ipb_SimSetDict
+ *
+ * @param[in] ptNode
+ *  Drive instance
+ * @param[in] u16SubNode
+ *  Internal network node
+ * @param[in] ptDict
+ *  Dictionary instance, may be shared by many drives. NULL removes it
+ *
+ * @retval true if success, false if node is out of range
+ */
+bool
+Ipb_FleetSetDict(Ipb_TFleetNode* ptNode, uint16_t u16SubNode, TIpbDictInst* ptDict);
+
+/**
+ * Serves the requests received by the drives of a fleet
+ *
+ * @param[in] ptFleet
+ *  Fleet instance
+ * @param[in] u32TimeoutMs
+ *  Max time to wait for requests
+ *
+ * @retval number of requests answered, negative error code otherwise
+ */
+int32_t
+Ipb_FleetRun(Ipb_TFleet* ptFleet, uint32_t u32TimeoutMs);
+
+/**
+ * Gets the response time under which a percentage of the requests of a
+ * drive were answered, measured from the arrival of the request to the
+ * transmission of its reply
+ *
+ * @param[in] ptStats
+ *  Drive statistics
+ * @param[in] u16Pct
+ *  Percentage, 1 to 100
+ *
+ * @retval upper bound of the response time in microseconds
+ */
+uint32_t
+Ipb_FleetPercentile(const Ipb_TFleetStats* ptStats, uint16_t u16Pct);
+
+/**
+ * Resets the statistics of all the drives of a fleet
+ *
+ * @param[in] ptFleet
+ *  Fleet instance
+ */
+void
+Ipb_FleetResetStats(Ipb_TFleet* ptFleet);
+
+/**
+ * Prints the request rate and response time distribution of each drive
+ * and the whole fleet, called from the thread serving the fleet
+ *
+ * @param[in] ptFleet
+ *  Fleet instance
+ * @param[in] ptFile
+ *  Output stream
+ * @param[in] u32ElapsedMs
+ *  Time the statistics were collected, gives the rates
+ */
+void
+Ipb_FleetReport(Ipb_TFleet* ptFleet, FILE* ptFile, uint32_t u32ElapsedMs);
+
+#endif /* IPB_FLEET_H */
@@ -10,7 +10,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#include "ipb_checksum.h"
+#include "ipb_crc.h"
 
 /** Frame description
  * Word 0..1    - Header
@@ -19,38 +19,20 @@
  * Word N       - CRC
  */
 
-typedef struct
-{
-    union
-    {
-        struct
-        {
-            /** Internal network node */
-            uint16_t u4SubNode :4;
-            /** Reserved bits */
-            uint16_t u12Reserved :12;
-        };
-        uint16_t u16NodeAll;
-    } NodeId;
-
-    union
-    {
-        struct
-        {
-            /** Extended message */
-            uint16_t u1Extended :1;
-            /** Frame command identification */
-            uint16_t u3Cmd :3;
-            /** Address of the Static Data */
-            uint16_t u12Addr :12;
-        };
-        uint16_t u16All;
-    } Command;
-} THeader;
-
 uint16_t
 Ipb_FrameCRC(const Ipb_TFrame* tFrame, uint16_t u16Sz);
 
+/**
+ * Builds header and config data of a frame.
+ *
+ * @param [out] pu16Dst
+ *      Destination buffer, at least header and config size
+ * @return true if frame is extended
+ */
+static bool
+Ipb_FrameBuildHead(uint16_t* pu16Dst, uint16_t u16SubNode, uint16_t u16Addr, uint8_t u8Cmd,
+                   const uint16_t* pu16Buf, uint16_t u16Sz);
+
 int32_t Ipb_FrameCreate(Ipb_TFrame* tFrame, uint16_t u16SubNode, uint16_t u16Addr, uint8_t u8Cmd,
                         const uint16_t* pu16Buf, uint16_t u16Sz, bool calcCRC)
 {
@@ -58,8 +40,6 @@ int32_t Ipb_FrameCreate(Ipb_TFrame* tFrame, uint16_t u16SubNode, uint16_t u16Add
 
     while (1)
     {
-        THeader tHeader;
-
         if (tFrame == NULL)
         {
             i32Err = -1L;
@@ -73,36 +53,7 @@ int32_t Ipb_FrameCreate(Ipb_TFrame* tFrame, uint16_t u16SubNode, uint16_t u16Add
             break;
         }
 
-        /* Build header and assign it to u16Buffer */
-        tHeader.NodeId.u12Reserved = (uint16_t)10U;
-        tHeader.NodeId.u4SubNode = u16SubNode;
-        tFrame->pu16Buf[0] = tHeader.NodeId.u16NodeAll;
-        tHeader.Command.u12Addr = u16Addr;
-        tHeader.Command.u3Cmd = u8Cmd;
-        tHeader.Command.u1Extended = (u16Sz > IPB_FRM_CONFIG_SZ);
-        tFrame->pu16Buf[1] = tHeader.Command.u16All;
-
-        /* Copy static & extended u16Buffer (if any) */
-        if (tHeader.Command.u1Extended != false)
-        {
-            uint16_t u16SzBy = u16Sz * sizeof(uint16_t);
-            memcpy(&tFrame->pu16Buf[IPB_FRM_HEAD_SZ], (const void*)&u16SzBy,
-                   sizeof(uint16_t));
-            /* Reserved config size */
-            memset(&tFrame->pu16Buf[IPB_FRM_HEAD_SZ + (uint16_t)1U], (uint16_t)0U,
-                   (IPB_FRM_CONFIG_SZ - (uint16_t)1U));
-        }
-        else if (pu16Buf != NULL)
-        {
-            memcpy(&tFrame->pu16Buf[IPB_FRM_HEAD_SZ], (const void*)pu16Buf,
-                   (sizeof(tFrame->pu16Buf[0]) * u16Sz));
-        }
-        else
-        {
-            memset(&tFrame->pu16Buf[IPB_FRM_HEAD_SZ], 0L,
-                   (sizeof(tFrame->pu16Buf[0]) * u16Sz));
-        }
-
+        Ipb_FrameBuildHead(tFrame->pu16Buf, u16SubNode, u16Addr, u8Cmd, pu16Buf, u16Sz);
         tFrame->u16Sz = IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ;
 
         if (calcCRC != false)
@@ -127,39 +78,134 @@ int32_t Ipb_FrameCreate(Ipb_TFrame* tFrame, uint16_t u16SubNode, uint16_t u16Add
     return i32Err;
 }
 
-uint16_t Ipb_FrameGetSubNode(const Ipb_TFrame* tFrame)
+int32_t Ipb_FrameCreateDesc(Ipb_TFrameDesc* ptDesc, uint16_t u16SubNode, uint16_t u16Addr, uint8_t u8Cmd,
+                            const uint16_t* pu16Buf, uint16_t u16Sz)
 {
-    THeader tHeader;
+    int32_t i32Err = 0L;
 
-    tHeader.NodeId.u16NodeAll = tFrame->pu16Buf[IPB_FRM_NODE_IDX];
+    while (1)
+    {
+        if (ptDesc == NULL)
+        {
+            i32Err = -1L;
+            break;
+        }
+
+        /* Check max data size */
+        if (u16Sz > IPB_MAX_DATA_SZ)
+        {
+            i32Err = -2L;
+            break;
+        }
+
+        bool isExtended = Ipb_FrameBuildHead(ptDesc->pu16Cfg, u16SubNode, u16Addr, u8Cmd, pu16Buf, u16Sz);
+        ptDesc->pu16Cfg[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ] =
+                    Ipb_CrcUpdate(IPB_CRC_START, (const uint8_t*)ptDesc->pu16Cfg,
+                                  ((IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ) * sizeof(uint16_t)));
+
+        ptDesc->ptIov[0].pu8Buf = (const uint8_t*)ptDesc->pu16Cfg;
+        ptDesc->ptIov[0].u16SzBy = (uint16_t)sizeof(ptDesc->pu16Cfg);
+        ptDesc->u16IovCnt = (uint16_t)1U;
 
-    return (uint16_t) tHeader.NodeId.u4SubNode;
+        if (isExtended != false)
+        {
+            /* Extended data is not copied, segment points to caller buffer */
+            ptDesc->ptIov[1].pu8Buf = (const uint8_t*)pu16Buf;
+            ptDesc->ptIov[1].u16SzBy = u16Sz * sizeof(uint16_t);
+            ptDesc->u16IovCnt++;
+        }
+
+        break;
+    }
+
+    return i32Err;
 }
 
-bool Ipb_FrameGetExtended(const Ipb_TFrame* tFrame)
+int32_t Ipb_FrameEncode(uint16_t* pu16Dst, uint16_t u16DstSz, uint16_t u16SubNode, uint16_t u16Addr,
+                        uint8_t u8Cmd, const uint16_t* pu16Buf, uint16_t u16Sz)
+{
+    int32_t i32Ret = (int32_t)IPB_FRAME_TOTAL_CFG_SIZE;
+
+    while (1)
+    {
+        if (pu16Dst == NULL)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        /* Check max data size */
+        if (u16Sz > IPB_MAX_DATA_SZ)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        if (u16Sz > IPB_FRM_CONFIG_SZ)
+        {
+            i32Ret += (int32_t)u16Sz;
+        }
+
+        /* Check destination size */
+        if (i32Ret > (int32_t)u16DstSz)
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        bool isExtended = Ipb_FrameBuildHead(pu16Dst, u16SubNode, u16Addr, u8Cmd, pu16Buf, u16Sz);
+        pu16Dst[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ] =
+                    Ipb_CrcUpdate(IPB_CRC_START, (const uint8_t*)pu16Dst,
+                                  ((IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ) * sizeof(uint16_t)));
+
+        if (isExtended != false)
+        {
+            memcpy(&pu16Dst[IPB_FRAME_TOTAL_CFG_SIZE], (const void*)pu16Buf,
+                   (sizeof(pu16Dst[0]) * u16Sz));
+        }
+
+        break;
+    }
+
+    return i32Ret;
+}
+
+uint16_t Ipb_FrameGetSubNode(const Ipb_TFrame* tFrame)
 {
-    THeader tHeader;
+    return (uint16_t)(tFrame->pu16Buf[IPB_FRM_NODE_IDX] & IPB_FRM_NODE_MASK);
+}
 
-    tHeader.Command.u16All = tFrame->pu16Buf[IPB_FRM_CMD_IDX];
-    return (bool) tHeader.Command.u1Extended;
+bool Ipb_FrameCheckSync(const Ipb_TFrame* tFrame)
+{
+    return ((tFrame->pu16Buf[IPB_FRM_NODE_IDX] >> IPB_FRM_SYNC_POS) == (uint16_t)IPB_FRM_SYNC_MARK);
 }
 
-uint16_t Ipb_FrameGetAddr(const Ipb_TFrame* tFrame)
+uint16_t Ipb_FrameGetEncodedSz(const uint16_t* pu16Buf)
 {
-    THeader tHeader;
+    uint16_t u16Sz = (uint16_t)IPB_FRAME_TOTAL_CFG_SIZE;
 
-    tHeader.Command.u16All = tFrame->pu16Buf[IPB_FRM_CMD_IDX];
+    if ((pu16Buf[IPB_FRM_CMD_IDX] & IPB_FRM_EXT_MASK) != (uint16_t)IPB_FRM_NOTEXT)
+    {
+        /** First config word holds the extended data size in bytes */
+        u16Sz += pu16Buf[IPB_FRM_CFG_IDX] / sizeof(uint16_t);
+    }
 
-    return (uint16_t) tHeader.Command.u12Addr;
+    return u16Sz;
 }
 
-uint8_t Ipb_FrameGetCmd(const Ipb_TFrame* tFrame)
+bool Ipb_FrameGetExtended(const Ipb_TFrame* tFrame)
 {
-    THeader tHeader;
+    return ((tFrame->pu16Buf[IPB_FRM_CMD_IDX] & IPB_FRM_EXT_MASK) != (uint16_t)IPB_FRM_NOTEXT);
+}
 
-    tHeader.Command.u16All = tFrame->pu16Buf[IPB_FRM_CMD_IDX];
+uint16_t Ipb_FrameGetAddr(const Ipb_TFrame* tFrame)
+{
+    return (uint16_t)(tFrame->pu16Buf[IPB_FRM_CMD_IDX] >> IPB_FRM_ADDR_POS);
+}
 
-    return (uint8_t) tHeader.Command.u3Cmd;
+uint8_t Ipb_FrameGetCmd(const Ipb_TFrame* tFrame)
+{
+    return (uint8_t)((tFrame->pu16Buf[IPB_FRM_CMD_IDX] >> IPB_FRM_CMD_POS) & IPB_FRM_CMD_MASK);
 }
 
 uint16_t Ipb_FrameGetConfigData(const Ipb_TFrame* tFrame, uint16_t* u16Buf)
@@ -185,13 +231,44 @@ bool Ipb_FrameCheckCRC(const Ipb_TFrame* tFrame)
 
 uint16_t Ipb_FrameCRC(const Ipb_TFrame* tFrame, uint16_t u16Sz)
 {
-    uint16_t crc = CRC_START_XMODEM;
-    uint8_t* pu8In = (uint8_t*)tFrame->pu16Buf;
+    return Ipb_CrcUpdate(IPB_CRC_START, (const uint8_t*)tFrame->pu16Buf, u16Sz);
+}
+
+static bool Ipb_FrameBuildHead(uint16_t* pu16Dst, uint16_t u16SubNode, uint16_t u16Addr, uint8_t u8Cmd,
+                               const uint16_t* pu16Buf, uint16_t u16Sz)
+{
+    bool isExtended = (u16Sz > IPB_FRM_CONFIG_SZ);
+
+    /* Build header and assign it to u16Buffer */
+    pu16Dst[IPB_FRM_NODE_IDX] = (uint16_t)(((uint16_t)IPB_FRM_SYNC_MARK << IPB_FRM_SYNC_POS)
+                                           | (u16SubNode & IPB_FRM_NODE_MASK));
+    pu16Dst[IPB_FRM_CMD_IDX] = (uint16_t)((u16Addr << IPB_FRM_ADDR_POS)
+                                          | ((u8Cmd & IPB_FRM_CMD_MASK) << IPB_FRM_CMD_POS)
+                                          | ((isExtended != false) ? IPB_FRM_EXT_MASK : 0U));
 
-    for (uint16_t u16Idx = 0; u16Idx < u16Sz; u16Idx++)
+    /* Copy static & extended u16Buffer (if any) */
+    if (isExtended != false)
+    {
+        uint16_t u16SzBy = u16Sz * sizeof(uint16_t);
+        memcpy(&pu16Dst[IPB_FRM_HEAD_SZ], (const void*)&u16SzBy,
+               sizeof(uint16_t));
+        /* Reserved config size */
+        memset(&pu16Dst[IPB_FRM_HEAD_SZ + (uint16_t)1U], (uint16_t)0U,
+               ((IPB_FRM_CONFIG_SZ - (uint16_t)1U) * sizeof(uint16_t)));
+    }
+    else if (pu16Buf != NULL)
+    {
+        memcpy(&pu16Dst[IPB_FRM_HEAD_SZ], (const void*)pu16Buf,
+               (sizeof(pu16Dst[0]) * u16Sz));
+        /* Unused config words */
+        memset(&pu16Dst[IPB_FRM_HEAD_SZ + u16Sz], 0L,
+               (sizeof(pu16Dst[0]) * (IPB_FRM_CONFIG_SZ - u16Sz)));
+    }
+    else
     {
-        crc = update_crc_ccitt(crc, pu8In[u16Idx]);
+        memset(&pu16Dst[IPB_FRM_HEAD_SZ], 0L,
+               (sizeof(pu16Dst[0]) * IPB_FRM_CONFIG_SZ));
     }
 
-    return crc;
+    return isExtended;
 }
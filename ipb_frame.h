@@ -33,6 +33,28 @@
 /** Total size of a config frame */
 #define IPB_FRAME_TOTAL_CFG_SIZE 7U
 
+/** Size in bytes of a config frame */
+#define IPB_FRM_CFG_SZ_BY       (uint16_t)(IPB_FRAME_TOTAL_CFG_SIZE * sizeof(uint16_t))
+/** Size in bytes of the frame header and config data covered by the crc */
+#define IPB_FRM_CRC_DATA_SZ_BY  (uint16_t)((IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ) * sizeof(uint16_t))
+/** Max size in bytes of the extended data of a frame */
+#define IPB_FRM_MAX_EXT_SZ_BY   (uint16_t)((IPB_FRM_MAX_DATA_SZ - IPB_FRAME_TOTAL_CFG_SIZE) * sizeof(uint16_t))
+/** Size in bytes of the node word holding the synchronisation mark */
+#define IPB_FRM_SYNC_SZ_BY      (uint16_t)sizeof(uint16_t)
+
+/** Position of the synchronisation mark in the node word */
+#define IPB_FRM_SYNC_POS        4U
+/** Internal network node bits of the node word */
+#define IPB_FRM_NODE_MASK       0x000FU
+/** Position of the address in the command word */
+#define IPB_FRM_ADDR_POS        4U
+/** Position of the command in the command word */
+#define IPB_FRM_CMD_POS         1U
+/** Command bits of the command word, once shifted */
+#define IPB_FRM_CMD_MASK        0x0007U
+/** Extended flag of the command word */
+#define IPB_FRM_EXT_MASK        0x0001U
+
 /** Ingenia protocol frame max util data size */
 #define IPB_MAX_DATA_SZ         (IPB_FRM_MAX_DATA_SZ - IPB_FRM_HEAD_SZ - IPB_FRM_CRC_SZ)
 
@@ -53,6 +75,9 @@
 /** General error */
 #define IPB_REP_ERROR           4U
 
+/** Value of the node reserved bits, used as synchronisation mark */
+#define IPB_FRM_SYNC_MARK       0x00AU
+
 /** Ingenia protocol extended flag definitions */
 #define IPB_FRM_NOTEXT          0U
 #define IPB_FRM_EXT             1U
@@ -65,6 +90,27 @@ typedef struct {
     uint16_t u16Sz;
 } Ipb_TFrame;
 
+/** Ingenia protocol bus frame segment */
+typedef struct {
+    /** Pointer to segment data */
+    const uint8_t* pu8Buf;
+    /** Segment size in bytes */
+    uint16_t u16SzBy;
+} Ipb_TFrameIov;
+
+/** Max number of segments of a frame descriptor */
+#define IPB_FRM_DESC_IOV_NUM    2U
+
+/** Ingenia protocol bus frame descriptor */
+typedef struct {
+    /** Header, config data and CRC */
+    uint16_t pu16Cfg[IPB_FRAME_TOTAL_CFG_SIZE];
+    /** Segments of the frame, extended data points to the caller buffer */
+    Ipb_TFrameIov ptIov[IPB_FRM_DESC_IOV_NUM];
+    /** Number of segments */
+    uint16_t u16IovCnt;
+} Ipb_TFrameDesc;
+
 /**
  * Initialises an Ingenia High Speed Protocol frame.
  *
@@ -88,6 +134,64 @@ int32_t
 Ipb_FrameCreate(Ipb_TFrame* tFrame, uint16_t u16SubNode, uint16_t u16Addr, uint8_t u8Cmd,
                 const uint16_t* pu16Buf, uint16_t u16Sz, bool calcCRC);
 
+/**
+ * Initialises an Ingenia High Speed Protocol frame descriptor.
+ *
+ * @note Only header, config data and CRC are built into the descriptor,
+ *  extended data is referenced from pu16Buf, that must remain valid
+ *  until the descriptor is transmitted.
+ *
+ * @param [out] ptDesc
+ *      Destination descriptor
+ * @param [in] u16SubNode
+ *      Destination internal network node.
+ * @param [in] u16Addr
+ *      Destination address.
+ * @param [in] u8Cmd
+ *      Frame command (request or reply)
+ * @param [in] pu16Buf
+ *      Buffer with data.
+ * @param [in] u16Sz
+ *      Size of data.
+ * @return 0 success, error code otherwise
+ */
+int32_t
+Ipb_FrameCreateDesc(Ipb_TFrameDesc* ptDesc, uint16_t u16SubNode, uint16_t u16Addr, uint8_t u8Cmd,
+                    const uint16_t* pu16Buf, uint16_t u16Sz);
+
+/**
+ * Encodes an Ingenia High Speed Protocol frame into a raw buffer.
+ *
+ * @param [out] pu16Dst
+ *      Destination buffer
+ * @param [in] u16DstSz
+ *      Size of the destination buffer in words.
+ * @param [in] u16SubNode
+ *      Destination internal network node.
+ * @param [in] u16Addr
+ *      Destination address.
+ * @param [in] u8Cmd
+ *      Frame command (request or reply)
+ * @param [in] pu16Buf
+ *      Buffer with data.
+ * @param [in] u16Sz
+ *      Size of data.
+ * @return frame size in words if success, negative error code otherwise
+ */
+int32_t
+Ipb_FrameEncode(uint16_t* pu16Dst, uint16_t u16DstSz, uint16_t u16SubNode, uint16_t u16Addr,
+                uint8_t u8Cmd, const uint16_t* pu16Buf, uint16_t u16Sz);
+
+/**
+ * Returns the size of a frame encoded with Ipb_FrameEncode.
+ *
+ * @param [in] pu16Buf
+ *      Encoded frame, at least IPB_FRAME_TOTAL_CFG_SIZE words.
+ * @return frame size in words.
+ */
+uint16_t
+Ipb_FrameGetEncodedSz(const uint16_t* pu16Buf);
+
 /**
  * Returns the SubNode of the header.
  *
@@ -128,6 +232,16 @@ Ipb_FrameGetCmd(const Ipb_TFrame* tFrame);
 bool
 Ipb_FrameGetExtended(const Ipb_TFrame* tFrame);
 
+/**
+ * Checks if the header holds the synchronisation mark.
+ *
+ * @param [in] tFrame
+ *      Input frame.
+ * @return true if node reserved bits match IPB_FRM_SYNC_MARK.
+ */
+bool
+Ipb_FrameCheckSync(const Ipb_TFrame* tFrame);
+
 /**
  * Returns the static data of a frame.
  *
@@ -8,10 +8,67 @@
  */
 
 #include "ipb_intf.h"
+#include "ipb_crc.h"
+#include "ipb_pool.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+/** Max number of datagrams handed to each ethernet multiple transmission */
+#ifndef IPB_INTF_ETH_TX_BATCH
+#define IPB_INTF_ETH_TX_BATCH       16U
+#endif
+
+static Ipb_EStatus
+Ipb_IntfRead(Ipb_TIntf* ptInst, uint16_t (*Reception)(uint16_t, uint8_t*, uint16_t),
+             uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd, uint16_t* pu16Data,
+             uint16_t* pu16Sz);
+
+/**
+ * Returns the rx frame to the pool
+ *
+ * @param[in] ptInst
+ *  Interface instance
+ */
+static void
+Ipb_IntfRxRelease(Ipb_TIntf* ptInst);
+
+/**
+ * Decodes the header of the rx config frame
+ *
+ * @param[in] ptInst
+ *  Interface instance
+ * @param[out] pu16SubNode
+ *  Internal network node
+ * @param[out] pu16Addr
+ *  Register address
+ * @param[out] pu16Cmd
+ *  Command
+ */
+static void
+Ipb_IntfRxHead(const Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd);
+
+/**
+ * Validates the received header bytes the way ipb_parser.h does, dropping
+ * those not starting a valid header
+ *
+ * @param[in] ptInst
+ *  Interface instance
+ *
+ * @retval true if a valid header and config data are received
+ */
+static bool
+Ipb_IntfRxCheck(Ipb_TIntf* ptInst);
+
+/**
+ * Drops the first received header byte to search the next header
+ *
+ * @param[in] ptInst
+ *  Interface instance
+ */
+static void
+Ipb_IntfRxSlide(Ipb_TIntf* ptInst);
+
 static Ipb_EStatus
 Ipb_IntfReadUart(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd,
                  uint16_t* pu16Data, uint16_t* pu16Sz);
@@ -20,6 +77,9 @@ static Ipb_EStatus
 Ipb_IntfWriteUart(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd,
                   uint16_t* pu16Data, uint16_t u16Sz);
 
+static Ipb_EStatus
+Ipb_IntfSendUart(Ipb_TIntf* ptInst, const uint16_t* pu16Buf, uint16_t u16Sz);
+
 static Ipb_EStatus
 Ipb_IntfReadUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd,
                 uint16_t* pu16Data, uint16_t* pu16Sz);
@@ -28,10 +88,30 @@ static Ipb_EStatus
 Ipb_IntfWriteUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd,
                  uint16_t* pu16Data, uint16_t u16Sz);
 
+static Ipb_EStatus
+Ipb_IntfSendUsb(Ipb_TIntf* ptInst, const uint16_t* pu16Buf, uint16_t u16Sz);
+
+static Ipb_EStatus
+Ipb_IntfReadEth(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd,
+                uint16_t* pu16Data, uint16_t* pu16Sz);
+
+static Ipb_EStatus
+Ipb_IntfWriteEth(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd,
+                 uint16_t* pu16Data, uint16_t u16Sz);
+
+static Ipb_EStatus
+Ipb_IntfSendEth(Ipb_TIntf* ptInst, const uint16_t* pu16Buf, uint16_t u16Sz);
+
 void Ipb_IntfInit(Ipb_TIntf* ptInst, Ipb_EIntf eIntf, uint16_t u16Id)
 {
     ptInst->eState = IPB_STANDBY;
+    ptInst->eIntf = eIntf;
     ptInst->u16Id = u16Id;
+    ptInst->ptRxfrm = NULL;
+    ptInst->u16RxSzBy = (uint16_t)0U;
+    ptInst->u16RxCrc = IPB_CRC_START;
+    ptInst->u32RxDropBy = (uint32_t)0UL;
+    ptInst->u32RxCrcErr = (uint32_t)0UL;
 
     switch (eIntf)
     {
@@ -39,11 +119,19 @@ void Ipb_IntfInit(Ipb_TIntf* ptInst, Ipb_EIntf eIntf, uint16_t u16Id)
             /* UART Slave mode */
             ptInst->Write = &Ipb_IntfWriteUart;
             ptInst->Read = &Ipb_IntfReadUart;
+            ptInst->Send = &Ipb_IntfSendUart;
             break;
         case USB_BASED:
             /** USB slave mode */
             ptInst->Write = &Ipb_IntfWriteUsb;
             ptInst->Read = &Ipb_IntfReadUsb;
+            ptInst->Send = &Ipb_IntfSendUsb;
+            break;
+        case ETHERNET_BASED:
+            /** Ethernet mode, one frame per datagram */
+            ptInst->Write = &Ipb_IntfWriteEth;
+            ptInst->Read = &Ipb_IntfReadEth;
+            ptInst->Send = &Ipb_IntfSendEth;
             break;
         default:
             /* Nothing */
@@ -52,65 +140,85 @@ void Ipb_IntfInit(Ipb_TIntf* ptInst, Ipb_EIntf eIntf, uint16_t u16Id)
 
 }
 
+void Ipb_IntfReset(Ipb_TIntf* ptInst)
+{
+    ptInst->eState = IPB_STANDBY;
+    ptInst->u16RxSzBy = (uint16_t)0U;
+    ptInst->u16RxCrc = IPB_CRC_START;
+    Ipb_IntfRxRelease(ptInst);
+}
+
 void Ipb_IntfDeinit(Ipb_TIntf* ptInst)
 {
     ptInst->Write = NULL;
     ptInst->Read = NULL;
+    ptInst->Send = NULL;
+    Ipb_IntfRxRelease(ptInst);
 }
 
 Ipb_EStatus Ipb_IntfReadUart(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
                              uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t* pu16Sz)
 {
+    return Ipb_IntfRead(ptInst, &Ipb_IntfUartReception,
+                        pu16SubNode, pu16Addr, pu16Cmd, pu16Data, pu16Sz);
+}
 
+Ipb_EStatus Ipb_IntfWriteUart(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
+                              uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t u16Sz)
+{
     if (ptInst->eState == IPB_STANDBY)
     {
-        ptInst->eState = IPB_READ_REQUEST;
+        ptInst->eState = IPB_WRITE_REQUEST;
     }
 
     switch (ptInst->eState)
     {
-        case IPB_READ_REQUEST:
-            /** UART read */
-            if (Ipb_IntfUartReception(ptInst->u16Id, (uint8_t*)&ptInst->Rxfrm,
-                    ((IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ + IPB_FRM_CRC_SZ) * sizeof(uint16_t))) != 0)
-            {
-                ptInst->Rxfrm.u16Sz = (IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ + IPB_FRM_CRC_SZ);
-
-                if (Ipb_FrameCheckCRC(&ptInst->Rxfrm) != false)
-                {
-                    *pu16SubNode = Ipb_FrameGetSubNode(&ptInst->Rxfrm);
-                    *pu16Addr = Ipb_FrameGetAddr(&ptInst->Rxfrm);
-                    *pu16Cmd = Ipb_FrameGetCmd(&ptInst->Rxfrm);
-                    *pu16Sz = Ipb_FrameGetConfigData(&ptInst->Rxfrm, pu16Data);
+        case IPB_WRITE_REQUEST:
+        {
+            ptInst->eState = IPB_ERROR;
 
-                    if (Ipb_FrameGetExtended(&ptInst->Rxfrm) != false)
-                    {
-                        uint16_t u16ExtSzBy = Ipb_IntfUartReception(ptInst->u16Id,
-                                             (uint8_t*)(ptInst->Rxfrm.pu16Buf + IPB_FRAME_TOTAL_CFG_SIZE), *pu16Data);
-                        memcpy((void*)pu16Data, (const void*)(ptInst->Rxfrm.pu16Buf + IPB_FRAME_TOTAL_CFG_SIZE), u16ExtSzBy);
-                        ptInst->Rxfrm.u16Sz += u16ExtSzBy /  sizeof(uint16_t);
-                        *pu16Sz = u16ExtSzBy / sizeof(uint16_t);
-                    }
+            if (Ipb_FrameCreateDesc(&ptInst->tTxDesc, *pu16SubNode, *pu16Addr, *pu16Cmd, pu16Data, u16Sz) == 0L)
+            {
+                ptInst->eState = IPB_SUCCESS;
 
-                    ptInst->eState = IPB_SUCCESS;
-                }
-                else
+                if (Ipb_IntfUartTransmissionV(ptInst->u16Id, ptInst->tTxDesc.ptIov, ptInst->tTxDesc.u16IovCnt)
+                        != false)
                 {
-                    /** CRC Error */
                     ptInst->eState = IPB_ERROR;
-                    Ipb_IntfUartDiscardData(ptInst->u16Id);
                 }
             }
+        }
             break;
         default:
-            ptInst->eState = IPB_STANDBY;
+            Ipb_IntfReset(ptInst);
             break;
     }
+
     return ptInst->eState;
 }
 
-Ipb_EStatus Ipb_IntfWriteUart(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
-                              uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t u16Sz)
+Ipb_EStatus Ipb_IntfSendUart(Ipb_TIntf* ptInst, const uint16_t* pu16Buf, uint16_t u16Sz)
+{
+    Ipb_EStatus eRet = IPB_SUCCESS;
+
+    if ((u16Sz > IPB_INTF_SEND_MAX_SZ)
+        || (Ipb_IntfUartTransmission(ptInst->u16Id, (const uint8_t*)pu16Buf, (u16Sz * sizeof(uint16_t))) != false))
+    {
+        eRet = IPB_ERROR;
+    }
+
+    return eRet;
+}
+
+Ipb_EStatus Ipb_IntfReadUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
+                            uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t* pu16Sz)
+{
+    return Ipb_IntfRead(ptInst, &Ipb_IntfUsbReception,
+                        pu16SubNode, pu16Addr, pu16Cmd, pu16Data, pu16Sz);
+}
+
+Ipb_EStatus Ipb_IntfWriteUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
+                             uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t u16Sz)
 {
     if (ptInst->eState == IPB_STANDBY)
     {
@@ -121,28 +229,47 @@ Ipb_EStatus Ipb_IntfWriteUart(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t
     {
         case IPB_WRITE_REQUEST:
         {
-            Ipb_FrameCreate(&ptInst->Txfrm, *pu16SubNode, *pu16Addr, *pu16Cmd, pu16Data, u16Sz, true);
-            ptInst->eState = IPB_SUCCESS;
 
-            if (Ipb_IntfUartTransmission(ptInst->u16Id, (const uint8_t*)ptInst->Txfrm.pu16Buf,
-                                         (ptInst->Txfrm.u16Sz * sizeof(uint16_t))) != false)
+            if (Ipb_FrameCreateDesc(&ptInst->tTxDesc, *pu16SubNode, *pu16Addr, *pu16Cmd, pu16Data, u16Sz) == 0L)
+            {
+                ptInst->eState = IPB_SUCCESS;
+
+                if (Ipb_IntfUsbTransmissionV(ptInst->u16Id, ptInst->tTxDesc.ptIov, ptInst->tTxDesc.u16IovCnt)
+                        != false)
+                {
+                    ptInst->eState = IPB_ERROR;
+                }
+            }
+            else
             {
                 ptInst->eState = IPB_ERROR;
             }
         }
             break;
         default:
-            ptInst->eState = IPB_STANDBY;
+            Ipb_IntfReset(ptInst);
             break;
     }
 
     return ptInst->eState;
 }
 
-Ipb_EStatus Ipb_IntfReadUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
-                            uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t* pu16Sz)
+Ipb_EStatus Ipb_IntfSendUsb(Ipb_TIntf* ptInst, const uint16_t* pu16Buf, uint16_t u16Sz)
 {
+    Ipb_EStatus eRet = IPB_SUCCESS;
+
+    if ((u16Sz > IPB_INTF_SEND_MAX_SZ)
+        || (Ipb_IntfUsbTransmission(ptInst->u16Id, (const uint8_t*)pu16Buf, (u16Sz * sizeof(uint16_t))) != false))
+    {
+        eRet = IPB_ERROR;
+    }
+
+    return eRet;
+}
 
+Ipb_EStatus Ipb_IntfReadEth(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
+                            uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t* pu16Sz)
+{
     if (ptInst->eState == IPB_STANDBY)
     {
         ptInst->eState = IPB_READ_REQUEST;
@@ -151,47 +278,83 @@ Ipb_EStatus Ipb_IntfReadUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t*
     switch (ptInst->eState)
     {
         case IPB_READ_REQUEST:
-            /** UART read */
-            if (Ipb_IntfUsbReception(ptInst->u16Id, (uint8_t*)&ptInst->Rxfrm,
-                    ((IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ + IPB_FRM_CRC_SZ) * sizeof(uint16_t))) != 0)
+        {
+            uint16_t u16RdBy;
+
+            /** Frame is only borrowed when a datagram may be pending */
+            if (Ipb_IntfWait(ptInst->u16Id, 0UL) == false)
             {
-                ptInst->Rxfrm.u16Sz = (IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ + IPB_FRM_CRC_SZ);
+                break;
+            }
 
-                if (Ipb_FrameCheckCRC(&ptInst->Rxfrm) != false)
+            /** Datagrams are received whole, any size may arrive */
+            Ipb_IntfRxRelease(ptInst);
+            ptInst->ptRxfrm = Ipb_PoolAlloc(IPB_FRM_MAX_DATA_SZ);
+            if (ptInst->ptRxfrm == NULL)
+            {
+                ptInst->eState = IPB_ERROR;
+                break;
+            }
+
+            u16RdBy = Ipb_IntfEthReception(ptInst->u16Id, (uint8_t*)ptInst->ptRxfrm->pu16Buf,
+                                           (uint16_t)sizeof(ptInst->ptRxfrm->pu16Buf));
+            if (u16RdBy == (uint16_t)0U)
+            {
+                Ipb_IntfRxRelease(ptInst);
+                break;
+            }
+
+            ptInst->eState = IPB_ERROR;
+            while (1)
+            {
+                if ((u16RdBy < IPB_FRM_CFG_SZ_BY)
+                    || (Ipb_FrameCheckSync(ptInst->ptRxfrm) == false))
                 {
-                    *pu16SubNode = Ipb_FrameGetSubNode(&ptInst->Rxfrm);
-                    *pu16Addr = Ipb_FrameGetAddr(&ptInst->Rxfrm);
-                    *pu16Cmd = Ipb_FrameGetCmd(&ptInst->Rxfrm);
-                    *pu16Sz = Ipb_FrameGetConfigData(&ptInst->Rxfrm, pu16Data);
+                    break;
+                }
 
-                    if (Ipb_FrameGetExtended(&ptInst->Rxfrm) != false)
-                    {
-                        uint16_t u16ExtSz = Ipb_IntfUsbReception(ptInst->u16Id,
-                                             (uint8_t*)(ptInst->Rxfrm.pu16Buf + IPB_FRAME_TOTAL_CFG_SIZE), *pu16Data);
-                        memcpy((void*)(pu16Data + (*pu16Sz)),
-                               (const void*)(ptInst->Rxfrm.pu16Buf + IPB_FRAME_TOTAL_CFG_SIZE), (u16ExtSz * sizeof(uint16_t)));
-                        ptInst->Rxfrm.u16Sz += u16ExtSz;
-                        *pu16Sz += u16ExtSz;
-                    }
+                if (Ipb_CrcUpdate(IPB_CRC_START, (const uint8_t*)ptInst->ptRxfrm->pu16Buf, IPB_FRM_CRC_DATA_SZ_BY)
+                        != ptInst->ptRxfrm->pu16Buf[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ])
+                {
+                    /** CRC Error */
+                    break;
+                }
 
-                    ptInst->eState = IPB_SUCCESS;
+                /** Datagram must hold exactly one frame */
+                ptInst->ptRxfrm->u16Sz = Ipb_FrameGetEncodedSz(ptInst->ptRxfrm->pu16Buf);
+                if ((ptInst->ptRxfrm->u16Sz * sizeof(uint16_t)) != u16RdBy)
+                {
+                    break;
+                }
+
+                *pu16SubNode = Ipb_FrameGetSubNode(ptInst->ptRxfrm);
+                *pu16Addr = Ipb_FrameGetAddr(ptInst->ptRxfrm);
+                *pu16Cmd = Ipb_FrameGetCmd(ptInst->ptRxfrm);
+                if (Ipb_FrameGetExtended(ptInst->ptRxfrm) == false)
+                {
+                    *pu16Sz = Ipb_FrameGetConfigData(ptInst->ptRxfrm, pu16Data);
                 }
                 else
                 {
-                    /** CRC Error */
-                    ptInst->eState = IPB_ERROR;
-                    Ipb_IntfUsbDiscardData(ptInst->u16Id);
+                    *pu16Sz = ptInst->ptRxfrm->u16Sz - IPB_FRAME_TOTAL_CFG_SIZE;
+                    memcpy((void*)pu16Data, (const void*)(ptInst->ptRxfrm->pu16Buf + IPB_FRAME_TOTAL_CFG_SIZE),
+                           (*pu16Sz * sizeof(uint16_t)));
                 }
+                ptInst->eState = IPB_SUCCESS;
+                break;
             }
+            Ipb_IntfRxRelease(ptInst);
+        }
             break;
         default:
-            ptInst->eState = IPB_STANDBY;
+            Ipb_IntfReset(ptInst);
             break;
     }
+
     return ptInst->eState;
 }
 
-Ipb_EStatus Ipb_IntfWriteUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
+Ipb_EStatus Ipb_IntfWriteEth(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
                              uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t u16Sz)
 {
     if (ptInst->eState == IPB_STANDBY)
@@ -203,28 +366,243 @@ Ipb_EStatus Ipb_IntfWriteUsb(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t*
     {
         case IPB_WRITE_REQUEST:
         {
+            ptInst->eState = IPB_ERROR;
 
-            if (u16Sz <= IPB_MAX_DATA_SZ)
+            if (Ipb_FrameCreateDesc(&ptInst->tTxDesc, *pu16SubNode, *pu16Addr, *pu16Cmd, pu16Data, u16Sz) == 0L)
             {
-                Ipb_FrameCreate(&ptInst->Txfrm, *pu16SubNode, *pu16Addr, *pu16Cmd, pu16Data, u16Sz, true);
                 ptInst->eState = IPB_SUCCESS;
 
-                if (Ipb_IntfUsbTransmission(ptInst->u16Id, (const uint8_t*)ptInst->Txfrm.pu16Buf, ptInst->Txfrm.u16Sz)
+                if (Ipb_IntfEthTransmissionV(ptInst->u16Id, ptInst->tTxDesc.ptIov, ptInst->tTxDesc.u16IovCnt)
                         != false)
                 {
                     ptInst->eState = IPB_ERROR;
                 }
             }
-            else
+        }
+            break;
+        default:
+            Ipb_IntfReset(ptInst);
+            break;
+    }
+
+    return ptInst->eState;
+}
+
+Ipb_EStatus Ipb_IntfSendEth(Ipb_TIntf* ptInst, const uint16_t* pu16Buf, uint16_t u16Sz)
+{
+    Ipb_EStatus eRet = IPB_SUCCESS;
+    Ipb_TFrameIov ptFrm[IPB_INTF_ETH_TX_BATCH];
+    uint16_t u16FrmCnt = (uint16_t)0U;
+    uint16_t u16Idx = (uint16_t)0U;
+
+    /** Split back to back frames into datagrams, flushed in batches */
+    while ((u16Idx < u16Sz) && (eRet == IPB_SUCCESS))
+    {
+        uint16_t u16FrmSz = IPB_FRAME_TOTAL_CFG_SIZE;
+
+        if ((uint16_t)(u16Sz - u16Idx) >= (uint16_t)IPB_FRAME_TOTAL_CFG_SIZE)
+        {
+            u16FrmSz = Ipb_FrameGetEncodedSz(&pu16Buf[u16Idx]);
+        }
+        if (u16FrmSz > (uint16_t)(u16Sz - u16Idx))
+        {
+            eRet = IPB_ERROR;
+            break;
+        }
+
+        ptFrm[u16FrmCnt].pu8Buf = (const uint8_t*)&pu16Buf[u16Idx];
+        ptFrm[u16FrmCnt].u16SzBy = u16FrmSz * sizeof(uint16_t);
+        u16FrmCnt++;
+        u16Idx += u16FrmSz;
+
+        if ((u16FrmCnt == IPB_INTF_ETH_TX_BATCH) || (u16Idx >= u16Sz))
+        {
+            if (Ipb_IntfEthTransmissionM(ptInst->u16Id, ptFrm, u16FrmCnt) != false)
+            {
+                eRet = IPB_ERROR;
+            }
+            u16FrmCnt = (uint16_t)0U;
+        }
+    }
+
+    return eRet;
+}
+
+static Ipb_EStatus Ipb_IntfRead(Ipb_TIntf* ptInst, uint16_t (*Reception)(uint16_t, uint8_t*, uint16_t),
+                                uint16_t* pu16SubNode, uint16_t* pu16Addr, uint16_t* pu16Cmd,
+                                uint16_t* pu16Data, uint16_t* pu16Sz)
+{
+    uint16_t u16RdBy;
+
+    if (ptInst->eState == IPB_STANDBY)
+    {
+        Ipb_IntfReset(ptInst);
+        ptInst->eState = IPB_READ_REQUEST;
+    }
+
+    switch (ptInst->eState)
+    {
+        case IPB_READ_REQUEST:
+        {
+            /** Header and config data are received into the instance */
+            uint8_t* pu8Rx = (uint8_t*)ptInst->pu16RxHead;
+            uint16_t u16ExtSzBy;
+            bool isHead;
+
+            /** Receive header and config data, crc is updated with each chunk */
+            do
+            {
+                u16RdBy = Reception(ptInst->u16Id, (pu8Rx + ptInst->u16RxSzBy),
+                                    (IPB_FRM_CFG_SZ_BY - ptInst->u16RxSzBy));
+                if (ptInst->u16RxSzBy < IPB_FRM_CRC_DATA_SZ_BY)
+                {
+                    uint16_t u16CrcBy = IPB_FRM_CRC_DATA_SZ_BY - ptInst->u16RxSzBy;
+
+                    if (u16RdBy < u16CrcBy)
+                    {
+                        u16CrcBy = u16RdBy;
+                    }
+                    ptInst->u16RxCrc = Ipb_CrcUpdate(ptInst->u16RxCrc, (pu8Rx + ptInst->u16RxSzBy), u16CrcBy);
+                }
+                ptInst->u16RxSzBy += u16RdBy;
+
+                isHead = Ipb_IntfRxCheck(ptInst);
+            } while ((isHead == false) && (u16RdBy > (uint16_t)0U));
+
+            if (isHead == false)
+            {
+                break;
+            }
+
+            if ((ptInst->pu16RxHead[IPB_FRM_CMD_IDX] & IPB_FRM_EXT_MASK) == (uint16_t)IPB_FRM_NOTEXT)
+            {
+                Ipb_IntfRxHead(ptInst, pu16SubNode, pu16Addr, pu16Cmd);
+                memcpy((void*)pu16Data, (const void*)&ptInst->pu16RxHead[IPB_FRM_CFG_IDX],
+                       (IPB_FRM_CONFIG_SZ * sizeof(uint16_t)));
+                *pu16Sz = IPB_FRM_CONFIG_SZ;
+                ptInst->eState = IPB_SUCCESS;
+                break;
+            }
+
+            /** First config word holds the extended data size in bytes */
+            u16ExtSzBy = ptInst->pu16RxHead[IPB_FRM_CFG_IDX];
+
+            /** Borrow a frame only for the extended data announced */
+            Ipb_IntfRxRelease(ptInst);
+            ptInst->ptRxfrm = Ipb_PoolAlloc((uint16_t)((u16ExtSzBy + sizeof(uint16_t) - 1U) / sizeof(uint16_t)));
+            if (ptInst->ptRxfrm == NULL)
             {
+                /** Extended data left in the stream is skipped by the next read */
                 ptInst->eState = IPB_ERROR;
+                break;
+            }
+            ptInst->ptRxfrm->u16Sz = (uint16_t)0U;
+            ptInst->u16RxSzBy = (uint16_t)0U;
+            ptInst->eState = IPB_READ_ANSWER;
+        }
+            /* fall through */
+        case IPB_READ_ANSWER:
+        {
+            /** Receive extended data */
+            uint8_t* pu8Rx = (uint8_t*)ptInst->ptRxfrm->pu16Buf;
+            uint16_t u16ExtSzBy = ptInst->pu16RxHead[IPB_FRM_CFG_IDX];
+
+            if (ptInst->u16RxSzBy < u16ExtSzBy)
+            {
+                ptInst->u16RxSzBy += Reception(ptInst->u16Id, (pu8Rx + ptInst->u16RxSzBy),
+                                               (u16ExtSzBy - ptInst->u16RxSzBy));
+            }
+
+            if (ptInst->u16RxSzBy >= u16ExtSzBy)
+            {
+                Ipb_IntfRxHead(ptInst, pu16SubNode, pu16Addr, pu16Cmd);
+                memcpy((void*)pu16Data, (const void*)ptInst->ptRxfrm->pu16Buf, u16ExtSzBy);
+                *pu16Sz = u16ExtSzBy / sizeof(uint16_t);
+                ptInst->eState = IPB_SUCCESS;
+                Ipb_IntfRxRelease(ptInst);
             }
         }
             break;
         default:
-            ptInst->eState = IPB_STANDBY;
+            Ipb_IntfReset(ptInst);
             break;
     }
 
     return ptInst->eState;
 }
+
+static bool Ipb_IntfRxCheck(Ipb_TIntf* ptInst)
+{
+    bool isHead = false;
+
+    while (ptInst->u16RxSzBy >= IPB_FRM_SYNC_SZ_BY)
+    {
+        if ((ptInst->pu16RxHead[IPB_FRM_NODE_IDX] >> IPB_FRM_SYNC_POS) != (uint16_t)IPB_FRM_SYNC_MARK)
+        {
+            Ipb_IntfRxSlide(ptInst);
+            continue;
+        }
+
+        if (ptInst->u16RxSzBy < IPB_FRM_CFG_SZ_BY)
+        {
+            break;
+        }
+
+        if (ptInst->u16RxCrc != ptInst->pu16RxHead[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ])
+        {
+            /** CRC Error, search next header */
+            ptInst->u32RxCrcErr++;
+            Ipb_IntfRxSlide(ptInst);
+            continue;
+        }
+
+        if (((ptInst->pu16RxHead[IPB_FRM_CMD_IDX] & IPB_FRM_EXT_MASK) != (uint16_t)IPB_FRM_NOTEXT)
+            && ((ptInst->pu16RxHead[IPB_FRM_CFG_IDX] > IPB_FRM_MAX_EXT_SZ_BY)
+                || ((ptInst->pu16RxHead[IPB_FRM_CFG_IDX] & (uint16_t)1U) != (uint16_t)0U)))
+        {
+            /** Invalid extended size */
+            Ipb_IntfRxSlide(ptInst);
+            continue;
+        }
+
+        isHead = true;
+        break;
+    }
+
+    return isHead;
+}
+
+static void Ipb_IntfRxSlide(Ipb_TIntf* ptInst)
+{
+    uint8_t* pu8Rx = (uint8_t*)ptInst->pu16RxHead;
+    uint16_t u16CrcBy;
+
+    ptInst->u16RxSzBy--;
+    memmove((void*)pu8Rx, (const void*)(pu8Rx + 1U), ptInst->u16RxSzBy);
+    ptInst->u32RxDropBy++;
+
+    /** Running crc restarts from the new first byte */
+    u16CrcBy = ptInst->u16RxSzBy;
+    if (u16CrcBy > IPB_FRM_CRC_DATA_SZ_BY)
+    {
+        u16CrcBy = IPB_FRM_CRC_DATA_SZ_BY;
+    }
+    ptInst->u16RxCrc = Ipb_CrcUpdate(IPB_CRC_START, pu8Rx, u16CrcBy);
+}
+
+static void Ipb_IntfRxHead(const Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
+                           uint16_t* pu16Cmd)
+{
+    *pu16SubNode = ptInst->pu16RxHead[IPB_FRM_NODE_IDX] & IPB_FRM_NODE_MASK;
+    *pu16Addr = ptInst->pu16RxHead[IPB_FRM_CMD_IDX] >> IPB_FRM_ADDR_POS;
+    *pu16Cmd = (ptInst->pu16RxHead[IPB_FRM_CMD_IDX] >> IPB_FRM_CMD_POS) & IPB_FRM_CMD_MASK;
+}
+
+static void Ipb_IntfRxRelease(Ipb_TIntf* ptInst)
+{
+    if (ptInst->ptRxfrm != NULL)
+    {
+        Ipb_PoolFree(ptInst->ptRxfrm);
+        ptInst->ptRxfrm = NULL;
+    }
+}
@@ -16,6 +16,9 @@
 #include "ipb_frame.h"
 #include "ipb_usr.h"
 
+/** Max size in words handed to Send, the transmission size in bytes takes 16 bits */
+#define IPB_INTF_SEND_MAX_SZ    (uint16_t)(UINT16_MAX / sizeof(uint16_t))
+
 /** Ipb communication states */
 typedef enum
 {
@@ -60,22 +63,41 @@ struct Ipb_TIntf
     Ipb_EStatus eState;
     /** Indicates the interface type */
     Ipb_EIntf eIntf;
-    /** Frame pool for holding tx data */
-    Ipb_TFrame Txfrm;
-    /** Frame pool for holding rx data */
-    Ipb_TFrame Rxfrm;
+    /** Frame descriptor for holding tx header, config data and crc */
+    Ipb_TFrameDesc tTxDesc;
+    /** Header, config data and crc of the rx frame */
+    uint16_t pu16RxHead[IPB_FRAME_TOTAL_CFG_SIZE];
+    /** Frame borrowed from the pool for rx extended data, NULL otherwise */
+    Ipb_TFrame* ptRxfrm;
+    /** Number of bytes of the rx header, then extended data, already received */
+    uint16_t u16RxSzBy;
+    /** Running crc of the rx frame header and config data */
+    uint16_t u16RxCrc;
+    /** Number of rx bytes skipped while resynchronising */
+    uint32_t u32RxDropBy;
+    /** Number of rx headers rejected by crc */
+    uint32_t u32RxCrcErr;
     /** Write frame */
     Ipb_EStatus (*Write)(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
             uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t u16Sz);
     /** Read frame */
     Ipb_EStatus (*Read)(Ipb_TIntf* ptInst, uint16_t* pu16SubNode, uint16_t* pu16Addr,
             uint16_t* pu16Cmd, uint16_t* pu16Data, uint16_t* pu16Sz);
+    /** Send already encoded frames with a single transmission, up to IPB_INTF_SEND_MAX_SZ words */
+    Ipb_EStatus (*Send)(Ipb_TIntf* ptInst, const uint16_t* pu16Buf, uint16_t u16Sz);
 };
 
 /** Initialize a High speed protocol interface */
 void
 Ipb_IntfInit(Ipb_TIntf* ptInst, Ipb_EIntf eIntf, uint16_t u16Id);
 
+/**
+ * Abandons the transaction in progress, e.g. on timeout, returning the
+ * interface to stand by and its rx frame to the pool
+ */
+void
+Ipb_IntfReset(Ipb_TIntf* ptInst);
+
 /** Deinitialize a high speed protocol interface */
 void
 Ipb_IntfDeinit(Ipb_TIntf* ptInst);
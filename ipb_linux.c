@@ -0,0 +1,39 @@
+/**
+ * @file ipb_linux.c
+ * @brief This file contains the platform functions of the
+ *        ingenia protocol bus (IPB) for Linux hosts
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <time.h>
+
+uint32_t Ipb_GetMillis(void)
+{
+    struct timespec tTs;
+
+    /** Monotonic clock is not affected by wall time changes */
+    (void)clock_gettime(CLOCK_MONOTONIC, &tTs);
+
+    return (uint32_t)(((uint64_t)tTs.tv_sec * 1000ULL) + ((uint64_t)tTs.tv_nsec / 1000000ULL));
+}
+
+uint32_t Ipb_GetMicros(void)
+{
+    struct timespec tTs;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &tTs);
+
+    return (uint32_t)(((uint64_t)tTs.tv_sec * 1000000ULL) + ((uint64_t)tTs.tv_nsec / 1000ULL));
+}
+
+#endif /* __linux__ */
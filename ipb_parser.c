@@ -0,0 +1,162 @@
+/**
+ * @file ipb_parser.c
+ * @brief This file contains a streaming frame parser for
+ *        byte oriented links of the ingenia protocol bus (IPB)
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_parser.h"
+#include "ipb_crc.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Returns the number of bytes required to progress with the current frame
+ *
+ * @param[in] ptParser
+ *  Parser instance
+ */
+static uint16_t
+Ipb_ParserNeeded(const Ipb_TParser* ptParser);
+
+/**
+ * Validates the buffered bytes, drops invalid ones and emits complete frames
+ *
+ * @param[in] ptParser
+ *  Parser instance
+ */
+static void
+Ipb_ParserCheck(Ipb_TParser* ptParser);
+
+/**
+ * Drops the first buffered byte to search the next header
+ *
+ * @param[in] ptParser
+ *  Parser instance
+ */
+static void
+Ipb_ParserSlide(Ipb_TParser* ptParser);
+
+void Ipb_ParserInit(Ipb_TParser* ptParser, void (*OnFrame)(void* pvCtx, const Ipb_TFrame* ptFrame),
+                    void* pvCtx)
+{
+    ptParser->OnFrame = OnFrame;
+    ptParser->pvCtx = pvCtx;
+    ptParser->u32DropBy = (uint32_t)0UL;
+    ptParser->u32CrcErr = (uint32_t)0UL;
+    Ipb_ParserReset(ptParser);
+}
+
+void Ipb_ParserReset(Ipb_TParser* ptParser)
+{
+    ptParser->u16SzBy = (uint16_t)0U;
+    ptParser->tFrm.u16Sz = (uint16_t)0U;
+}
+
+void Ipb_ParserFeed(Ipb_TParser* ptParser, const uint8_t* pu8Buf, uint16_t u16SzBy)
+{
+    uint8_t* pu8Frm = (uint8_t*)ptParser->tFrm.pu16Buf;
+
+    do
+    {
+        /** Only buffer the bytes of the current frame */
+        uint16_t u16CpyBy = Ipb_ParserNeeded(ptParser) - ptParser->u16SzBy;
+
+        if (u16CpyBy > u16SzBy)
+        {
+            u16CpyBy = u16SzBy;
+        }
+
+        memcpy((void*)(pu8Frm + ptParser->u16SzBy), (const void*)pu8Buf, u16CpyBy);
+        ptParser->u16SzBy += u16CpyBy;
+        pu8Buf += u16CpyBy;
+        u16SzBy -= u16CpyBy;
+
+        Ipb_ParserCheck(ptParser);
+    } while (u16SzBy > (uint16_t)0U);
+}
+
+static uint16_t Ipb_ParserNeeded(const Ipb_TParser* ptParser)
+{
+    uint16_t u16NeedBy = IPB_FRM_SYNC_SZ_BY;
+
+    if (ptParser->u16SzBy >= IPB_FRM_CFG_SZ_BY)
+    {
+        u16NeedBy = IPB_FRM_CFG_SZ_BY;
+
+        if (Ipb_FrameGetExtended(&ptParser->tFrm) != false)
+        {
+            /** First config word holds the extended data size in bytes */
+            u16NeedBy += ptParser->tFrm.pu16Buf[IPB_FRM_CFG_IDX];
+        }
+    }
+    else if (ptParser->u16SzBy >= IPB_FRM_SYNC_SZ_BY)
+    {
+        u16NeedBy = IPB_FRM_CFG_SZ_BY;
+    }
+
+    return u16NeedBy;
+}
+
+static void Ipb_ParserCheck(Ipb_TParser* ptParser)
+{
+    while (ptParser->u16SzBy >= IPB_FRM_SYNC_SZ_BY)
+    {
+        if (Ipb_FrameCheckSync(&ptParser->tFrm) == false)
+        {
+            Ipb_ParserSlide(ptParser);
+            continue;
+        }
+
+        if (ptParser->u16SzBy < IPB_FRM_CFG_SZ_BY)
+        {
+            break;
+        }
+
+        if (ptParser->u16SzBy == IPB_FRM_CFG_SZ_BY)
+        {
+            uint16_t u16Crc = Ipb_CrcUpdate(IPB_CRC_START, (const uint8_t*)ptParser->tFrm.pu16Buf,
+                                            IPB_FRM_CRC_DATA_SZ_BY);
+
+            if (u16Crc != ptParser->tFrm.pu16Buf[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ])
+            {
+                /** CRC Error, search next header */
+                ptParser->u32CrcErr++;
+                Ipb_ParserSlide(ptParser);
+                continue;
+            }
+
+            if ((Ipb_FrameGetExtended(&ptParser->tFrm) != false)
+                && ((ptParser->tFrm.pu16Buf[IPB_FRM_CFG_IDX] > IPB_FRM_MAX_EXT_SZ_BY)
+                    || ((ptParser->tFrm.pu16Buf[IPB_FRM_CFG_IDX] & (uint16_t)1U) != (uint16_t)0U)))
+            {
+                /** Invalid extended size */
+                Ipb_ParserSlide(ptParser);
+                continue;
+            }
+        }
+
+        if (ptParser->u16SzBy < Ipb_ParserNeeded(ptParser))
+        {
+            break;
+        }
+
+        ptParser->tFrm.u16Sz = ptParser->u16SzBy / sizeof(uint16_t);
+        if (ptParser->OnFrame != NULL)
+        {
+            ptParser->OnFrame(ptParser->pvCtx, &ptParser->tFrm);
+        }
+        ptParser->u16SzBy = (uint16_t)0U;
+    }
+}
+
+static void Ipb_ParserSlide(Ipb_TParser* ptParser)
+{
+    uint8_t* pu8Frm = (uint8_t*)ptParser->tFrm.pu16Buf;
+
+    ptParser->u16SzBy--;
+    memmove((void*)pu8Frm, (const void*)(pu8Frm + 1U), ptParser->u16SzBy);
+    ptParser->u32DropBy++;
+}
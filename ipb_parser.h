@@ -0,0 +1,77 @@
+/**
+ * @file ipb_parser.h
+ * @brief This file contains a streaming frame parser for
+ *        byte oriented links of the ingenia protocol bus (IPB)
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_PARSER_H
+#define IPB_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb_frame.h"
+
+typedef struct Ipb_TParser Ipb_TParser;
+
+/** Ingenia protocol bus streaming parser */
+struct Ipb_TParser
+{
+    /** Frame being assembled */
+    Ipb_TFrame tFrm;
+    /** Number of bytes buffered into the frame */
+    uint16_t u16SzBy;
+    /** Complete frame callback */
+    void (*OnFrame)(void* pvCtx, const Ipb_TFrame* ptFrame);
+    /** User context of the callback */
+    void* pvCtx;
+    /** Number of bytes skipped while resynchronising */
+    uint32_t u32DropBy;
+    /** Number of headers rejected by crc */
+    uint32_t u32CrcErr;
+};
+
+/**
+ * Initialises a streaming parser
+ *
+ * @param[out] ptParser
+ *  Parser instance
+ * @param[in] OnFrame
+ *  Callback called for each complete frame, the frame is only valid
+ *  during the call
+ * @param[in] pvCtx
+ *  User context passed to the callback
+ */
+void
+Ipb_ParserInit(Ipb_TParser* ptParser, void (*OnFrame)(void* pvCtx, const Ipb_TFrame* ptFrame),
+               void* pvCtx);
+
+/**
+ * Discards any partially received frame
+ *
+ * @param[in] ptParser
+ *  Parser instance
+ */
+void
+Ipb_ParserReset(Ipb_TParser* ptParser);
+
+/**
+ * Feeds a chunk of received bytes into the parser
+ *
+ * @note Chunks may split frames at any byte. When a header fails the
+ *  crc check, parser slides one byte and searches the next header
+ *  holding the synchronisation mark, instead of discarding the stream.
+ *
+ * @param[in] ptParser
+ *  Parser instance
+ * @param[in] pu8Buf
+ *  Received bytes
+ * @param[in] u16SzBy
+ *  Number of received bytes
+ */
+void
+Ipb_ParserFeed(Ipb_TParser* ptParser, const uint8_t* pu8Buf, uint16_t u16SzBy);
+
+#endif /* IPB_PARSER_H */
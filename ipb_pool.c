@@ -0,0 +1,273 @@
+/**
+ * @file ipb_pool.c
+ * @brief This file contains the frame and message pool shared by
+ *        the ingenia protocol bus (IPB) interfaces
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_pool.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/** Free list head: tag in the upper half against ABA, index + 1 in the lower */
+#define IPB_POOL_HEAD_IDX_MSK   (uint32_t)0x0000FFFFUL
+#define IPB_POOL_HEAD_TAG_INC   (uint32_t)0x00010000UL
+
+/** Pool size class, lock-free for any number of producers and consumers */
+typedef struct
+{
+    /** Objects storage */
+    uint8_t* pu8Base;
+    /** Size in bytes of each object */
+    uint16_t u16ObjSz;
+    /** Number of words each frame holds */
+    uint16_t u16Cap;
+    /** Number of objects */
+    uint16_t u16Num;
+    /** Free list links, index + 1, 0 is end of list */
+    _Atomic uint16_t* pu16Next;
+    /** Free list head, tagged index + 1, 0 index if empty */
+    _Atomic uint32_t u32Head;
+    /** Objects from this index on have never been borrowed */
+    _Atomic uint16_t u16Fresh;
+    /** Number of objects borrowed */
+    _Atomic uint16_t u16InUse;
+    /** Max number of objects borrowed at once */
+    _Atomic uint16_t u16HighWater;
+} Ipb_TPoolClass;
+
+/** Objects storage */
+static Ipb_TFrame ptPoolCfgFrm[IPB_POOL_CFG_FRM_NUM];
+static Ipb_TFrame ptPoolExtFrm[IPB_POOL_EXT_FRM_NUM];
+static Ipb_TMsg ptPoolMsg[IPB_POOL_MSG_NUM];
+
+/** Free list links */
+static _Atomic uint16_t pu16PoolCfgNext[IPB_POOL_CFG_FRM_NUM];
+static _Atomic uint16_t pu16PoolExtNext[IPB_POOL_EXT_FRM_NUM];
+static _Atomic uint16_t pu16PoolMsgNext[IPB_POOL_MSG_NUM];
+
+/** Size classes, frames ordered by capacity. Free lists need no initialisation */
+static Ipb_TPoolClass ptPoolClass[IPB_POOL_CLASS_NUM] =
+{
+    { (uint8_t*)ptPoolCfgFrm, (uint16_t)sizeof(Ipb_TFrame), (uint16_t)IPB_FRAME_TOTAL_CFG_SIZE,
+      (uint16_t)IPB_POOL_CFG_FRM_NUM, pu16PoolCfgNext, 0U, 0U, 0U, 0U },
+    { (uint8_t*)ptPoolExtFrm, (uint16_t)sizeof(Ipb_TFrame), (uint16_t)IPB_FRM_MAX_DATA_SZ,
+      (uint16_t)IPB_POOL_EXT_FRM_NUM, pu16PoolExtNext, 0U, 0U, 0U, 0U },
+    { (uint8_t*)ptPoolMsg, (uint16_t)sizeof(Ipb_TMsg), (uint16_t)0U,
+      (uint16_t)IPB_POOL_MSG_NUM, pu16PoolMsgNext, 0U, 0U, 0U, 0U }
+};
+
+/**
+ * Takes an object from a class
+ *
+ * @param[in] ptClass
+ *  Size class
+ *
+ * @retval pointer to object if success, NULL if class is exhausted
+ */
+static void*
+Ipb_PoolClassGet(Ipb_TPoolClass* ptClass);
+
+/**
+ * Returns an object to its class
+ *
+ * @param[in] ptClass
+ *  Size class
+ * @param[in] pvObj
+ *  Object to be returned
+ *
+ * @retval true if object belongs to the class
+ */
+static bool
+Ipb_PoolClassPut(Ipb_TPoolClass* ptClass, void* pvObj);
+
+Ipb_TFrame* Ipb_PoolAlloc(uint16_t u16Sz)
+{
+    Ipb_TFrame* ptFrame = NULL;
+
+    for (uint16_t u16Class = (uint16_t)IPB_POOL_CFG; u16Class <= (uint16_t)IPB_POOL_EXT; ++u16Class)
+    {
+        /** Exhausted classes fall back to a bigger one */
+        if (u16Sz <= ptPoolClass[u16Class].u16Cap)
+        {
+            ptFrame = (Ipb_TFrame*)Ipb_PoolClassGet(&ptPoolClass[u16Class]);
+            if (ptFrame != NULL)
+            {
+                ptFrame->u16Sz = (uint16_t)0U;
+                break;
+            }
+        }
+    }
+
+    return ptFrame;
+}
+
+void Ipb_PoolFree(Ipb_TFrame* ptFrame)
+{
+    for (uint16_t u16Class = (uint16_t)IPB_POOL_CFG; u16Class <= (uint16_t)IPB_POOL_EXT; ++u16Class)
+    {
+        if (Ipb_PoolClassPut(&ptPoolClass[u16Class], (void*)ptFrame) != false)
+        {
+            break;
+        }
+    }
+}
+
+Ipb_TMsg* Ipb_PoolMsgAlloc(void)
+{
+    return (Ipb_TMsg*)Ipb_PoolClassGet(&ptPoolClass[IPB_POOL_MSG]);
+}
+
+void Ipb_PoolMsgFree(Ipb_TMsg* ptMsg)
+{
+    (void)Ipb_PoolClassPut(&ptPoolClass[IPB_POOL_MSG], (void*)ptMsg);
+}
+
+Ipb_TMsg* Ipb_PoolTransfer(Ipb_TInst* ptInst, uint16_t u16SubNode, uint16_t u16Addr, uint16_t u16Cmd,
+                           const uint16_t* pu16Data, uint16_t u16Size, uint32_t u32Timeout)
+{
+    Ipb_TMsg* ptMsg = NULL;
+    uint32_t u32Millis = Ipb_GetMillis();
+    uint32_t u32Elapsed;
+
+    while (1)
+    {
+        if ((ptInst->eMode != IPB_BLOCKING) || (u16Size > (uint16_t)IPB_MAX_DATA_SZ))
+        {
+            break;
+        }
+
+        ptMsg = Ipb_PoolMsgAlloc();
+        if (ptMsg == NULL)
+        {
+            break;
+        }
+
+        ptMsg->u16SubNode = u16SubNode;
+        ptMsg->u16Addr = u16Addr;
+        ptMsg->u16Cmd = u16Cmd;
+        ptMsg->u16Size = u16Size;
+        for (uint16_t u16Idx = (uint16_t)0U; u16Idx < u16Size; ++u16Idx)
+        {
+            ptMsg->pu16Data[u16Idx] = pu16Data[u16Idx];
+        }
+
+        if (Ipb_Write(ptInst, ptMsg, u32Timeout) == IPB_SUCCESS)
+        {
+            u32Elapsed = Ipb_GetMillis() - u32Millis;
+            if ((u32Elapsed < u32Timeout)
+                && (Ipb_Read(ptInst, ptMsg, (u32Timeout - u32Elapsed)) == IPB_SUCCESS))
+            {
+                break;
+            }
+        }
+
+        Ipb_PoolMsgFree(ptMsg);
+        ptMsg = NULL;
+        break;
+    }
+
+    return ptMsg;
+}
+
+uint16_t Ipb_PoolGetInUse(Ipb_EPoolClass eClass)
+{
+    return atomic_load_explicit(&ptPoolClass[eClass].u16InUse, memory_order_relaxed);
+}
+
+uint16_t Ipb_PoolGetHighWater(Ipb_EPoolClass eClass)
+{
+    return atomic_load_explicit(&ptPoolClass[eClass].u16HighWater, memory_order_relaxed);
+}
+
+static void* Ipb_PoolClassGet(Ipb_TPoolClass* ptClass)
+{
+    void* pvObj = NULL;
+    uint32_t u32Head = atomic_load_explicit(&ptClass->u32Head, memory_order_acquire);
+    uint32_t u32NewHead;
+    uint16_t u16Idx = (uint16_t)0U;
+    bool isFound = false;
+
+    /** Pop from the free list, tag changes on every update */
+    while ((u32Head & IPB_POOL_HEAD_IDX_MSK) != (uint32_t)0UL)
+    {
+        u16Idx = (uint16_t)(u32Head & IPB_POOL_HEAD_IDX_MSK) - (uint16_t)1U;
+        u32NewHead = ((u32Head + IPB_POOL_HEAD_TAG_INC) & ~IPB_POOL_HEAD_IDX_MSK)
+                     | (uint32_t)atomic_load_explicit(&ptClass->pu16Next[u16Idx], memory_order_relaxed);
+
+        if (atomic_compare_exchange_weak_explicit(&ptClass->u32Head, &u32Head, u32NewHead,
+                                                  memory_order_acquire, memory_order_acquire) != false)
+        {
+            isFound = true;
+            break;
+        }
+    }
+
+    /** Free list empty, take an object never borrowed */
+    if (isFound == false)
+    {
+        uint16_t u16Fresh = atomic_load_explicit(&ptClass->u16Fresh, memory_order_relaxed);
+
+        while (u16Fresh < ptClass->u16Num)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ptClass->u16Fresh, &u16Fresh, (uint16_t)(u16Fresh + 1U),
+                                                      memory_order_relaxed, memory_order_relaxed) != false)
+            {
+                u16Idx = u16Fresh;
+                isFound = true;
+                break;
+            }
+        }
+    }
+
+    if (isFound != false)
+    {
+        uint16_t u16InUse = atomic_fetch_add_explicit(&ptClass->u16InUse, 1U, memory_order_relaxed) + 1U;
+        uint16_t u16HighWater = atomic_load_explicit(&ptClass->u16HighWater, memory_order_relaxed);
+
+        while ((u16InUse > u16HighWater)
+               && (atomic_compare_exchange_weak_explicit(&ptClass->u16HighWater, &u16HighWater, u16InUse,
+                                                         memory_order_relaxed, memory_order_relaxed) == false))
+        {
+        }
+
+        pvObj = (void*)(ptClass->pu8Base + ((size_t)u16Idx * ptClass->u16ObjSz));
+    }
+
+    return pvObj;
+}
+
+static bool Ipb_PoolClassPut(Ipb_TPoolClass* ptClass, void* pvObj)
+{
+    bool isOwner = false;
+    uint8_t* pu8Obj = (uint8_t*)pvObj;
+
+    if ((pu8Obj >= ptClass->pu8Base)
+        && (pu8Obj < (ptClass->pu8Base + ((size_t)ptClass->u16Num * ptClass->u16ObjSz))))
+    {
+        uint16_t u16Idx = (uint16_t)((size_t)(pu8Obj - ptClass->pu8Base) / ptClass->u16ObjSz);
+        uint32_t u32Head = atomic_load_explicit(&ptClass->u32Head, memory_order_relaxed);
+        uint32_t u32NewHead;
+
+        /** Accounted before the object can be borrowed again */
+        atomic_fetch_sub_explicit(&ptClass->u16InUse, 1U, memory_order_relaxed);
+
+        /** Push into the free list */
+        do
+        {
+            atomic_store_explicit(&ptClass->pu16Next[u16Idx], (uint16_t)(u32Head & IPB_POOL_HEAD_IDX_MSK),
+                                  memory_order_relaxed);
+            u32NewHead = ((u32Head + IPB_POOL_HEAD_TAG_INC) & ~IPB_POOL_HEAD_IDX_MSK)
+                         | (uint32_t)(u16Idx + 1U);
+        } while (atomic_compare_exchange_weak_explicit(&ptClass->u32Head, &u32Head, u32NewHead,
+                                                       memory_order_release, memory_order_relaxed) == false);
+
+        isOwner = true;
+    }
+
+    return isOwner;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file ipb_pool.h
+ * @brief This file contains the frame and message pool shared by
+ *        the ingenia protocol bus (IPB) interfaces
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_POOL_H
+#define IPB_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb.h"
+
+/** Number of config size frames of the pool */
+#ifndef IPB_POOL_CFG_FRM_NUM
+#define IPB_POOL_CFG_FRM_NUM    16U
+#endif
+
+/** Number of extended size frames of the pool */
+#ifndef IPB_POOL_EXT_FRM_NUM
+#define IPB_POOL_EXT_FRM_NUM    2U
+#endif
+
+/** Number of messages of the pool */
+#ifndef IPB_POOL_MSG_NUM
+#define IPB_POOL_MSG_NUM        16U
+#endif
+
+/** Pool classes */
+typedef enum
+{
+    /** Frames for up to IPB_FRAME_TOTAL_CFG_SIZE words */
+    IPB_POOL_CFG = 0,
+    /** Frames for up to IPB_FRM_MAX_DATA_SZ words */
+    IPB_POOL_EXT,
+    /** Ipb_TMsg messages */
+    IPB_POOL_MSG,
+    /** Number of classes */
+    IPB_POOL_CLASS_NUM
+} Ipb_EPoolClass;
+
+/**
+ * @note All pool functions are lock-free, they can be called from any
+ *  thread or interrupt without locks and never use the heap.
+ */
+
+/**
+ * Borrows a frame from the pool
+ *
+ * @note The smallest class meant for u16Sz words is used, falling back
+ *  to a bigger one if exhausted. Every frame is a whole Ipb_TFrame,
+ *  classes only keep config frames from using up the extended ones.
+ *
+ * @param[in] u16Sz
+ *  Number of words the frame must hold
+ *
+ * @retval pointer to frame if success, NULL otherwise
+ */
+Ipb_TFrame*
+Ipb_PoolAlloc(uint16_t u16Sz);
+
+/**
+ * Returns a frame to the pool
+ *
+ * @param[in] ptFrame
+ *  Frame borrowed with Ipb_PoolAlloc
+ */
+void
+Ipb_PoolFree(Ipb_TFrame* ptFrame);
+
+/**
+ * Borrows a message from the pool, to be used with Ipb_Write and Ipb_Read
+ *
+ * @retval pointer to message if success, NULL otherwise
+ */
+Ipb_TMsg*
+Ipb_PoolMsgAlloc(void);
+
+/**
+ * Returns a message to the pool
+ *
+ * @param[in] ptMsg
+ *  Message borrowed with Ipb_PoolMsgAlloc
+ */
+void
+Ipb_PoolMsgFree(Ipb_TMsg* ptMsg);
+
+/**
+ * Blocking transaction on a pooled message, the request is sent with
+ * Ipb_Write and the reply read with Ipb_Read
+ *
+ * @note The instance must be in blocking mode. Requests of several
+ *  threads to the same instance must still be serialised, see
+ *  ipb_shared.h.
+ *
+ * @param[in] ptInst
+ *  Specifies the target instance
+ * @param[in] u16SubNode
+ *  Target subnode
+ * @param[in] u16Addr
+ *  Target register address
+ * @param[in] u16Cmd
+ *  Request command, IPB_REQ_READ or IPB_REQ_WRITE
+ * @param[in] pu16Data
+ *  Request data, may be NULL if u16Size is 0
+ * @param[in] u16Size
+ *  Request data size in words
+ * @param[in] u32Timeout
+ *  Timeout duration of the whole transaction
+ *
+ * @retval message loaded with the reply, to be returned with
+ *  Ipb_PoolMsgFree, NULL if the pool is exhausted or the transaction
+ *  fails
+ */
+Ipb_TMsg*
+Ipb_PoolTransfer(Ipb_TInst* ptInst, uint16_t u16SubNode, uint16_t u16Addr, uint16_t u16Cmd,
+                 const uint16_t* pu16Data, uint16_t u16Size, uint32_t u32Timeout);
+
+/**
+ * Gets the number of objects of a class currently borrowed
+ *
+ * @param[in] eClass
+ *  Pool class
+ *
+ * @retval number of objects in use
+ */
+uint16_t
+Ipb_PoolGetInUse(Ipb_EPoolClass eClass);
+
+/**
+ * Gets the maximum number of objects of a class borrowed at once
+ *
+ * @param[in] eClass
+ *  Pool class
+ *
+ * @retval high-water mark
+ */
+uint16_t
+Ipb_PoolGetHighWater(Ipb_EPoolClass eClass);
+
+#endif /* IPB_POOL_H */
@@ -0,0 +1,60 @@
+/**
+ * @file ipb_port.c
+ * @brief This file contains the registry of transport ports used by
+ *        the default ingenia protocol bus (IPB) user functions
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_port.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/** Registered port */
+typedef struct
+{
+    /** Port operations */
+    const Ipb_TPortOps* ptOps;
+    /** Port context */
+    void* pvCtx;
+} Ipb_TPort;
+
+/** Ports indexed by instance identification */
+static Ipb_TPort ptPort[IPB_PORT_MAX_NUM];
+
+bool Ipb_PortRegister(uint16_t u16Id, const Ipb_TPortOps* ptOps, void* pvCtx)
+{
+    bool isRegistered = false;
+
+    if (u16Id < IPB_PORT_MAX_NUM)
+    {
+        ptPort[u16Id].pvCtx = pvCtx;
+        ptPort[u16Id].ptOps = ptOps;
+        isRegistered = true;
+    }
+
+    return isRegistered;
+}
+
+void Ipb_PortUnregister(uint16_t u16Id)
+{
+    if (u16Id < IPB_PORT_MAX_NUM)
+    {
+        ptPort[u16Id].ptOps = NULL;
+        ptPort[u16Id].pvCtx = NULL;
+    }
+}
+
+const Ipb_TPortOps* Ipb_PortGet(uint16_t u16Id, void** ppvCtx)
+{
+    const Ipb_TPortOps* ptOps = NULL;
+
+    if (u16Id < IPB_PORT_MAX_NUM)
+    {
+        ptOps = ptPort[u16Id].ptOps;
+        *ppvCtx = ptPort[u16Id].pvCtx;
+    }
+
+    return ptOps;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file ipb_port.h
+ * @brief This file contains the registry of transport ports used by
+ *        the default ingenia protocol bus (IPB) user functions
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_PORT_H
+#define IPB_PORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb_frame.h"
+
+/** Max number of ports, port identifiers go from 0 to IPB_PORT_MAX_NUM - 1 */
+#ifndef IPB_PORT_MAX_NUM
+#define IPB_PORT_MAX_NUM        8U
+#endif
+
+/** Transport port operations */
+typedef struct
+{
+    /** Receive bytes (stream ports) or one datagram, returns read bytes */
+    uint16_t (*Reception)(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size);
+    /** Transmit segments as a single frame, returns 0 if success */
+    uint16_t (*Transmission)(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+    /** Transmit several frames, one segment each, returns 0 if success. Optional */
+    uint16_t (*TransmissionM)(void* pvCtx, const Ipb_TFrameIov* ptFrm, uint16_t u16FrmCnt);
+    /** Discard received data */
+    void (*DiscardData)(void* pvCtx);
+    /** Wait up to a timeout in microseconds for received data, returns true if any. Optional */
+    bool (*Wait)(void* pvCtx, uint32_t u32TimeoutUs);
+} Ipb_TPortOps;
+
+/**
+ * Registers a port, default user functions of ipb_usr.c called with
+ * u16Id are redirected to it
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] ptOps
+ *  Port operations
+ * @param[in] pvCtx
+ *  Port context passed to the operations
+ *
+ * @retval true if success, false if identifier is out of range
+ */
+bool
+Ipb_PortRegister(uint16_t u16Id, const Ipb_TPortOps* ptOps, void* pvCtx);
+
+/**
+ * Unregisters a port
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ */
+void
+Ipb_PortUnregister(uint16_t u16Id);
+
+/**
+ * Gets the operations of a port
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[out] ppvCtx
+ *  Port context
+ *
+ * @retval port operations, NULL if no port is registered
+ */
+const Ipb_TPortOps*
+Ipb_PortGet(uint16_t u16Id, void** ppvCtx);
+
+#endif /* IPB_PORT_H */
@@ -0,0 +1,271 @@
+/**
+ * @file ipb_reactor.c
+ * @brief This file contains a single thread event loop driving many
+ *        ingenia protocol bus (IPB) instances on Linux hosts
+ *
+ * @note Instances are only driven when a request is queued or their
+ *  descriptor gets data, so idle instances cost nothing. Requests
+ *  waiting for a reply are checked for timeout each u16TickMs.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_reactor.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/**
+ * Appends a source to the ready list
+ */
+static void
+Ipb_ReactorReady(Ipb_TReactorSrc* ptSrc);
+
+/**
+ * Drives the requests of a source
+ *
+ * @retval number of completed requests
+ */
+static uint16_t
+Ipb_ReactorDrive(Ipb_TReactorSrc* ptSrc);
+
+/**
+ * Indicates if the oldest request of a source waits for received data
+ */
+static bool
+Ipb_ReactorIsWaiting(const Ipb_TReactorSrc* ptSrc);
+
+int32_t Ipb_ReactorInit(Ipb_TReactor* ptReactor)
+{
+    int32_t i32Ret = 0L;
+
+    memset((void*)ptReactor, 0, sizeof(*ptReactor));
+    ptReactor->u16TickMs = (uint16_t)IPB_REACTOR_TICK_MS;
+    ptReactor->u32TickMillis = Ipb_GetMillis();
+    ptReactor->i32Ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ptReactor->i32Ep < 0L)
+    {
+        i32Ret = -1L;
+    }
+
+    return i32Ret;
+}
+
+void Ipb_ReactorDeinit(Ipb_TReactor* ptReactor)
+{
+    if (ptReactor->i32Ep >= 0L)
+    {
+        (void)close(ptReactor->i32Ep);
+        ptReactor->i32Ep = -1L;
+    }
+}
+
+int32_t Ipb_ReactorAdd(Ipb_TReactor* ptReactor, Ipb_TReactorSrc* ptSrc, Ipb_TInst* ptInst, int32_t i32Fd,
+                       void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx)
+{
+    int32_t i32Ret = 0L;
+    struct epoll_event tEv;
+
+    while (1)
+    {
+        if (ptReactor->u16SrcCnt >= (uint16_t)IPB_REACTOR_MAX_NUM)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        ptSrc->ptReactor = ptReactor;
+        ptSrc->ptInst = ptInst;
+        ptSrc->i32Fd = i32Fd;
+        ptSrc->OnDone = OnDone;
+        ptSrc->pvCtx = pvCtx;
+        ptSrc->isReady = false;
+
+        /** Edge triggered, data left unread is picked up by the next request */
+        memset((void*)&tEv, 0, sizeof(tEv));
+        tEv.events = (EPOLLIN | EPOLLET);
+        tEv.data.ptr = (void*)ptSrc;
+        if (epoll_ctl(ptReactor->i32Ep, EPOLL_CTL_ADD, i32Fd, &tEv) != 0)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        ptSrc->u16Idx = ptReactor->u16SrcCnt;
+        ptReactor->ptSrc[ptReactor->u16SrcCnt] = ptSrc;
+        ptReactor->u16SrcCnt++;
+        break;
+    }
+
+    return i32Ret;
+}
+
+void Ipb_ReactorRemove(Ipb_TReactorSrc* ptSrc)
+{
+    Ipb_TReactor* ptReactor = ptSrc->ptReactor;
+
+    (void)epoll_ctl(ptReactor->i32Ep, EPOLL_CTL_DEL, ptSrc->i32Fd, NULL);
+
+    if (ptSrc->isReady != false)
+    {
+        for (uint16_t u16Idx = 0U; u16Idx < ptReactor->u16ReadyCnt; ++u16Idx)
+        {
+            uint16_t u16Pos = (uint16_t)((ptReactor->u16ReadyHead + u16Idx) % IPB_REACTOR_MAX_NUM);
+
+            if (ptReactor->ptReady[u16Pos] == ptSrc)
+            {
+                /** Newest ready source takes the free position */
+                ptReactor->u16ReadyCnt--;
+                ptReactor->ptReady[u16Pos] = ptReactor->ptReady[(ptReactor->u16ReadyHead + ptReactor->u16ReadyCnt)
+                                                                 % IPB_REACTOR_MAX_NUM];
+                break;
+            }
+        }
+        ptSrc->isReady = false;
+    }
+
+    /** Last source takes the free position */
+    ptReactor->u16SrcCnt--;
+    ptReactor->ptSrc[ptSrc->u16Idx] = ptReactor->ptSrc[ptReactor->u16SrcCnt];
+    ptReactor->ptSrc[ptSrc->u16Idx]->u16Idx = ptSrc->u16Idx;
+    ptReactor->ptSrc[ptReactor->u16SrcCnt] = NULL;
+}
+
+Ipb_EStatus Ipb_ReactorWrite(Ipb_TReactorSrc* ptSrc, Ipb_TMsg* ptMsg, uint32_t u32Timeout)
+{
+    Ipb_EStatus eRet = Ipb_WriteAsync(ptSrc->ptInst, ptMsg, u32Timeout, ptSrc->OnDone, ptSrc->pvCtx);
+
+    if (eRet == IPB_SUCCESS)
+    {
+        Ipb_ReactorReady(ptSrc);
+    }
+
+    return eRet;
+}
+
+Ipb_EStatus Ipb_ReactorRead(Ipb_TReactorSrc* ptSrc, Ipb_TMsg* ptMsg, uint32_t u32Timeout)
+{
+    Ipb_EStatus eRet = Ipb_ReadAsync(ptSrc->ptInst, ptMsg, u32Timeout, ptSrc->OnDone, ptSrc->pvCtx);
+
+    if (eRet == IPB_SUCCESS)
+    {
+        Ipb_ReactorReady(ptSrc);
+    }
+
+    return eRet;
+}
+
+int32_t Ipb_ReactorRun(Ipb_TReactor* ptReactor, uint32_t u32TimeoutMs)
+{
+    int32_t i32Ret = 0L;
+    struct epoll_event ptEv[IPB_REACTOR_EVENTS];
+    uint16_t u16Cnt;
+    uint32_t u32Millis;
+    int iEvCnt;
+
+    /** Sources readied meanwhile by callbacks are driven on the next iteration */
+    u16Cnt = ptReactor->u16ReadyCnt;
+    while (u16Cnt > (uint16_t)0U)
+    {
+        Ipb_TReactorSrc* ptSrc = ptReactor->ptReady[ptReactor->u16ReadyHead];
+
+        ptReactor->u16ReadyHead = (uint16_t)((ptReactor->u16ReadyHead + 1U) % IPB_REACTOR_MAX_NUM);
+        ptReactor->u16ReadyCnt--;
+        ptSrc->isReady = false;
+        i32Ret += (int32_t)Ipb_ReactorDrive(ptSrc);
+        u16Cnt--;
+    }
+
+    /** Expire requests whose reply never arrives */
+    u32Millis = Ipb_GetMillis();
+    if ((u32Millis - ptReactor->u32TickMillis) >= ptReactor->u16TickMs)
+    {
+        ptReactor->u32TickMillis = u32Millis;
+        for (uint16_t u16Idx = 0U; u16Idx < ptReactor->u16SrcCnt; ++u16Idx)
+        {
+            const Ipb_TInst* ptInst = ptReactor->ptSrc[u16Idx]->ptInst;
+            const Ipb_TAsyncReq* ptReq = &ptInst->ptAsync[ptInst->u16AsyncHead];
+
+            if ((ptInst->u16AsyncCnt > (uint16_t)0U) && (ptReq->isStarted != false)
+                && ((u32Millis - ptReq->u32Millis) >= ptReq->u32Timeout))
+            {
+                Ipb_ReactorReady(ptReactor->ptSrc[u16Idx]);
+            }
+        }
+    }
+
+    if (ptReactor->u16ReadyCnt > (uint16_t)0U)
+    {
+        u32TimeoutMs = 0UL;
+    }
+    else if (u32TimeoutMs > ptReactor->u16TickMs)
+    {
+        u32TimeoutMs = ptReactor->u16TickMs;
+    }
+
+    ptReactor->u32Waits++;
+    iEvCnt = epoll_wait(ptReactor->i32Ep, ptEv, (int)IPB_REACTOR_EVENTS, (int)u32TimeoutMs);
+    if ((iEvCnt < 0) && (errno != EINTR))
+    {
+        i32Ret = -1L;
+    }
+
+    for (int iIdx = 0; iIdx < iEvCnt; ++iIdx)
+    {
+        Ipb_TReactorSrc* ptSrc = (Ipb_TReactorSrc*)ptEv[iIdx].data.ptr;
+
+        /** Sources already ready are driven on the next iteration */
+        if (ptSrc->isReady == false)
+        {
+            i32Ret += (int32_t)Ipb_ReactorDrive(ptSrc);
+        }
+    }
+
+    return i32Ret;
+}
+
+static void Ipb_ReactorReady(Ipb_TReactorSrc* ptSrc)
+{
+    Ipb_TReactor* ptReactor = ptSrc->ptReactor;
+
+    if (ptSrc->isReady == false)
+    {
+        ptSrc->isReady = true;
+        ptReactor->ptReady[(ptReactor->u16ReadyHead + ptReactor->u16ReadyCnt) % IPB_REACTOR_MAX_NUM] = ptSrc;
+        ptReactor->u16ReadyCnt++;
+    }
+}
+
+static uint16_t Ipb_ReactorDrive(Ipb_TReactorSrc* ptSrc)
+{
+    uint16_t u16Done = Ipb_Poll(ptSrc->ptInst, (uint16_t)IPB_REACTOR_BUDGET);
+
+    /** Out of budget, or a request that does not wait for data is next */
+    if ((Ipb_GetPending(ptSrc->ptInst) > (uint16_t)0U) && (Ipb_ReactorIsWaiting(ptSrc) == false))
+    {
+        Ipb_ReactorReady(ptSrc);
+    }
+
+    return u16Done;
+}
+
+static bool Ipb_ReactorIsWaiting(const Ipb_TReactorSrc* ptSrc)
+{
+    const Ipb_TInst* ptInst = ptSrc->ptInst;
+    const Ipb_TMsg* ptMsg = ptInst->ptAsync[ptInst->u16AsyncHead].ptMsg;
+
+    return ((ptInst->ptAsync[ptInst->u16AsyncHead].isStarted != false)
+            && ((ptMsg->eStatus == IPB_READ_REQUEST) || (ptMsg->eStatus == IPB_READ_ANSWER)));
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,194 @@
+/**
+ * @file ipb_reactor.h
+ * @brief This file contains a single thread event loop driving many
+ *        ingenia protocol bus (IPB) instances on Linux hosts
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_REACTOR_H
+#define IPB_REACTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb.h"
+
+/**
+ * Max number of instances of a reactor
+ *
+ * @note Limits of the shared modules default to small targets, build
+ *  flags must raise them along with the number of instances served:
+ *  - IPB_PORT_MAX_NUM (ipb_port.h, 8) to the number of instances, each
+ *    one needs its own port identification.
+ *  - IPB_POOL_EXT_FRM_NUM and IPB_POOL_CFG_FRM_NUM (ipb_pool.h, 2 and
+ *    16) to the number of UART/USB instances that may be receiving an
+ *    extended reply at the same time. Waiting for a reply borrows no
+ *    frame, ethernet instances borrow one only during each reception.
+ *  - IPB_POOL_MSG_NUM (ipb_pool.h, 16) to the number of pooled messages
+ *    in flight.
+ */
+#ifndef IPB_REACTOR_MAX_NUM
+#define IPB_REACTOR_MAX_NUM     1024U
+#endif
+
+/** Max number of readiness events fetched with each wait */
+#ifndef IPB_REACTOR_EVENTS
+#define IPB_REACTOR_EVENTS      64U
+#endif
+
+/** Max number of interface steps of an instance each time it is driven */
+#ifndef IPB_REACTOR_BUDGET
+#define IPB_REACTOR_BUDGET      8U
+#endif
+
+/** Default period in milliseconds of the request timeout checks */
+#ifndef IPB_REACTOR_TICK_MS
+#define IPB_REACTOR_TICK_MS     10U
+#endif
+
+typedef struct Ipb_TReactor Ipb_TReactor;
+
+/** Instance served by a reactor */
+typedef struct
+{
+    /** Reactor serving the instance */
+    Ipb_TReactor* ptReactor;
+    /** Instance */
+    Ipb_TInst* ptInst;
+    /** Descriptor signalling received data, owned by the port */
+    int32_t i32Fd;
+    /** Completion callback of the instance requests, may be NULL */
+    void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg);
+    /** User context of the callback */
+    void* pvCtx;
+    /** Index of the source in the reactor */
+    uint16_t u16Idx;
+    /** Source is in the ready list */
+    bool isReady;
+} Ipb_TReactorSrc;
+
+/** Reactor instance */
+struct Ipb_TReactor
+{
+    /** Readiness notification descriptor, -1 if closed */
+    int32_t i32Ep;
+    /** Sources served */
+    Ipb_TReactorSrc* ptSrc[IPB_REACTOR_MAX_NUM];
+    /** Number of sources */
+    uint16_t u16SrcCnt;
+    /** Sources to be driven without waiting for data, in order */
+    Ipb_TReactorSrc* ptReady[IPB_REACTOR_MAX_NUM];
+    /** Oldest ready source */
+    uint16_t u16ReadyHead;
+    /** Number of ready sources */
+    uint16_t u16ReadyCnt;
+    /** Period in milliseconds of the request timeout checks */
+    uint16_t u16TickMs;
+    /** Time in milliseconds of the last timeout check */
+    uint32_t u32TickMillis;
+    /** Number of readiness waits */
+    uint32_t u32Waits;
+};
+
+/**
+ * Initialises a reactor
+ *
+ * @param[out] ptReactor
+ *  Reactor instance
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_ReactorInit(Ipb_TReactor* ptReactor);
+
+/**
+ * Releases a reactor, sources must be removed before
+ *
+ * @param[in] ptReactor
+ *  Reactor instance
+ */
+void
+Ipb_ReactorDeinit(Ipb_TReactor* ptReactor);
+
+/**
+ * Adds an instance to a reactor
+ *
+ * @note Descriptor is watched edge triggered, e.g. the descriptor of
+ *  an Ipb_TSerial or Ipb_TUdp port. Instances on an io_uring engine are
+ *  driven by the engine instead.
+ *
+ * @param[in] ptReactor
+ *  Reactor instance
+ * @param[out] ptSrc
+ *  Source instance
+ * @param[in] ptInst
+ *  IPB instance, its requests must only be issued through the reactor
+ * @param[in] i32Fd
+ *  Descriptor of the instance port
+ * @param[in] OnDone
+ *  Callback called for each completed request of the instance, may be
+ *  NULL
+ * @param[in] pvCtx
+ *  User context passed to the callback
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_ReactorAdd(Ipb_TReactor* ptReactor, Ipb_TReactorSrc* ptSrc, Ipb_TInst* ptInst, int32_t i32Fd,
+               void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx);
+
+/**
+ * Removes an instance from its reactor, not to be called from callbacks
+ *
+ * @param[in] ptSrc
+ *  Source instance
+ */
+void
+Ipb_ReactorRemove(Ipb_TReactorSrc* ptSrc);
+
+/**
+ * Queues a write request of an instance, see Ipb_WriteAsync
+ *
+ * @param[in] ptSrc
+ *  Source instance
+ * @param[in/out] ptMsg
+ *  Request to be send
+ * @param[in] u32Timeout
+ *  Timeout duration
+ *
+ * @retval IPB_SUCCESS if queued, IPB_STANDBY if queue is full
+ */
+Ipb_EStatus
+Ipb_ReactorWrite(Ipb_TReactorSrc* ptSrc, Ipb_TMsg* ptMsg, uint32_t u32Timeout);
+
+/**
+ * Queues a read request of an instance, see Ipb_ReadAsync
+ *
+ * @param[in] ptSrc
+ *  Source instance
+ * @param[in/out] ptMsg
+ *  Message to be loaded with reply
+ * @param[in] u32Timeout
+ *  Timeout duration
+ *
+ * @retval IPB_SUCCESS if queued, IPB_STANDBY if queue is full
+ */
+Ipb_EStatus
+Ipb_ReactorRead(Ipb_TReactorSrc* ptSrc, Ipb_TMsg* ptMsg, uint32_t u32Timeout);
+
+/**
+ * Runs one loop iteration: drives the ready instances, waits for
+ * received data and drives the instances that got it
+ *
+ * @param[in] ptReactor
+ *  Reactor instance
+ * @param[in] u32TimeoutMs
+ *  Max time to wait for received data, 0 does not wait
+ *
+ * @retval number of completed requests, negative error code otherwise
+ */
+int32_t
+Ipb_ReactorRun(Ipb_TReactor* ptReactor, uint32_t u32TimeoutMs);
+
+#endif /* IPB_REACTOR_H */
@@ -0,0 +1,331 @@
+/**
+ * @file ipb_reg.hpp
+ * @brief This file contains the C++20 typed register access layer of the
+ *        ingenia protocol bus (IPB)
+ *
+ * @note Registers are described once at compile time:
+ *
+ *  using ControlWord = ipb::Reg<0x010U, 1U, uint16_t, ipb::Access::RW>;
+ *  using StatusWord = ipb::Reg<0x011U, 1U, uint16_t, ipb::Access::RO>;
+ *
+ *  ipb::Device tDrive(tInst);
+ *  tDrive.write<ControlWord>(uint16_t { 0x000FU });
+ *  auto tSw = tDrive.read<StatusWord>();
+ *  if (tSw.ok()) { ... tSw.tValue ... }
+ *
+ *  Read requests are constant frames, CRC included. Write requests only
+ *  copy the value into a frame whose header CRC is precomputed. Frames are
+ *  sent as they are with the interface Send, no Ipb_TMsg is involved.
+ *  Wrong value types and access rights fail to compile.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_REG_HPP
+#define IPB_REG_HPP
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+extern "C"
+{
+#include "ipb.h"
+#include "ipb_crc.h"
+#include "ipb_usr.h"
+}
+
+static_assert(std::endian::native == std::endian::little, "frames are encoded as little endian words");
+
+namespace ipb
+{
+
+/** Register access rights */
+enum class Access : uint8_t
+{
+    /** Read only */
+    RO,
+    /** Write only */
+    WO,
+    /** Read and write */
+    RW
+};
+
+/**
+ * Register descriptor
+ *
+ * @note Values are held in the config data of a frame, so they take up
+ *  to IPB_FRM_CONFIG_SZ words.
+ */
+template <uint16_t u16KeyV, uint16_t u16SubNodeV, class TValue, Access eAccessV = Access::RW>
+struct Reg
+{
+    /** Value type */
+    using Type = TValue;
+
+    /** Register address */
+    static constexpr uint16_t u16Key = u16KeyV;
+    /** Internal network node */
+    static constexpr uint16_t u16SubNode = u16SubNodeV;
+    /** Access rights */
+    static constexpr Access eAccess = eAccessV;
+    /** Number of words of the value */
+    static constexpr uint16_t u16Words = static_cast<uint16_t>((sizeof(TValue) + 1U) / sizeof(uint16_t));
+
+    static_assert(u16KeyV <= 0x0FFFU, "register address takes 12 bits");
+    static_assert(u16SubNodeV <= 0x000FU, "subnode takes 4 bits");
+    static_assert(std::is_trivially_copyable_v<TValue>, "register value must be trivially copyable");
+    static_assert(sizeof(TValue) <= (IPB_FRM_CONFIG_SZ * sizeof(uint16_t)), "register value must fit config data");
+};
+
+namespace detail
+{
+
+/** CRC of a byte, same as Ipb_CrcUpdate */
+constexpr uint16_t CrcByte(uint16_t u16Crc, uint8_t u8Byte) noexcept
+{
+    u16Crc = static_cast<uint16_t>(u16Crc ^ static_cast<uint16_t>(u8Byte << 8U));
+    for (uint16_t u16Bit = 0U; u16Bit < 8U; ++u16Bit)
+    {
+        u16Crc = ((u16Crc & 0x8000U) != 0U) ? static_cast<uint16_t>((u16Crc << 1U) ^ 0x1021U)
+                                              : static_cast<uint16_t>(u16Crc << 1U);
+    }
+
+    return u16Crc;
+}
+
+/** CRC of words as stored in memory */
+constexpr uint16_t CrcWords(uint16_t u16Crc, const uint16_t* pu16Buf, std::size_t szWords) noexcept
+{
+    for (std::size_t szIdx = 0U; szIdx < szWords; ++szIdx)
+    {
+        u16Crc = CrcByte(u16Crc, static_cast<uint8_t>(pu16Buf[szIdx] & 0x00FFU));
+        u16Crc = CrcByte(u16Crc, static_cast<uint8_t>(pu16Buf[szIdx] >> 8U));
+    }
+
+    return u16Crc;
+}
+
+/** Node header word */
+constexpr uint16_t HeadNode(uint16_t u16SubNode) noexcept
+{
+    return static_cast<uint16_t>((IPB_FRM_SYNC_MARK << IPB_FRM_SYNC_POS) | (u16SubNode & IPB_FRM_NODE_MASK));
+}
+
+/** Command header word of a config data frame */
+constexpr uint16_t HeadCmd(uint16_t u16Addr, uint16_t u16Cmd) noexcept
+{
+    return static_cast<uint16_t>((u16Addr << IPB_FRM_ADDR_POS) | ((u16Cmd & IPB_FRM_CMD_MASK) << IPB_FRM_CMD_POS));
+}
+
+} /* namespace detail */
+
+/** Frames of a register, built at compile time */
+template <class TReg>
+struct Frame
+{
+    /** Number of words of a frame */
+    static constexpr uint16_t u16Sz = IPB_FRAME_TOTAL_CFG_SIZE;
+
+    /** Read request, complete */
+    static constexpr std::array<uint16_t, IPB_FRAME_TOTAL_CFG_SIZE> pu16Read = []() {
+        std::array<uint16_t, IPB_FRAME_TOTAL_CFG_SIZE> pu16Frm {};
+
+        pu16Frm[IPB_FRM_NODE_IDX] = detail::HeadNode(TReg::u16SubNode);
+        pu16Frm[IPB_FRM_CMD_IDX] = detail::HeadCmd(TReg::u16Key, IPB_REQ_READ);
+        pu16Frm[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ] =
+            detail::CrcWords(IPB_CRC_START, pu16Frm.data(), (IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ));
+
+        return pu16Frm;
+    }();
+
+    /** Write request header */
+    static constexpr std::array<uint16_t, IPB_FRM_HEAD_SZ> pu16WriteHead = {
+        detail::HeadNode(TReg::u16SubNode), detail::HeadCmd(TReg::u16Key, IPB_REQ_WRITE)
+    };
+
+    /** CRC of the write request header, config data is added at run time */
+    static constexpr uint16_t u16WriteHeadCrc = detail::CrcWords(IPB_CRC_START, pu16WriteHead.data(),
+                                                                 IPB_FRM_HEAD_SZ);
+
+    /**
+     * Encodes a write request
+     *
+     * @param[in] tValue
+     *  Value to be written
+     * @param[out] pu16Frm
+     *  Frame buffer, u16Sz words
+     */
+    static void EncodeWrite(const typename TReg::Type& tValue, uint16_t* pu16Frm) noexcept
+    {
+        pu16Frm[IPB_FRM_NODE_IDX] = pu16WriteHead[IPB_FRM_NODE_IDX];
+        pu16Frm[IPB_FRM_CMD_IDX] = pu16WriteHead[IPB_FRM_CMD_IDX];
+        std::memset(&pu16Frm[IPB_FRM_CFG_IDX], 0, (IPB_FRM_CONFIG_SZ * sizeof(uint16_t)));
+        std::memcpy(&pu16Frm[IPB_FRM_CFG_IDX], &tValue, sizeof(tValue));
+        pu16Frm[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ] =
+            Ipb_CrcUpdate(u16WriteHeadCrc, reinterpret_cast<const uint8_t*>(&pu16Frm[IPB_FRM_CFG_IDX]),
+                          static_cast<uint16_t>(IPB_FRM_CONFIG_SZ * sizeof(uint16_t)));
+    }
+};
+
+/** Result of a register read */
+template <class TValue>
+struct Result
+{
+    /** Final status, IPB_SUCCESS or IPB_ERROR */
+    Ipb_EStatus eStatus;
+    /** Value read, valid on success */
+    TValue tValue;
+
+    bool ok() const noexcept
+    {
+        return (eStatus == IPB_SUCCESS);
+    }
+};
+
+/** Value types accepted for a register, only conversions without narrowing */
+template <class TArg, class TValue>
+concept Assignable = requires(TArg tArg) { TValue { tArg }; };
+
+/**
+ * Typed register access of an instance, blocking as Ipb_Write and Ipb_Read
+ * do, following the instance wait strategy
+ */
+class Device
+{
+public:
+    /**
+     * @param[in] tNewInst
+     *  Instance, not used by anybody else during a call
+     * @param[in] u32NewTimeout
+     *  Timeout duration of each transaction
+     */
+    explicit Device(Ipb_TInst& tNewInst, uint32_t u32NewTimeout = IPB_DFLT_TIMEOUT) noexcept
+        : tInst(tNewInst), u32Timeout(u32NewTimeout)
+    {
+    }
+
+    Device(const Device&) = delete;
+    Device& operator=(const Device&) = delete;
+
+    /** Reads a register */
+    template <class TReg>
+    Result<typename TReg::Type> read() noexcept
+    {
+        static_assert(TReg::eAccess != Access::WO, "register is write only");
+
+        Result<typename TReg::Type> tRes { IPB_ERROR, typename TReg::Type {} };
+
+        if (tInst.tIntf.Send(&tInst.tIntf, Frame<TReg>::pu16Read.data(), Frame<TReg>::u16Sz) == IPB_SUCCESS)
+        {
+            tRes.eStatus = reply(TReg::u16SubNode, TReg::u16Key, TReg::u16Words);
+            if (tRes.eStatus == IPB_SUCCESS)
+            {
+                std::memcpy(&tRes.tValue, pu16Rx, sizeof(tRes.tValue));
+            }
+        }
+
+        return tRes;
+    }
+
+    /** Writes a register, the value must convert to its type without narrowing */
+    template <class TReg, class TArg>
+    Ipb_EStatus write(const TArg& tArg) noexcept
+    {
+        static_assert(TReg::eAccess != Access::RO, "register is read only");
+        static_assert(Assignable<TArg, typename TReg::Type>, "value type does not match the register");
+
+        Ipb_EStatus eRet = IPB_ERROR;
+        const typename TReg::Type tValue { tArg };
+
+        Frame<TReg>::EncodeWrite(tValue, pu16Tx);
+        if (tInst.tIntf.Send(&tInst.tIntf, pu16Tx, Frame<TReg>::u16Sz) == IPB_SUCCESS)
+        {
+            eRet = reply(TReg::u16SubNode, TReg::u16Key, 0U);
+        }
+
+        return eRet;
+    }
+
+private:
+    /** Waits for the acknowledge of the request of a register */
+    Ipb_EStatus reply(uint16_t u16SubNode, uint16_t u16Key, uint16_t u16MinWords) noexcept
+    {
+        Ipb_EStatus eRet;
+        uint16_t u16RxSubNode = 0U;
+        uint16_t u16RxAddr = 0U;
+        uint16_t u16RxCmd = 0U;
+        uint16_t u16RxSz = 0U;
+        uint32_t u32Millis = Ipb_GetMillis();
+        uint32_t u32StartUs = Ipb_GetMicros();
+        uint32_t u32Elapsed;
+
+        do
+        {
+            eRet = tInst.tIntf.Read(&tInst.tIntf, &u16RxSubNode, &u16RxAddr, &u16RxCmd, pu16Rx, &u16RxSz);
+            u32Elapsed = Ipb_GetMillis() - u32Millis;
+
+            if (((eRet == IPB_READ_REQUEST) || (eRet == IPB_READ_ANSWER)) && (u32Elapsed < u32Timeout))
+            {
+                wait(u32StartUs, (u32Timeout - u32Elapsed));
+                u32Elapsed = Ipb_GetMillis() - u32Millis;
+            }
+        } while ((eRet != IPB_ERROR) && (eRet != IPB_SUCCESS) && (u32Elapsed < u32Timeout));
+
+        if ((eRet != IPB_ERROR) && (eRet != IPB_SUCCESS))
+        {
+            Ipb_IntfReset(&tInst.tIntf);
+        }
+
+        if ((eRet == IPB_SUCCESS)
+            && ((u16RxSubNode != u16SubNode) || (u16RxAddr != u16Key) || (u16RxCmd != IPB_REP_ACK)
+                || (u16RxSz < u16MinWords)))
+        {
+            eRet = IPB_ERROR;
+        }
+        else if (eRet != IPB_SUCCESS)
+        {
+            eRet = IPB_ERROR;
+        }
+
+        return eRet;
+    }
+
+    /** Waits for data as Ipb_Read does */
+    void wait(uint32_t u32StartUs, uint32_t u32LeftMs) noexcept
+    {
+        bool isWait = (tInst.eWait == IPB_WAIT_SLEEP);
+
+        if (tInst.eWait == IPB_WAIT_ADAPTIVE)
+        {
+            isWait = ((Ipb_GetMicros() - u32StartUs) >= tInst.u32SpinUs);
+        }
+
+        if (isWait)
+        {
+            if (u32LeftMs > IPB_DFLT_TIMEOUT)
+            {
+                u32LeftMs = IPB_DFLT_TIMEOUT;
+            }
+            (void)Ipb_IntfWait(tInst.tIntf.u16Id, (u32LeftMs * 1000UL));
+        }
+    }
+
+    /** Instance */
+    Ipb_TInst& tInst;
+    /** Timeout duration of each transaction */
+    uint32_t u32Timeout;
+    /** Write request */
+    uint16_t pu16Tx[IPB_FRAME_TOTAL_CFG_SIZE] {};
+    /** Reply data, extended replies included */
+    uint16_t pu16Rx[IPB_MAX_DATA_SZ] {};
+};
+
+} /* namespace ipb */
+
+#endif /* IPB_REG_HPP */
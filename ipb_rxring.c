@@ -0,0 +1,275 @@
+/**
+ * @file ipb_rxring.c
+ * @brief This file contains a circular reception buffer of the ingenia
+ *        protocol bus (IPB), handing out frames without copying them
+ *
+ * @note Only the config frame is copied out, to check its crc and
+ *  decode the header. Data is handed out as segments of the buffer, two
+ *  when the frame wraps around its end.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_rxring.h"
+#include "ipb_crc.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Copies bytes out of the buffer, wrapping around its end
+ */
+static void
+Ipb_RxRingCopyOut(const Ipb_TRxRing* ptRing, uint32_t u32Pos, uint8_t* pu8Dst, uint32_t u32SzBy);
+
+/**
+ * Describes bytes of the buffer as segments
+ *
+ * @retval number of segments
+ */
+static uint16_t
+Ipb_RxRingSegs(const Ipb_TRxRing* ptRing, uint32_t u32Pos, uint16_t u16SzBy, Ipb_TFrameIov* ptIov);
+
+/**
+ * Drops the first decoded byte to search the next header
+ *
+ * @param[in] ptRing
+ *  Ring instance
+ */
+static void
+Ipb_RxRingSlide(Ipb_TRxRing* ptRing);
+
+bool Ipb_RxRingInit(Ipb_TRxRing* ptRing, uint8_t* pu8Buf, uint32_t u32SzBy)
+{
+    bool isOk = ((u32SzBy != (uint32_t)0UL) && ((u32SzBy & (u32SzBy - 1UL)) == (uint32_t)0UL));
+
+    ptRing->pu8Buf = pu8Buf;
+    ptRing->u32SzBy = u32SzBy;
+    ptRing->u32WrBy = (uint32_t)0UL;
+    ptRing->u32ScanBy = (uint32_t)0UL;
+    ptRing->u32RelBy = (uint32_t)0UL;
+    ptRing->u32Held = (uint32_t)0UL;
+    ptRing->u32DropBy = (uint32_t)0UL;
+    ptRing->u32CrcErr = (uint32_t)0UL;
+    ptRing->u32Overruns = (uint32_t)0UL;
+    ptRing->u32Epoch = (uint32_t)0UL;
+
+    return isOk;
+}
+
+uint32_t Ipb_RxRingSpace(Ipb_TRxRing* ptRing, uint8_t** ppu8Dst)
+{
+    uint32_t u32Off = ptRing->u32WrBy & (ptRing->u32SzBy - 1UL);
+    uint32_t u32FreeBy = ptRing->u32SzBy - (ptRing->u32WrBy - ptRing->u32RelBy);
+
+    *ppu8Dst = &ptRing->pu8Buf[u32Off];
+    if (u32FreeBy > (ptRing->u32SzBy - u32Off))
+    {
+        u32FreeBy = ptRing->u32SzBy - u32Off;
+    }
+
+    return u32FreeBy;
+}
+
+void Ipb_RxRingCommit(Ipb_TRxRing* ptRing, uint32_t u32SzBy)
+{
+    ptRing->u32WrBy += u32SzBy;
+}
+
+void Ipb_RxRingSetPos(Ipb_TRxRing* ptRing, uint32_t u32Pos)
+{
+    ptRing->u32WrBy += (u32Pos - ptRing->u32WrBy) & (ptRing->u32SzBy - 1UL);
+
+    if ((ptRing->u32WrBy - ptRing->u32RelBy) > ptRing->u32SzBy)
+    {
+        /** Unreleased bytes were overwritten, the last lap is kept */
+        ptRing->u32Overruns++;
+        ptRing->u32RelBy = ptRing->u32WrBy - ptRing->u32SzBy;
+        if ((int32_t)(ptRing->u32ScanBy - ptRing->u32RelBy) < 0L)
+        {
+            ptRing->u32ScanBy = ptRing->u32RelBy;
+        }
+        /** Views held are stale, their release must not give back newer ones */
+        ptRing->u32Held = (uint32_t)0UL;
+        ptRing->u32Epoch++;
+    }
+}
+
+bool Ipb_RxRingNext(Ipb_TRxRing* ptRing, Ipb_TFrameView* ptView)
+{
+    bool isFrame = false;
+    uint16_t pu16Cfg[IPB_FRAME_TOTAL_CFG_SIZE];
+
+    while (isFrame == false)
+    {
+        uint32_t u32AvailBy = ptRing->u32WrBy - ptRing->u32ScanBy;
+        uint32_t u32FrmBy = IPB_FRM_CFG_SZ_BY;
+        uint16_t u16DataSzBy = (uint16_t)(IPB_FRM_CONFIG_SZ * sizeof(uint16_t));
+        bool isExt;
+
+        if (u32AvailBy < IPB_FRM_SYNC_SZ_BY)
+        {
+            break;
+        }
+
+        Ipb_RxRingCopyOut(ptRing, ptRing->u32ScanBy, (uint8_t*)pu16Cfg, IPB_FRM_SYNC_SZ_BY);
+        if ((pu16Cfg[IPB_FRM_NODE_IDX] >> IPB_FRM_SYNC_POS) != (uint16_t)IPB_FRM_SYNC_MARK)
+        {
+            Ipb_RxRingSlide(ptRing);
+            continue;
+        }
+
+        if (u32AvailBy < IPB_FRM_CFG_SZ_BY)
+        {
+            break;
+        }
+
+        Ipb_RxRingCopyOut(ptRing, ptRing->u32ScanBy, (uint8_t*)pu16Cfg, IPB_FRM_CFG_SZ_BY);
+        if (Ipb_CrcUpdate(IPB_CRC_START, (const uint8_t*)pu16Cfg, IPB_FRM_CRC_DATA_SZ_BY)
+            != pu16Cfg[IPB_FRM_HEAD_SZ + IPB_FRM_CONFIG_SZ])
+        {
+            /** CRC Error, search next header */
+            ptRing->u32CrcErr++;
+            Ipb_RxRingSlide(ptRing);
+            continue;
+        }
+
+        isExt = ((pu16Cfg[IPB_FRM_CMD_IDX] & IPB_FRM_EXT_MASK) != (uint16_t)0U);
+        if (isExt != false)
+        {
+            /** First config word holds the extended data size in bytes */
+            u16DataSzBy = pu16Cfg[IPB_FRM_CFG_IDX];
+            u32FrmBy += u16DataSzBy;
+            if ((u16DataSzBy > IPB_FRM_MAX_EXT_SZ_BY) || ((u16DataSzBy & (uint16_t)1U) != (uint16_t)0U)
+                || (u32FrmBy > ptRing->u32SzBy))
+            {
+                /** Invalid extended size */
+                Ipb_RxRingSlide(ptRing);
+                continue;
+            }
+        }
+
+        if (u32AvailBy < u32FrmBy)
+        {
+            break;
+        }
+
+        ptView->u16SubNode = pu16Cfg[IPB_FRM_NODE_IDX] & IPB_FRM_NODE_MASK;
+        ptView->u16Addr = pu16Cfg[IPB_FRM_CMD_IDX] >> IPB_FRM_ADDR_POS;
+        ptView->u8Cmd = (uint8_t)((pu16Cfg[IPB_FRM_CMD_IDX] >> IPB_FRM_CMD_POS) & IPB_FRM_CMD_MASK);
+        ptView->isExt = isExt;
+        ptView->u16DataSzBy = u16DataSzBy;
+        ptView->u16DataCnt = Ipb_RxRingSegs(ptRing,
+                                            (ptRing->u32ScanBy + ((isExt != false) ? IPB_FRM_CFG_SZ_BY
+                                                : (uint32_t)(IPB_FRM_HEAD_SZ * sizeof(uint16_t)))),
+                                            u16DataSzBy, ptView->ptData);
+        ptView->u32EndBy = ptRing->u32ScanBy + u32FrmBy;
+        ptView->u32Epoch = ptRing->u32Epoch;
+
+        ptRing->u32ScanBy = ptView->u32EndBy;
+        ptRing->u32Held++;
+        isFrame = true;
+    }
+
+    return isFrame;
+}
+
+bool Ipb_RxRingIsValid(const Ipb_TRxRing* ptRing, const Ipb_TFrameView* ptView)
+{
+    return (ptView->u32Epoch == ptRing->u32Epoch);
+}
+
+void Ipb_RxRingRelease(Ipb_TRxRing* ptRing, const Ipb_TFrameView* ptView)
+{
+    /** Stale views were already given back by the overrun */
+    if (ptView->u32Epoch == ptRing->u32Epoch)
+    {
+        if ((int32_t)(ptView->u32EndBy - ptRing->u32RelBy) > 0L)
+        {
+            ptRing->u32RelBy = ptView->u32EndBy;
+        }
+        if (ptRing->u32Held > (uint32_t)0UL)
+        {
+            ptRing->u32Held--;
+        }
+        if (ptRing->u32Held == (uint32_t)0UL)
+        {
+            /** Bytes dropped after the last frame are given back too */
+            ptRing->u32RelBy = ptRing->u32ScanBy;
+        }
+    }
+}
+
+uint16_t Ipb_RxRingCopyData(const Ipb_TFrameView* ptView, uint16_t* pu16Dst, uint16_t u16Sz)
+{
+    uint8_t* pu8Dst = (uint8_t*)pu16Dst;
+    uint32_t u32LeftBy = (uint32_t)u16Sz * sizeof(uint16_t);
+    uint16_t u16CpyBy = (uint16_t)0U;
+    uint16_t u16Idx;
+
+    if (u32LeftBy > ptView->u16DataSzBy)
+    {
+        u32LeftBy = ptView->u16DataSzBy;
+    }
+
+    for (u16Idx = (uint16_t)0U; (u16Idx < ptView->u16DataCnt) && (u32LeftBy > (uint32_t)0UL); u16Idx++)
+    {
+        uint16_t u16SegBy = ptView->ptData[u16Idx].u16SzBy;
+
+        if (u16SegBy > u32LeftBy)
+        {
+            u16SegBy = (uint16_t)u32LeftBy;
+        }
+        memcpy((void*)&pu8Dst[u16CpyBy], (const void*)ptView->ptData[u16Idx].pu8Buf, u16SegBy);
+        u16CpyBy += u16SegBy;
+        u32LeftBy -= u16SegBy;
+    }
+
+    return (uint16_t)(u16CpyBy / sizeof(uint16_t));
+}
+
+static void Ipb_RxRingCopyOut(const Ipb_TRxRing* ptRing, uint32_t u32Pos, uint8_t* pu8Dst, uint32_t u32SzBy)
+{
+    uint32_t u32Off = u32Pos & (ptRing->u32SzBy - 1UL);
+    uint32_t u32First = ptRing->u32SzBy - u32Off;
+
+    if (u32First > u32SzBy)
+    {
+        u32First = u32SzBy;
+    }
+    memcpy((void*)pu8Dst, (const void*)&ptRing->pu8Buf[u32Off], u32First);
+    memcpy((void*)&pu8Dst[u32First], (const void*)ptRing->pu8Buf, (u32SzBy - u32First));
+}
+
+static uint16_t Ipb_RxRingSegs(const Ipb_TRxRing* ptRing, uint32_t u32Pos, uint16_t u16SzBy, Ipb_TFrameIov* ptIov)
+{
+    uint32_t u32Off = u32Pos & (ptRing->u32SzBy - 1UL);
+    uint16_t u16Cnt = (uint16_t)0U;
+
+    if (u16SzBy > (uint16_t)0U)
+    {
+        ptIov[0].pu8Buf = &ptRing->pu8Buf[u32Off];
+        ptIov[0].u16SzBy = u16SzBy;
+        u16Cnt = (uint16_t)1U;
+
+        if ((u32Off + u16SzBy) > ptRing->u32SzBy)
+        {
+            ptIov[0].u16SzBy = (uint16_t)(ptRing->u32SzBy - u32Off);
+            ptIov[1].pu8Buf = ptRing->pu8Buf;
+            ptIov[1].u16SzBy = u16SzBy - ptIov[0].u16SzBy;
+            u16Cnt = (uint16_t)2U;
+        }
+    }
+
+    return u16Cnt;
+}
+
+static void Ipb_RxRingSlide(Ipb_TRxRing* ptRing)
+{
+    ptRing->u32ScanBy++;
+    ptRing->u32DropBy++;
+    if (ptRing->u32Held == (uint32_t)0UL)
+    {
+        ptRing->u32RelBy = ptRing->u32ScanBy;
+    }
+}
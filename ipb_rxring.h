@@ -0,0 +1,187 @@
+/**
+ * @file ipb_rxring.h
+ * @brief This file contains a circular reception buffer of the ingenia
+ *        protocol bus (IPB), handing out frames without copying them
+ *
+ * @note The ring is not used by Ipb_TIntf, Ipb_IntfReadUart keeps
+ *  receiving through Ipb_IntfUartReception. Users of the ring drive it
+ *  themselves: they feed it from their DMA channel or read() calls,
+ *  decode frames with Ipb_RxRingNext and match replies to their requests,
+ *  e.g. copying the data into an Ipb_TMsg with Ipb_RxRingCopyData.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_RXRING_H
+#define IPB_RXRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb_frame.h"
+
+/** Max number of segments of the data of a frame, two when it wraps */
+#define IPB_RXRING_IOV_NUM      2U
+
+/** Circular reception buffer */
+typedef struct
+{
+    /** Buffer filled by the DMA engine or the OS */
+    uint8_t* pu8Buf;
+    /** Size of the buffer in bytes, power of 2 */
+    uint32_t u32SzBy;
+    /** Bytes written, free running */
+    uint32_t u32WrBy;
+    /** Bytes decoded, free running */
+    uint32_t u32ScanBy;
+    /** Bytes released, free running */
+    uint32_t u32RelBy;
+    /** Number of frames handed out and not yet released */
+    uint32_t u32Held;
+    /** Number of bytes skipped while resynchronising */
+    uint32_t u32DropBy;
+    /** Number of headers rejected by crc */
+    uint32_t u32CrcErr;
+    /** Number of times the writer overran unreleased bytes */
+    uint32_t u32Overruns;
+    /** Generation of the views handed out, changes with each overrun */
+    uint32_t u32Epoch;
+} Ipb_TRxRing;
+
+/** Frame decoded in place */
+typedef struct
+{
+    /** Internal network node */
+    uint16_t u16SubNode;
+    /** Register address */
+    uint16_t u16Addr;
+    /** Command */
+    uint8_t u8Cmd;
+    /** Data is extended data, config data otherwise */
+    bool isExt;
+    /** Data segments, pointing into the buffer */
+    Ipb_TFrameIov ptData[IPB_RXRING_IOV_NUM];
+    /** Number of data segments */
+    uint16_t u16DataCnt;
+    /** Size of the data in bytes */
+    uint16_t u16DataSzBy;
+    /** Buffer position past the frame */
+    uint32_t u32EndBy;
+    /** Ring generation the view belongs to */
+    uint32_t u32Epoch;
+} Ipb_TFrameView;
+
+/**
+ * Initialises a circular reception buffer
+ *
+ * @param[out] ptRing
+ *  Ring instance
+ * @param[in] pu8Buf
+ *  Buffer, e.g. the one of a circular DMA channel
+ * @param[in] u32SzBy
+ *  Size of the buffer in bytes, power of 2
+ *
+ * @retval true if success, false if size is not a power of 2
+ */
+bool
+Ipb_RxRingInit(Ipb_TRxRing* ptRing, uint8_t* pu8Buf, uint32_t u32SzBy);
+
+/**
+ * Gets the free space the next received bytes are written to, for
+ * writers told where to write, e.g. read() system calls
+ *
+ * @param[in] ptRing
+ *  Ring instance
+ * @param[out] ppu8Dst
+ *  Start of the free space
+ *
+ * @retval contiguous free bytes, 0 if ring is full
+ */
+uint32_t
+Ipb_RxRingSpace(Ipb_TRxRing* ptRing, uint8_t** ppu8Dst);
+
+/**
+ * Commits bytes written into the space given by Ipb_RxRingSpace
+ *
+ * @param[in] ptRing
+ *  Ring instance
+ * @param[in] u32SzBy
+ *  Number of bytes written
+ */
+void
+Ipb_RxRingCommit(Ipb_TRxRing* ptRing, uint32_t u32SzBy);
+
+/**
+ * Sets the position a circular DMA engine writes the next byte to, for
+ * writers filling the buffer on their own
+ *
+ * @note The engine does not wait for frames to be released. The buffer
+ *  must hold the bytes received while views are held plus those between
+ *  two calls; a whole lap between two calls can not be detected. Views
+ *  held when unreleased bytes are overwritten become stale, see
+ *  Ipb_RxRingIsValid.
+ *
+ * @param[in] ptRing
+ *  Ring instance
+ * @param[in] u32Pos
+ *  Offset in the buffer, e.g. size minus the DMA remaining count
+ */
+void
+Ipb_RxRingSetPos(Ipb_TRxRing* ptRing, uint32_t u32Pos);
+
+/**
+ * Decodes the next complete frame, skipping bytes not starting a valid
+ * header the way ipb_parser.h does
+ *
+ * @param[in] ptRing
+ *  Ring instance
+ * @param[out] ptView
+ *  Frame view, valid until released
+ *
+ * @retval true if a frame was decoded, false if none is complete
+ */
+bool
+Ipb_RxRingNext(Ipb_TRxRing* ptRing, Ipb_TFrameView* ptView);
+
+/**
+ * Indicates if the data of a view is still in the buffer
+ *
+ * @param[in] ptRing
+ *  Ring instance
+ * @param[in] ptView
+ *  Frame view
+ *
+ * @retval true if valid, false if overwritten by an overrun
+ */
+bool
+Ipb_RxRingIsValid(const Ipb_TRxRing* ptRing, const Ipb_TFrameView* ptView);
+
+/**
+ * Releases a frame and the bytes before it, views are released in the
+ * order they were decoded. Releasing a stale view has no effect.
+ *
+ * @param[in] ptRing
+ *  Ring instance
+ * @param[in] ptView
+ *  Frame view
+ */
+void
+Ipb_RxRingRelease(Ipb_TRxRing* ptRing, const Ipb_TFrameView* ptView);
+
+/**
+ * Copies the data of a frame, for users needing it contiguous, e.g. in
+ * an Ipb_TMsg
+ *
+ * @param[in] ptView
+ *  Frame view
+ * @param[out] pu16Dst
+ *  Destination buffer
+ * @param[in] u16Sz
+ *  Size of the destination buffer in words
+ *
+ * @retval number of words copied
+ */
+uint16_t
+Ipb_RxRingCopyData(const Ipb_TFrameView* ptView, uint16_t* pu16Dst, uint16_t u16Sz);
+
+#endif /* IPB_RXRING_H */
@@ -0,0 +1,776 @@
+/**
+ * @file ipb_sched.c
+ * @brief This file contains a work stealing pool of workers driving
+ *        many ingenia protocol bus (IPB) buses on Linux hosts
+ *
+ * @note A bus with queued or in flight transactions is runnable and sits
+ *  in exactly one run queue: the one of the worker that last ran it, or
+ *  the injection queue when a submission wakes it up. Workers run their
+ *  own buses newest first and steal the oldest ones of the others when
+ *  out of work. Buses waiting for a reply are parked out of the run
+ *  queues until their descriptor gets readable or the transaction is
+ *  due to time out. A single worker at a time polls the parked buses,
+ *  blocking on them when there is nothing else to do.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_sched.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/** Run queue position mask */
+#define IPB_SCHED_MSK           (uint32_t)(IPB_SCHED_MAX_BUS - 1U)
+
+/** Bus scheduling states */
+#define IPB_SCHED_IDLE          (uint32_t)0UL
+#define IPB_SCHED_QUEUED        (uint32_t)1UL
+#define IPB_SCHED_RUNNING       (uint32_t)2UL
+#define IPB_SCHED_PARKED        (uint32_t)3UL
+
+/** Max number of readiness events fetched with each poll of parked buses */
+#define IPB_SCHED_EVENTS        16U
+
+/**
+ * Worker thread
+ */
+static void*
+Ipb_SchedWorker(void* pvArg);
+
+/**
+ * Runs a bus and queues it again if it still has work
+ */
+static void
+Ipb_SchedRun(Ipb_TSchedWorker* ptWorker, Ipb_TSchedBus* ptBus);
+
+/**
+ * Sleeps a worker until woken up or IPB_SCHED_IDLE_US elapse, polling
+ * the parked buses meanwhile if no other worker does
+ */
+static void
+Ipb_SchedSleep(Ipb_TSchedWorker* ptWorker);
+
+/**
+ * Parks a bus waiting for a reply until data arrives or its transaction
+ * is due to time out
+ */
+static void
+Ipb_SchedPark(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus);
+
+/**
+ * Pushes the parked buses with data or due into the run queue of the
+ * worker, only done by one worker at a time
+ *
+ * @param[in] ptWorker
+ *  Worker instance
+ * @param[in] u32TimeoutUs
+ *  Max time to wait for a parked bus to get ready
+ *
+ * @retval true if polled, false if another worker is polling
+ */
+static bool
+Ipb_SchedReap(Ipb_TSchedWorker* ptWorker, uint32_t u32TimeoutUs);
+
+/**
+ * Moves a parked bus back to the runnable state
+ *
+ * @note Called with the lock taken.
+ *
+ * @retval true if it was parked, false otherwise
+ */
+static bool
+Ipb_SchedUnpark(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus);
+
+/**
+ * Wakes up a sleeping worker, if any
+ */
+static void
+Ipb_SchedWake(Ipb_TSched* ptSched);
+
+/**
+ * Pushes a bus at the bottom of the run queue, only called by its owner
+ */
+static void
+Ipb_SchedPush(Ipb_TSchedWorker* ptWorker, Ipb_TSchedBus* ptBus);
+
+/**
+ * Takes the newest bus of the run queue, only called by its owner
+ *
+ * @retval bus, NULL if empty
+ */
+static Ipb_TSchedBus*
+Ipb_SchedTake(Ipb_TSchedWorker* ptWorker);
+
+/**
+ * Takes the oldest bus of the run queue of another worker
+ *
+ * @retval bus, NULL if empty or lost against another thief
+ */
+static Ipb_TSchedBus*
+Ipb_SchedSteal(Ipb_TSchedWorker* ptWorker);
+
+/**
+ * Pushes a bus into the injection queue
+ */
+static void
+Ipb_SchedInject(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus);
+
+/**
+ * Takes the oldest bus of the injection queue
+ *
+ * @retval bus, NULL if empty
+ */
+static Ipb_TSchedBus*
+Ipb_SchedInjected(Ipb_TSched* ptSched);
+
+/**
+ * Indicates if the shared request queue of a bus has a request at a
+ * consumer position
+ */
+static bool
+Ipb_SchedHasReq(Ipb_TSchedBus* ptBus, uint32_t u32Head);
+
+int32_t Ipb_SchedInit(Ipb_TSched* ptSched, uint16_t u16WorkerCnt, const int32_t* pi32Cpu)
+{
+    int32_t i32Ret = 0L;
+    pthread_condattr_t tAttr;
+    struct epoll_event tEv;
+
+    while (1)
+    {
+        if ((u16WorkerCnt == (uint16_t)0U) || (u16WorkerCnt > (uint16_t)IPB_SCHED_MAX_WORKER))
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        memset((void*)ptSched, 0, sizeof(*ptSched));
+        ptSched->i32Ep = -1L;
+        ptSched->i32Ev = -1L;
+        ptSched->u16WorkerCnt = u16WorkerCnt;
+        for (uint16_t u16Idx = 0U; u16Idx < u16WorkerCnt; ++u16Idx)
+        {
+            ptSched->ptWorker[u16Idx].ptSched = ptSched;
+            ptSched->ptWorker[u16Idx].i32Cpu = (pi32Cpu != NULL) ? pi32Cpu[u16Idx] : -1L;
+        }
+        for (uint32_t u32Idx = 0UL; u32Idx < IPB_SCHED_MAX_BUS; ++u32Idx)
+        {
+            atomic_init(&ptSched->ptInject[u32Idx].u32Seq, u32Idx);
+        }
+
+        (void)pthread_condattr_init(&tAttr);
+        (void)pthread_condattr_setclock(&tAttr, CLOCK_MONOTONIC);
+        if ((pthread_mutex_init(&ptSched->tLock, NULL) != 0) || (pthread_cond_init(&ptSched->tCond, &tAttr) != 0))
+        {
+            i32Ret = -2L;
+        }
+        (void)pthread_condattr_destroy(&tAttr);
+        if (i32Ret != 0L)
+        {
+            break;
+        }
+
+        /** Wake ups of the polling worker come with a NULL bus */
+        ptSched->i32Ep = epoll_create1(EPOLL_CLOEXEC);
+        ptSched->i32Ev = eventfd(0U, (EFD_NONBLOCK | EFD_CLOEXEC));
+        tEv.events = EPOLLIN;
+        tEv.data.ptr = NULL;
+        if ((ptSched->i32Ep < 0L) || (ptSched->i32Ev < 0L)
+            || (epoll_ctl(ptSched->i32Ep, EPOLL_CTL_ADD, ptSched->i32Ev, &tEv) != 0))
+        {
+            Ipb_SchedDeinit(ptSched);
+            i32Ret = -3L;
+        }
+        break;
+    }
+
+    return i32Ret;
+}
+
+void Ipb_SchedDeinit(Ipb_TSched* ptSched)
+{
+    if (ptSched->i32Ev >= 0L)
+    {
+        (void)close(ptSched->i32Ev);
+        ptSched->i32Ev = -1L;
+    }
+    if (ptSched->i32Ep >= 0L)
+    {
+        (void)close(ptSched->i32Ep);
+        ptSched->i32Ep = -1L;
+    }
+    (void)pthread_cond_destroy(&ptSched->tCond);
+    (void)pthread_mutex_destroy(&ptSched->tLock);
+}
+
+int32_t Ipb_SchedAdd(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus, Ipb_TInst* ptInst, int32_t i32Fd)
+{
+    int32_t i32Ret = -1L;
+    uint16_t u16Cnt = atomic_load_explicit(&ptSched->u16BusCnt, memory_order_relaxed);
+    struct epoll_event tEv;
+
+    /** Descriptor is watched once armed by each park */
+    tEv.events = EPOLLONESHOT;
+    tEv.data.ptr = (void*)ptBus;
+    if ((i32Fd >= 0L) && (epoll_ctl(ptSched->i32Ep, EPOLL_CTL_ADD, i32Fd, &tEv) != 0))
+    {
+        u16Cnt = (uint16_t)IPB_SCHED_MAX_BUS;
+        i32Ret = -2L;
+    }
+
+    /** Run queues hold every bus at once, so they never get full */
+    while (u16Cnt < (uint16_t)IPB_SCHED_MAX_BUS)
+    {
+        if (atomic_compare_exchange_weak_explicit(&ptSched->u16BusCnt, &u16Cnt, (uint16_t)(u16Cnt + 1U),
+                                                  memory_order_relaxed, memory_order_relaxed) != false)
+        {
+            ptBus->ptSched = ptSched;
+            ptBus->i32Fd = i32Fd;
+            ptBus->u32WakeUs = (uint32_t)0UL;
+            Ipb_SharedInit(&ptBus->tShared, ptInst);
+            atomic_init(&ptBus->u32State, IPB_SCHED_IDLE);
+            i32Ret = 0L;
+            break;
+        }
+    }
+
+    if ((i32Ret == -1L) && (i32Fd >= 0L))
+    {
+        (void)epoll_ctl(ptSched->i32Ep, EPOLL_CTL_DEL, i32Fd, NULL);
+    }
+
+    return i32Ret;
+}
+
+Ipb_EStatus Ipb_SchedSubmit(Ipb_TSchedBus* ptBus, Ipb_TSharedReq* ptReq, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+                            void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx)
+{
+    Ipb_EStatus eRet = Ipb_SharedSubmit(&ptBus->tShared, ptReq, ptMsg, u32Timeout, OnDone, pvCtx);
+    uint32_t u32State = IPB_SCHED_IDLE;
+
+    /** Request visible before the state is checked, see Ipb_SchedRun */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if ((eRet == IPB_SUCCESS)
+        && (atomic_compare_exchange_strong_explicit(&ptBus->u32State, &u32State, IPB_SCHED_QUEUED,
+                                                    memory_order_acq_rel, memory_order_relaxed) != false))
+    {
+        Ipb_SchedInject(ptBus->ptSched, ptBus);
+        Ipb_SchedWake(ptBus->ptSched);
+    }
+
+    return eRet;
+}
+
+int32_t Ipb_SchedStart(Ipb_TSched* ptSched)
+{
+    int32_t i32Ret = 0L;
+    cpu_set_t tCpus;
+
+    atomic_store_explicit(&ptSched->isRunning, true, memory_order_release);
+    for (uint16_t u16Idx = 0U; u16Idx < ptSched->u16WorkerCnt; ++u16Idx)
+    {
+        Ipb_TSchedWorker* ptWorker = &ptSched->ptWorker[u16Idx];
+
+        if (pthread_create(&ptWorker->tThread, NULL, Ipb_SchedWorker, (void*)ptWorker) != 0)
+        {
+            /** Workers already started keep running until stopped */
+            ptSched->u16WorkerCnt = u16Idx;
+            i32Ret = -1L;
+            break;
+        }
+
+        if (ptWorker->i32Cpu >= 0L)
+        {
+            CPU_ZERO(&tCpus);
+            CPU_SET((int)ptWorker->i32Cpu, &tCpus);
+            if (pthread_setaffinity_np(ptWorker->tThread, sizeof(tCpus), &tCpus) != 0)
+            {
+                i32Ret = -2L;
+            }
+        }
+    }
+
+    return i32Ret;
+}
+
+void Ipb_SchedStop(Ipb_TSched* ptSched)
+{
+    uint64_t u64One = 1ULL;
+
+    atomic_store_explicit(&ptSched->isRunning, false, memory_order_release);
+    (void)pthread_mutex_lock(&ptSched->tLock);
+    (void)pthread_cond_broadcast(&ptSched->tCond);
+    (void)pthread_mutex_unlock(&ptSched->tLock);
+    (void)write(ptSched->i32Ev, &u64One, sizeof(u64One));
+
+    for (uint16_t u16Idx = 0U; u16Idx < ptSched->u16WorkerCnt; ++u16Idx)
+    {
+        (void)pthread_join(ptSched->ptWorker[u16Idx].tThread, NULL);
+    }
+}
+
+void Ipb_SchedGetStats(Ipb_TSched* ptSched, uint16_t u16Worker, Ipb_TSchedStats* ptStats)
+{
+    Ipb_TSchedWorker* ptWorker = &ptSched->ptWorker[u16Worker];
+
+    ptStats->u64BusyUs = atomic_load_explicit(&ptWorker->u64BusyUs, memory_order_relaxed);
+    ptStats->u64IdleUs = atomic_load_explicit(&ptWorker->u64IdleUs, memory_order_relaxed);
+    ptStats->u32Runs = atomic_load_explicit(&ptWorker->u32Runs, memory_order_relaxed);
+    ptStats->u32Parks = atomic_load_explicit(&ptWorker->u32Parks, memory_order_relaxed);
+    ptStats->u32Steals = atomic_load_explicit(&ptWorker->u32Steals, memory_order_relaxed);
+    ptStats->u32Done = atomic_load_explicit(&ptWorker->u32Done, memory_order_relaxed);
+}
+
+static void* Ipb_SchedWorker(void* pvArg)
+{
+    Ipb_TSchedWorker* ptWorker = (Ipb_TSchedWorker*)pvArg;
+    Ipb_TSched* ptSched = ptWorker->ptSched;
+    uint16_t u16Self = (uint16_t)(ptWorker - &ptSched->ptWorker[0]);
+    Ipb_TSchedBus* ptBus;
+
+    while (atomic_load_explicit(&ptSched->isRunning, memory_order_acquire) != false)
+    {
+        /** Parked buses are not left behind by workers that never sleep */
+        if ((Ipb_GetMicros() - ptWorker->u32ReapUs) >= (uint32_t)IPB_SCHED_IDLE_US)
+        {
+            (void)Ipb_SchedReap(ptWorker, 0UL);
+        }
+
+        ptBus = Ipb_SchedTake(ptWorker);
+        if (ptBus == NULL)
+        {
+            ptBus = Ipb_SchedInjected(ptSched);
+        }
+
+        /** Out of work, victims visited starting by the next worker */
+        for (uint16_t u16Idx = 1U; (ptBus == NULL) && (u16Idx < ptSched->u16WorkerCnt); ++u16Idx)
+        {
+            ptBus = Ipb_SchedSteal(&ptSched->ptWorker[(u16Self + u16Idx) % ptSched->u16WorkerCnt]);
+            if (ptBus != NULL)
+            {
+                atomic_fetch_add_explicit(&ptWorker->u32Steals, 1UL, memory_order_relaxed);
+            }
+        }
+
+        if (ptBus != NULL)
+        {
+            Ipb_SchedRun(ptWorker, ptBus);
+        }
+        else
+        {
+            Ipb_SchedSleep(ptWorker);
+        }
+    }
+
+    return NULL;
+}
+
+static void Ipb_SchedRun(Ipb_TSchedWorker* ptWorker, Ipb_TSchedBus* ptBus)
+{
+    uint32_t u32Start = Ipb_GetMicros();
+    uint32_t u32State = IPB_SCHED_IDLE;
+    const Ipb_TSharedReq* ptCur = ptBus->tShared.ptCur;
+    uint64_t u64RunUs;
+    uint32_t u32Head;
+    uint16_t u16Done;
+    bool isProgress;
+
+    atomic_store_explicit(&ptBus->u32State, IPB_SCHED_RUNNING, memory_order_relaxed);
+    u16Done = Ipb_SharedWork(&ptBus->tShared, (uint16_t)IPB_SCHED_BUDGET);
+    isProgress = ((u16Done > (uint16_t)0U) || (ptBus->tShared.ptCur != ptCur));
+
+    if (ptBus->tShared.ptCur != NULL)
+    {
+        /** Request sent, nothing to do until its reply arrives */
+        Ipb_SchedPark(ptWorker->ptSched, ptBus);
+        atomic_fetch_add_explicit(&ptWorker->u32Parks, 1UL, memory_order_relaxed);
+    }
+    else if (Ipb_SharedIsIdle(&ptBus->tShared) == false)
+    {
+        atomic_store_explicit(&ptBus->u32State, IPB_SCHED_QUEUED, memory_order_relaxed);
+        Ipb_SchedPush(ptWorker, ptBus);
+    }
+    else
+    {
+        /** Once idle the bus may run elsewhere, so its position is kept before */
+        u32Head = ptBus->tShared.u32Head;
+
+        /** A submission racing with going idle is caught by one side */
+        atomic_store_explicit(&ptBus->u32State, IPB_SCHED_IDLE, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        if ((Ipb_SchedHasReq(ptBus, u32Head) != false)
+            && (atomic_compare_exchange_strong_explicit(&ptBus->u32State, &u32State, IPB_SCHED_QUEUED,
+                                                        memory_order_acq_rel, memory_order_relaxed) != false))
+        {
+            Ipb_SchedPush(ptWorker, ptBus);
+        }
+    }
+
+    /** Runs only polling a bus for its reply are no useful work */
+    u64RunUs = (uint64_t)(Ipb_GetMicros() - u32Start);
+    if (isProgress != false)
+    {
+        atomic_fetch_add_explicit(&ptWorker->u64BusyUs, u64RunUs, memory_order_relaxed);
+    }
+    else
+    {
+        atomic_fetch_add_explicit(&ptWorker->u64IdleUs, u64RunUs, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&ptWorker->u32Runs, 1UL, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ptWorker->u32Done, (uint32_t)u16Done, memory_order_relaxed);
+}
+
+static void Ipb_SchedSleep(Ipb_TSchedWorker* ptWorker)
+{
+    Ipb_TSched* ptSched = ptWorker->ptSched;
+    uint32_t u32Start = Ipb_GetMicros();
+    uint32_t u32Pos;
+    struct timespec tAbs;
+
+    if (Ipb_SchedReap(ptWorker, (uint32_t)IPB_SCHED_IDLE_US) == false)
+    {
+        atomic_fetch_add_explicit(&ptSched->u32Sleepers, 1UL, memory_order_seq_cst);
+        (void)clock_gettime(CLOCK_MONOTONIC, &tAbs);
+        tAbs.tv_nsec += (long)IPB_SCHED_IDLE_US * 1000L;
+        if (tAbs.tv_nsec >= 1000000000L)
+        {
+            tAbs.tv_sec++;
+            tAbs.tv_nsec -= 1000000000L;
+        }
+
+        (void)pthread_mutex_lock(&ptSched->tLock);
+        u32Pos = atomic_load_explicit(&ptSched->u32InjectHead, memory_order_relaxed);
+        if ((atomic_load_explicit(&ptSched->isRunning, memory_order_acquire) != false)
+            && (atomic_load_explicit(&ptSched->ptInject[u32Pos & IPB_SCHED_MSK].u32Seq, memory_order_acquire)
+                != (u32Pos + 1UL)))
+        {
+            (void)pthread_cond_timedwait(&ptSched->tCond, &ptSched->tLock, &tAbs);
+        }
+        (void)pthread_mutex_unlock(&ptSched->tLock);
+        atomic_fetch_sub_explicit(&ptSched->u32Sleepers, 1UL, memory_order_relaxed);
+    }
+
+    atomic_fetch_add_explicit(&ptWorker->u64IdleUs, (uint64_t)(Ipb_GetMicros() - u32Start), memory_order_relaxed);
+}
+
+static void Ipb_SchedWake(Ipb_TSched* ptSched)
+{
+    uint64_t u64One = 1ULL;
+
+    /** Work published before sleepers are checked, see Ipb_SchedReap */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ptSched->u32Sleepers, memory_order_seq_cst) > 0UL)
+    {
+        (void)pthread_mutex_lock(&ptSched->tLock);
+        (void)pthread_cond_signal(&ptSched->tCond);
+        (void)pthread_mutex_unlock(&ptSched->tLock);
+    }
+    else if (atomic_load_explicit(&ptSched->isPolling, memory_order_seq_cst) != false)
+    {
+        (void)write(ptSched->i32Ev, &u64One, sizeof(u64One));
+    }
+}
+
+static void Ipb_SchedPark(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus)
+{
+    /** One millisecond late so the transaction has timed out when it runs */
+    uint32_t u32ParkUs = (Ipb_SharedGetLeft(&ptBus->tShared) + 1UL) * (uint32_t)1000UL;
+    struct epoll_event tEv;
+
+    if ((ptBus->i32Fd < 0L) && (u32ParkUs > (uint32_t)IPB_SCHED_POLL_US))
+    {
+        u32ParkUs = IPB_SCHED_POLL_US;
+    }
+
+    (void)pthread_mutex_lock(&ptSched->tLock);
+    ptBus->u32WakeUs = Ipb_GetMicros() + u32ParkUs;
+    atomic_store_explicit(&ptBus->u32State, IPB_SCHED_PARKED, memory_order_relaxed);
+    ptSched->ptParked[ptSched->u16ParkedCnt] = ptBus;
+    ptSched->u16ParkedCnt++;
+    (void)pthread_mutex_unlock(&ptSched->tLock);
+
+    /** Armed once parked, data already received is reported at once */
+    if (ptBus->i32Fd >= 0L)
+    {
+        tEv.events = (EPOLLIN | EPOLLONESHOT);
+        tEv.data.ptr = (void*)ptBus;
+        if (epoll_ctl(ptSched->i32Ep, EPOLL_CTL_MOD, ptBus->i32Fd, &tEv) != 0)
+        {
+            (void)pthread_mutex_lock(&ptSched->tLock);
+            ptBus->u32WakeUs = Ipb_GetMicros() + (uint32_t)IPB_SCHED_POLL_US;
+            (void)pthread_mutex_unlock(&ptSched->tLock);
+        }
+    }
+}
+
+static bool Ipb_SchedReap(Ipb_TSchedWorker* ptWorker, uint32_t u32TimeoutUs)
+{
+    Ipb_TSched* ptSched = ptWorker->ptSched;
+    Ipb_TSchedBus* ptReady[IPB_SCHED_MAX_BUS];
+    struct epoll_event ptEv[IPB_SCHED_EVENTS];
+    uint16_t u16ReadyCnt = (uint16_t)0U;
+    bool isPolling = false;
+    bool isPolled = false;
+    uint64_t u64Cnt;
+    uint32_t u32Now;
+    uint32_t u32Pos;
+    int32_t i32Left;
+    int iEvCnt;
+
+    while (1)
+    {
+        if (atomic_compare_exchange_strong_explicit(&ptSched->isPolling, &isPolling, true,
+                                                    memory_order_seq_cst, memory_order_relaxed) == false)
+        {
+            break;
+        }
+        isPolled = true;
+        atomic_thread_fence(memory_order_seq_cst);
+        ptWorker->u32ReapUs = Ipb_GetMicros();
+
+        /** Wait no longer than the first parked bus due, nor with work injected */
+        (void)pthread_mutex_lock(&ptSched->tLock);
+        for (uint16_t u16Idx = 0U; u16Idx < ptSched->u16ParkedCnt; ++u16Idx)
+        {
+            i32Left = (int32_t)(ptSched->ptParked[u16Idx]->u32WakeUs - ptWorker->u32ReapUs);
+            if (i32Left < (int32_t)u32TimeoutUs)
+            {
+                u32TimeoutUs = (i32Left > 0L) ? (uint32_t)i32Left : 0UL;
+            }
+        }
+        (void)pthread_mutex_unlock(&ptSched->tLock);
+
+        u32Pos = atomic_load_explicit(&ptSched->u32InjectHead, memory_order_relaxed);
+        if ((atomic_load_explicit(&ptSched->isRunning, memory_order_acquire) == false)
+            || (atomic_load_explicit(&ptSched->ptInject[u32Pos & IPB_SCHED_MSK].u32Seq, memory_order_acquire)
+                == (u32Pos + 1UL)))
+        {
+            u32TimeoutUs = 0UL;
+        }
+
+        iEvCnt = epoll_wait(ptSched->i32Ep, ptEv, (int)IPB_SCHED_EVENTS,
+                            (int)((u32TimeoutUs + 999UL) / 1000UL));
+
+        (void)pthread_mutex_lock(&ptSched->tLock);
+        for (int iIdx = 0; iIdx < iEvCnt; ++iIdx)
+        {
+            Ipb_TSchedBus* ptBus = (Ipb_TSchedBus*)ptEv[iIdx].data.ptr;
+
+            if (ptBus == NULL)
+            {
+                (void)read(ptSched->i32Ev, &u64Cnt, sizeof(u64Cnt));
+            }
+            else if (Ipb_SchedUnpark(ptSched, ptBus) != false)
+            {
+                ptReady[u16ReadyCnt] = ptBus;
+                u16ReadyCnt++;
+            }
+        }
+
+        u32Now = Ipb_GetMicros();
+        for (uint16_t u16Idx = 0U; u16Idx < ptSched->u16ParkedCnt;)
+        {
+            Ipb_TSchedBus* ptBus = ptSched->ptParked[u16Idx];
+
+            if (((int32_t)(u32Now - ptBus->u32WakeUs) >= 0L) && (Ipb_SchedUnpark(ptSched, ptBus) != false))
+            {
+                ptReady[u16ReadyCnt] = ptBus;
+                u16ReadyCnt++;
+            }
+            else
+            {
+                ++u16Idx;
+            }
+        }
+        (void)pthread_mutex_unlock(&ptSched->tLock);
+
+        atomic_store_explicit(&ptSched->isPolling, false, memory_order_seq_cst);
+
+        for (uint16_t u16Idx = 0U; u16Idx < u16ReadyCnt; ++u16Idx)
+        {
+            Ipb_SchedPush(ptWorker, ptReady[u16Idx]);
+        }
+        break;
+    }
+
+    return isPolled;
+}
+
+static bool Ipb_SchedUnpark(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus)
+{
+    bool isParked = false;
+
+    for (uint16_t u16Idx = 0U; u16Idx < ptSched->u16ParkedCnt; ++u16Idx)
+    {
+        if (ptSched->ptParked[u16Idx] == ptBus)
+        {
+            /** Last parked bus takes the free position */
+            ptSched->u16ParkedCnt--;
+            ptSched->ptParked[u16Idx] = ptSched->ptParked[ptSched->u16ParkedCnt];
+            atomic_store_explicit(&ptBus->u32State, IPB_SCHED_QUEUED, memory_order_relaxed);
+            isParked = true;
+            break;
+        }
+    }
+
+    return isParked;
+}
+
+static void Ipb_SchedPush(Ipb_TSchedWorker* ptWorker, Ipb_TSchedBus* ptBus)
+{
+    int32_t i32Bottom = atomic_load_explicit(&ptWorker->i32Bottom, memory_order_relaxed);
+    int32_t i32Top = atomic_load_explicit(&ptWorker->i32Top, memory_order_acquire);
+
+    /** Bus published to thieves with the new bottom */
+    atomic_store_explicit(&ptWorker->ptDeque[(uint32_t)i32Bottom & IPB_SCHED_MSK], ptBus, memory_order_relaxed);
+    atomic_store_explicit(&ptWorker->i32Bottom, (i32Bottom + 1L), memory_order_release);
+
+    /** More work than this worker can do at once, let a sleeper steal it */
+    if ((i32Bottom - i32Top) > 0L)
+    {
+        Ipb_SchedWake(ptWorker->ptSched);
+    }
+}
+
+static Ipb_TSchedBus* Ipb_SchedTake(Ipb_TSchedWorker* ptWorker)
+{
+    Ipb_TSchedBus* ptBus = NULL;
+    int32_t i32Bottom = atomic_load_explicit(&ptWorker->i32Bottom, memory_order_relaxed) - 1L;
+    int32_t i32Top;
+
+    atomic_store_explicit(&ptWorker->i32Bottom, i32Bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    i32Top = atomic_load_explicit(&ptWorker->i32Top, memory_order_relaxed);
+
+    if (i32Top <= i32Bottom)
+    {
+        ptBus = atomic_load_explicit(&ptWorker->ptDeque[(uint32_t)i32Bottom & IPB_SCHED_MSK], memory_order_relaxed);
+        if (i32Top == i32Bottom)
+        {
+            /** Last one, thieves may be after it */
+            if (atomic_compare_exchange_strong_explicit(&ptWorker->i32Top, &i32Top, (i32Top + 1L),
+                                                        memory_order_seq_cst, memory_order_relaxed) == false)
+            {
+                ptBus = NULL;
+            }
+            atomic_store_explicit(&ptWorker->i32Bottom, (i32Bottom + 1L), memory_order_relaxed);
+        }
+    }
+    else
+    {
+        atomic_store_explicit(&ptWorker->i32Bottom, (i32Bottom + 1L), memory_order_relaxed);
+    }
+
+    return ptBus;
+}
+
+static Ipb_TSchedBus* Ipb_SchedSteal(Ipb_TSchedWorker* ptWorker)
+{
+    Ipb_TSchedBus* ptBus = NULL;
+    int32_t i32Top = atomic_load_explicit(&ptWorker->i32Top, memory_order_acquire);
+    int32_t i32Bottom;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    i32Bottom = atomic_load_explicit(&ptWorker->i32Bottom, memory_order_acquire);
+
+    if (i32Top < i32Bottom)
+    {
+        ptBus = atomic_load_explicit(&ptWorker->ptDeque[(uint32_t)i32Top & IPB_SCHED_MSK], memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&ptWorker->i32Top, &i32Top, (i32Top + 1L),
+                                                    memory_order_seq_cst, memory_order_relaxed) == false)
+        {
+            ptBus = NULL;
+        }
+    }
+
+    return ptBus;
+}
+
+static void Ipb_SchedInject(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus)
+{
+    uint32_t u32Pos = atomic_load_explicit(&ptSched->u32InjectTail, memory_order_relaxed);
+    Ipb_TSchedCell* ptCell;
+    int32_t i32Dif;
+
+    /** Never full, a bus is queued at most once */
+    while (1)
+    {
+        ptCell = &ptSched->ptInject[u32Pos & IPB_SCHED_MSK];
+        i32Dif = (int32_t)(atomic_load_explicit(&ptCell->u32Seq, memory_order_acquire) - u32Pos);
+
+        if (i32Dif == 0L)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ptSched->u32InjectTail, &u32Pos, (u32Pos + 1UL),
+                                                      memory_order_relaxed, memory_order_relaxed) != false)
+            {
+                ptCell->ptBus = ptBus;
+                atomic_store_explicit(&ptCell->u32Seq, (u32Pos + 1UL), memory_order_release);
+                break;
+            }
+        }
+        else
+        {
+            u32Pos = atomic_load_explicit(&ptSched->u32InjectTail, memory_order_relaxed);
+        }
+    }
+}
+
+static Ipb_TSchedBus* Ipb_SchedInjected(Ipb_TSched* ptSched)
+{
+    Ipb_TSchedBus* ptBus = NULL;
+    uint32_t u32Pos = atomic_load_explicit(&ptSched->u32InjectHead, memory_order_relaxed);
+    Ipb_TSchedCell* ptCell;
+    int32_t i32Dif;
+
+    while (1)
+    {
+        ptCell = &ptSched->ptInject[u32Pos & IPB_SCHED_MSK];
+        i32Dif = (int32_t)(atomic_load_explicit(&ptCell->u32Seq, memory_order_acquire) - (u32Pos + 1UL));
+
+        if (i32Dif == 0L)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ptSched->u32InjectHead, &u32Pos, (u32Pos + 1UL),
+                                                      memory_order_relaxed, memory_order_relaxed) != false)
+            {
+                ptBus = ptCell->ptBus;
+                atomic_store_explicit(&ptCell->u32Seq, (u32Pos + IPB_SCHED_MAX_BUS), memory_order_release);
+                break;
+            }
+        }
+        else if (i32Dif < 0L)
+        {
+            /** Empty */
+            break;
+        }
+        else
+        {
+            u32Pos = atomic_load_explicit(&ptSched->u32InjectHead, memory_order_relaxed);
+        }
+    }
+
+    return ptBus;
+}
+
+static bool Ipb_SchedHasReq(Ipb_TSchedBus* ptBus, uint32_t u32Head)
+{
+    const Ipb_TSharedCell* ptCell = &ptBus->tShared.ptCell[u32Head & (IPB_SHARED_QUEUE_SZ - 1U)];
+
+    return (atomic_load_explicit(&ptCell->u32Seq, memory_order_acquire) == (u32Head + 1UL));
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,264 @@
+/**
+ * @file ipb_sched.h
+ * @brief This file contains a work stealing pool of workers driving
+ *        many ingenia protocol bus (IPB) buses on Linux hosts
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_SCHED_H
+#define IPB_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "ipb_shared.h"
+
+/** Max number of buses of a pool, power of 2 */
+#ifndef IPB_SCHED_MAX_BUS
+#define IPB_SCHED_MAX_BUS       64U
+#endif
+
+/** Max number of workers of a pool */
+#ifndef IPB_SCHED_MAX_WORKER
+#define IPB_SCHED_MAX_WORKER    16U
+#endif
+
+/** Max number of transactions started on a bus each time it runs */
+#ifndef IPB_SCHED_BUDGET
+#define IPB_SCHED_BUDGET        4U
+#endif
+
+/** Max time in microseconds an idle worker sleeps before looking for work */
+#ifndef IPB_SCHED_IDLE_US
+#define IPB_SCHED_IDLE_US       1000U
+#endif
+
+/**
+ * Max time in microseconds a bus waiting for a reply stays parked when it
+ * has no descriptor signalling received data
+ */
+#ifndef IPB_SCHED_POLL_US
+#define IPB_SCHED_POLL_US       1000U
+#endif
+
+typedef struct Ipb_TSched Ipb_TSched;
+
+/** Bus driven by a pool */
+typedef struct
+{
+    /** Pool driving the bus */
+    Ipb_TSched* ptSched;
+    /** Requests of the bus */
+    Ipb_TShared tShared;
+    /** Scheduling state, see ipb_sched.c */
+    _Atomic uint32_t u32State;
+    /** Descriptor signalling received data, owned by the port, negative if none */
+    int32_t i32Fd;
+    /** Time in microseconds a parked bus runs again without received data */
+    uint32_t u32WakeUs;
+} Ipb_TSchedBus;
+
+/** Injection queue position */
+typedef struct
+{
+    /** Position sequence, tells producers and consumers if it is free */
+    _Atomic uint32_t u32Seq;
+    /** Queued bus */
+    Ipb_TSchedBus* ptBus;
+} Ipb_TSchedCell;
+
+/** Worker statistics */
+typedef struct
+{
+    /** Time in microseconds spent driving buses making progress */
+    uint64_t u64BusyUs;
+    /** Time in microseconds spent sleeping or running buses making no progress */
+    uint64_t u64IdleUs;
+    /** Number of bus runs */
+    uint32_t u32Runs;
+    /** Number of buses parked waiting for a reply */
+    uint32_t u32Parks;
+    /** Number of buses taken from other workers */
+    uint32_t u32Steals;
+    /** Number of completed transactions */
+    uint32_t u32Done;
+} Ipb_TSchedStats;
+
+/** Worker of a pool */
+typedef struct
+{
+    /** Pool of the worker */
+    Ipb_TSched* ptSched;
+    /** Thread */
+    pthread_t tThread;
+    /** CPU the thread is bound to, negative if not bound */
+    int32_t i32Cpu;
+    /** Run queue, the owner works at the bottom and thieves at the top */
+    _Atomic(Ipb_TSchedBus*) ptDeque[IPB_SCHED_MAX_BUS];
+    /** Oldest position of the run queue */
+    _Atomic int32_t i32Top;
+    /** Next free position of the run queue */
+    _Atomic int32_t i32Bottom;
+    /** Time in microseconds spent driving buses making progress */
+    _Atomic uint64_t u64BusyUs;
+    /** Time in microseconds spent sleeping or running buses making no progress */
+    _Atomic uint64_t u64IdleUs;
+    /** Time in microseconds of the last check of parked buses */
+    uint32_t u32ReapUs;
+    /** Number of bus runs */
+    _Atomic uint32_t u32Runs;
+    /** Number of buses parked waiting for a reply */
+    _Atomic uint32_t u32Parks;
+    /** Number of buses taken from other workers */
+    _Atomic uint32_t u32Steals;
+    /** Number of completed transactions */
+    _Atomic uint32_t u32Done;
+} Ipb_TSchedWorker;
+
+/** Pool instance */
+struct Ipb_TSched
+{
+    /** Workers */
+    Ipb_TSchedWorker ptWorker[IPB_SCHED_MAX_WORKER];
+    /** Number of workers */
+    uint16_t u16WorkerCnt;
+    /** Number of buses */
+    _Atomic uint16_t u16BusCnt;
+    /** Buses woken from outside the workers, any producer and consumer */
+    Ipb_TSchedCell ptInject[IPB_SCHED_MAX_BUS];
+    /** Next position to be filled of the injection queue */
+    _Atomic uint32_t u32InjectTail;
+    /** Next position to be taken of the injection queue */
+    _Atomic uint32_t u32InjectHead;
+    /** Workers sleeping without work, the one polling parked buses excluded */
+    _Atomic uint32_t u32Sleepers;
+    /** A worker is polling the parked buses */
+    _Atomic bool isPolling;
+    /** Readiness notification descriptor of the parked buses, -1 if closed */
+    int32_t i32Ep;
+    /** Wakes up the worker polling the parked buses, -1 if closed */
+    int32_t i32Ev;
+    /** Buses waiting for a reply, protected by tLock */
+    Ipb_TSchedBus* ptParked[IPB_SCHED_MAX_BUS];
+    /** Number of parked buses */
+    uint16_t u16ParkedCnt;
+    /** Idle sleep and parked buses lock */
+    pthread_mutex_t tLock;
+    /** Idle sleep wakeup */
+    pthread_cond_t tCond;
+    /** Workers keep running while set */
+    _Atomic bool isRunning;
+};
+
+/**
+ * Initialises a pool, workers are not started yet
+ *
+ * @param[out] ptSched
+ *  Pool instance
+ * @param[in] u16WorkerCnt
+ *  Number of workers, up to IPB_SCHED_MAX_WORKER
+ * @param[in] pi32Cpu
+ *  CPU each worker is bound to, negative does not bind. NULL does not
+ *  bind any worker
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_SchedInit(Ipb_TSched* ptSched, uint16_t u16WorkerCnt, const int32_t* pi32Cpu);
+
+/**
+ * Releases a pool, workers must be stopped before
+ *
+ * @param[in] ptSched
+ *  Pool instance
+ */
+void
+Ipb_SchedDeinit(Ipb_TSched* ptSched);
+
+/**
+ * Adds a bus to a pool
+ *
+ * @note A bus waiting for a reply is parked, it runs again once its
+ *  descriptor is readable or the transaction times out. Buses without
+ *  descriptor, e.g. on an io_uring engine, run again every
+ *  IPB_SCHED_POLL_US while parked.
+ *
+ * @param[in] ptSched
+ *  Pool instance
+ * @param[out] ptBus
+ *  Bus instance
+ * @param[in] ptInst
+ *  Instance of the bus, only used by the pool from now on
+ * @param[in] i32Fd
+ *  Descriptor signalling received data, e.g. the one of an Ipb_TSerial or
+ *  Ipb_TUdp port, negative if none
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_SchedAdd(Ipb_TSched* ptSched, Ipb_TSchedBus* ptBus, Ipb_TInst* ptInst, int32_t i32Fd);
+
+/**
+ * Queues a transaction on a bus, callable from any thread, see
+ * Ipb_SharedSubmit
+ *
+ * @param[in] ptBus
+ *  Bus instance
+ * @param[out] ptReq
+ *  Request instance
+ * @param[in/out] ptMsg
+ *  Request to be send and load with reply
+ * @param[in] u32Timeout
+ *  Timeout duration of the whole transaction once started
+ * @param[in] OnDone
+ *  Callback called from a worker on completion, may be NULL
+ * @param[in] pvCtx
+ *  User context passed to the callback
+ *
+ * @retval IPB_SUCCESS if queued, IPB_STANDBY if queue is full
+ */
+Ipb_EStatus
+Ipb_SchedSubmit(Ipb_TSchedBus* ptBus, Ipb_TSharedReq* ptReq, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+                void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx);
+
+/**
+ * Starts the workers of a pool
+ *
+ * @param[in] ptSched
+ *  Pool instance
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_SchedStart(Ipb_TSched* ptSched);
+
+/**
+ * Stops the workers of a pool and waits for them
+ *
+ * @note Transactions in progress are left as they are.
+ *
+ * @param[in] ptSched
+ *  Pool instance
+ */
+void
+Ipb_SchedStop(Ipb_TSched* ptSched);
+
+/**
+ * Gets the statistics of a worker, callable from any thread
+ *
+ * @note Utilisation is u64BusyUs over the sum of busy and idle time.
+ *
+ * @param[in] ptSched
+ *  Pool instance
+ * @param[in] u16Worker
+ *  Worker index
+ * @param[out] ptStats
+ *  Statistics
+ */
+void
+Ipb_SchedGetStats(Ipb_TSched* ptSched, uint16_t u16Worker, Ipb_TSchedStats* ptStats);
+
+#endif /* IPB_SCHED_H */
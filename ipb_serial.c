@@ -0,0 +1,314 @@
+/**
+ * @file ipb_serial.c
+ * @brief This file contains the serial port of the
+ *        ingenia protocol bus (IPB) for Linux hosts
+ *
+ * @note Device is non blocking. Blocking requests sleep on the device
+ *  through the port Wait operation. A reception finding no data may
+ *  also sleep on epoll for up to u16RxWaitMs.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_serial.h"
+#include "ipb_port.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <linux/serial.h>
+
+static uint16_t
+Ipb_SerialReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size);
+
+static uint16_t
+Ipb_SerialTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+static void
+Ipb_SerialDiscardData(void* pvCtx);
+
+static bool
+Ipb_SerialWaitRx(void* pvCtx, uint32_t u32TimeoutUs);
+
+/**
+ * Waits for the device to be ready
+ *
+ * @param[in] ptSerial
+ *  Port instance
+ * @param[in] u32Events
+ *  EPOLLIN or EPOLLOUT
+ * @param[in] u16TimeoutMs
+ *  Max time to wait in milliseconds
+ *
+ * @retval true if ready
+ */
+static bool
+Ipb_SerialWait(Ipb_TSerial* ptSerial, uint32_t u32Events, uint16_t u16TimeoutMs);
+
+/**
+ * Configures the device for raw low latency transfers
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+static int32_t
+Ipb_SerialConfig(int32_t i32Fd, uint32_t u32Baud);
+
+static const Ipb_TPortOps tSerialOps =
+{
+    &Ipb_SerialReception,
+    &Ipb_SerialTransmission,
+    NULL,
+    &Ipb_SerialDiscardData,
+    &Ipb_SerialWaitRx
+};
+
+int32_t Ipb_SerialOpen(Ipb_TSerial* ptSerial, uint16_t u16Id, const char* szDev, uint32_t u32Baud)
+{
+    int32_t i32Ret = 0L;
+
+    ptSerial->i32Ep = -1L;
+    ptSerial->u16Id = u16Id;
+    ptSerial->u16RxWaitMs = (uint16_t)IPB_SERIAL_RX_WAIT_MS;
+    ptSerial->u32RxWaits = (uint32_t)0UL;
+
+    while (1)
+    {
+        struct epoll_event tEv;
+
+        ptSerial->i32Fd = open(szDev, (O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC));
+        if (ptSerial->i32Fd < 0L)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        i32Ret = Ipb_SerialConfig(ptSerial->i32Fd, u32Baud);
+        if (i32Ret != 0L)
+        {
+            break;
+        }
+
+        ptSerial->i32Ep = epoll_create1(EPOLL_CLOEXEC);
+        if (ptSerial->i32Ep < 0L)
+        {
+            i32Ret = -4L;
+            break;
+        }
+
+        /** Interest is changed on each wait, registered without events */
+        memset((void*)&tEv, 0, sizeof(tEv));
+        if (epoll_ctl(ptSerial->i32Ep, EPOLL_CTL_ADD, ptSerial->i32Fd, &tEv) != 0)
+        {
+            i32Ret = -5L;
+            break;
+        }
+
+        if (Ipb_PortRegister(u16Id, &tSerialOps, (void*)ptSerial) == false)
+        {
+            i32Ret = -6L;
+            break;
+        }
+
+        break;
+    }
+
+    if (i32Ret != 0L)
+    {
+        if (ptSerial->i32Ep >= 0L)
+        {
+            (void)close(ptSerial->i32Ep);
+            ptSerial->i32Ep = -1L;
+        }
+        if (ptSerial->i32Fd >= 0L)
+        {
+            (void)close(ptSerial->i32Fd);
+            ptSerial->i32Fd = -1L;
+        }
+    }
+
+    return i32Ret;
+}
+
+void Ipb_SerialClose(Ipb_TSerial* ptSerial)
+{
+    if (ptSerial->i32Fd >= 0L)
+    {
+        Ipb_PortUnregister(ptSerial->u16Id);
+        (void)close(ptSerial->i32Ep);
+        (void)close(ptSerial->i32Fd);
+        ptSerial->i32Ep = -1L;
+        ptSerial->i32Fd = -1L;
+    }
+}
+
+static uint16_t Ipb_SerialReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size)
+{
+    Ipb_TSerial* ptSerial = (Ipb_TSerial*)pvCtx;
+    ssize_t sRdBy = read(ptSerial->i32Fd, (void*)pu8Buf, u16Size);
+
+    if ((sRdBy <= 0) && (ptSerial->u16RxWaitMs > (uint16_t)0U))
+    {
+        ptSerial->u32RxWaits++;
+        if (Ipb_SerialWait(ptSerial, EPOLLIN, ptSerial->u16RxWaitMs) != false)
+        {
+            sRdBy = read(ptSerial->i32Fd, (void*)pu8Buf, u16Size);
+        }
+    }
+
+    return (sRdBy > 0) ? (uint16_t)sRdBy : (uint16_t)0U;
+}
+
+static uint16_t Ipb_SerialTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TSerial* ptSerial = (Ipb_TSerial*)pvCtx;
+    uint16_t u16Ret = 0U;
+    struct iovec ptVec[IPB_FRM_DESC_IOV_NUM];
+    uint16_t u16Idx = (uint16_t)0U;
+
+    while (u16Idx < u16IovCnt)
+    {
+        uint16_t u16Cnt = (uint16_t)0U;
+        ssize_t sWrBy;
+
+        /** Segments are written with a single system call */
+        while ((u16Cnt < IPB_FRM_DESC_IOV_NUM) && ((u16Idx + u16Cnt) < u16IovCnt))
+        {
+            ptVec[u16Cnt].iov_base = (void*)ptIov[u16Idx + u16Cnt].pu8Buf;
+            ptVec[u16Cnt].iov_len = ptIov[u16Idx + u16Cnt].u16SzBy;
+            u16Cnt++;
+        }
+
+        while (u16Cnt > (uint16_t)0U)
+        {
+            sWrBy = writev(ptSerial->i32Fd, ptVec, u16Cnt);
+            if (sWrBy < 0)
+            {
+                if ((errno != EAGAIN)
+                    || (Ipb_SerialWait(ptSerial, EPOLLOUT, IPB_SERIAL_TX_WAIT_MS) == false))
+                {
+                    u16Ret = (uint16_t)errno;
+                    break;
+                }
+                continue;
+            }
+
+            /** Partial write, skip the written bytes */
+            while ((u16Cnt > (uint16_t)0U) && ((size_t)sWrBy >= ptVec[0].iov_len))
+            {
+                sWrBy -= (ssize_t)ptVec[0].iov_len;
+                memmove((void*)&ptVec[0], (const void*)&ptVec[1], (sizeof(ptVec[0]) * (u16Cnt - 1U)));
+                u16Cnt--;
+                u16Idx++;
+            }
+            if (u16Cnt > (uint16_t)0U)
+            {
+                ptVec[0].iov_base = (void*)((uint8_t*)ptVec[0].iov_base + sWrBy);
+                ptVec[0].iov_len -= (size_t)sWrBy;
+            }
+        }
+
+        if (u16Ret != 0U)
+        {
+            break;
+        }
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_SerialDiscardData(void* pvCtx)
+{
+    Ipb_TSerial* ptSerial = (Ipb_TSerial*)pvCtx;
+    uint8_t pu8Drop[64];
+
+    (void)tcflush(ptSerial->i32Fd, TCIFLUSH);
+    while (read(ptSerial->i32Fd, (void*)pu8Drop, sizeof(pu8Drop)) > 0)
+    {
+    }
+}
+
+static bool Ipb_SerialWaitRx(void* pvCtx, uint32_t u32TimeoutUs)
+{
+    Ipb_TSerial* ptSerial = (Ipb_TSerial*)pvCtx;
+    struct pollfd tPfd = { ptSerial->i32Fd, POLLIN, 0 };
+    struct timespec tTs;
+
+    /** Microsecond resolution, epoll waits are limited to milliseconds */
+    tTs.tv_sec = (time_t)(u32TimeoutUs / 1000000UL);
+    tTs.tv_nsec = (long)(u32TimeoutUs % 1000000UL) * 1000L;
+    ptSerial->u32RxWaits++;
+
+    return (ppoll(&tPfd, 1U, &tTs, NULL) > 0);
+}
+
+static bool Ipb_SerialWait(Ipb_TSerial* ptSerial, uint32_t u32Events, uint16_t u16TimeoutMs)
+{
+    struct epoll_event tEv;
+
+    memset((void*)&tEv, 0, sizeof(tEv));
+    tEv.events = u32Events;
+    (void)epoll_ctl(ptSerial->i32Ep, EPOLL_CTL_MOD, ptSerial->i32Fd, &tEv);
+
+    return (epoll_wait(ptSerial->i32Ep, &tEv, 1, (int)u16TimeoutMs) > 0);
+}
+
+static int32_t Ipb_SerialConfig(int32_t i32Fd, uint32_t u32Baud)
+{
+    int32_t i32Ret = 0L;
+    struct termios tTio;
+    struct serial_struct tSer;
+
+    while (1)
+    {
+        if (tcgetattr(i32Fd, &tTio) != 0)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        /** Raw 8N1, reads return whatever is available */
+        cfmakeraw(&tTio);
+        tTio.c_cflag |= (CLOCAL | CREAD);
+        tTio.c_cflag &= ~(CSTOPB | CRTSCTS);
+        tTio.c_cc[VMIN] = 0;
+        tTio.c_cc[VTIME] = 0;
+
+        if ((u32Baud != (uint32_t)0UL) && (cfsetspeed(&tTio, (speed_t)u32Baud) != 0))
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        if (tcsetattr(i32Fd, TCSANOW, &tTio) != 0)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        /** Optional, USB adapters otherwise batch rx bytes for several ms */
+        if (ioctl(i32Fd, TIOCGSERIAL, &tSer) == 0)
+        {
+            tSer.flags |= ASYNC_LOW_LATENCY;
+            (void)ioctl(i32Fd, TIOCSSERIAL, &tSer);
+        }
+
+        break;
+    }
+
+    return i32Ret;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,76 @@
+/**
+ * @file ipb_serial.h
+ * @brief This file contains the serial port of the
+ *        ingenia protocol bus (IPB) for Linux hosts
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_SERIAL_H
+#define IPB_SERIAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Default max time in milliseconds a reception waits for data. Blocking
+ * requests already wait through the port Wait operation, see
+ * Ipb_SetWait
+ */
+#ifndef IPB_SERIAL_RX_WAIT_MS
+#define IPB_SERIAL_RX_WAIT_MS   0U
+#endif
+
+/** Max time in milliseconds a transmission waits for room in the driver */
+#ifndef IPB_SERIAL_TX_WAIT_MS
+#define IPB_SERIAL_TX_WAIT_MS   100U
+#endif
+
+/** Serial port instance */
+typedef struct
+{
+    /** Device file descriptor, -1 if closed */
+    int32_t i32Fd;
+    /** Readiness notification descriptor */
+    int32_t i32Ep;
+    /** Identification of the IPB instance using the port */
+    uint16_t u16Id;
+    /** Max time in milliseconds a reception waits for data, 0 never waits */
+    uint16_t u16RxWaitMs;
+    /** Number of waits for received data */
+    uint32_t u32RxWaits;
+} Ipb_TSerial;
+
+/**
+ * Opens a serial device (or pseudo-terminal) and registers it for
+ * u16Id, so the UART_BASED instance initialised with the same
+ * identification uses it
+ *
+ * @note Device is configured raw, 8N1, without flow control. Low
+ *  latency mode is requested from the driver when supported.
+ *
+ * @param[out] ptSerial
+ *  Port instance
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] szDev
+ *  Device path, e.g. "/dev/ttyUSB0"
+ * @param[in] u32Baud
+ *  Baudrate, 0 to keep the current one (pseudo-terminals)
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_SerialOpen(Ipb_TSerial* ptSerial, uint16_t u16Id, const char* szDev, uint32_t u32Baud);
+
+/**
+ * Unregisters and closes a serial port
+ *
+ * @param[in] ptSerial
+ *  Port instance
+ */
+void
+Ipb_SerialClose(Ipb_TSerial* ptSerial);
+
+#endif /* IPB_SERIAL_H */
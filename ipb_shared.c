@@ -0,0 +1,227 @@
+/**
+ * @file ipb_shared.c
+ * @brief This file contains the shared bus mode of the ingenia protocol
+ *        bus (IPB), requests from any thread served by one bus worker
+ *
+ * @note Producers never block each other nor the worker: each position
+ *  of the queue carries a sequence telling whether it is free for the
+ *  producer of that round or filled for the consumer.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_shared.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/** Queue position mask */
+#define IPB_SHARED_QUEUE_MSK    (uint32_t)(IPB_SHARED_QUEUE_SZ - 1U)
+
+/**
+ * Takes the oldest queued request, only called by the worker
+ *
+ * @retval request, NULL if queue is empty
+ */
+static Ipb_TSharedReq*
+Ipb_SharedPop(Ipb_TShared* ptShared);
+
+/**
+ * Write completion of the current request, reads the reply
+ */
+static void
+Ipb_SharedOnWrite(void* pvCtx, Ipb_TMsg* ptMsg);
+
+/**
+ * Read completion of the current request
+ */
+static void
+Ipb_SharedOnRead(void* pvCtx, Ipb_TMsg* ptMsg);
+
+/**
+ * Posts the result of the current request to its submitter
+ */
+static void
+Ipb_SharedPost(Ipb_TShared* ptShared, Ipb_TMsg* ptMsg);
+
+void Ipb_SharedInit(Ipb_TShared* ptShared, Ipb_TInst* ptInst)
+{
+    ptShared->ptInst = ptInst;
+    for (uint32_t u32Idx = 0UL; u32Idx < IPB_SHARED_QUEUE_SZ; ++u32Idx)
+    {
+        atomic_init(&ptShared->ptCell[u32Idx].u32Seq, u32Idx);
+        ptShared->ptCell[u32Idx].ptReq = NULL;
+    }
+    atomic_init(&ptShared->u32Tail, 0UL);
+    ptShared->u32Head = (uint32_t)0UL;
+    ptShared->ptCur = NULL;
+    ptShared->u32StartMillis = (uint32_t)0UL;
+    atomic_init(&ptShared->u32Full, 0UL);
+}
+
+Ipb_EStatus Ipb_SharedSubmit(Ipb_TShared* ptShared, Ipb_TSharedReq* ptReq, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+                             void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx)
+{
+    Ipb_EStatus eRet = IPB_STANDBY;
+    uint32_t u32Pos = atomic_load_explicit(&ptShared->u32Tail, memory_order_relaxed);
+    Ipb_TSharedCell* ptCell;
+    int32_t i32Dif;
+
+    ptReq->ptMsg = ptMsg;
+    ptReq->u32Timeout = u32Timeout;
+    ptReq->OnDone = OnDone;
+    ptReq->pvCtx = pvCtx;
+    atomic_store_explicit(&ptReq->isDone, false, memory_order_relaxed);
+
+    while (1)
+    {
+        ptCell = &ptShared->ptCell[u32Pos & IPB_SHARED_QUEUE_MSK];
+        i32Dif = (int32_t)(atomic_load_explicit(&ptCell->u32Seq, memory_order_acquire) - u32Pos);
+
+        if (i32Dif == 0L)
+        {
+            /** Position free for this round, claim it */
+            if (atomic_compare_exchange_weak_explicit(&ptShared->u32Tail, &u32Pos, (u32Pos + 1UL),
+                                                      memory_order_relaxed, memory_order_relaxed) != false)
+            {
+                ptCell->ptReq = ptReq;
+                atomic_store_explicit(&ptCell->u32Seq, (u32Pos + 1UL), memory_order_release);
+                eRet = IPB_SUCCESS;
+                break;
+            }
+        }
+        else if (i32Dif < 0L)
+        {
+            /** Not yet consumed from the previous round */
+            atomic_fetch_add_explicit(&ptShared->u32Full, 1UL, memory_order_relaxed);
+            break;
+        }
+        else
+        {
+            /** Taken by another producer */
+            u32Pos = atomic_load_explicit(&ptShared->u32Tail, memory_order_relaxed);
+        }
+    }
+
+    return eRet;
+}
+
+bool Ipb_SharedIsDone(Ipb_TSharedReq* ptReq)
+{
+    return atomic_load_explicit(&ptReq->isDone, memory_order_acquire);
+}
+
+uint16_t Ipb_SharedWork(Ipb_TShared* ptShared, uint16_t u16Budget)
+{
+    uint16_t u16Done = (uint16_t)0U;
+
+    while (1)
+    {
+        if (ptShared->ptCur == NULL)
+        {
+            if (u16Budget == (uint16_t)0U)
+            {
+                break;
+            }
+            ptShared->ptCur = Ipb_SharedPop(ptShared);
+            if (ptShared->ptCur == NULL)
+            {
+                break;
+            }
+            u16Budget--;
+            ptShared->u32StartMillis = Ipb_GetMillis();
+
+            /** Only one transaction on the bus, its write always gets queued */
+            (void)Ipb_WriteAsync(ptShared->ptInst, ptShared->ptCur->ptMsg, ptShared->ptCur->u32Timeout,
+                                 Ipb_SharedOnWrite, (void*)ptShared);
+        }
+
+        (void)Ipb_Poll(ptShared->ptInst, (uint16_t)IPB_SHARED_STEPS);
+
+        /** Still waiting for the reply */
+        if (ptShared->ptCur != NULL)
+        {
+            break;
+        }
+        u16Done++;
+    }
+
+    return u16Done;
+}
+
+uint32_t Ipb_SharedGetLeft(Ipb_TShared* ptShared)
+{
+    uint32_t u32Left = (uint32_t)0UL;
+    uint32_t u32Elapsed = Ipb_GetMillis() - ptShared->u32StartMillis;
+
+    if ((ptShared->ptCur != NULL) && (u32Elapsed < ptShared->ptCur->u32Timeout))
+    {
+        u32Left = ptShared->ptCur->u32Timeout - u32Elapsed;
+    }
+
+    return u32Left;
+}
+
+bool Ipb_SharedIsIdle(Ipb_TShared* ptShared)
+{
+    const Ipb_TSharedCell* ptCell = &ptShared->ptCell[ptShared->u32Head & IPB_SHARED_QUEUE_MSK];
+
+    return ((ptShared->ptCur == NULL)
+            && (atomic_load_explicit(&ptCell->u32Seq, memory_order_acquire) != (ptShared->u32Head + 1UL)));
+}
+
+static Ipb_TSharedReq* Ipb_SharedPop(Ipb_TShared* ptShared)
+{
+    Ipb_TSharedReq* ptReq = NULL;
+    Ipb_TSharedCell* ptCell = &ptShared->ptCell[ptShared->u32Head & IPB_SHARED_QUEUE_MSK];
+
+    if (atomic_load_explicit(&ptCell->u32Seq, memory_order_acquire) == (ptShared->u32Head + 1UL))
+    {
+        ptReq = ptCell->ptReq;
+        /** Free for the producer of the next round */
+        atomic_store_explicit(&ptCell->u32Seq, (ptShared->u32Head + IPB_SHARED_QUEUE_SZ), memory_order_release);
+        ptShared->u32Head++;
+    }
+
+    return ptReq;
+}
+
+static void Ipb_SharedOnWrite(void* pvCtx, Ipb_TMsg* ptMsg)
+{
+    Ipb_TShared* ptShared = (Ipb_TShared*)pvCtx;
+    uint32_t u32Left = Ipb_SharedGetLeft(ptShared);
+
+    /** Reply gets the time the request left of the transaction timeout */
+    if ((ptMsg->eStatus == IPB_SUCCESS) && (u32Left == (uint32_t)0UL))
+    {
+        ptMsg->eStatus = IPB_ERROR;
+    }
+
+    if (ptMsg->eStatus == IPB_SUCCESS)
+    {
+        (void)Ipb_ReadAsync(ptShared->ptInst, ptMsg, u32Left, Ipb_SharedOnRead, pvCtx);
+    }
+    else
+    {
+        Ipb_SharedPost(ptShared, ptMsg);
+    }
+}
+
+static void Ipb_SharedOnRead(void* pvCtx, Ipb_TMsg* ptMsg)
+{
+    Ipb_SharedPost((Ipb_TShared*)pvCtx, ptMsg);
+}
+
+static void Ipb_SharedPost(Ipb_TShared* ptShared, Ipb_TMsg* ptMsg)
+{
+    Ipb_TSharedReq* ptReq = ptShared->ptCur;
+
+    ptShared->ptCur = NULL;
+    if (ptReq->OnDone != NULL)
+    {
+        ptReq->OnDone(ptReq->pvCtx, ptMsg);
+    }
+
+    /** Last access to the request, submitter may reuse it from now on */
+    atomic_store_explicit(&ptReq->isDone, true, memory_order_release);
+}
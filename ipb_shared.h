@@ -0,0 +1,162 @@
+/**
+ * @file ipb_shared.h
+ * @brief This file contains the shared bus mode of the ingenia protocol
+ *        bus (IPB), requests from any thread served by one bus worker
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_SHARED_H
+#define IPB_SHARED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ipb.h"
+
+/** Number of requests the queue of a shared bus holds, power of 2 */
+#ifndef IPB_SHARED_QUEUE_SZ
+#define IPB_SHARED_QUEUE_SZ     32U
+#endif
+
+/** Max number of interface steps of a transaction each time it is served */
+#ifndef IPB_SHARED_STEPS
+#define IPB_SHARED_STEPS        8U
+#endif
+
+/** Shared bus request, owned by its submitter */
+typedef struct
+{
+    /** Request to be send, loaded with the reply on completion */
+    Ipb_TMsg* ptMsg;
+    /** Max time in milliseconds of the transaction once started */
+    uint32_t u32Timeout;
+    /** Completion callback, called from the worker, may be NULL */
+    void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg);
+    /** User context of the callback */
+    void* pvCtx;
+    /** Set once the result is posted */
+    _Atomic bool isDone;
+} Ipb_TSharedReq;
+
+/** Queue position */
+typedef struct
+{
+    /** Position sequence, tells producers and consumer if it is free */
+    _Atomic uint32_t u32Seq;
+    /** Queued request */
+    Ipb_TSharedReq* ptReq;
+} Ipb_TSharedCell;
+
+/** Shared bus instance */
+typedef struct
+{
+    /** Instance of the bus, only used by the worker */
+    Ipb_TInst* ptInst;
+    /** Request queue, any number of producers and a single consumer */
+    Ipb_TSharedCell ptCell[IPB_SHARED_QUEUE_SZ];
+    /** Next position to be taken by a producer */
+    _Atomic uint32_t u32Tail;
+    /** Next position to be consumed by the worker */
+    uint32_t u32Head;
+    /** Request being served by the worker, NULL if none */
+    Ipb_TSharedReq* ptCur;
+    /** Time in milliseconds the request being served started */
+    uint32_t u32StartMillis;
+    /** Number of submissions rejected because queue was full */
+    _Atomic uint32_t u32Full;
+} Ipb_TShared;
+
+/**
+ * Initialises a shared bus on an instance
+ *
+ * @param[out] ptShared
+ *  Shared bus instance
+ * @param[in] ptInst
+ *  Instance of the bus, it must not be used by anybody but the worker
+ */
+void
+Ipb_SharedInit(Ipb_TShared* ptShared, Ipb_TInst* ptInst);
+
+/**
+ * Queues a transaction, callable from any thread
+ *
+ * @note The request is written and its reply read into the same message,
+ *  the way Ipb_Write followed by Ipb_Read does. Request and message must
+ *  remain valid and untouched until done, then ptMsg->eStatus is
+ *  IPB_SUCCESS or IPB_ERROR.
+ *
+ * @param[in] ptShared
+ *  Shared bus instance
+ * @param[out] ptReq
+ *  Request instance
+ * @param[in/out] ptMsg
+ *  Request to be send and load with reply
+ * @param[in] u32Timeout
+ *  Timeout duration of the whole transaction once started, request and
+ *  reply included
+ * @param[in] OnDone
+ *  Callback called from the worker on completion, may be NULL
+ * @param[in] pvCtx
+ *  User context passed to the callback
+ *
+ * @retval IPB_SUCCESS if queued, IPB_STANDBY if queue is full
+ */
+Ipb_EStatus
+Ipb_SharedSubmit(Ipb_TShared* ptShared, Ipb_TSharedReq* ptReq, Ipb_TMsg* ptMsg, uint32_t u32Timeout,
+                 void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx);
+
+/**
+ * Indicates if the result of a request has been posted, callable from
+ * any thread
+ *
+ * @param[in] ptReq
+ *  Request instance
+ *
+ * @retval true if done, false otherwise
+ */
+bool
+Ipb_SharedIsDone(Ipb_TSharedReq* ptReq);
+
+/**
+ * Serves the queued requests one at a time, only called from the bus
+ * worker thread
+ *
+ * @note Returns as soon as the transaction on the bus waits for its reply,
+ *  so the worker can wait for data or serve other buses meanwhile.
+ *
+ * @param[in] ptShared
+ *  Shared bus instance
+ * @param[in] u16Budget
+ *  Max number of transactions started
+ *
+ * @retval number of completed requests
+ */
+uint16_t
+Ipb_SharedWork(Ipb_TShared* ptShared, uint16_t u16Budget);
+
+/**
+ * Gets the time left until the request being served times out, only
+ * called from the bus worker thread
+ *
+ * @param[in] ptShared
+ *  Shared bus instance
+ *
+ * @retval milliseconds left, 0 if expired or no request is served
+ */
+uint32_t
+Ipb_SharedGetLeft(Ipb_TShared* ptShared);
+
+/**
+ * Indicates if the worker has nothing to serve
+ *
+ * @param[in] ptShared
+ *  Shared bus instance
+ *
+ * @retval true if idle, false otherwise
+ */
+bool
+Ipb_SharedIsIdle(Ipb_TShared* ptShared);
+
+#endif /* IPB_SHARED_H */
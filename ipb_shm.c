@@ -0,0 +1,479 @@
+/**
+ * @file ipb_shm.c
+ * @brief This file contains the shared memory port of the ingenia
+ *        protocol bus (IPB), linking processes of the same Linux host
+ *
+ * @note Frames are copied once into the ring of the region and once out
+ *  of it. Producers publish with a store of the ring head; a consumer
+ *  finding its ring empty sleeps on a futex of the region, and only
+ *  the transmission filling an empty ring wakes it up.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_shm.h"
+#include "ipb_port.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if ((IPB_SHM_RING_SZ_BY & (IPB_SHM_RING_SZ_BY - 1U)) != 0U)
+#error "IPB_SHM_RING_SZ_BY must be a power of 2"
+#endif
+
+/** Region initialised, "IPBS" */
+#define IPB_SHM_MAGIC           0x49504253UL
+
+/** Ring position mask */
+#define IPB_SHM_MSK             (IPB_SHM_RING_SZ_BY - 1U)
+
+/** Ring bytes taken by a frame, records keep a 2 bytes alignment */
+#define IPB_SHM_RECORD_SZ_BY(u16SzBy) \
+    ((uint32_t)sizeof(uint16_t) + (((uint32_t)(u16SzBy) + 1UL) & ~1UL))
+
+static uint16_t
+Ipb_ShmReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size);
+
+static uint16_t
+Ipb_ShmTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+static uint16_t
+Ipb_ShmTransmissionM(void* pvCtx, const Ipb_TFrameIov* ptFrm, uint16_t u16FrmCnt);
+
+static void
+Ipb_ShmDiscardData(void* pvCtx);
+
+static bool
+Ipb_ShmWaitRx(void* pvCtx, uint32_t u32TimeoutUs);
+
+/**
+ * Maps a region
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+static int32_t
+Ipb_ShmMap(Ipb_TShm* ptShm, const char* szName, bool isOwner);
+
+/**
+ * Writes a frame in the transmission ring without publishing it
+ *
+ * @param[in] ptShm
+ *  Port instance
+ * @param[in, out] pu32Head
+ *  Ring position to write at, advanced past the frame
+ * @param[in] ptIov
+ *  Segments of the frame
+ * @param[in] u16IovCnt
+ *  Number of segments
+ *
+ * @retval 0 if success, errno otherwise
+ */
+static uint16_t
+Ipb_ShmPush(Ipb_TShm* ptShm, uint32_t* pu32Head, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+/**
+ * Publishes the written frames, waking up the other end if it may sleep
+ *
+ * @param[in] ptShm
+ *  Port instance
+ * @param[in] u32Head
+ *  Ring head before the frames were written
+ * @param[in] u32New
+ *  Ring head after the frames
+ */
+static void
+Ipb_ShmPublish(Ipb_TShm* ptShm, uint32_t u32Head, uint32_t u32New);
+
+/**
+ * Copies bytes into a ring, wrapping around its end
+ */
+static void
+Ipb_ShmCopyIn(Ipb_TShmRing* ptRing, uint32_t u32Pos, const uint8_t* pu8Src, uint32_t u32SzBy);
+
+/**
+ * Copies bytes out of a ring, wrapping around its end
+ */
+static void
+Ipb_ShmCopyOut(const Ipb_TShmRing* ptRing, uint32_t u32Pos, uint8_t* pu8Dst, uint32_t u32SzBy);
+
+static const Ipb_TPortOps tShmOps =
+{
+    &Ipb_ShmReception,
+    &Ipb_ShmTransmission,
+    &Ipb_ShmTransmissionM,
+    &Ipb_ShmDiscardData,
+    &Ipb_ShmWaitRx
+};
+
+int32_t Ipb_ShmCreate(Ipb_TShm* ptShm, const char* szName)
+{
+    int32_t i32Ret = Ipb_ShmMap(ptShm, szName, true);
+
+    if (i32Ret == 0L)
+    {
+        Ipb_TShmRegion* ptRegion = ptShm->ptRegion;
+
+        /** Fresh pages are zeroed, rings start empty */
+        ptRegion->u32RingSzBy = (uint32_t)IPB_SHM_RING_SZ_BY;
+        atomic_store_explicit(&ptRegion->u32Magic, IPB_SHM_MAGIC, memory_order_release);
+        ptShm->ptTx = &ptRegion->tRep;
+        ptShm->ptRx = &ptRegion->tReq;
+    }
+
+    return i32Ret;
+}
+
+int32_t Ipb_ShmOpen(Ipb_TShm* ptShm, uint16_t u16Id, const char* szName)
+{
+    int32_t i32Ret = Ipb_ShmMap(ptShm, szName, false);
+
+    while (i32Ret == 0L)
+    {
+        Ipb_TShmRegion* ptRegion = ptShm->ptRegion;
+
+        if ((atomic_load_explicit(&ptRegion->u32Magic, memory_order_acquire) != IPB_SHM_MAGIC)
+            || (ptRegion->u32RingSzBy != (uint32_t)IPB_SHM_RING_SZ_BY))
+        {
+            i32Ret = -5L;
+            break;
+        }
+        ptShm->ptTx = &ptRegion->tReq;
+        ptShm->ptRx = &ptRegion->tRep;
+
+        if (Ipb_PortRegister(u16Id, &tShmOps, (void*)ptShm) == false)
+        {
+            i32Ret = -6L;
+            break;
+        }
+        ptShm->u16Id = u16Id;
+        ptShm->isPort = true;
+
+        break;
+    }
+
+    if ((i32Ret != 0L) && (ptShm->ptRegion != NULL))
+    {
+        (void)munmap((void*)ptShm->ptRegion, sizeof(Ipb_TShmRegion));
+        ptShm->ptRegion = NULL;
+    }
+
+    return i32Ret;
+}
+
+void Ipb_ShmClose(Ipb_TShm* ptShm)
+{
+    if (ptShm->ptRegion != NULL)
+    {
+        if (ptShm->isPort != false)
+        {
+            Ipb_PortUnregister(ptShm->u16Id);
+            ptShm->isPort = false;
+        }
+        (void)munmap((void*)ptShm->ptRegion, sizeof(Ipb_TShmRegion));
+        ptShm->ptRegion = NULL;
+        if (ptShm->isOwner != false)
+        {
+            (void)shm_unlink(ptShm->szName);
+        }
+    }
+}
+
+uint16_t Ipb_ShmSend(Ipb_TShm* ptShm, const uint8_t* pu8Buf, uint16_t u16SzBy)
+{
+    Ipb_TFrameIov tIov = { pu8Buf, u16SzBy };
+
+    return Ipb_ShmTransmission((void*)ptShm, &tIov, (uint16_t)1U);
+}
+
+uint16_t Ipb_ShmRecv(Ipb_TShm* ptShm, uint8_t* pu8Buf, uint16_t u16Size)
+{
+    Ipb_TShmRing* ptRing = ptShm->ptRx;
+    uint32_t u32Tail = atomic_load_explicit(&ptRing->u32Tail, memory_order_relaxed);
+    uint16_t u16RdBy = (uint16_t)0U;
+
+    if (atomic_load_explicit(&ptRing->u32Head, memory_order_acquire) != u32Tail)
+    {
+        uint16_t u16SzBy;
+
+        Ipb_ShmCopyOut(ptRing, u32Tail, (uint8_t*)&u16SzBy, (uint32_t)sizeof(u16SzBy));
+        u16RdBy = u16SzBy - ptShm->u16RxOffBy;
+        if (u16RdBy > u16Size)
+        {
+            u16RdBy = u16Size;
+        }
+        Ipb_ShmCopyOut(ptRing, (u32Tail + (uint32_t)sizeof(u16SzBy) + ptShm->u16RxOffBy), pu8Buf, u16RdBy);
+        ptShm->u16RxOffBy += u16RdBy;
+
+        if (ptShm->u16RxOffBy == u16SzBy)
+        {
+            /** Frame space given back to the producer */
+            ptShm->u16RxOffBy = (uint16_t)0U;
+            atomic_store_explicit(&ptRing->u32Tail, (u32Tail + IPB_SHM_RECORD_SZ_BY(u16SzBy)),
+                                  memory_order_seq_cst);
+        }
+    }
+
+    return u16RdBy;
+}
+
+bool Ipb_ShmWait(Ipb_TShm* ptShm, uint32_t u32TimeoutUs)
+{
+    Ipb_TShmRing* ptRing = ptShm->ptRx;
+    uint32_t u32Seq = atomic_load_explicit(&ptRing->u32Seq, memory_order_seq_cst);
+    uint32_t u32Tail = atomic_load_explicit(&ptRing->u32Tail, memory_order_relaxed);
+    bool isReady = (atomic_load_explicit(&ptRing->u32Head, memory_order_seq_cst) != u32Tail);
+
+    if ((isReady == false) && (u32TimeoutUs > (uint32_t)0UL))
+    {
+        struct timespec tTs;
+
+        tTs.tv_sec = (time_t)(u32TimeoutUs / 1000000UL);
+        tTs.tv_nsec = (long)(u32TimeoutUs % 1000000UL) * 1000L;
+        ptShm->u32Sleeps++;
+
+        /** A frame published after u32Seq was read changes it, no sleep */
+        atomic_store_explicit(&ptRing->u32Sleepers, 1UL, memory_order_seq_cst);
+        (void)syscall(SYS_futex, (uint32_t*)&ptRing->u32Seq, FUTEX_WAIT, u32Seq, &tTs, NULL, 0);
+        atomic_store_explicit(&ptRing->u32Sleepers, 0UL, memory_order_relaxed);
+
+        isReady = (atomic_load_explicit(&ptRing->u32Head, memory_order_acquire) != u32Tail);
+    }
+
+    return isReady;
+}
+
+static uint16_t Ipb_ShmReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size)
+{
+    return Ipb_ShmRecv((Ipb_TShm*)pvCtx, pu8Buf, u16Size);
+}
+
+static uint16_t Ipb_ShmTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TShm* ptShm = (Ipb_TShm*)pvCtx;
+    uint32_t u32Head = atomic_load_explicit(&ptShm->ptTx->u32Head, memory_order_relaxed);
+    uint32_t u32New = u32Head;
+    uint16_t u16Ret = Ipb_ShmPush(ptShm, &u32New, ptIov, u16IovCnt);
+
+    if (u16Ret == 0U)
+    {
+        Ipb_ShmPublish(ptShm, u32Head, u32New);
+    }
+
+    return u16Ret;
+}
+
+static uint16_t Ipb_ShmTransmissionM(void* pvCtx, const Ipb_TFrameIov* ptFrm, uint16_t u16FrmCnt)
+{
+    Ipb_TShm* ptShm = (Ipb_TShm*)pvCtx;
+    uint32_t u32Head = atomic_load_explicit(&ptShm->ptTx->u32Head, memory_order_relaxed);
+    uint32_t u32New = u32Head;
+    uint16_t u16Ret = 0U;
+    uint16_t u16Idx;
+
+    for (u16Idx = (uint16_t)0U; (u16Idx < u16FrmCnt) && (u16Ret == 0U); u16Idx++)
+    {
+        u16Ret = Ipb_ShmPush(ptShm, &u32New, &ptFrm[u16Idx], (uint16_t)1U);
+    }
+
+    /** Frames written before an error still go, with a single wake up */
+    if (u32New != u32Head)
+    {
+        Ipb_ShmPublish(ptShm, u32Head, u32New);
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_ShmDiscardData(void* pvCtx)
+{
+    Ipb_TShm* ptShm = (Ipb_TShm*)pvCtx;
+    Ipb_TShmRing* ptRing = ptShm->ptRx;
+
+    ptShm->u16RxOffBy = (uint16_t)0U;
+    atomic_store_explicit(&ptRing->u32Tail, atomic_load_explicit(&ptRing->u32Head, memory_order_acquire),
+                          memory_order_seq_cst);
+}
+
+static bool Ipb_ShmWaitRx(void* pvCtx, uint32_t u32TimeoutUs)
+{
+    return Ipb_ShmWait((Ipb_TShm*)pvCtx, u32TimeoutUs);
+}
+
+static int32_t Ipb_ShmMap(Ipb_TShm* ptShm, const char* szName, bool isOwner)
+{
+    int32_t i32Ret = 0L;
+    int32_t i32Fd = -1L;
+    void* pvMap;
+
+    ptShm->ptRegion = NULL;
+    ptShm->ptTx = NULL;
+    ptShm->ptRx = NULL;
+    ptShm->isOwner = isOwner;
+    ptShm->isPort = false;
+    ptShm->u16Id = (uint16_t)0U;
+    ptShm->u16RxOffBy = (uint16_t)0U;
+    ptShm->u32TxFrames = (uint32_t)0UL;
+    ptShm->u32Wakes = (uint32_t)0UL;
+    ptShm->u32Sleeps = (uint32_t)0UL;
+
+    while (1)
+    {
+        struct stat tStat;
+
+        if (strlen(szName) >= sizeof(ptShm->szName))
+        {
+            i32Ret = -1L;
+            break;
+        }
+        strcpy(ptShm->szName, szName);
+
+        if (isOwner != false)
+        {
+            /** A region left by a dead gateway is replaced */
+            (void)shm_unlink(szName);
+            i32Fd = shm_open(szName, (O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC), (S_IRUSR | S_IWUSR));
+            if ((i32Fd >= 0L) && (ftruncate(i32Fd, (off_t)sizeof(Ipb_TShmRegion)) != 0))
+            {
+                i32Ret = -3L;
+                break;
+            }
+        }
+        else
+        {
+            i32Fd = shm_open(szName, (O_RDWR | O_CLOEXEC), 0);
+        }
+        if (i32Fd < 0L)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        if ((fstat(i32Fd, &tStat) != 0) || (tStat.st_size != (off_t)sizeof(Ipb_TShmRegion)))
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        pvMap = mmap(NULL, sizeof(Ipb_TShmRegion), (PROT_READ | PROT_WRITE), MAP_SHARED, i32Fd, 0);
+        if (pvMap == MAP_FAILED)
+        {
+            i32Ret = -4L;
+            break;
+        }
+        ptShm->ptRegion = (Ipb_TShmRegion*)pvMap;
+
+        break;
+    }
+
+    /** Mapping keeps the region alive */
+    if (i32Fd >= 0L)
+    {
+        (void)close(i32Fd);
+    }
+    if ((i32Ret != 0L) && (isOwner != false) && (i32Fd >= 0L))
+    {
+        (void)shm_unlink(szName);
+    }
+
+    return i32Ret;
+}
+
+static uint16_t Ipb_ShmPush(Ipb_TShm* ptShm, uint32_t* pu32Head, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TShmRing* ptRing = ptShm->ptTx;
+    uint32_t u32SzBy = (uint32_t)0UL;
+    uint32_t u32Pos;
+    uint16_t u16SzBy;
+    uint16_t u16Ret = 0U;
+    uint16_t u16Idx;
+
+    for (u16Idx = (uint16_t)0U; u16Idx < u16IovCnt; u16Idx++)
+    {
+        u32SzBy += ptIov[u16Idx].u16SzBy;
+    }
+    u16SzBy = (uint16_t)u32SzBy;
+
+    if ((u32SzBy == (uint32_t)0UL) || (u32SzBy > (uint32_t)UINT16_MAX))
+    {
+        u16Ret = (uint16_t)EMSGSIZE;
+    }
+    else if ((*pu32Head + IPB_SHM_RECORD_SZ_BY(u16SzBy)
+              - atomic_load_explicit(&ptRing->u32Tail, memory_order_acquire)) > (uint32_t)IPB_SHM_RING_SZ_BY)
+    {
+        u16Ret = (uint16_t)ENOBUFS;
+    }
+    else
+    {
+        Ipb_ShmCopyIn(ptRing, *pu32Head, (const uint8_t*)&u16SzBy, (uint32_t)sizeof(u16SzBy));
+        u32Pos = *pu32Head + (uint32_t)sizeof(u16SzBy);
+        for (u16Idx = (uint16_t)0U; u16Idx < u16IovCnt; u16Idx++)
+        {
+            Ipb_ShmCopyIn(ptRing, u32Pos, ptIov[u16Idx].pu8Buf, ptIov[u16Idx].u16SzBy);
+            u32Pos += ptIov[u16Idx].u16SzBy;
+        }
+        *pu32Head += IPB_SHM_RECORD_SZ_BY(u16SzBy);
+        ptShm->u32TxFrames++;
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_ShmPublish(Ipb_TShm* ptShm, uint32_t u32Head, uint32_t u32New)
+{
+    Ipb_TShmRing* ptRing = ptShm->ptTx;
+
+    atomic_store_explicit(&ptRing->u32Head, u32New, memory_order_seq_cst);
+
+    /** Consumers only sleep on empty rings */
+    if (atomic_load_explicit(&ptRing->u32Tail, memory_order_seq_cst) == u32Head)
+    {
+        atomic_fetch_add_explicit(&ptRing->u32Seq, 1UL, memory_order_seq_cst);
+        if (atomic_load_explicit(&ptRing->u32Sleepers, memory_order_seq_cst) != 0UL)
+        {
+            (void)syscall(SYS_futex, (uint32_t*)&ptRing->u32Seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+            ptShm->u32Wakes++;
+        }
+    }
+}
+
+static void Ipb_ShmCopyIn(Ipb_TShmRing* ptRing, uint32_t u32Pos, const uint8_t* pu8Src, uint32_t u32SzBy)
+{
+    uint32_t u32Off = u32Pos & IPB_SHM_MSK;
+    uint32_t u32First = (uint32_t)IPB_SHM_RING_SZ_BY - u32Off;
+
+    if (u32First > u32SzBy)
+    {
+        u32First = u32SzBy;
+    }
+    memcpy((void*)&ptRing->pu8Buf[u32Off], (const void*)pu8Src, u32First);
+    memcpy((void*)ptRing->pu8Buf, (const void*)&pu8Src[u32First], (u32SzBy - u32First));
+}
+
+static void Ipb_ShmCopyOut(const Ipb_TShmRing* ptRing, uint32_t u32Pos, uint8_t* pu8Dst, uint32_t u32SzBy)
+{
+    uint32_t u32Off = u32Pos & IPB_SHM_MSK;
+    uint32_t u32First = (uint32_t)IPB_SHM_RING_SZ_BY - u32Off;
+
+    if (u32First > u32SzBy)
+    {
+        u32First = u32SzBy;
+    }
+    memcpy((void*)pu8Dst, (const void*)&ptRing->pu8Buf[u32Off], u32First);
+    memcpy((void*)&pu8Dst[u32First], (const void*)ptRing->pu8Buf, (u32SzBy - u32First));
+}
+
+#endif /* __linux__ */
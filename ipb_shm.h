@@ -0,0 +1,175 @@
+/**
+ * @file ipb_shm.h
+ * @brief This file contains the shared memory port of the ingenia
+ *        protocol bus (IPB), linking processes of the same Linux host
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_SHM_H
+#define IPB_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/** Size of each ring in bytes, power of 2 */
+#ifndef IPB_SHM_RING_SZ_BY
+#define IPB_SHM_RING_SZ_BY      65536U
+#endif
+
+/** Cache line size, producer and consumer positions never share one */
+#define IPB_SHM_LINE_SZ_BY      64U
+
+/** Max length of a region name, terminator included */
+#define IPB_SHM_NAME_SZ         64U
+
+/** Single producer single consumer frame ring */
+typedef struct
+{
+    /** Bytes written by the producer, free running */
+    _Atomic uint32_t u32Head;
+    uint8_t pu8Pad0[IPB_SHM_LINE_SZ_BY - sizeof(uint32_t)];
+    /** Bytes read by the consumer, free running */
+    _Atomic uint32_t u32Tail;
+    uint8_t pu8Pad1[IPB_SHM_LINE_SZ_BY - sizeof(uint32_t)];
+    /** Bumped each time the ring gets data while empty, futex word */
+    _Atomic uint32_t u32Seq;
+    /** Set while the consumer sleeps on u32Seq */
+    _Atomic uint32_t u32Sleepers;
+    uint8_t pu8Pad2[IPB_SHM_LINE_SZ_BY - (2U * sizeof(uint32_t))];
+    /** Frames, each one preceded by its size in bytes */
+    uint8_t pu8Buf[IPB_SHM_RING_SZ_BY];
+} Ipb_TShmRing;
+
+/** Shared memory region linking two processes */
+typedef struct
+{
+    /** Tells the region is initialised and built with the same layout */
+    _Atomic uint32_t u32Magic;
+    /** Size of each ring in bytes */
+    uint32_t u32RingSzBy;
+    uint8_t pu8Pad[IPB_SHM_LINE_SZ_BY - (2U * sizeof(uint32_t))];
+    /** Requests, from the process opening the region to its creator */
+    Ipb_TShmRing tReq;
+    /** Replies, from the creator to the process opening the region */
+    Ipb_TShmRing tRep;
+} Ipb_TShmRegion;
+
+/** Shared memory port instance, one end of a region */
+typedef struct
+{
+    /** Mapped region, NULL if closed */
+    Ipb_TShmRegion* ptRegion;
+    /** Ring written by this end */
+    Ipb_TShmRing* ptTx;
+    /** Ring read by this end */
+    Ipb_TShmRing* ptRx;
+    /** Region name, removed when the creator closes it */
+    char szName[IPB_SHM_NAME_SZ];
+    /** This end created the region */
+    bool isOwner;
+    /** Port registered for an IPB instance */
+    bool isPort;
+    /** Identification of the IPB instance using the port */
+    uint16_t u16Id;
+    /** Bytes of the frame being read already read */
+    uint16_t u16RxOffBy;
+    /** Number of frames transmitted */
+    uint32_t u32TxFrames;
+    /** Number of wake ups of the other end */
+    uint32_t u32Wakes;
+    /** Number of sleeps waiting for frames */
+    uint32_t u32Sleeps;
+} Ipb_TShm;
+
+/**
+ * Creates a shared memory region, the gateway end serving requests
+ *
+ * @note Both ends poll their ring without system calls. A sleeping end
+ *  is only woken up when its ring gets data while empty. Regions are
+ *  linked by one process each end; serve many clients with a region
+ *  each.
+ *
+ * @param[out] ptShm
+ *  Port instance
+ * @param[in] szName
+ *  Region name, e.g. "/ipb-hmi"
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_ShmCreate(Ipb_TShm* ptShm, const char* szName);
+
+/**
+ * Opens a region created by the gateway and registers it for u16Id, so
+ * the ETHERNET_BASED instance initialised with the same identification
+ * sends its requests through it
+ *
+ * @param[out] ptShm
+ *  Port instance
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] szName
+ *  Region name given to Ipb_ShmCreate
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_ShmOpen(Ipb_TShm* ptShm, uint16_t u16Id, const char* szName);
+
+/**
+ * Unregisters and unmaps a region, the creator also removes its name
+ *
+ * @param[in] ptShm
+ *  Port instance
+ */
+void
+Ipb_ShmClose(Ipb_TShm* ptShm);
+
+/**
+ * Transmits a frame to the other end
+ *
+ * @param[in] ptShm
+ *  Port instance
+ * @param[in] pu8Buf
+ *  Encoded frame
+ * @param[in] u16SzBy
+ *  Size of the frame in bytes
+ *
+ * @retval 0 if success, errno otherwise
+ */
+uint16_t
+Ipb_ShmSend(Ipb_TShm* ptShm, const uint8_t* pu8Buf, uint16_t u16SzBy);
+
+/**
+ * Receives a frame from the other end
+ *
+ * @param[in] ptShm
+ *  Port instance
+ * @param[out] pu8Buf
+ *  Frame buffer
+ * @param[in] u16Size
+ *  Size of the buffer in bytes, the rest of a bigger frame is returned
+ *  by the next receptions
+ *
+ * @retval number of bytes received, 0 if none
+ */
+uint16_t
+Ipb_ShmRecv(Ipb_TShm* ptShm, uint8_t* pu8Buf, uint16_t u16Size);
+
+/**
+ * Waits for frames from the other end
+ *
+ * @param[in] ptShm
+ *  Port instance
+ * @param[in] u32TimeoutUs
+ *  Max time to wait in microseconds
+ *
+ * @retval true if there are frames to be received
+ */
+bool
+Ipb_ShmWait(Ipb_TShm* ptShm, uint32_t u32TimeoutUs);
+
+#endif /* IPB_SHM_H */
@@ -0,0 +1,563 @@
+/**
+ * @file ipb_sim.c
+ * @brief This file contains the in-memory loopback port of the ingenia
+ *        protocol bus (IPB), wired to a simulated drive answering from
+ *        its dictionaries
+ *
+ * @note Each direction of the link is modelled as a wire sending one
+ *  frame after the other at the configured bandwidth. Requests reach
+ *  the drive once transmitted, replies start after the drive latency.
+ *  Byte stream ports receive replies as their bytes arrive, datagram
+ *  ports once the whole frame has arrived.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_sim.h"
+#include "ipb_port.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+static uint16_t
+Ipb_SimReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size);
+
+static uint16_t
+Ipb_SimTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+static void
+Ipb_SimDiscardData(void* pvCtx);
+
+static bool
+Ipb_SimWait(void* pvCtx, uint32_t u32TimeoutUs);
+
+/**
+ * Serves a request received by the drive
+ *
+ * @param[in] pvCtx
+ *  Simulated drive instance
+ * @param[in] ptFrame
+ *  Request frame
+ */
+static void
+Ipb_SimServe(void* pvCtx, const Ipb_TFrame* ptFrame);
+
+/**
+ * Encodes a reply frame
+ *
+ * @param[in] ptMsg
+ *  Request being answered
+ * @param[in] u8Cmd
+ *  Reply command
+ * @param[in] pu16Data
+ *  Reply data, NULL if none
+ * @param[in] u16Sz
+ *  Size of reply data in words
+ * @param[out] pu16Dst
+ *  Reply frame buffer
+ * @param[in] u16DstSz
+ *  Size of the reply frame buffer in words
+ *
+ * @retval frame size in words if success, negative error code otherwise
+ */
+static int32_t
+Ipb_SimEncode(const Ipb_TMsg* ptMsg, uint8_t u8Cmd, const uint16_t* pu16Data, uint16_t u16Sz,
+              uint16_t* pu16Dst, uint16_t u16DstSz);
+
+/**
+ * Gets the number of bytes of a reply already arrived to the host
+ *
+ * @param[in] ptSim
+ *  Simulated drive instance
+ * @param[in] ptFrm
+ *  Reply frame
+ * @param[in] u32NowUs
+ *  Current time in microseconds
+ *
+ * @retval number of arrived bytes
+ */
+static uint16_t
+Ipb_SimArrived(const Ipb_TSim* ptSim, const Ipb_TSimFrame* ptFrm, uint32_t u32NowUs);
+
+/**
+ * Flips the bits hit by errors while crossing the link
+ *
+ * @param[in] ptSim
+ *  Simulated drive instance
+ * @param[in/out] pu8Buf
+ *  Bytes crossing the link
+ * @param[in] u16SzBy
+ *  Number of bytes
+ */
+static void
+Ipb_SimCorrupt(Ipb_TSim* ptSim, uint8_t* pu8Buf, uint16_t u16SzBy);
+
+/**
+ * Draws the number of bits until the next bit error
+ *
+ * @param[in] ptSim
+ *  Simulated drive instance
+ *
+ * @retval number of bits, 1 to twice the configured error rate
+ */
+static uint32_t
+Ipb_SimNextErr(Ipb_TSim* ptSim);
+
+/** Indicates if the link is timed, otherwise time is never read */
+static bool
+Ipb_SimIsTimed(const Ipb_TSim* ptSim);
+
+/** Gets the time in microseconds a number of bytes takes to cross the link */
+static uint32_t
+Ipb_SimDuration(const Ipb_TSim* ptSim, uint32_t u32SzBy);
+
+/** Indicates if time a is not earlier than time b, wrap around safe */
+static bool
+Ipb_SimIsAfter(uint32_t u32A, uint32_t u32B);
+
+static const Ipb_TPortOps tSimOps =
+{
+    &Ipb_SimReception,
+    &Ipb_SimTransmission,
+    NULL,
+    &Ipb_SimDiscardData,
+    &Ipb_SimWait
+};
+
+int32_t Ipb_SimOpen(Ipb_TSim* ptSim, uint16_t u16Id, bool isDgram, const Ipb_TSimCfg* ptCfg)
+{
+    int32_t i32Ret = 0L;
+
+    ptSim->u16Id = u16Id;
+    ptSim->isDgram = isDgram;
+    for (uint16_t u16Node = 0U; u16Node < IPB_SIM_NODE_NUM; ++u16Node)
+    {
+        ptSim->ptDict[u16Node] = NULL;
+    }
+    Ipb_ParserInit(&ptSim->tParser, &Ipb_SimServe, (void*)ptSim);
+    ptSim->u16RxHead = (uint16_t)0U;
+    ptSim->u16RxCnt = (uint16_t)0U;
+    ptSim->u32ReqUs = (uint32_t)0UL;
+    ptSim->u32Requests = (uint32_t)0UL;
+    ptSim->u32BitErrs = (uint32_t)0UL;
+    ptSim->u32Overflows = (uint32_t)0UL;
+    Ipb_SimSetCfg(ptSim, ptCfg);
+
+    if (Ipb_PortRegister(u16Id, &tSimOps, (void*)ptSim) == false)
+    {
+        i32Ret = -1L;
+    }
+
+    return i32Ret;
+}
+
+void Ipb_SimClose(Ipb_TSim* ptSim)
+{
+    Ipb_PortUnregister(ptSim->u16Id);
+    ptSim->u16RxCnt = (uint16_t)0U;
+}
+
+bool Ipb_SimSetDict(Ipb_TSim* ptSim, uint16_t u16SubNode, TIpbDictInst* ptDict)
+{
+    bool isSet = false;
+
+    if (u16SubNode < IPB_SIM_NODE_NUM)
+    {
+        ptSim->ptDict[u16SubNode] = ptDict;
+        isSet = true;
+    }
+
+    return isSet;
+}
+
+void Ipb_SimSetCfg(Ipb_TSim* ptSim, const Ipb_TSimCfg* ptCfg)
+{
+    if (ptCfg != NULL)
+    {
+        ptSim->tCfg = *ptCfg;
+    }
+    else
+    {
+        memset((void*)&ptSim->tCfg, 0, sizeof(ptSim->tCfg));
+    }
+
+    /** Zero seed would stall the generator */
+    ptSim->u32Rand = (ptSim->tCfg.u32Seed != (uint32_t)0UL) ? ptSim->tCfg.u32Seed : (uint32_t)0x2545F491UL;
+    ptSim->u32ErrLeft = Ipb_SimNextErr(ptSim);
+
+    if (Ipb_SimIsTimed(ptSim) != false)
+    {
+        ptSim->u32TxFreeUs = Ipb_GetMicros();
+        ptSim->u32RxFreeUs = ptSim->u32TxFreeUs;
+    }
+    else
+    {
+        ptSim->u32TxFreeUs = (uint32_t)0UL;
+        ptSim->u32RxFreeUs = (uint32_t)0UL;
+    }
+}
+
+static uint16_t Ipb_SimReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size)
+{
+    Ipb_TSim* ptSim = (Ipb_TSim*)pvCtx;
+    uint16_t u16RdBy = (uint16_t)0U;
+
+    if (ptSim->u16RxCnt > (uint16_t)0U)
+    {
+        Ipb_TSimFrame* ptFrm = &ptSim->ptRx[ptSim->u16RxHead];
+        uint32_t u32NowUs = (Ipb_SimIsTimed(ptSim) != false) ? Ipb_GetMicros() : (uint32_t)0UL;
+        uint16_t u16ArrivedBy = Ipb_SimArrived(ptSim, ptFrm, u32NowUs);
+
+        if (ptSim->isDgram != false)
+        {
+            /** Whole datagram or nothing, truncated if it does not fit */
+            if (u16ArrivedBy == ptFrm->u16SzBy)
+            {
+                u16RdBy = (ptFrm->u16SzBy > u16Size) ? u16Size : ptFrm->u16SzBy;
+                ptFrm->u16RdBy = ptFrm->u16SzBy;
+            }
+        }
+        else
+        {
+            u16RdBy = u16ArrivedBy - ptFrm->u16RdBy;
+            if (u16RdBy > u16Size)
+            {
+                u16RdBy = u16Size;
+            }
+        }
+
+        if (u16RdBy > (uint16_t)0U)
+        {
+            uint16_t u16Off = (ptSim->isDgram != false) ? (uint16_t)0U : ptFrm->u16RdBy;
+
+            memcpy((void*)pu8Buf, (const void*)((const uint8_t*)ptFrm->pu16Buf + u16Off), u16RdBy);
+            if (ptSim->isDgram == false)
+            {
+                ptFrm->u16RdBy += u16RdBy;
+            }
+        }
+
+        if (ptFrm->u16RdBy == ptFrm->u16SzBy)
+        {
+            ptSim->u16RxHead = (ptSim->u16RxHead + 1U) % IPB_SIM_QUEUE_SZ;
+            ptSim->u16RxCnt--;
+        }
+    }
+
+    return u16RdBy;
+}
+
+static uint16_t Ipb_SimTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TSim* ptSim = (Ipb_TSim*)pvCtx;
+    uint16_t u16Ret = 0U;
+    uint32_t u32SzBy = (uint32_t)0UL;
+
+    for (uint16_t u16Idx = 0U; u16Idx < u16IovCnt; ++u16Idx)
+    {
+        u32SzBy += ptIov[u16Idx].u16SzBy;
+    }
+
+    if (Ipb_SimIsTimed(ptSim) != false)
+    {
+        uint32_t u32NowUs = Ipb_GetMicros();
+
+        /** Frames queue up on the wire */
+        if (Ipb_SimIsAfter(u32NowUs, ptSim->u32TxFreeUs) != false)
+        {
+            ptSim->u32TxFreeUs = u32NowUs;
+        }
+        ptSim->u32TxFreeUs += Ipb_SimDuration(ptSim, u32SzBy);
+        ptSim->u32ReqUs = ptSim->u32TxFreeUs;
+    }
+
+    for (uint16_t u16Idx = 0U; u16Idx < u16IovCnt; ++u16Idx)
+    {
+        const uint8_t* pu8Buf = ptIov[u16Idx].pu8Buf;
+        uint16_t u16SzBy = ptIov[u16Idx].u16SzBy;
+
+        if (ptSim->tCfg.u32BitErrBits == (uint32_t)0UL)
+        {
+            /** Drive answers while the request is parsed */
+            Ipb_ParserFeed(&ptSim->tParser, pu8Buf, u16SzBy);
+        }
+        else
+        {
+            /** Corrupted through the copy buffer, batches may be larger */
+            while (u16SzBy > (uint16_t)0U)
+            {
+                uint16_t u16ChunkBy = (u16SzBy < (uint16_t)sizeof(ptSim->pu8Tx)) ?
+                                      u16SzBy : (uint16_t)sizeof(ptSim->pu8Tx);
+
+                memcpy((void*)ptSim->pu8Tx, (const void*)pu8Buf, u16ChunkBy);
+                Ipb_SimCorrupt(ptSim, ptSim->pu8Tx, u16ChunkBy);
+                Ipb_ParserFeed(&ptSim->tParser, ptSim->pu8Tx, u16ChunkBy);
+                pu8Buf += u16ChunkBy;
+                u16SzBy = (uint16_t)(u16SzBy - u16ChunkBy);
+            }
+        }
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_SimDiscardData(void* pvCtx)
+{
+    Ipb_TSim* ptSim = (Ipb_TSim*)pvCtx;
+    uint32_t u32NowUs = (Ipb_SimIsTimed(ptSim) != false) ? Ipb_GetMicros() : (uint32_t)0UL;
+
+    /** Replies still on their way are not received yet */
+    while ((ptSim->u16RxCnt > (uint16_t)0U)
+           && (Ipb_SimIsAfter(u32NowUs, ptSim->ptRx[ptSim->u16RxHead].u32StartUs) != false))
+    {
+        ptSim->u16RxHead = (ptSim->u16RxHead + 1U) % IPB_SIM_QUEUE_SZ;
+        ptSim->u16RxCnt--;
+    }
+}
+
+static bool Ipb_SimWait(void* pvCtx, uint32_t u32TimeoutUs)
+{
+    Ipb_TSim* ptSim = (Ipb_TSim*)pvCtx;
+    bool isReady = false;
+
+    if (ptSim->u16RxCnt > (uint16_t)0U)
+    {
+        const Ipb_TSimFrame* ptFrm = &ptSim->ptRx[ptSim->u16RxHead];
+        uint16_t u16NeedBy = (ptSim->isDgram != false) ? ptFrm->u16SzBy : (uint16_t)(ptFrm->u16RdBy + 1U);
+        uint32_t u32StartUs = (Ipb_SimIsTimed(ptSim) != false) ? Ipb_GetMicros() : (uint32_t)0UL;
+        uint32_t u32NowUs = u32StartUs;
+
+        /** Nothing to sleep on, the link is modelled by time */
+        while (1)
+        {
+            isReady = (Ipb_SimArrived(ptSim, ptFrm, u32NowUs) >= u16NeedBy);
+            if ((isReady != false) || ((u32NowUs - u32StartUs) >= u32TimeoutUs))
+            {
+                break;
+            }
+            u32NowUs = Ipb_GetMicros();
+        }
+    }
+
+    return isReady;
+}
+
+int32_t Ipb_SimAnswer(TIpbDictInst* const* pptDict, Ipb_TMsg* ptMsg, const Ipb_TFrame* ptFrame,
+                      uint16_t* pu16Dst, uint16_t u16DstSz)
+{
+    int32_t i32Ret = 0L;
+    TIpbDictInst* ptDict = pptDict[Ipb_FrameGetSubNode(ptFrame)];
+    uint8_t u8Cmd = Ipb_FrameGetCmd(ptFrame);
+    uint8_t u8Res;
+
+    ptMsg->u16SubNode = Ipb_FrameGetSubNode(ptFrame);
+    ptMsg->u16Addr = Ipb_FrameGetAddr(ptFrame);
+    ptMsg->u16Cmd = u8Cmd;
+    ptMsg->eStatus = IPB_SUCCESS;
+
+    while (1)
+    {
+        if ((u8Cmd != IPB_REQ_READ) && (u8Cmd != IPB_REQ_WRITE))
+        {
+            break;
+        }
+
+        if (ptDict == NULL)
+        {
+            ptMsg->pu16Data[0] = (uint16_t)NOT_SUPPORTED;
+            i32Ret = Ipb_SimEncode(ptMsg, IPB_REP_ERROR, ptMsg->pu16Data, (uint16_t)1U, pu16Dst, u16DstSz);
+            break;
+        }
+
+        if (u8Cmd == IPB_REQ_READ)
+        {
+            ptMsg->u16Size = (uint16_t)0U;
+            u8Res = Ipb_DictRead(ptDict, ptMsg);
+            if (u8Res == NO_ERROR)
+            {
+                i32Ret = Ipb_SimEncode(ptMsg, IPB_REP_ACK, ptMsg->pu16Data, ptMsg->u16Size, pu16Dst, u16DstSz);
+            }
+            else
+            {
+                ptMsg->pu16Data[0] = (uint16_t)u8Res;
+                i32Ret = Ipb_SimEncode(ptMsg, IPB_REP_READ_ERROR, ptMsg->pu16Data, (uint16_t)1U, pu16Dst,
+                                       u16DstSz);
+            }
+            break;
+        }
+
+        if (Ipb_FrameGetExtended(ptFrame) == false)
+        {
+            ptMsg->u16Size = Ipb_FrameGetConfigData(ptFrame, ptMsg->pu16Data);
+        }
+        else
+        {
+            ptMsg->u16Size = ptFrame->u16Sz - IPB_FRAME_TOTAL_CFG_SIZE;
+            memcpy((void*)ptMsg->pu16Data, (const void*)&ptFrame->pu16Buf[IPB_FRAME_TOTAL_CFG_SIZE],
+                   (ptMsg->u16Size * sizeof(uint16_t)));
+        }
+
+        u8Res = Ipb_DictWrite(ptDict, ptMsg);
+        if (u8Res == NO_ERROR)
+        {
+            i32Ret = Ipb_SimEncode(ptMsg, IPB_REP_ACK, NULL, (uint16_t)0U, pu16Dst, u16DstSz);
+        }
+        else
+        {
+            ptMsg->pu16Data[0] = (uint16_t)u8Res;
+            i32Ret = Ipb_SimEncode(ptMsg, IPB_REP_WRITE_ERROR, ptMsg->pu16Data, (uint16_t)1U, pu16Dst, u16DstSz);
+        }
+        break;
+    }
+
+    return i32Ret;
+}
+
+static void Ipb_SimServe(void* pvCtx, const Ipb_TFrame* ptFrame)
+{
+    Ipb_TSim* ptSim = (Ipb_TSim*)pvCtx;
+    Ipb_TSimFrame* ptFrm;
+    int32_t i32Sz;
+
+    while (1)
+    {
+        if (ptSim->u16RxCnt == IPB_SIM_QUEUE_SZ)
+        {
+            ptSim->u32Overflows++;
+            break;
+        }
+
+        ptFrm = &ptSim->ptRx[(ptSim->u16RxHead + ptSim->u16RxCnt) % IPB_SIM_QUEUE_SZ];
+        i32Sz = Ipb_SimAnswer(ptSim->ptDict, &ptSim->tMsg, ptFrame, ptFrm->pu16Buf, IPB_FRM_MAX_DATA_SZ);
+        if (i32Sz <= 0L)
+        {
+            break;
+        }
+
+        ptSim->u32Requests++;
+        ptFrm->u16SzBy = (uint16_t)((uint32_t)i32Sz * sizeof(uint16_t));
+        ptFrm->u16RdBy = (uint16_t)0U;
+        Ipb_SimCorrupt(ptSim, (uint8_t*)ptFrm->pu16Buf, ptFrm->u16SzBy);
+
+        if (Ipb_SimIsTimed(ptSim) != false)
+        {
+            uint32_t u32ReadyUs = ptSim->u32ReqUs + ptSim->tCfg.u32LatencyUs;
+
+            /** Replies queue up on the wire */
+            if (Ipb_SimIsAfter(u32ReadyUs, ptSim->u32RxFreeUs) != false)
+            {
+                ptSim->u32RxFreeUs = u32ReadyUs;
+            }
+            ptFrm->u32StartUs = ptSim->u32RxFreeUs;
+            ptSim->u32RxFreeUs += Ipb_SimDuration(ptSim, ptFrm->u16SzBy);
+            ptFrm->u32EndUs = ptSim->u32RxFreeUs;
+        }
+        else
+        {
+            ptFrm->u32StartUs = (uint32_t)0UL;
+            ptFrm->u32EndUs = (uint32_t)0UL;
+        }
+
+        ptSim->u16RxCnt++;
+        break;
+    }
+}
+
+static int32_t Ipb_SimEncode(const Ipb_TMsg* ptMsg, uint8_t u8Cmd, const uint16_t* pu16Data, uint16_t u16Sz,
+                             uint16_t* pu16Dst, uint16_t u16DstSz)
+{
+    static const uint16_t pu16None[IPB_FRM_CONFIG_SZ] = { 0U, 0U, 0U, 0U };
+
+    if (pu16Data == NULL)
+    {
+        pu16Data = pu16None;
+    }
+
+    return Ipb_FrameEncode(pu16Dst, u16DstSz, ptMsg->u16SubNode, ptMsg->u16Addr, u8Cmd, pu16Data, u16Sz);
+}
+
+static uint16_t Ipb_SimArrived(const Ipb_TSim* ptSim, const Ipb_TSimFrame* ptFrm, uint32_t u32NowUs)
+{
+    uint16_t u16ArrivedBy = ptFrm->u16SzBy;
+
+    if (Ipb_SimIsAfter(u32NowUs, ptFrm->u32EndUs) == false)
+    {
+        if (Ipb_SimIsAfter(u32NowUs, ptFrm->u32StartUs) == false)
+        {
+            u16ArrivedBy = (uint16_t)0U;
+        }
+        else
+        {
+            /** Only links with a bandwidth get here */
+            u16ArrivedBy = (uint16_t)(((uint64_t)(u32NowUs - ptFrm->u32StartUs) * ptSim->tCfg.u32BytesPerSec)
+                                      / 1000000ULL);
+            if (u16ArrivedBy > ptFrm->u16SzBy)
+            {
+                u16ArrivedBy = ptFrm->u16SzBy;
+            }
+        }
+    }
+
+    return u16ArrivedBy;
+}
+
+static void Ipb_SimCorrupt(Ipb_TSim* ptSim, uint8_t* pu8Buf, uint16_t u16SzBy)
+{
+    if (ptSim->tCfg.u32BitErrBits != (uint32_t)0UL)
+    {
+        uint32_t u32Bits = (uint32_t)u16SzBy * 8UL;
+        uint32_t u32Pos = (uint32_t)0UL;
+
+        while ((u32Bits - u32Pos) >= ptSim->u32ErrLeft)
+        {
+            u32Pos += ptSim->u32ErrLeft;
+            pu8Buf[(u32Pos - 1UL) / 8UL] ^= (uint8_t)(1U << ((u32Pos - 1UL) % 8UL));
+            ptSim->u32BitErrs++;
+            ptSim->u32ErrLeft = Ipb_SimNextErr(ptSim);
+        }
+        ptSim->u32ErrLeft -= (u32Bits - u32Pos);
+    }
+}
+
+static uint32_t Ipb_SimNextErr(Ipb_TSim* ptSim)
+{
+    uint32_t u32Bits = (uint32_t)0UL;
+
+    if (ptSim->tCfg.u32BitErrBits != (uint32_t)0UL)
+    {
+        /** Xorshift, errors are reproducible for a given seed */
+        ptSim->u32Rand ^= ptSim->u32Rand << 13U;
+        ptSim->u32Rand ^= ptSim->u32Rand >> 17U;
+        ptSim->u32Rand ^= ptSim->u32Rand << 5U;
+        u32Bits = (uint32_t)1UL + (uint32_t)((uint64_t)ptSim->u32Rand
+                                             % ((uint64_t)ptSim->tCfg.u32BitErrBits * 2ULL));
+    }
+
+    return u32Bits;
+}
+
+static bool Ipb_SimIsTimed(const Ipb_TSim* ptSim)
+{
+    return ((ptSim->tCfg.u32LatencyUs != (uint32_t)0UL) || (ptSim->tCfg.u32BytesPerSec != (uint32_t)0UL));
+}
+
+static uint32_t Ipb_SimDuration(const Ipb_TSim* ptSim, uint32_t u32SzBy)
+{
+    uint32_t u32Us = (uint32_t)0UL;
+
+    if (ptSim->tCfg.u32BytesPerSec != (uint32_t)0UL)
+    {
+        /** Rounded up, so a frame is never early */
+        u32Us = (uint32_t)((((uint64_t)u32SzBy * 1000000ULL) + ptSim->tCfg.u32BytesPerSec - 1ULL)
+                           / ptSim->tCfg.u32BytesPerSec);
+    }
+
+    return u32Us;
+}
+
+static bool Ipb_SimIsAfter(uint32_t u32A, uint32_t u32B)
+{
+    return ((int32_t)(u32A - u32B) >= 0L);
+}
@@ -0,0 +1,184 @@
+/**
+ * @file ipb_sim.h
+ * @brief This file contains the in-memory loopback port of the ingenia
+ *        protocol bus (IPB), wired to a simulated drive answering from
+ *        its dictionaries
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_SIM_H
+#define IPB_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb_frame.h"
+#include "ipb_parser.h"
+#include "ipb_dict.h"
+
+/** Number of replies the link holds before the host receives them */
+#ifndef IPB_SIM_QUEUE_SZ
+#define IPB_SIM_QUEUE_SZ        8U
+#endif
+
+/** Number of internal network nodes of the simulated drive */
+#define IPB_SIM_NODE_NUM        16U
+
+/** Link configuration */
+typedef struct
+{
+    /** Time in microseconds the drive takes to answer a request */
+    uint32_t u32LatencyUs;
+    /** Link bandwidth in bytes per second each way, 0 is unlimited */
+    uint32_t u32BytesPerSec;
+    /** One bit error every this number of bits on average, 0 is none */
+    uint32_t u32BitErrBits;
+    /** Seed of the bit error generator */
+    uint32_t u32Seed;
+} Ipb_TSimCfg;
+
+/** Reply on its way to the host */
+typedef struct
+{
+    /** Encoded frame */
+    uint16_t pu16Buf[IPB_FRM_MAX_DATA_SZ];
+    /** Size of the frame in bytes */
+    uint16_t u16SzBy;
+    /** Number of bytes already received by the host */
+    uint16_t u16RdBy;
+    /** Time in microseconds the first byte reaches the host */
+    uint32_t u32StartUs;
+    /** Time in microseconds the last byte reaches the host */
+    uint32_t u32EndUs;
+} Ipb_TSimFrame;
+
+/** Simulated drive instance */
+typedef struct
+{
+    /** Identification of the IPB instance using the port */
+    uint16_t u16Id;
+    /** Replies are received as whole datagrams, as ethernet does */
+    bool isDgram;
+    /** Link configuration */
+    Ipb_TSimCfg tCfg;
+    /** Dictionary of each internal network node, NULL if none */
+    TIpbDictInst* ptDict[IPB_SIM_NODE_NUM];
+    /** Request parser of the drive */
+    Ipb_TParser tParser;
+    /** Request being served */
+    Ipb_TMsg tMsg;
+    /** Transmitted bytes, copied when corrupted */
+    uint8_t pu8Tx[IPB_FRM_MAX_DATA_SZ * sizeof(uint16_t)];
+    /** Replies not yet received */
+    Ipb_TSimFrame ptRx[IPB_SIM_QUEUE_SZ];
+    /** Next reply to be received */
+    uint16_t u16RxHead;
+    /** Number of replies not yet received */
+    uint16_t u16RxCnt;
+    /** Time in microseconds the request being parsed reaches the drive */
+    uint32_t u32ReqUs;
+    /** Time in microseconds the host to drive link gets free */
+    uint32_t u32TxFreeUs;
+    /** Time in microseconds the drive to host link gets free */
+    uint32_t u32RxFreeUs;
+    /** Bit error generator state */
+    uint32_t u32Rand;
+    /** Number of bits until the next bit error */
+    uint32_t u32ErrLeft;
+    /** Number of requests served */
+    uint32_t u32Requests;
+    /** Number of bits flipped */
+    uint32_t u32BitErrs;
+    /** Number of replies lost because the link was full */
+    uint32_t u32Overflows;
+} Ipb_TSim;
+
+/**
+ * Opens a simulated drive and registers its port for u16Id, so the
+ * instance initialised with the same identification talks to it
+ *
+ * @note The drive answers within the transmission of each request and
+ *  the reply is received once the configured time has elapsed, based on
+ *  Ipb_GetMicros. With no latency and unlimited bandwidth replies are
+ *  received at once and time is never read.
+ *
+ * @param[out] ptSim
+ *  Simulated drive instance
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] isDgram
+ *  true for ETHERNET_BASED instances, false for byte stream ones
+ * @param[in] ptCfg
+ *  Link configuration, NULL for an ideal link
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_SimOpen(Ipb_TSim* ptSim, uint16_t u16Id, bool isDgram, const Ipb_TSimCfg* ptCfg);
+
+/**
+ * Unregisters the port of a simulated drive
+ *
+ * @param[in] ptSim
+ *  Simulated drive instance
+ */
+void
+Ipb_SimClose(Ipb_TSim* ptSim);
+
+/**
+ * Sets the dictionary answering the requests of an internal network node
+ *
+ * @note Read requests are served with Ipb_DictRead and write requests
+ *  with Ipb_DictWrite. Requests to nodes without dictionary get an
+ *  IPB_REP_ERROR reply.
+ *
+ * @param[in] ptSim
+ *  Simulated drive instance
+ * @param[in] u16SubNode
+ *  Internal network node
+ * @param[in] ptDict
+ *  Dictionary instance, NULL removes it
+ *
+ * @retval true if success, false if node is out of range
+ */
+bool
+Ipb_SimSetDict(Ipb_TSim* ptSim, uint16_t u16SubNode, TIpbDictInst* ptDict);
+
+/**
+ * Changes the link configuration, replies already on their way keep
+ * their timing
+ *
+ * @param[in] ptSim
+ *  Simulated drive instance
+ * @param[in] ptCfg
+ *  Link configuration, NULL for an ideal link
+ */
+void
+Ipb_SimSetCfg(Ipb_TSim* ptSim, const Ipb_TSimCfg* ptCfg);
+
+/**
+ * Answers a request frame the way the simulated drive does
+ *
+ * @note Drive simulators hosting their own links use it to serve
+ *  requests, see ipb_fleet.h
+ *
+ * @param[in] pptDict
+ *  Dictionary of each internal network node, IPB_SIM_NODE_NUM entries
+ * @param[out] ptMsg
+ *  Work message
+ * @param[in] ptFrame
+ *  Request frame
+ * @param[out] pu16Dst
+ *  Reply frame buffer
+ * @param[in] u16DstSz
+ *  Size of the reply frame buffer in words
+ *
+ * @retval reply frame size in words, 0 if frame is not a request,
+ *  negative error code otherwise
+ */
+int32_t
+Ipb_SimAnswer(TIpbDictInst* const* pptDict, Ipb_TMsg* ptMsg, const Ipb_TFrame* ptFrame,
+              uint16_t* pu16Dst, uint16_t u16DstSz);
+
+#endif /* IPB_SIM_H */
@@ -0,0 +1,289 @@
+/**
+ * @file ipb_udp.c
+ * @brief This file contains the UDP port of the
+ *        ingenia protocol bus (IPB) for Linux hosts
+ *
+ * @note Received datagrams are fetched in batches with recvmmsg and
+ *  multiple frames are transmitted with a single sendmmsg.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_udp.h"
+#include "ipb_port.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static uint16_t
+Ipb_UdpReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size);
+
+static uint16_t
+Ipb_UdpTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+static uint16_t
+Ipb_UdpTransmissionM(void* pvCtx, const Ipb_TFrameIov* ptFrm, uint16_t u16FrmCnt);
+
+static void
+Ipb_UdpDiscardData(void* pvCtx);
+
+static bool
+Ipb_UdpWait(void* pvCtx, uint32_t u32TimeoutUs);
+
+/**
+ * Fetches pending datagrams into the reception queue
+ *
+ * @param[in] ptUdp
+ *  Port instance
+ */
+static void
+Ipb_UdpFetch(Ipb_TUdp* ptUdp);
+
+static const Ipb_TPortOps tUdpOps =
+{
+    &Ipb_UdpReception,
+    &Ipb_UdpTransmission,
+    &Ipb_UdpTransmissionM,
+    &Ipb_UdpDiscardData,
+    &Ipb_UdpWait
+};
+
+int32_t Ipb_UdpOpen(Ipb_TUdp* ptUdp, uint16_t u16Id, const char* szAddr, uint16_t u16Port)
+{
+    int32_t i32Ret = 0L;
+    struct sockaddr_in tAddr;
+
+    ptUdp->i32Fd = -1L;
+    ptUdp->u16Id = u16Id;
+    ptUdp->u16RxHead = (uint16_t)0U;
+    ptUdp->u16RxCnt = (uint16_t)0U;
+    ptUdp->u32RxCalls = (uint32_t)0UL;
+    ptUdp->u32TxCalls = (uint32_t)0UL;
+
+    while (1)
+    {
+        memset((void*)&tAddr, 0, sizeof(tAddr));
+        tAddr.sin_family = AF_INET;
+        tAddr.sin_port = htons(u16Port);
+        if (inet_pton(AF_INET, szAddr, &tAddr.sin_addr) != 1)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        ptUdp->i32Fd = socket(AF_INET, (SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC), 0);
+        if (ptUdp->i32Fd < 0L)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        /** Connected socket only receives datagrams from the drive */
+        if (connect(ptUdp->i32Fd, (const struct sockaddr*)&tAddr, sizeof(tAddr)) != 0)
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        if (Ipb_PortRegister(u16Id, &tUdpOps, (void*)ptUdp) == false)
+        {
+            i32Ret = -4L;
+            break;
+        }
+
+        break;
+    }
+
+    if ((i32Ret != 0L) && (ptUdp->i32Fd >= 0L))
+    {
+        (void)close(ptUdp->i32Fd);
+        ptUdp->i32Fd = -1L;
+    }
+
+    return i32Ret;
+}
+
+void Ipb_UdpClose(Ipb_TUdp* ptUdp)
+{
+    if (ptUdp->i32Fd >= 0L)
+    {
+        Ipb_PortUnregister(ptUdp->u16Id);
+        (void)close(ptUdp->i32Fd);
+        ptUdp->i32Fd = -1L;
+    }
+}
+
+static uint16_t Ipb_UdpReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size)
+{
+    Ipb_TUdp* ptUdp = (Ipb_TUdp*)pvCtx;
+    uint16_t u16RdBy = (uint16_t)0U;
+
+    if (ptUdp->u16RxCnt == (uint16_t)0U)
+    {
+        Ipb_UdpFetch(ptUdp);
+    }
+
+    if (ptUdp->u16RxCnt > (uint16_t)0U)
+    {
+        u16RdBy = ptUdp->pu16RxSzBy[ptUdp->u16RxHead];
+        if (u16RdBy > u16Size)
+        {
+            u16RdBy = u16Size;
+        }
+        memcpy((void*)pu8Buf, (const void*)ptUdp->pu8RxDgram[ptUdp->u16RxHead], u16RdBy);
+
+        ptUdp->u16RxHead++;
+        ptUdp->u16RxCnt--;
+    }
+
+    return u16RdBy;
+}
+
+static uint16_t Ipb_UdpTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TUdp* ptUdp = (Ipb_TUdp*)pvCtx;
+    uint16_t u16Ret = 0U;
+    struct iovec ptVec[IPB_FRM_DESC_IOV_NUM];
+    struct msghdr tMsg;
+
+    if (u16IovCnt > IPB_FRM_DESC_IOV_NUM)
+    {
+        u16Ret = (uint16_t)EMSGSIZE;
+    }
+    else
+    {
+        /** Segments are gathered by the kernel into one datagram */
+        for (uint16_t u16Idx = 0U; u16Idx < u16IovCnt; ++u16Idx)
+        {
+            ptVec[u16Idx].iov_base = (void*)ptIov[u16Idx].pu8Buf;
+            ptVec[u16Idx].iov_len = ptIov[u16Idx].u16SzBy;
+        }
+
+        memset((void*)&tMsg, 0, sizeof(tMsg));
+        tMsg.msg_iov = ptVec;
+        tMsg.msg_iovlen = u16IovCnt;
+
+        ptUdp->u32TxCalls++;
+        if (sendmsg(ptUdp->i32Fd, &tMsg, MSG_NOSIGNAL) < 0)
+        {
+            u16Ret = (uint16_t)errno;
+        }
+    }
+
+    return u16Ret;
+}
+
+static uint16_t Ipb_UdpTransmissionM(void* pvCtx, const Ipb_TFrameIov* ptFrm, uint16_t u16FrmCnt)
+{
+    Ipb_TUdp* ptUdp = (Ipb_TUdp*)pvCtx;
+    uint16_t u16Ret = 0U;
+    struct iovec ptVec[IPB_UDP_TX_BATCH];
+    struct mmsghdr ptMsg[IPB_UDP_TX_BATCH];
+    uint16_t u16Sent = (uint16_t)0U;
+
+    while ((u16Sent < u16FrmCnt) && (u16Ret == 0U))
+    {
+        uint16_t u16Cnt = u16FrmCnt - u16Sent;
+        int iRet;
+
+        if (u16Cnt > IPB_UDP_TX_BATCH)
+        {
+            u16Cnt = IPB_UDP_TX_BATCH;
+        }
+
+        memset((void*)ptMsg, 0, (sizeof(ptMsg[0]) * u16Cnt));
+        for (uint16_t u16Idx = 0U; u16Idx < u16Cnt; ++u16Idx)
+        {
+            ptVec[u16Idx].iov_base = (void*)ptFrm[u16Sent + u16Idx].pu8Buf;
+            ptVec[u16Idx].iov_len = ptFrm[u16Sent + u16Idx].u16SzBy;
+            ptMsg[u16Idx].msg_hdr.msg_iov = &ptVec[u16Idx];
+            ptMsg[u16Idx].msg_hdr.msg_iovlen = 1U;
+        }
+
+        ptUdp->u32TxCalls++;
+        iRet = sendmmsg(ptUdp->i32Fd, ptMsg, u16Cnt, MSG_NOSIGNAL);
+        if (iRet <= 0)
+        {
+            u16Ret = (uint16_t)((iRet < 0) ? errno : EIO);
+        }
+        else
+        {
+            /** Kernel may stop early, the rest goes with the next call */
+            u16Sent += (uint16_t)iRet;
+        }
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_UdpDiscardData(void* pvCtx)
+{
+    Ipb_TUdp* ptUdp = (Ipb_TUdp*)pvCtx;
+
+    do
+    {
+        ptUdp->u16RxCnt = (uint16_t)0U;
+        Ipb_UdpFetch(ptUdp);
+    } while (ptUdp->u16RxCnt > (uint16_t)0U);
+}
+
+static bool Ipb_UdpWait(void* pvCtx, uint32_t u32TimeoutUs)
+{
+    Ipb_TUdp* ptUdp = (Ipb_TUdp*)pvCtx;
+    bool isReady = true;
+
+    if (ptUdp->u16RxCnt == (uint16_t)0U)
+    {
+        struct pollfd tPfd = { ptUdp->i32Fd, POLLIN, 0 };
+        struct timespec tTs;
+
+        tTs.tv_sec = (time_t)(u32TimeoutUs / 1000000UL);
+        tTs.tv_nsec = (long)(u32TimeoutUs % 1000000UL) * 1000L;
+        isReady = (ppoll(&tPfd, 1U, &tTs, NULL) > 0);
+    }
+
+    return isReady;
+}
+
+static void Ipb_UdpFetch(Ipb_TUdp* ptUdp)
+{
+    struct iovec ptVec[IPB_UDP_RX_BATCH];
+    struct mmsghdr ptMsg[IPB_UDP_RX_BATCH];
+    int iRet;
+
+    memset((void*)ptMsg, 0, sizeof(ptMsg));
+    for (uint16_t u16Idx = 0U; u16Idx < IPB_UDP_RX_BATCH; ++u16Idx)
+    {
+        ptVec[u16Idx].iov_base = (void*)ptUdp->pu8RxDgram[u16Idx];
+        ptVec[u16Idx].iov_len = IPB_UDP_DGRAM_SZ_BY;
+        ptMsg[u16Idx].msg_hdr.msg_iov = &ptVec[u16Idx];
+        ptMsg[u16Idx].msg_hdr.msg_iovlen = 1U;
+    }
+
+    ptUdp->u32RxCalls++;
+    iRet = recvmmsg(ptUdp->i32Fd, ptMsg, IPB_UDP_RX_BATCH, MSG_DONTWAIT, NULL);
+
+    ptUdp->u16RxHead = (uint16_t)0U;
+    ptUdp->u16RxCnt = (uint16_t)0U;
+    for (int iIdx = 0; iIdx < iRet; ++iIdx)
+    {
+        /** Truncated datagrams are kept, frame validation rejects them */
+        ptUdp->pu16RxSzBy[iIdx] = (uint16_t)ptMsg[iIdx].msg_len;
+        ptUdp->u16RxCnt++;
+    }
+}
+
+#endif /* __linux__ */
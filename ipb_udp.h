@@ -0,0 +1,79 @@
+/**
+ * @file ipb_udp.h
+ * @brief This file contains the UDP port of the
+ *        ingenia protocol bus (IPB) for Linux hosts
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_UDP_H
+#define IPB_UDP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb_frame.h"
+
+/** Max number of datagrams received with a single system call */
+#ifndef IPB_UDP_RX_BATCH
+#define IPB_UDP_RX_BATCH        16U
+#endif
+
+/** Max number of datagrams transmitted with a single system call */
+#ifndef IPB_UDP_TX_BATCH
+#define IPB_UDP_TX_BATCH        16U
+#endif
+
+/** Max size in bytes of a datagram, one frame */
+#define IPB_UDP_DGRAM_SZ_BY     (uint16_t)(IPB_FRM_MAX_DATA_SZ * sizeof(uint16_t))
+
+/** UDP port instance */
+typedef struct
+{
+    /** Connected socket, -1 if closed */
+    int32_t i32Fd;
+    /** Identification of the IPB instance using the port */
+    uint16_t u16Id;
+    /** Datagrams received and not yet read */
+    uint8_t pu8RxDgram[IPB_UDP_RX_BATCH][IPB_UDP_DGRAM_SZ_BY];
+    /** Size in bytes of each received datagram */
+    uint16_t pu16RxSzBy[IPB_UDP_RX_BATCH];
+    /** Next datagram to be read */
+    uint16_t u16RxHead;
+    /** Number of datagrams not yet read */
+    uint16_t u16RxCnt;
+    /** Number of reception system calls */
+    uint32_t u32RxCalls;
+    /** Number of transmission system calls */
+    uint32_t u32TxCalls;
+} Ipb_TUdp;
+
+/**
+ * Opens a UDP port connected to a drive and registers it for u16Id,
+ * so the ETHERNET_BASED instance initialised with the same
+ * identification uses it
+ *
+ * @param[out] ptUdp
+ *  Port instance
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] szAddr
+ *  IPv4 address of the drive, e.g. "192.168.2.22"
+ * @param[in] u16Port
+ *  UDP port of the drive
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_UdpOpen(Ipb_TUdp* ptUdp, uint16_t u16Id, const char* szAddr, uint16_t u16Port);
+
+/**
+ * Unregisters and closes a UDP port
+ *
+ * @param[in] ptUdp
+ *  Port instance
+ */
+void
+Ipb_UdpClose(Ipb_TUdp* ptUdp);
+
+#endif /* IPB_UDP_H */
@@ -0,0 +1,798 @@
+/**
+ * @file ipb_uring.c
+ * @brief This file contains an io_uring transport engine of the
+ *        ingenia protocol bus (IPB) for Linux hosts
+ *
+ * @note Receptions stay posted on every bus and completed data is
+ *  queued into a per bus ring, so reading an instance does not issue
+ *  system calls. Transmissions are buffered and submitted together
+ *  with the receptions of all buses on the next Ipb_UringPoll. Raw
+ *  system calls are used, no library is required.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_uring.h"
+#include "ipb_port.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/** Operation encoded into the user data of each entry */
+#define IPB_URING_OP_RX         (uint64_t)0x00ULL
+#define IPB_URING_OP_TX         (uint64_t)0x01ULL
+#define IPB_URING_OP_TIMEOUT    (uint64_t)0x02ULL
+#define IPB_URING_OP_CANCEL     (uint64_t)0x03ULL
+
+/** User data layout: bus index, operation and reception slot */
+#define IPB_URING_DATA(bus, op, slot) \
+    (((uint64_t)(bus) << 16) | ((uint64_t)(op) << 8) | (uint64_t)(slot))
+#define IPB_URING_DATA_BUS(data)    (uint16_t)((data) >> 16)
+#define IPB_URING_DATA_OP(data)     (uint64_t)(((data) >> 8) & 0xFFULL)
+#define IPB_URING_DATA_SLOT(data)   (uint16_t)((data) & 0xFFULL)
+
+/** Bus index of the engine entries */
+#define IPB_URING_BUS_NONE      (uint16_t)0xFFFFU
+
+/** Size in bytes of the datagram size prefix in the reception ring */
+#define IPB_URING_DGRAM_HDR_SZ_BY   (uint32_t)sizeof(uint16_t)
+
+static uint16_t
+Ipb_UringReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size);
+
+static uint16_t
+Ipb_UringTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+static uint16_t
+Ipb_UringTransmissionM(void* pvCtx, const Ipb_TFrameIov* ptFrm, uint16_t u16FrmCnt);
+
+static void
+Ipb_UringDiscardData(void* pvCtx);
+
+static bool
+Ipb_UringWait(void* pvCtx, uint32_t u32TimeoutUs);
+
+/**
+ * Runs one engine iteration, see Ipb_UringPoll
+ *
+ * @retval number of completions, negative error code otherwise
+ */
+static int32_t
+Ipb_UringPollUs(Ipb_TUring* ptUring, uint32_t u32TimeoutUs);
+
+/**
+ * Gets a free submission entry, submitting the queued ones if the
+ * ring is full
+ *
+ * @retval submission entry, NULL if ring is full
+ */
+static struct io_uring_sqe*
+Ipb_UringGetSqe(Ipb_TUring* ptUring);
+
+/**
+ * Submits queued entries and waits for completions, up to the timeout of
+ * the poll on kernels taking it in the call
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+static int32_t
+Ipb_UringEnter(Ipb_TUring* ptUring, uint32_t u32MinComplete);
+
+/**
+ * Queues the receptions and transmissions a bus needs
+ */
+static void
+Ipb_UringBusPrepare(Ipb_TUringBus* ptBus);
+
+/**
+ * Processes a completion of a bus
+ */
+static void
+Ipb_UringBusComplete(Ipb_TUringBus* ptBus, uint64_t u64Op, uint16_t u16Slot, int32_t i32Res);
+
+/**
+ * Appends received bytes to the reception ring of a bus
+ */
+static void
+Ipb_UringRxPush(Ipb_TUringBus* ptBus, const uint8_t* pu8Buf, uint32_t u32SzBy);
+
+/**
+ * Copies bytes out of the reception ring of a bus
+ */
+static void
+Ipb_UringRxPop(Ipb_TUringBus* ptBus, uint8_t* pu8Buf, uint32_t u32SzBy);
+
+/**
+ * Moves the held bytes of a stream reception into the reception ring,
+ * as many as fit
+ */
+static void
+Ipb_UringRxRefill(Ipb_TUringBus* ptBus);
+
+static const Ipb_TPortOps tUringOps =
+{
+    &Ipb_UringReception,
+    &Ipb_UringTransmission,
+    &Ipb_UringTransmissionM,
+    &Ipb_UringDiscardData,
+    &Ipb_UringWait
+};
+
+int32_t Ipb_UringInit(Ipb_TUring* ptUring)
+{
+    int32_t i32Ret = 0L;
+    struct io_uring_params tParams;
+
+    memset((void*)ptUring, 0, sizeof(*ptUring));
+    ptUring->pvSqMap = MAP_FAILED;
+    ptUring->pvCqMap = MAP_FAILED;
+    ptUring->pvSqes = MAP_FAILED;
+    ptUring->u16AutoWaitMs = (uint16_t)0U;
+    ptUring->isAutoPoll = true;
+    ptUring->u32AutoPollUs = IPB_URING_AUTO_POLL_US;
+
+    while (1)
+    {
+        memset((void*)&tParams, 0, sizeof(tParams));
+        ptUring->i32Fd = (int32_t)syscall(__NR_io_uring_setup, IPB_URING_ENTRIES, &tParams);
+        if (ptUring->i32Fd < 0L)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        ptUring->isExtArg = ((tParams.features & IORING_FEAT_EXT_ARG) != 0U);
+        ptUring->u32SqMapSz = tParams.sq_off.array + (tParams.sq_entries * sizeof(uint32_t));
+        ptUring->u32CqMapSz = tParams.cq_off.cqes + (tParams.cq_entries * sizeof(struct io_uring_cqe));
+        if ((tParams.features & IORING_FEAT_SINGLE_MMAP) != 0U)
+        {
+            if (ptUring->u32CqMapSz > ptUring->u32SqMapSz)
+            {
+                ptUring->u32SqMapSz = ptUring->u32CqMapSz;
+            }
+            ptUring->u32CqMapSz = ptUring->u32SqMapSz;
+        }
+
+        ptUring->pvSqMap = mmap(NULL, ptUring->u32SqMapSz, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE),
+                                ptUring->i32Fd, IORING_OFF_SQ_RING);
+        if (ptUring->pvSqMap == MAP_FAILED)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        if ((tParams.features & IORING_FEAT_SINGLE_MMAP) != 0U)
+        {
+            ptUring->pvCqMap = ptUring->pvSqMap;
+        }
+        else
+        {
+            ptUring->pvCqMap = mmap(NULL, ptUring->u32CqMapSz, (PROT_READ | PROT_WRITE),
+                                    (MAP_SHARED | MAP_POPULATE), ptUring->i32Fd, IORING_OFF_CQ_RING);
+            if (ptUring->pvCqMap == MAP_FAILED)
+            {
+                i32Ret = -2L;
+                break;
+            }
+        }
+
+        ptUring->u32SqesSz = tParams.sq_entries * sizeof(struct io_uring_sqe);
+        ptUring->pvSqes = mmap(NULL, ptUring->u32SqesSz, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE),
+                               ptUring->i32Fd, IORING_OFF_SQES);
+        if (ptUring->pvSqes == MAP_FAILED)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        ptUring->pu32SqHead = (uint32_t*)((uint8_t*)ptUring->pvSqMap + tParams.sq_off.head);
+        ptUring->pu32SqTail = (uint32_t*)((uint8_t*)ptUring->pvSqMap + tParams.sq_off.tail);
+        ptUring->pu32SqArray = (uint32_t*)((uint8_t*)ptUring->pvSqMap + tParams.sq_off.array);
+        ptUring->u32SqMask = *(uint32_t*)((uint8_t*)ptUring->pvSqMap + tParams.sq_off.ring_mask);
+        ptUring->pu32CqHead = (uint32_t*)((uint8_t*)ptUring->pvCqMap + tParams.cq_off.head);
+        ptUring->pu32CqTail = (uint32_t*)((uint8_t*)ptUring->pvCqMap + tParams.cq_off.tail);
+        ptUring->pvCqes = (void*)((uint8_t*)ptUring->pvCqMap + tParams.cq_off.cqes);
+        ptUring->u32CqMask = *(uint32_t*)((uint8_t*)ptUring->pvCqMap + tParams.cq_off.ring_mask);
+
+        /** Submission array is an identity map of the entries */
+        for (uint32_t u32Idx = 0U; u32Idx <= ptUring->u32SqMask; ++u32Idx)
+        {
+            ptUring->pu32SqArray[u32Idx] = u32Idx;
+        }
+
+        break;
+    }
+
+    if (i32Ret != 0L)
+    {
+        Ipb_UringDeinit(ptUring);
+    }
+
+    return i32Ret;
+}
+
+void Ipb_UringDeinit(Ipb_TUring* ptUring)
+{
+    if (ptUring->pvSqes != MAP_FAILED)
+    {
+        (void)munmap(ptUring->pvSqes, ptUring->u32SqesSz);
+        ptUring->pvSqes = MAP_FAILED;
+    }
+    if ((ptUring->pvCqMap != MAP_FAILED) && (ptUring->pvCqMap != ptUring->pvSqMap))
+    {
+        (void)munmap(ptUring->pvCqMap, ptUring->u32CqMapSz);
+    }
+    ptUring->pvCqMap = MAP_FAILED;
+    if (ptUring->pvSqMap != MAP_FAILED)
+    {
+        (void)munmap(ptUring->pvSqMap, ptUring->u32SqMapSz);
+        ptUring->pvSqMap = MAP_FAILED;
+    }
+    if (ptUring->i32Fd >= 0L)
+    {
+        (void)close(ptUring->i32Fd);
+        ptUring->i32Fd = -1L;
+    }
+}
+
+int32_t Ipb_UringAdd(Ipb_TUring* ptUring, Ipb_TUringBus* ptBus, uint16_t u16Id, int32_t i32Fd, bool isDgram)
+{
+    int32_t i32Ret = -1L;
+
+    for (uint16_t u16Idx = 0U; u16Idx < IPB_URING_BUS_NUM; ++u16Idx)
+    {
+        if (ptUring->ptBus[u16Idx] == NULL)
+        {
+            memset((void*)ptBus, 0, sizeof(*ptBus));
+            ptBus->ptUring = ptUring;
+            ptBus->i32Fd = i32Fd;
+            ptBus->u16Id = u16Id;
+            ptBus->isDgram = isDgram;
+            ptBus->u16Idx = u16Idx;
+
+            /** Posted operations must wait for data, not fail with EAGAIN */
+            ptBus->i32FdFlags = fcntl(i32Fd, F_GETFL);
+            if ((ptBus->i32FdFlags < 0L)
+                || (fcntl(i32Fd, F_SETFL, (ptBus->i32FdFlags & ~O_NONBLOCK)) != 0))
+            {
+                i32Ret = -2L;
+                break;
+            }
+
+            if (Ipb_PortRegister(u16Id, &tUringOps, (void*)ptBus) == false)
+            {
+                (void)fcntl(i32Fd, F_SETFL, ptBus->i32FdFlags);
+                i32Ret = -3L;
+                break;
+            }
+
+            ptBus->isOpen = true;
+            ptUring->ptBus[u16Idx] = ptBus;
+            if (u16Idx >= ptUring->u16BusCnt)
+            {
+                ptUring->u16BusCnt = u16Idx + 1U;
+            }
+            i32Ret = 0L;
+            break;
+        }
+    }
+
+    return i32Ret;
+}
+
+void Ipb_UringRemove(Ipb_TUringBus* ptBus)
+{
+    Ipb_TUring* ptUring = ptBus->ptUring;
+    bool isPending;
+
+    if (ptBus->isOpen != false)
+    {
+        Ipb_PortUnregister(ptBus->u16Id);
+        ptBus->isOpen = false;
+
+        for (uint16_t u16Slot = 0U; u16Slot < IPB_URING_RX_DEPTH; ++u16Slot)
+        {
+            struct io_uring_sqe* ptSqe;
+
+            if (ptBus->pisRxPosted[u16Slot] == false)
+            {
+                continue;
+            }
+
+            ptSqe = Ipb_UringGetSqe(ptUring);
+            if (ptSqe != NULL)
+            {
+                ptSqe->opcode = IORING_OP_ASYNC_CANCEL;
+                ptSqe->fd = -1;
+                ptSqe->addr = IPB_URING_DATA(ptBus->u16Idx, IPB_URING_OP_RX, u16Slot);
+                ptSqe->user_data = IPB_URING_DATA(IPB_URING_BUS_NONE, IPB_URING_OP_CANCEL, 0U);
+            }
+        }
+
+        /** Buffers of the bus are in use until all its operations complete */
+        do
+        {
+            isPending = (ptBus->u16TxPend > (uint16_t)0U);
+            for (uint16_t u16Slot = 0U; u16Slot < IPB_URING_RX_DEPTH; ++u16Slot)
+            {
+                isPending = isPending || ptBus->pisRxPosted[u16Slot];
+            }
+        } while ((isPending != false) && (Ipb_UringPoll(ptUring, 10UL) >= 0L));
+
+        ptUring->ptBus[ptBus->u16Idx] = NULL;
+        (void)fcntl(ptBus->i32Fd, F_SETFL, ptBus->i32FdFlags);
+    }
+}
+
+int32_t Ipb_UringPoll(Ipb_TUring* ptUring, uint32_t u32TimeoutMs)
+{
+    return Ipb_UringPollUs(ptUring, (u32TimeoutMs * 1000UL));
+}
+
+static int32_t Ipb_UringPollUs(Ipb_TUring* ptUring, uint32_t u32TimeoutUs)
+{
+    int32_t i32Ret = 0L;
+    uint32_t u32MinComplete = 0UL;
+    uint32_t u32Head;
+    uint32_t u32Tail;
+
+    for (uint16_t u16Idx = 0U; u16Idx < ptUring->u16BusCnt; ++u16Idx)
+    {
+        if ((ptUring->ptBus[u16Idx] != NULL) && (ptUring->ptBus[u16Idx]->isOpen != false))
+        {
+            Ipb_UringBusPrepare(ptUring->ptBus[u16Idx]);
+        }
+    }
+
+    if (u32TimeoutUs > 0UL)
+    {
+        /** Same layout as struct __kernel_timespec */
+        ptUring->pi64Timeout[0] = (int64_t)(u32TimeoutUs / 1000000UL);
+        ptUring->pi64Timeout[1] = (int64_t)(u32TimeoutUs % 1000000UL) * 1000LL;
+        u32MinComplete = 1UL;
+
+        /**
+         * Older kernels wait on a timeout entry completing on the first other
+         * completion, one left by the last wait completes with the next one
+         */
+        if ((ptUring->isExtArg == false) && (ptUring->isTimeoutArmed == false))
+        {
+            struct io_uring_sqe* ptSqe = Ipb_UringGetSqe(ptUring);
+
+            if (ptSqe != NULL)
+            {
+                ptSqe->opcode = IORING_OP_TIMEOUT;
+                ptSqe->fd = -1;
+                ptSqe->addr = (uint64_t)(uintptr_t)ptUring->pi64Timeout;
+                ptSqe->len = 1U;
+                ptSqe->off = 1ULL;
+                ptUring->u8TimeoutSeq++;
+                ptSqe->user_data = IPB_URING_DATA(IPB_URING_BUS_NONE, IPB_URING_OP_TIMEOUT, ptUring->u8TimeoutSeq);
+                ptUring->isTimeoutArmed = true;
+            }
+            else
+            {
+                u32MinComplete = 0UL;
+            }
+        }
+    }
+
+    i32Ret = Ipb_UringEnter(ptUring, u32MinComplete);
+    ptUring->u32PollUs = Ipb_GetMicros();
+
+    u32Head = *ptUring->pu32CqHead;
+    u32Tail = __atomic_load_n(ptUring->pu32CqTail, __ATOMIC_ACQUIRE);
+    while ((i32Ret >= 0L) && (u32Head != u32Tail))
+    {
+        const struct io_uring_cqe* ptCqe = &((const struct io_uring_cqe*)ptUring->pvCqes)[u32Head & ptUring->u32CqMask];
+        uint16_t u16Bus = IPB_URING_DATA_BUS(ptCqe->user_data);
+
+        if ((u16Bus < ptUring->u16BusCnt) && (ptUring->ptBus[u16Bus] != NULL))
+        {
+            Ipb_UringBusComplete(ptUring->ptBus[u16Bus], IPB_URING_DATA_OP(ptCqe->user_data),
+                                 IPB_URING_DATA_SLOT(ptCqe->user_data), ptCqe->res);
+            i32Ret++;
+        }
+        else if ((IPB_URING_DATA_OP(ptCqe->user_data) == IPB_URING_OP_TIMEOUT)
+                 && (IPB_URING_DATA_SLOT(ptCqe->user_data) == (uint16_t)ptUring->u8TimeoutSeq))
+        {
+            ptUring->isTimeoutArmed = false;
+        }
+
+        u32Head++;
+        if (u32Head == u32Tail)
+        {
+            __atomic_store_n(ptUring->pu32CqHead, u32Head, __ATOMIC_RELEASE);
+            u32Tail = __atomic_load_n(ptUring->pu32CqTail, __ATOMIC_ACQUIRE);
+        }
+    }
+    __atomic_store_n(ptUring->pu32CqHead, u32Head, __ATOMIC_RELEASE);
+
+    return i32Ret;
+}
+
+static uint16_t Ipb_UringReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size)
+{
+    Ipb_TUringBus* ptBus = (Ipb_TUringBus*)pvCtx;
+    Ipb_TUring* ptUring = ptBus->ptUring;
+    uint32_t u32RdBy = ptBus->u32RxTail - ptBus->u32RxHead;
+
+    /** Empty polls are rate limited, waits poll the engine anyway */
+    if ((u32RdBy == 0UL) && (ptUring->isAutoPoll != false)
+        && ((ptBus->pu16TxSzBy[ptBus->u16TxFill] > (uint16_t)0U)
+            || ((Ipb_GetMicros() - ptUring->u32PollUs) >= ptUring->u32AutoPollUs)))
+    {
+        (void)Ipb_UringPoll(ptUring, ptUring->u16AutoWaitMs);
+        u32RdBy = ptBus->u32RxTail - ptBus->u32RxHead;
+    }
+
+    if (u32RdBy > 0UL)
+    {
+        if (ptBus->isDgram != false)
+        {
+            uint16_t u16DgramBy;
+
+            Ipb_UringRxPop(ptBus, (uint8_t*)&u16DgramBy, IPB_URING_DGRAM_HDR_SZ_BY);
+            u32RdBy = (u16DgramBy < u16Size) ? u16DgramBy : u16Size;
+            Ipb_UringRxPop(ptBus, pu8Buf, u32RdBy);
+
+            /** Rest of a truncated datagram is dropped */
+            ptBus->u32RxHead += (uint32_t)u16DgramBy - u32RdBy;
+            ptBus->u32RxDropBy += (uint32_t)u16DgramBy - u32RdBy;
+        }
+        else
+        {
+            if (u32RdBy > u16Size)
+            {
+                u32RdBy = u16Size;
+            }
+            Ipb_UringRxPop(ptBus, pu8Buf, u32RdBy);
+            Ipb_UringRxRefill(ptBus);
+        }
+    }
+
+    return (uint16_t)u32RdBy;
+}
+
+static uint16_t Ipb_UringTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TUringBus* ptBus = (Ipb_TUringBus*)pvCtx;
+    uint16_t u16Ret = 0U;
+    uint16_t u16Fill = ptBus->u16TxFill;
+    uint32_t u32SzBy = 0UL;
+
+    for (uint16_t u16Idx = 0U; u16Idx < u16IovCnt; ++u16Idx)
+    {
+        u32SzBy += ptIov[u16Idx].u16SzBy;
+    }
+
+    if (ptBus->i32TxErr != 0L)
+    {
+        /** Reports the failure of a previous transmission once */
+        u16Ret = (uint16_t)(-ptBus->i32TxErr);
+        ptBus->i32TxErr = 0L;
+    }
+    else if (((ptBus->pu16TxSzBy[u16Fill] + u32SzBy) > IPB_URING_TX_SZ_BY)
+             || ((ptBus->isDgram != false) && (ptBus->pu16TxDgramCnt[u16Fill] >= IPB_URING_TX_DGRAM_NUM)))
+    {
+        u16Ret = (uint16_t)ENOBUFS;
+    }
+    else
+    {
+        for (uint16_t u16Idx = 0U; u16Idx < u16IovCnt; ++u16Idx)
+        {
+            memcpy((void*)&ptBus->pu8Tx[u16Fill][ptBus->pu16TxSzBy[u16Fill]], (const void*)ptIov[u16Idx].pu8Buf,
+                   ptIov[u16Idx].u16SzBy);
+            ptBus->pu16TxSzBy[u16Fill] += ptIov[u16Idx].u16SzBy;
+        }
+
+        if (ptBus->isDgram != false)
+        {
+            ptBus->pu16TxDgram[u16Fill][ptBus->pu16TxDgramCnt[u16Fill]] = (uint16_t)u32SzBy;
+            ptBus->pu16TxDgramCnt[u16Fill]++;
+        }
+    }
+
+    return u16Ret;
+}
+
+static uint16_t Ipb_UringTransmissionM(void* pvCtx, const Ipb_TFrameIov* ptFrm, uint16_t u16FrmCnt)
+{
+    uint16_t u16Ret = 0U;
+
+    /** Frames are only buffered, all of them go with the next poll */
+    for (uint16_t u16Idx = 0U; (u16Idx < u16FrmCnt) && (u16Ret == 0U); ++u16Idx)
+    {
+        u16Ret = Ipb_UringTransmission(pvCtx, &ptFrm[u16Idx], (uint16_t)1U);
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_UringDiscardData(void* pvCtx)
+{
+    Ipb_TUringBus* ptBus = (Ipb_TUringBus*)pvCtx;
+
+    ptBus->u32RxHead = ptBus->u32RxTail;
+    ptBus->u16RxHeldBy = (uint16_t)0U;
+}
+
+static bool Ipb_UringWait(void* pvCtx, uint32_t u32TimeoutUs)
+{
+    Ipb_TUringBus* ptBus = (Ipb_TUringBus*)pvCtx;
+
+    /** Without auto poll the engine is driven by a loop, nothing to wait on */
+    if ((ptBus->u32RxTail == ptBus->u32RxHead) && (ptBus->ptUring->isAutoPoll != false))
+    {
+        (void)Ipb_UringPollUs(ptBus->ptUring, u32TimeoutUs);
+    }
+
+    return (ptBus->u32RxTail != ptBus->u32RxHead);
+}
+
+static struct io_uring_sqe* Ipb_UringGetSqe(Ipb_TUring* ptUring)
+{
+    struct io_uring_sqe* ptSqe = NULL;
+    uint32_t u32Tail = *ptUring->pu32SqTail;
+
+    if (((u32Tail - __atomic_load_n(ptUring->pu32SqHead, __ATOMIC_ACQUIRE)) > ptUring->u32SqMask)
+        && (Ipb_UringEnter(ptUring, 0UL) == 0L))
+    {
+        u32Tail = *ptUring->pu32SqTail;
+    }
+
+    if ((u32Tail - __atomic_load_n(ptUring->pu32SqHead, __ATOMIC_ACQUIRE)) <= ptUring->u32SqMask)
+    {
+        ptSqe = &((struct io_uring_sqe*)ptUring->pvSqes)[u32Tail & ptUring->u32SqMask];
+        memset((void*)ptSqe, 0, sizeof(*ptSqe));
+        __atomic_store_n(ptUring->pu32SqTail, (u32Tail + 1U), __ATOMIC_RELEASE);
+        ptUring->u32ToSubmit++;
+    }
+
+    return ptSqe;
+}
+
+static int32_t Ipb_UringEnter(Ipb_TUring* ptUring, uint32_t u32MinComplete)
+{
+    int32_t i32Ret = 0L;
+    uint32_t u32Flags = 0UL;
+    struct io_uring_getevents_arg tArg;
+    long lRet;
+
+    memset((void*)&tArg, 0, sizeof(tArg));
+    if (u32MinComplete > 0UL)
+    {
+        u32Flags = IORING_ENTER_GETEVENTS;
+        if (ptUring->isExtArg != false)
+        {
+            u32Flags |= IORING_ENTER_EXT_ARG;
+            tArg.ts = (uint64_t)(uintptr_t)ptUring->pi64Timeout;
+        }
+    }
+
+    do
+    {
+        ptUring->u32Enters++;
+        lRet = syscall(__NR_io_uring_enter, ptUring->i32Fd, ptUring->u32ToSubmit, u32MinComplete, u32Flags,
+                       ((ptUring->isExtArg != false) ? (void*)&tArg : NULL),
+                       ((ptUring->isExtArg != false) ? sizeof(tArg) : 0U));
+    } while ((lRet < 0L) && (errno == EINTR));
+
+    /** Timed out waits submitted nothing */
+    if ((lRet < 0L) && (errno != ETIME))
+    {
+        i32Ret = -(int32_t)errno;
+    }
+    else if (lRet > 0L)
+    {
+        ptUring->u32ToSubmit -= (uint32_t)lRet;
+    }
+
+    return i32Ret;
+}
+
+static void Ipb_UringBusPrepare(Ipb_TUringBus* ptBus)
+{
+    Ipb_TUring* ptUring = ptBus->ptUring;
+    uint16_t u16RxDepth = (ptBus->isDgram != false) ? (uint16_t)IPB_URING_RX_DEPTH : (uint16_t)1U;
+    uint16_t u16Fly = (uint16_t)1U - ptBus->u16TxFill;
+    struct io_uring_sqe* ptSqe;
+
+    /** Keep receptions posted, streams use one to keep bytes in order */
+    for (uint16_t u16Slot = 0U; u16Slot < u16RxDepth; ++u16Slot)
+    {
+        /** Held stream bytes keep the kernel buffering the next ones */
+        if ((ptBus->pisRxPosted[u16Slot] != false) || (ptBus->u16RxHeldBy > (uint16_t)0U))
+        {
+            continue;
+        }
+
+        ptSqe = Ipb_UringGetSqe(ptUring);
+        if (ptSqe == NULL)
+        {
+            break;
+        }
+        ptSqe->opcode = (ptBus->isDgram != false) ? IORING_OP_RECV : IORING_OP_READ;
+        ptSqe->fd = ptBus->i32Fd;
+        ptSqe->addr = (uint64_t)(uintptr_t)ptBus->pu8RxPost[u16Slot];
+        ptSqe->len = IPB_URING_RX_SZ_BY;
+        /** Current file position for reads, must be 0 for receives */
+        ptSqe->off = (ptBus->isDgram != false) ? 0ULL : (uint64_t)-1LL;
+        ptSqe->user_data = IPB_URING_DATA(ptBus->u16Idx, IPB_URING_OP_RX, u16Slot);
+        ptBus->pisRxPosted[u16Slot] = true;
+    }
+
+    /** Filled buffer goes in flight once the previous one completes */
+    if ((ptBus->u16TxPend == (uint16_t)0U) && (ptBus->pu16TxSzBy[u16Fly] == (uint16_t)0U)
+        && (ptBus->pu16TxSzBy[ptBus->u16TxFill] > (uint16_t)0U))
+    {
+        u16Fly = ptBus->u16TxFill;
+        ptBus->u16TxFill = (uint16_t)1U - u16Fly;
+        ptBus->u16TxDoneBy = (uint16_t)0U;
+    }
+
+    if ((ptBus->u16TxPend == (uint16_t)0U) && (ptBus->pu16TxSzBy[u16Fly] > (uint16_t)0U))
+    {
+        if (ptBus->isDgram == false)
+        {
+            ptSqe = Ipb_UringGetSqe(ptUring);
+            if (ptSqe != NULL)
+            {
+                ptSqe->opcode = IORING_OP_WRITE;
+                ptSqe->fd = ptBus->i32Fd;
+                ptSqe->addr = (uint64_t)(uintptr_t)&ptBus->pu8Tx[u16Fly][ptBus->u16TxDoneBy];
+                ptSqe->len = (uint32_t)(ptBus->pu16TxSzBy[u16Fly] - ptBus->u16TxDoneBy);
+                ptSqe->off = (uint64_t)-1LL;
+                ptSqe->user_data = IPB_URING_DATA(ptBus->u16Idx, IPB_URING_OP_TX, 0U);
+                ptBus->u16TxPend++;
+            }
+        }
+        else
+        {
+            uint16_t u16OffBy = (uint16_t)0U;
+
+            /** One send per datagram, all submitted with the same call */
+            for (uint16_t u16Dgram = 0U; u16Dgram < ptBus->pu16TxDgramCnt[u16Fly]; ++u16Dgram)
+            {
+                ptSqe = Ipb_UringGetSqe(ptUring);
+                if (ptSqe == NULL)
+                {
+                    break;
+                }
+                ptSqe->opcode = IORING_OP_SEND;
+                ptSqe->fd = ptBus->i32Fd;
+                ptSqe->addr = (uint64_t)(uintptr_t)&ptBus->pu8Tx[u16Fly][u16OffBy];
+                ptSqe->len = ptBus->pu16TxDgram[u16Fly][u16Dgram];
+                ptSqe->msg_flags = MSG_NOSIGNAL;
+                ptSqe->user_data = IPB_URING_DATA(ptBus->u16Idx, IPB_URING_OP_TX, 0U);
+                u16OffBy += ptBus->pu16TxDgram[u16Fly][u16Dgram];
+                ptBus->u16TxPend++;
+            }
+        }
+    }
+}
+
+static void Ipb_UringBusComplete(Ipb_TUringBus* ptBus, uint64_t u64Op, uint16_t u16Slot, int32_t i32Res)
+{
+    uint16_t u16Fly = (uint16_t)1U - ptBus->u16TxFill;
+
+    switch (u64Op)
+    {
+        case IPB_URING_OP_RX:
+            ptBus->pisRxPosted[u16Slot] = false;
+            if (i32Res > 0L)
+            {
+                if (ptBus->isDgram != false)
+                {
+                    uint16_t u16DgramBy = (uint16_t)i32Res;
+
+                    if ((IPB_URING_RX_RING_SZ_BY - (ptBus->u32RxTail - ptBus->u32RxHead))
+                        < (IPB_URING_DGRAM_HDR_SZ_BY + (uint32_t)i32Res))
+                    {
+                        ptBus->u32RxDropBy += (uint32_t)i32Res;
+                        break;
+                    }
+                    Ipb_UringRxPush(ptBus, (const uint8_t*)&u16DgramBy, IPB_URING_DGRAM_HDR_SZ_BY);
+                    Ipb_UringRxPush(ptBus, ptBus->pu8RxPost[u16Slot], (uint32_t)i32Res);
+                }
+                else
+                {
+                    /** Stream bytes not fitting the ring are held, never dropped */
+                    ptBus->u16RxHeldBy = (uint16_t)i32Res;
+                    ptBus->u16RxHeldOffBy = (uint16_t)0U;
+                    Ipb_UringRxRefill(ptBus);
+                    if (ptBus->u16RxHeldBy > (uint16_t)0U)
+                    {
+                        ptBus->u32RxHolds++;
+                    }
+                }
+            }
+            break;
+        case IPB_URING_OP_TX:
+            ptBus->u16TxPend--;
+            if (i32Res < 0L)
+            {
+                ptBus->i32TxErr = i32Res;
+                ptBus->u16TxDoneBy = ptBus->pu16TxSzBy[u16Fly];
+            }
+            else if (ptBus->isDgram == false)
+            {
+                /** Short writes are continued on the next poll */
+                ptBus->u16TxDoneBy += (uint16_t)i32Res;
+            }
+            else
+            {
+                ptBus->u16TxDoneBy += (uint16_t)i32Res;
+                if (ptBus->u16TxPend == (uint16_t)0U)
+                {
+                    ptBus->u16TxDoneBy = ptBus->pu16TxSzBy[u16Fly];
+                }
+            }
+
+            if ((ptBus->u16TxPend == (uint16_t)0U) && (ptBus->u16TxDoneBy >= ptBus->pu16TxSzBy[u16Fly]))
+            {
+                ptBus->pu16TxSzBy[u16Fly] = (uint16_t)0U;
+                ptBus->pu16TxDgramCnt[u16Fly] = (uint16_t)0U;
+            }
+            break;
+        default:
+            /* Nothing */
+            break;
+    }
+}
+
+static void Ipb_UringRxPush(Ipb_TUringBus* ptBus, const uint8_t* pu8Buf, uint32_t u32SzBy)
+{
+    uint32_t u32FreeBy = IPB_URING_RX_RING_SZ_BY - (ptBus->u32RxTail - ptBus->u32RxHead);
+
+    if (u32SzBy > u32FreeBy)
+    {
+        ptBus->u32RxDropBy += u32SzBy - u32FreeBy;
+        u32SzBy = u32FreeBy;
+    }
+
+    for (uint32_t u32Idx = 0UL; u32Idx < u32SzBy; ++u32Idx)
+    {
+        ptBus->pu8Rx[(ptBus->u32RxTail + u32Idx) & (IPB_URING_RX_RING_SZ_BY - 1U)] = pu8Buf[u32Idx];
+    }
+    ptBus->u32RxTail += u32SzBy;
+}
+
+static void Ipb_UringRxPop(Ipb_TUringBus* ptBus, uint8_t* pu8Buf, uint32_t u32SzBy)
+{
+    for (uint32_t u32Idx = 0UL; u32Idx < u32SzBy; ++u32Idx)
+    {
+        pu8Buf[u32Idx] = ptBus->pu8Rx[(ptBus->u32RxHead + u32Idx) & (IPB_URING_RX_RING_SZ_BY - 1U)];
+    }
+    ptBus->u32RxHead += u32SzBy;
+}
+
+static void Ipb_UringRxRefill(Ipb_TUringBus* ptBus)
+{
+    uint32_t u32FreeBy = IPB_URING_RX_RING_SZ_BY - (ptBus->u32RxTail - ptBus->u32RxHead);
+    uint32_t u32SzBy = (ptBus->u16RxHeldBy < u32FreeBy) ? ptBus->u16RxHeldBy : u32FreeBy;
+
+    if (u32SzBy > 0UL)
+    {
+        Ipb_UringRxPush(ptBus, &ptBus->pu8RxPost[0][ptBus->u16RxHeldOffBy], u32SzBy);
+        ptBus->u16RxHeldOffBy += (uint16_t)u32SzBy;
+        ptBus->u16RxHeldBy -= (uint16_t)u32SzBy;
+    }
+}
+
+#endif /* __linux__ */
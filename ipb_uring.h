@@ -0,0 +1,241 @@
+/**
+ * @file ipb_uring.h
+ * @brief This file contains an io_uring transport engine of the
+ *        ingenia protocol bus (IPB) for Linux hosts
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_URING_H
+#define IPB_URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb_frame.h"
+
+/** Number of submission queue entries of the engine */
+#ifndef IPB_URING_ENTRIES
+#define IPB_URING_ENTRIES       256U
+#endif
+
+/** Max number of buses of an engine */
+#ifndef IPB_URING_BUS_NUM
+#define IPB_URING_BUS_NUM       64U
+#endif
+
+/** Number of receptions kept posted on each datagram bus */
+#ifndef IPB_URING_RX_DEPTH
+#define IPB_URING_RX_DEPTH      4U
+#endif
+
+/** Size in bytes of the reception ring of each bus, power of 2 */
+#ifndef IPB_URING_RX_RING_SZ_BY
+#define IPB_URING_RX_RING_SZ_BY 8192U
+#endif
+
+/** Size in bytes of each of the two transmission buffers of a bus */
+#ifndef IPB_URING_TX_SZ_BY
+#define IPB_URING_TX_SZ_BY      4096U
+#endif
+
+/** Max number of datagrams of each transmission buffer */
+#ifndef IPB_URING_TX_DGRAM_NUM
+#define IPB_URING_TX_DGRAM_NUM  32U
+#endif
+
+/** Default min time in microseconds between two polls of empty receptions */
+#ifndef IPB_URING_AUTO_POLL_US
+#define IPB_URING_AUTO_POLL_US  100U
+#endif
+
+/** Size in bytes of each posted reception */
+#define IPB_URING_RX_SZ_BY      (uint16_t)(IPB_FRM_MAX_DATA_SZ * sizeof(uint16_t))
+
+typedef struct Ipb_TUring Ipb_TUring;
+
+/** Bus served by the engine */
+typedef struct
+{
+    /** Engine serving the bus */
+    Ipb_TUring* ptUring;
+    /** Bus file descriptor, owned by the caller */
+    int32_t i32Fd;
+    /** Identification of the IPB instance using the bus */
+    uint16_t u16Id;
+    /** Datagram bus (UDP) if true, byte stream (tty, USB-CDC) otherwise */
+    bool isDgram;
+    /** Bus is served, false while being removed */
+    bool isOpen;
+    /** Index of the bus in the engine */
+    uint16_t u16Idx;
+    /** File status flags of the descriptor before being added */
+    int32_t i32FdFlags;
+    /** Posted reception buffers, a single one is used on stream buses */
+    uint8_t pu8RxPost[IPB_URING_RX_DEPTH][IPB_URING_RX_SZ_BY];
+    /** Indicates which reception buffers are posted */
+    bool pisRxPosted[IPB_URING_RX_DEPTH];
+    /** Received bytes, datagrams are prefixed with their size */
+    uint8_t pu8Rx[IPB_URING_RX_RING_SZ_BY];
+    /** Reception ring read index */
+    uint32_t u32RxHead;
+    /** Reception ring write index */
+    uint32_t u32RxTail;
+    /** Bytes of a stream reception not yet in the ring, it is posted again once empty */
+    uint16_t u16RxHeldBy;
+    /** Offset of the held bytes in the reception buffer */
+    uint16_t u16RxHeldOffBy;
+    /** Number of times a stream reception was held because the ring was full */
+    uint32_t u32RxHolds;
+    /** Number of received datagram bytes dropped, ring full or datagram truncated */
+    uint32_t u32RxDropBy;
+    /** Transmission buffers, one filled while the other is in flight */
+    uint8_t pu8Tx[2][IPB_URING_TX_SZ_BY];
+    /** Number of bytes of each transmission buffer */
+    uint16_t pu16TxSzBy[2];
+    /** Datagram sizes of each transmission buffer */
+    uint16_t pu16TxDgram[2][IPB_URING_TX_DGRAM_NUM];
+    /** Number of datagrams of each transmission buffer */
+    uint16_t pu16TxDgramCnt[2];
+    /** Transmission buffer being filled */
+    uint16_t u16TxFill;
+    /** Number of bytes of the in flight buffer already written */
+    uint16_t u16TxDoneBy;
+    /** Number of transmissions in flight */
+    uint16_t u16TxPend;
+    /** Last transmission error, 0 if none */
+    int32_t i32TxErr;
+} Ipb_TUringBus;
+
+/** io_uring engine */
+struct Ipb_TUring
+{
+    /** Ring file descriptor, -1 if closed */
+    int32_t i32Fd;
+    /** Submission ring mapping */
+    void* pvSqMap;
+    /** Size in bytes of the submission ring mapping */
+    uint32_t u32SqMapSz;
+    /** Completion ring mapping, same as pvSqMap on single mmap kernels */
+    void* pvCqMap;
+    /** Size in bytes of the completion ring mapping */
+    uint32_t u32CqMapSz;
+    /** Submission entries mapping */
+    void* pvSqes;
+    /** Size in bytes of the submission entries mapping */
+    uint32_t u32SqesSz;
+    /** Submission ring */
+    uint32_t* pu32SqHead;
+    uint32_t* pu32SqTail;
+    uint32_t* pu32SqArray;
+    uint32_t u32SqMask;
+    /** Completion ring */
+    uint32_t* pu32CqHead;
+    uint32_t* pu32CqTail;
+    void* pvCqes;
+    uint32_t u32CqMask;
+    /** Entries queued and not yet submitted */
+    uint32_t u32ToSubmit;
+    /** Wait timeout of the last poll, seconds and nanoseconds */
+    int64_t pi64Timeout[2];
+    /** Waits pass their timeout to io_uring_enter, no timeout entry queued */
+    bool isExtArg;
+    /** Sequence number of the last wait timeout entry, older kernels */
+    uint8_t u8TimeoutSeq;
+    /** Last wait timeout entry did not complete yet, the next wait reuses it */
+    bool isTimeoutArmed;
+    /** Time in microseconds of the last poll */
+    uint32_t u32PollUs;
+    /** Buses served */
+    Ipb_TUringBus* ptBus[IPB_URING_BUS_NUM];
+    /** Number of buses */
+    uint16_t u16BusCnt;
+    /**
+     * Max time in milliseconds an empty reception polls the engine, when
+     * receptions poll. Blocking requests already wait through the port
+     * Wait operation. Set isAutoPoll to false when a loop calls
+     * Ipb_UringPoll for all buses.
+     */
+    uint16_t u16AutoWaitMs;
+    /** Receptions and waits of empty buses poll the engine */
+    bool isAutoPoll;
+    /**
+     * Min time in microseconds between two polls of empty receptions
+     * without transmissions to submit, waits always poll
+     */
+    uint32_t u32AutoPollUs;
+    /** Number of io_uring_enter system calls */
+    uint32_t u32Enters;
+};
+
+/**
+ * Initialises an io_uring engine
+ *
+ * @param[out] ptUring
+ *  Engine instance
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_UringInit(Ipb_TUring* ptUring);
+
+/**
+ * Releases an io_uring engine, buses must be removed before
+ *
+ * @param[in] ptUring
+ *  Engine instance
+ */
+void
+Ipb_UringDeinit(Ipb_TUring* ptUring);
+
+/**
+ * Adds a bus to the engine and registers it as the port of u16Id,
+ * replacing any port registered before
+ *
+ * @note Each reception of an empty bus is a system call, so spinning
+ *  gains nothing. Blocking instances on the bus should use
+ *  IPB_WAIT_SLEEP, see Ipb_SetWait.
+ *
+ * @param[in] ptUring
+ *  Engine instance
+ * @param[out] ptBus
+ *  Bus instance
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] i32Fd
+ *  Open file descriptor, e.g. Ipb_TSerial or Ipb_TUdp descriptor
+ * @param[in] isDgram
+ *  true for datagram sockets, false for byte streams
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_UringAdd(Ipb_TUring* ptUring, Ipb_TUringBus* ptBus, uint16_t u16Id, int32_t i32Fd, bool isDgram);
+
+/**
+ * Removes a bus from the engine and unregisters its port
+ *
+ * @note Posted receptions are cancelled, the call waits for them.
+ *
+ * @param[in] ptBus
+ *  Bus instance
+ */
+void
+Ipb_UringRemove(Ipb_TUringBus* ptBus);
+
+/**
+ * Runs one engine iteration: reposts receptions, submits the pending
+ * transmissions of all buses and collects completions with a single
+ * io_uring_enter
+ *
+ * @param[in] ptUring
+ *  Engine instance
+ * @param[in] u32TimeoutMs
+ *  Max time to wait for a completion, 0 does not wait
+ *
+ * @retval number of completions, negative error code otherwise
+ */
+int32_t
+Ipb_UringPoll(Ipb_TUring* ptUring, uint32_t u32TimeoutMs);
+
+#endif /* IPB_URING_H */
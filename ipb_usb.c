@@ -0,0 +1,490 @@
+/**
+ * @file ipb_usb.c
+ * @brief This file contains the USB-CDC port of the ingenia protocol bus
+ *        (IPB) for Linux hosts, coalescing frames into bulk transfers
+ *
+ * @note Every write of the device ends a bulk transfer, each taking at
+ *  least one bus frame (1 ms full speed, 125 us high speed). Frames of
+ *  all the instances of a device wait in one buffer and go out together.
+ *  Replies come back in request order; each received frame is matched
+ *  to the oldest request with the same node and address and queued for
+ *  the instance that sent it.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#if defined(__linux__)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ipb_usb.h"
+#include "ipb_port.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+
+static uint16_t
+Ipb_UsbReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size);
+
+static uint16_t
+Ipb_UsbTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+static void
+Ipb_UsbDiscardData(void* pvCtx);
+
+static bool
+Ipb_UsbWaitRx(void* pvCtx, uint32_t u32TimeoutUs);
+
+/**
+ * Transfers the waiting frames once the oldest reaches its deadline
+ *
+ * @param[in] ptUsb
+ *  Device instance
+ */
+static void
+Ipb_UsbPoll(Ipb_TUsb* ptUsb);
+
+/**
+ * Records the requests of a transmission, their replies are routed back
+ * to the instance
+ *
+ * @note Frame headers are never split between segments
+ *
+ * @param[in] ptLink
+ *  Instance transmitting
+ * @param[in] ptIov
+ *  Segments holding whole frames
+ * @param[in] u16IovCnt
+ *  Number of segments
+ */
+static void
+Ipb_UsbTrack(Ipb_TUsbLink* ptLink, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt);
+
+/**
+ * Reads a transfer and splits it into frames
+ *
+ * @param[in] ptUsb
+ *  Device instance
+ */
+static void
+Ipb_UsbReceive(Ipb_TUsb* ptUsb);
+
+/**
+ * Queues a received frame for the instance that sent its request
+ */
+static void
+Ipb_UsbOnFrame(void* pvCtx, const Ipb_TFrame* ptFrame);
+
+static const Ipb_TPortOps tUsbOps =
+{
+    &Ipb_UsbReception,
+    &Ipb_UsbTransmission,
+    NULL,
+    &Ipb_UsbDiscardData,
+    &Ipb_UsbWaitRx
+};
+
+int32_t Ipb_UsbOpen(Ipb_TUsb* ptUsb, const char* szDev, uint16_t u16PacketSzBy, uint32_t u32FlushUs)
+{
+    int32_t i32Ret = 0L;
+
+    ptUsb->i32Fd = -1L;
+    ptUsb->u16PacketSzBy = u16PacketSzBy;
+    ptUsb->u32FlushUs = u32FlushUs;
+    ptUsb->u16TxSzBy = (uint16_t)0U;
+    ptUsb->u32TxUs = (uint32_t)0UL;
+    ptUsb->u16LinkCnt = (uint16_t)0U;
+    ptUsb->u16PendHead = (uint16_t)0U;
+    ptUsb->u16PendCnt = (uint16_t)0U;
+    ptUsb->u32TxXfers = (uint32_t)0UL;
+    ptUsb->u32TxFrames = (uint32_t)0UL;
+    ptUsb->u32RxXfers = (uint32_t)0UL;
+    ptUsb->u32RxFrames = (uint32_t)0UL;
+    ptUsb->u32Unmatched = (uint32_t)0UL;
+    ptUsb->u32Lost = (uint32_t)0UL;
+    Ipb_ParserInit(&ptUsb->tParser, &Ipb_UsbOnFrame, (void*)ptUsb);
+
+    while (1)
+    {
+        struct termios tTio;
+
+        if ((u16PacketSzBy < IPB_FRM_CFG_SZ_BY) || (u16PacketSzBy > (uint16_t)IPB_USB_TX_SZ_BY))
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        ptUsb->i32Fd = open(szDev, (O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC));
+        if (ptUsb->i32Fd < 0L)
+        {
+            i32Ret = -2L;
+            break;
+        }
+
+        /** Raw, the line coding is meaningless to CDC devices */
+        if (tcgetattr(ptUsb->i32Fd, &tTio) != 0)
+        {
+            i32Ret = -3L;
+            break;
+        }
+        cfmakeraw(&tTio);
+        tTio.c_cflag |= (CLOCAL | CREAD);
+        tTio.c_cc[VMIN] = 0;
+        tTio.c_cc[VTIME] = 0;
+        if (tcsetattr(ptUsb->i32Fd, TCSANOW, &tTio) != 0)
+        {
+            i32Ret = -3L;
+            break;
+        }
+
+        break;
+    }
+
+    if ((i32Ret != 0L) && (ptUsb->i32Fd >= 0L))
+    {
+        (void)close(ptUsb->i32Fd);
+        ptUsb->i32Fd = -1L;
+    }
+
+    return i32Ret;
+}
+
+int32_t Ipb_UsbAttach(Ipb_TUsb* ptUsb, uint16_t u16Id)
+{
+    int32_t i32Ret = 0L;
+
+    while (1)
+    {
+        Ipb_TUsbLink* ptLink;
+
+        if (ptUsb->u16LinkCnt >= (uint16_t)IPB_USB_MAX_LINK)
+        {
+            i32Ret = -1L;
+            break;
+        }
+
+        ptLink = &ptUsb->ptLink[ptUsb->u16LinkCnt];
+        ptLink->ptUsb = ptUsb;
+        ptLink->u16Id = u16Id;
+        ptLink->u16RxRdBy = (uint16_t)0U;
+        ptLink->u16RxWrBy = (uint16_t)0U;
+
+        if (Ipb_PortRegister(u16Id, &tUsbOps, (void*)ptLink) == false)
+        {
+            i32Ret = -2L;
+            break;
+        }
+        ptUsb->u16LinkCnt++;
+
+        break;
+    }
+
+    return i32Ret;
+}
+
+uint16_t Ipb_UsbFlush(Ipb_TUsb* ptUsb)
+{
+    uint16_t u16Ret = 0U;
+    uint16_t u16WrBy = (uint16_t)0U;
+
+    while (u16WrBy < ptUsb->u16TxSzBy)
+    {
+        ssize_t sWrBy = write(ptUsb->i32Fd, (const void*)&ptUsb->pu8Tx[u16WrBy],
+                              (size_t)(ptUsb->u16TxSzBy - u16WrBy));
+        if (sWrBy < 0)
+        {
+            struct pollfd tPfd = { ptUsb->i32Fd, POLLOUT, 0 };
+
+            if ((errno != EAGAIN) || (poll(&tPfd, 1U, (int)IPB_USB_TX_WAIT_MS) <= 0))
+            {
+                u16Ret = (uint16_t)errno;
+                break;
+            }
+            continue;
+        }
+        u16WrBy += (uint16_t)sWrBy;
+    }
+
+    if (ptUsb->u16TxSzBy > (uint16_t)0U)
+    {
+        ptUsb->u32TxXfers++;
+    }
+    /** Frames not written on error are dropped, their requests time out */
+    ptUsb->u16TxSzBy = (uint16_t)0U;
+
+    return u16Ret;
+}
+
+void Ipb_UsbClose(Ipb_TUsb* ptUsb)
+{
+    uint16_t u16Idx;
+
+    if (ptUsb->i32Fd >= 0L)
+    {
+        (void)Ipb_UsbFlush(ptUsb);
+        for (u16Idx = (uint16_t)0U; u16Idx < ptUsb->u16LinkCnt; u16Idx++)
+        {
+            Ipb_PortUnregister(ptUsb->ptLink[u16Idx].u16Id);
+        }
+        ptUsb->u16LinkCnt = (uint16_t)0U;
+        (void)close(ptUsb->i32Fd);
+        ptUsb->i32Fd = -1L;
+    }
+}
+
+static uint16_t Ipb_UsbReception(void* pvCtx, uint8_t* pu8Buf, uint16_t u16Size)
+{
+    Ipb_TUsbLink* ptLink = (Ipb_TUsbLink*)pvCtx;
+    uint16_t u16RdBy;
+
+    Ipb_UsbPoll(ptLink->ptUsb);
+    if (ptLink->u16RxRdBy == ptLink->u16RxWrBy)
+    {
+        Ipb_UsbReceive(ptLink->ptUsb);
+    }
+
+    u16RdBy = ptLink->u16RxWrBy - ptLink->u16RxRdBy;
+    if (u16RdBy > u16Size)
+    {
+        u16RdBy = u16Size;
+    }
+    memcpy((void*)pu8Buf, (const void*)&ptLink->pu8Rx[ptLink->u16RxRdBy], u16RdBy);
+    ptLink->u16RxRdBy += u16RdBy;
+    if (ptLink->u16RxRdBy == ptLink->u16RxWrBy)
+    {
+        ptLink->u16RxRdBy = (uint16_t)0U;
+        ptLink->u16RxWrBy = (uint16_t)0U;
+    }
+
+    return u16RdBy;
+}
+
+static uint16_t Ipb_UsbTransmission(void* pvCtx, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TUsbLink* ptLink = (Ipb_TUsbLink*)pvCtx;
+    Ipb_TUsb* ptUsb = ptLink->ptUsb;
+    uint16_t u16Ret = 0U;
+    uint32_t u32SzBy = (uint32_t)0UL;
+    uint16_t u16Idx;
+
+    for (u16Idx = (uint16_t)0U; u16Idx < u16IovCnt; u16Idx++)
+    {
+        u32SzBy += ptIov[u16Idx].u16SzBy;
+    }
+
+    Ipb_UsbPoll(ptUsb);
+    /** Frames of a transfer fit in a packet, unless a single write is bigger */
+    if (((uint32_t)ptUsb->u16TxSzBy + u32SzBy) > ptUsb->u16PacketSzBy)
+    {
+        u16Ret = Ipb_UsbFlush(ptUsb);
+    }
+    if ((ptUsb->u16TxSzBy == (uint16_t)0U) && (ptUsb->u32FlushUs != (uint32_t)0UL))
+    {
+        ptUsb->u32TxUs = Ipb_GetMicros();
+    }
+
+    for (u16Idx = (uint16_t)0U; (u16Idx < u16IovCnt) && (u16Ret == 0U); u16Idx++)
+    {
+        uint16_t u16OffBy = (uint16_t)0U;
+
+        while ((u16Ret == 0U) && (u16OffBy < ptIov[u16Idx].u16SzBy))
+        {
+            uint16_t u16CpBy = ptIov[u16Idx].u16SzBy - u16OffBy;
+
+            if (u16CpBy > ((uint16_t)IPB_USB_TX_SZ_BY - ptUsb->u16TxSzBy))
+            {
+                u16CpBy = (uint16_t)IPB_USB_TX_SZ_BY - ptUsb->u16TxSzBy;
+            }
+            if (u16CpBy == (uint16_t)0U)
+            {
+                u16Ret = Ipb_UsbFlush(ptUsb);
+                continue;
+            }
+            memcpy((void*)&ptUsb->pu8Tx[ptUsb->u16TxSzBy], (const void*)&ptIov[u16Idx].pu8Buf[u16OffBy], u16CpBy);
+            ptUsb->u16TxSzBy += u16CpBy;
+            u16OffBy += u16CpBy;
+        }
+    }
+
+    if (u16Ret == 0U)
+    {
+        Ipb_UsbTrack(ptLink, ptIov, u16IovCnt);
+
+        /** Nothing to wait for when no other frame fits in the packet */
+        if ((ptUsb->u32FlushUs == (uint32_t)0UL)
+            || ((ptUsb->u16TxSzBy + IPB_FRM_CFG_SZ_BY) > ptUsb->u16PacketSzBy))
+        {
+            u16Ret = Ipb_UsbFlush(ptUsb);
+        }
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_UsbDiscardData(void* pvCtx)
+{
+    Ipb_TUsbLink* ptLink = (Ipb_TUsbLink*)pvCtx;
+
+    /** Only the frames of the instance, the device is shared */
+    ptLink->u16RxRdBy = (uint16_t)0U;
+    ptLink->u16RxWrBy = (uint16_t)0U;
+}
+
+static bool Ipb_UsbWaitRx(void* pvCtx, uint32_t u32TimeoutUs)
+{
+    Ipb_TUsbLink* ptLink = (Ipb_TUsbLink*)pvCtx;
+    Ipb_TUsb* ptUsb = ptLink->ptUsb;
+    bool isReady = (ptLink->u16RxRdBy != ptLink->u16RxWrBy);
+
+    if (isReady == false)
+    {
+        struct pollfd tPfd = { ptUsb->i32Fd, POLLIN, 0 };
+        struct timespec tTs;
+
+        Ipb_UsbPoll(ptUsb);
+        /** Replies never come before their requests, wake up to send them */
+        if (ptUsb->u16TxSzBy > (uint16_t)0U)
+        {
+            uint32_t u32WaitUs = Ipb_GetMicros() - ptUsb->u32TxUs;
+
+            u32WaitUs = (u32WaitUs < ptUsb->u32FlushUs) ? (ptUsb->u32FlushUs - u32WaitUs) : (uint32_t)0UL;
+            if (u32WaitUs < u32TimeoutUs)
+            {
+                u32TimeoutUs = u32WaitUs;
+            }
+        }
+
+        tTs.tv_sec = (time_t)(u32TimeoutUs / 1000000UL);
+        tTs.tv_nsec = (long)(u32TimeoutUs % 1000000UL) * 1000L;
+        isReady = (ppoll(&tPfd, 1U, &tTs, NULL) > 0);
+        Ipb_UsbPoll(ptUsb);
+    }
+
+    return isReady;
+}
+
+static void Ipb_UsbPoll(Ipb_TUsb* ptUsb)
+{
+    if ((ptUsb->u16TxSzBy > (uint16_t)0U)
+        && ((Ipb_GetMicros() - ptUsb->u32TxUs) >= ptUsb->u32FlushUs))
+    {
+        (void)Ipb_UsbFlush(ptUsb);
+    }
+}
+
+static void Ipb_UsbTrack(Ipb_TUsbLink* ptLink, const Ipb_TFrameIov* ptIov, uint16_t u16IovCnt)
+{
+    Ipb_TUsb* ptUsb = ptLink->ptUsb;
+    uint16_t pu16Head[IPB_FRM_CFG_IDX + 1U];
+    uint32_t u32SkipBy = (uint32_t)0UL;
+    uint16_t u16Idx;
+
+    for (u16Idx = (uint16_t)0U; u16Idx < u16IovCnt; u16Idx++)
+    {
+        uint32_t u32SegBy = ptIov[u16Idx].u16SzBy;
+
+        while ((u32SkipBy + sizeof(pu16Head)) <= u32SegBy)
+        {
+            uint16_t u16Cmd;
+
+            /** Segments have no alignment guarantee */
+            memcpy((void*)pu16Head, (const void*)&ptIov[u16Idx].pu8Buf[u32SkipBy], sizeof(pu16Head));
+            u16Cmd = (pu16Head[IPB_FRM_CMD_IDX] >> IPB_FRM_CMD_POS) & IPB_FRM_CMD_MASK;
+            if ((u16Cmd == IPB_REQ_READ) || (u16Cmd == IPB_REQ_WRITE))
+            {
+                Ipb_TUsbPend* ptPend;
+
+                if (ptUsb->u16PendCnt >= (uint16_t)IPB_USB_PEND_NUM)
+                {
+                    /** Oldest request is given up */
+                    ptUsb->u16PendHead = (ptUsb->u16PendHead + 1U) % IPB_USB_PEND_NUM;
+                    ptUsb->u16PendCnt--;
+                    ptUsb->u32Lost++;
+                }
+                ptPend = &ptUsb->ptPend[(ptUsb->u16PendHead + ptUsb->u16PendCnt) % IPB_USB_PEND_NUM];
+                ptPend->u16Link = (uint16_t)(ptLink - ptUsb->ptLink);
+                ptPend->u16SubNode = pu16Head[IPB_FRM_NODE_IDX] & IPB_FRM_NODE_MASK;
+                ptPend->u16Addr = pu16Head[IPB_FRM_CMD_IDX] >> IPB_FRM_ADDR_POS;
+                ptUsb->u16PendCnt++;
+            }
+            ptUsb->u32TxFrames++;
+            u32SkipBy += (uint32_t)Ipb_FrameGetEncodedSz(pu16Head) * sizeof(uint16_t);
+        }
+
+        u32SkipBy = (u32SkipBy > u32SegBy) ? (u32SkipBy - u32SegBy) : (uint32_t)0UL;
+    }
+}
+
+static void Ipb_UsbReceive(Ipb_TUsb* ptUsb)
+{
+    ssize_t sRdBy = read(ptUsb->i32Fd, (void*)ptUsb->pu8Xfer, sizeof(ptUsb->pu8Xfer));
+
+    if (sRdBy > 0)
+    {
+        ptUsb->u32RxXfers++;
+        Ipb_ParserFeed(&ptUsb->tParser, ptUsb->pu8Xfer, (uint16_t)sRdBy);
+    }
+}
+
+static void Ipb_UsbOnFrame(void* pvCtx, const Ipb_TFrame* ptFrame)
+{
+    Ipb_TUsb* ptUsb = (Ipb_TUsb*)pvCtx;
+    uint16_t u16SubNode = Ipb_FrameGetSubNode(ptFrame);
+    uint16_t u16Addr = Ipb_FrameGetAddr(ptFrame);
+    uint16_t u16Idx = (uint16_t)0U;
+    const Ipb_TUsbPend* ptPend = NULL;
+
+    ptUsb->u32RxFrames++;
+    while ((u16Idx < ptUsb->u16PendCnt) && (ptPend == NULL))
+    {
+        const Ipb_TUsbPend* ptCur = &ptUsb->ptPend[(ptUsb->u16PendHead + u16Idx) % IPB_USB_PEND_NUM];
+
+        if ((ptCur->u16SubNode == u16SubNode) && (ptCur->u16Addr == u16Addr))
+        {
+            ptPend = ptCur;
+        }
+        u16Idx++;
+    }
+
+    if (ptPend == NULL)
+    {
+        ptUsb->u32Unmatched++;
+    }
+    else
+    {
+        Ipb_TUsbLink* ptLink = &ptUsb->ptLink[ptPend->u16Link];
+        uint16_t u16SzBy = ptFrame->u16Sz * sizeof(uint16_t);
+
+        /** Replies come in request order, older requests lost theirs */
+        ptUsb->u32Lost += (uint32_t)(u16Idx - 1U);
+        ptUsb->u16PendHead = (ptUsb->u16PendHead + u16Idx) % IPB_USB_PEND_NUM;
+        ptUsb->u16PendCnt -= u16Idx;
+
+        if ((ptLink->u16RxWrBy + u16SzBy) > (uint16_t)IPB_USB_RX_SZ_BY)
+        {
+            memmove((void*)ptLink->pu8Rx, (const void*)&ptLink->pu8Rx[ptLink->u16RxRdBy],
+                    (ptLink->u16RxWrBy - ptLink->u16RxRdBy));
+            ptLink->u16RxWrBy -= ptLink->u16RxRdBy;
+            ptLink->u16RxRdBy = (uint16_t)0U;
+        }
+        if ((ptLink->u16RxWrBy + u16SzBy) <= (uint16_t)IPB_USB_RX_SZ_BY)
+        {
+            memcpy((void*)&ptLink->pu8Rx[ptLink->u16RxWrBy], (const void*)ptFrame->pu16Buf, u16SzBy);
+            ptLink->u16RxWrBy += u16SzBy;
+        }
+        else
+        {
+            ptUsb->u32Lost++;
+        }
+    }
+}
+
+#endif /* __linux__ */
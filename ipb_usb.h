@@ -0,0 +1,180 @@
+/**
+ * @file ipb_usb.h
+ * @brief This file contains the USB-CDC port of the ingenia protocol bus
+ *        (IPB) for Linux hosts, coalescing frames into bulk transfers
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_USB_H
+#define IPB_USB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb_frame.h"
+#include "ipb_parser.h"
+
+/** Bulk endpoint packet size of full speed devices */
+#define IPB_USB_PKT_FS_SZ_BY    64U
+
+/** Bulk endpoint packet size of high speed devices */
+#define IPB_USB_PKT_HS_SZ_BY    512U
+
+/** Max number of IPB instances sharing a device */
+#ifndef IPB_USB_MAX_LINK
+#define IPB_USB_MAX_LINK        8U
+#endif
+
+/** Size of the transmission buffer, frames never wait beyond it */
+#ifndef IPB_USB_TX_SZ_BY
+#define IPB_USB_TX_SZ_BY        2048U
+#endif
+
+/** Size of the received frames queue of each instance */
+#ifndef IPB_USB_RX_SZ_BY
+#define IPB_USB_RX_SZ_BY        2048U
+#endif
+
+/** Max number of requests waiting for their replies */
+#ifndef IPB_USB_PEND_NUM
+#define IPB_USB_PEND_NUM        64U
+#endif
+
+/** Max time in milliseconds a transfer waits for room in the driver */
+#ifndef IPB_USB_TX_WAIT_MS
+#define IPB_USB_TX_WAIT_MS      100U
+#endif
+
+typedef struct Ipb_TUsb Ipb_TUsb;
+
+/** IPB instance using a device */
+typedef struct
+{
+    /** Device of the instance */
+    Ipb_TUsb* ptUsb;
+    /** Identification of the IPB instance */
+    uint16_t u16Id;
+    /** Replies received and not yet read by the instance */
+    uint8_t pu8Rx[IPB_USB_RX_SZ_BY];
+    /** Next byte to be read */
+    uint16_t u16RxRdBy;
+    /** Number of bytes queued, from the start of the buffer */
+    uint16_t u16RxWrBy;
+} Ipb_TUsbLink;
+
+/** Request waiting for its reply */
+typedef struct
+{
+    /** Instance the reply is routed to */
+    uint16_t u16Link;
+    /** Internal network node of the request */
+    uint16_t u16SubNode;
+    /** Address of the request */
+    uint16_t u16Addr;
+} Ipb_TUsbPend;
+
+/** USB-CDC device instance, all its instances are used from one thread */
+struct Ipb_TUsb
+{
+    /** Device file descriptor, -1 if closed */
+    int32_t i32Fd;
+    /** Bulk endpoint packet size in bytes */
+    uint16_t u16PacketSzBy;
+    /** Max time in microseconds a frame waits for others, 0 never waits */
+    uint32_t u32FlushUs;
+    /** Frames waiting to be transferred */
+    uint8_t pu8Tx[IPB_USB_TX_SZ_BY];
+    /** Number of bytes waiting to be transferred */
+    uint16_t u16TxSzBy;
+    /** Time in microseconds the oldest waiting frame was queued */
+    uint32_t u32TxUs;
+    /** Last received transfer */
+    uint8_t pu8Xfer[IPB_USB_RX_SZ_BY];
+    /** Splits received transfers into frames */
+    Ipb_TParser tParser;
+    /** Instances using the device */
+    Ipb_TUsbLink ptLink[IPB_USB_MAX_LINK];
+    /** Number of instances */
+    uint16_t u16LinkCnt;
+    /** Requests waiting for their replies, in transmission order */
+    Ipb_TUsbPend ptPend[IPB_USB_PEND_NUM];
+    /** Oldest request */
+    uint16_t u16PendHead;
+    /** Number of requests */
+    uint16_t u16PendCnt;
+    /** Number of transfers sent */
+    uint32_t u32TxXfers;
+    /** Number of frames sent */
+    uint32_t u32TxFrames;
+    /** Number of transfers received */
+    uint32_t u32RxXfers;
+    /** Number of frames received */
+    uint32_t u32RxFrames;
+    /** Number of replies matching no request, dropped */
+    uint32_t u32Unmatched;
+    /** Number of requests whose reply never came or was dropped */
+    uint32_t u32Lost;
+};
+
+/**
+ * Opens a USB-CDC device
+ *
+ * @note Frames written by the instances of the device are packed into
+ *  one transfer until the next one does not fit in a packet or the
+ *  oldest has waited u32FlushUs. A single write bigger than a packet,
+ *  e.g. a window, goes out as one transfer at once. Received transfers
+ *  are split into frames and each reply is routed to the instance that
+ *  sent the request with the same node and address.
+ *
+ * @param[out] ptUsb
+ *  Device instance
+ * @param[in] szDev
+ *  Device path, e.g. "/dev/ttyACM0"
+ * @param[in] u16PacketSzBy
+ *  Bulk endpoint packet size, IPB_USB_PKT_FS_SZ_BY or IPB_USB_PKT_HS_SZ_BY
+ * @param[in] u32FlushUs
+ *  Max time in microseconds a frame waits for others, 0 sends each
+ *  write at once
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_UsbOpen(Ipb_TUsb* ptUsb, const char* szDev, uint16_t u16PacketSzBy, uint32_t u32FlushUs);
+
+/**
+ * Registers the device for u16Id, so the USB_BASED instance initialised
+ * with the same identification uses it
+ *
+ * @param[in] ptUsb
+ *  Device instance
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ *
+ * @retval 0 if success, negative error code otherwise
+ */
+int32_t
+Ipb_UsbAttach(Ipb_TUsb* ptUsb, uint16_t u16Id);
+
+/**
+ * Transfers the waiting frames at once
+ *
+ * @param[in] ptUsb
+ *  Device instance
+ *
+ * @retval 0 if success, errno otherwise
+ */
+uint16_t
+Ipb_UsbFlush(Ipb_TUsb* ptUsb);
+
+/**
+ * Transfers the waiting frames, unregisters all the instances and closes
+ * the device
+ *
+ * @param[in] ptUsb
+ *  Device instance
+ */
+void
+Ipb_UsbClose(Ipb_TUsb* ptUsb);
+
+#endif /* IPB_USB_H */
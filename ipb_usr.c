@@ -3,11 +3,41 @@
  * @brief This file contains functions to be implemented by user to
  *        migrate platform dependencies
  *
+ * @note Default implementations redirect to the port registered for
+ *  the instance identification, see ipb_port.h
+ *
  * @author  Firmware department
  * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
  */
 
 #include "ipb_usr.h"
+#include "ipb_port.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Receives from the registered port
+ *
+ * @retval number of read bytes, 0 if no port is registered
+ */
+static uint16_t
+Ipb_UsrPortReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size);
+
+/**
+ * Transmits a frame through the registered port, or with the scalar
+ * transmission function if no port is registered
+ *
+ * @retval 0 if success, error code otherwise
+ */
+static uint16_t
+Ipb_UsrPortTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt,
+                         uint16_t (*Transmission)(uint16_t, const uint8_t*, uint16_t));
+
+/**
+ * Discards data of the registered port
+ */
+static void
+Ipb_UsrPortDiscardData(uint16_t u16Id);
 
 __attribute__((weak))uint32_t Ipb_GetMillis(void)
 {
@@ -15,25 +45,53 @@ __attribute__((weak))uint32_t Ipb_GetMillis(void)
     return 0;
 }
 
+__attribute__((weak))uint32_t Ipb_GetMicros(void)
+{
+    /** Return microseconds */
+    return Ipb_GetMillis() * (uint32_t)1000UL;
+}
+
+__attribute__((weak))bool Ipb_IntfWait(uint16_t u16Id, uint32_t u32TimeoutUs)
+{
+    bool isReady = true;
+    void* pvCtx;
+    const Ipb_TPortOps* ptOps = Ipb_PortGet(u16Id, &pvCtx);
+
+    /** Wait for received data */
+    if ((ptOps != NULL) && (ptOps->Wait != NULL))
+    {
+        isReady = ptOps->Wait(pvCtx, u32TimeoutUs);
+    }
+
+    return isReady;
+}
+
 __attribute__((weak))uint16_t Ipb_IntfUartReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size)
 {
     /** Receive data */
 
     /** Return read bytes */
-    return 0;
+    return Ipb_UsrPortReception(u16Id, pu8Buf, u16Size);
 }
 
 __attribute__((weak))uint16_t Ipb_IntfUartTransmission(uint16_t u16Id, const uint8_t *pu8Buf, uint16_t u16Size)
 {
     /** Trasmit data */
+    Ipb_TFrameIov tIov = { pu8Buf, u16Size };
 
-    /** Return write bytes */
-    return 0;
+    /** Return error code */
+    return Ipb_UsrPortTransmissionV(u16Id, &tIov, (uint16_t)1U, NULL);
+}
+
+__attribute__((weak))uint16_t Ipb_IntfUartTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt)
+{
+    return Ipb_UsrPortTransmissionV(u16Id, ptIov, u16IovCnt, &Ipb_IntfUartTransmission);
 }
 
 __attribute__((weak))void Ipb_IntfUartDiscardData(uint16_t u16Id)
 {
     /** Discard accumulated data from Uart buffer */
+    Ipb_UsrPortDiscardData(u16Id);
 }
 
 __attribute__((weak))uint16_t Ipb_IntfUsbReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size)
@@ -41,18 +99,154 @@ __attribute__((weak))uint16_t Ipb_IntfUsbReception(uint16_t u16Id, uint8_t *pu8B
     /** Receive data */
 
     /** Return read bytes */
-    return 0;
+    return Ipb_UsrPortReception(u16Id, pu8Buf, u16Size);
 }
 
 __attribute__((weak))uint16_t Ipb_IntfUsbTransmission(uint16_t u16Id, const uint8_t *pu8Buf, uint16_t u16Size)
 {
     /** Trasmit data */
+    Ipb_TFrameIov tIov = { pu8Buf, u16Size };
 
-    /** Return write bytes */
-    return 0;
+    /** Return error code */
+    return Ipb_UsrPortTransmissionV(u16Id, &tIov, (uint16_t)1U, NULL);
+}
+
+__attribute__((weak))uint16_t Ipb_IntfUsbTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt)
+{
+    return Ipb_UsrPortTransmissionV(u16Id, ptIov, u16IovCnt, &Ipb_IntfUsbTransmission);
 }
 
 __attribute__((weak))void Ipb_IntfUsbDiscardData(uint16_t u16Id)
 {
-    /** Discard accumulated data from Uart buffer */
+    /** Discard accumulated data from Usb buffer */
+    Ipb_UsrPortDiscardData(u16Id);
+}
+
+__attribute__((weak))uint16_t Ipb_IntfEthReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size)
+{
+    /** Receive a datagram */
+
+    /** Return datagram bytes */
+    return Ipb_UsrPortReception(u16Id, pu8Buf, u16Size);
+}
+
+__attribute__((weak))uint16_t Ipb_IntfEthTransmission(uint16_t u16Id, const uint8_t *pu8Buf, uint16_t u16Size)
+{
+    /** Trasmit a datagram */
+    Ipb_TFrameIov tIov = { pu8Buf, u16Size };
+
+    /** Return error code */
+    return Ipb_UsrPortTransmissionV(u16Id, &tIov, (uint16_t)1U, NULL);
+}
+
+__attribute__((weak))uint16_t Ipb_IntfEthTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt)
+{
+    uint16_t u16Ret = 0U;
+    void* pvCtx;
+    const Ipb_TPortOps* ptOps = Ipb_PortGet(u16Id, &pvCtx);
+
+    if ((ptOps != NULL) || (u16IovCnt <= (uint16_t)1U))
+    {
+        u16Ret = Ipb_UsrPortTransmissionV(u16Id, ptIov, u16IovCnt, &Ipb_IntfEthTransmission);
+    }
+    else
+    {
+        /** Segments are gathered to keep a single datagram, on the stack of the caller thread */
+        uint8_t pu8Dgram[IPB_FRM_MAX_DATA_SZ * sizeof(uint16_t)];
+        uint16_t u16SzBy = (uint16_t)0U;
+
+        for (uint16_t u16Idx = 0U; u16Idx < u16IovCnt; ++u16Idx)
+        {
+            if ((u16SzBy + ptIov[u16Idx].u16SzBy) > (uint16_t)sizeof(pu8Dgram))
+            {
+                u16Ret = 1U;
+                break;
+            }
+            memcpy(&pu8Dgram[u16SzBy], ptIov[u16Idx].pu8Buf, ptIov[u16Idx].u16SzBy);
+            u16SzBy += ptIov[u16Idx].u16SzBy;
+        }
+
+        if (u16Ret == 0U)
+        {
+            u16Ret = Ipb_IntfEthTransmission(u16Id, pu8Dgram, u16SzBy);
+        }
+    }
+
+    return u16Ret;
+}
+
+__attribute__((weak))uint16_t Ipb_IntfEthTransmissionM(uint16_t u16Id, const Ipb_TFrameIov *ptFrm, uint16_t u16FrmCnt)
+{
+    uint16_t u16Ret = 0U;
+    void* pvCtx;
+    const Ipb_TPortOps* ptOps = Ipb_PortGet(u16Id, &pvCtx);
+
+    if ((ptOps != NULL) && (ptOps->TransmissionM != NULL))
+    {
+        u16Ret = ptOps->TransmissionM(pvCtx, ptFrm, u16FrmCnt);
+    }
+    else
+    {
+        /** One datagram per frame */
+        for (uint16_t u16Idx = 0U; (u16Idx < u16FrmCnt) && (u16Ret == 0U); ++u16Idx)
+        {
+            u16Ret = Ipb_IntfEthTransmission(u16Id, ptFrm[u16Idx].pu8Buf, ptFrm[u16Idx].u16SzBy);
+        }
+    }
+
+    return u16Ret;
+}
+
+__attribute__((weak))void Ipb_IntfEthDiscardData(uint16_t u16Id)
+{
+    /** Discard pending datagrams */
+    Ipb_UsrPortDiscardData(u16Id);
+}
+
+static uint16_t Ipb_UsrPortReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size)
+{
+    uint16_t u16Ret = 0U;
+    void* pvCtx;
+    const Ipb_TPortOps* ptOps = Ipb_PortGet(u16Id, &pvCtx);
+
+    if (ptOps != NULL)
+    {
+        u16Ret = ptOps->Reception(pvCtx, pu8Buf, u16Size);
+    }
+
+    return u16Ret;
+}
+
+static uint16_t Ipb_UsrPortTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt,
+                                         uint16_t (*Transmission)(uint16_t, const uint8_t*, uint16_t))
+{
+    uint16_t u16Ret = 0U;
+    void* pvCtx;
+    const Ipb_TPortOps* ptOps = Ipb_PortGet(u16Id, &pvCtx);
+
+    if (ptOps != NULL)
+    {
+        u16Ret = ptOps->Transmission(pvCtx, ptIov, u16IovCnt);
+    }
+    else if (Transmission != NULL)
+    {
+        /** Trasmit each segment */
+        for (uint16_t u16Idx = 0U; (u16Idx < u16IovCnt) && (u16Ret == 0U); ++u16Idx)
+        {
+            u16Ret = Transmission(u16Id, ptIov[u16Idx].pu8Buf, ptIov[u16Idx].u16SzBy);
+        }
+    }
+
+    return u16Ret;
+}
+
+static void Ipb_UsrPortDiscardData(uint16_t u16Id)
+{
+    void* pvCtx;
+    const Ipb_TPortOps* ptOps = Ipb_PortGet(u16Id, &pvCtx);
+
+    if ((ptOps != NULL) && (ptOps->DiscardData != NULL))
+    {
+        ptOps->DiscardData(pvCtx);
+    }
 }
@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "ipb_frame.h"
 
 /**
  * Gets the number of milliseconds since system was started
@@ -21,6 +22,33 @@
 uint32_t
 Ipb_GetMillis(void);
 
+/**
+ * Gets the number of microseconds since system was started
+ *
+ * @note Default implementation is based on Ipb_GetMillis
+ *
+ * @retval microseconds
+ */
+uint32_t
+Ipb_GetMicros(void);
+
+/**
+ * Waits for received data of an instance, used by blocking requests
+ * instead of spinning on the reception
+ *
+ * @note Default implementation waits on the registered port, or
+ *  returns at once if the port cannot wait.
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] u32TimeoutUs
+ *  Max time to wait in microseconds
+ *
+ * @retval true if data may be available, false on timeout
+ */
+bool
+Ipb_IntfWait(uint16_t u16Id, uint32_t u32TimeoutUs);
+
 /**
  * UART reception
  *
@@ -50,11 +78,30 @@ Ipb_IntfUartReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size);
  * @param[in] u16Size
  *  Size to transmit bytes
  *
- * @retval number of read bytes
+ * @retval 0 if success, error code otherwise
  */
 uint16_t
 Ipb_IntfUartTransmission(uint16_t u16Id, const uint8_t *pu8Buf, uint16_t u16Size);
 
+/**
+ * UART vectored transmission
+ *
+ * @note Non Blocking function. Segments are transmitted in order as a
+ *  single frame and are only valid during the call. Default
+ *  implementation calls Ipb_IntfUartTransmission for each segment.
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] ptIov
+ *  Segments to be transmitted
+ * @param[in] u16IovCnt
+ *  Number of segments
+ *
+ * @retval 0 if success, error code otherwise
+ */
+uint16_t
+Ipb_IntfUartTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt);
+
 /**
  * Discard accumulated data of the uart buffer
  *
@@ -96,11 +143,30 @@ Ipb_IntfUsbReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size);
  * @param[in] u16Size
  *  Size to transmit bytes
  *
- * @retval number of read bytes
+ * @retval 0 if success, error code otherwise
  */
 uint16_t
 Ipb_IntfUsbTransmission(uint16_t u16Id, const uint8_t *pu8Buf, uint16_t u16Size);
 
+/**
+ * USB vectored transmission
+ *
+ * @note Non Blocking function. Segments are transmitted in order as a
+ *  single frame and are only valid during the call. Default
+ *  implementation calls Ipb_IntfUsbTransmission for each segment.
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] ptIov
+ *  Segments to be transmitted
+ * @param[in] u16IovCnt
+ *  Number of segments
+ *
+ * @retval 0 if success, error code otherwise
+ */
+uint16_t
+Ipb_IntfUsbTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt);
+
 /**
  * Discard accumulated data of the usb buffer
  *
@@ -110,4 +176,85 @@ Ipb_IntfUsbTransmission(uint16_t u16Id, const uint8_t *pu8Buf, uint16_t u16Size)
 void
 Ipb_IntfUsbDiscardData(uint16_t u16Id);
 
+/**
+ * Ethernet reception
+ *
+ * @note Non Blocking function. Each call returns at most one datagram,
+ *  datagrams bigger than u16Size are truncated.
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] pu8Buf
+ *  Pointer to buffer to be recevied
+ * @param[in] u16Size
+ *  Size of the buffer in bytes
+ *
+ * @retval number of bytes of the received datagram, 0 if none
+ */
+uint16_t
+Ipb_IntfEthReception(uint16_t u16Id, uint8_t *pu8Buf, uint16_t u16Size);
+
+/**
+ * Ethernet transmission
+ *
+ * @note Non Blocking function. Buffer is transmitted as one datagram.
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] pu8Buf
+ *  Pointer to buffer to be transmited
+ * @param[in] u16Size
+ *  Size to transmit bytes
+ *
+ * @retval 0 if success, error code otherwise
+ */
+uint16_t
+Ipb_IntfEthTransmission(uint16_t u16Id, const uint8_t *pu8Buf, uint16_t u16Size);
+
+/**
+ * Ethernet vectored transmission
+ *
+ * @note Non Blocking function. Segments are gathered into a single
+ *  datagram and are only valid during the call.
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] ptIov
+ *  Segments to be transmitted
+ * @param[in] u16IovCnt
+ *  Number of segments
+ *
+ * @retval 0 if success, error code otherwise
+ */
+uint16_t
+Ipb_IntfEthTransmissionV(uint16_t u16Id, const Ipb_TFrameIov *ptIov, uint16_t u16IovCnt);
+
+/**
+ * Ethernet multiple transmission
+ *
+ * @note Non Blocking function. Each frame is transmitted as its own
+ *  datagram, ports may send all of them with a single system call.
+ *  Default implementation calls Ipb_IntfEthTransmission for each frame.
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ * @param[in] ptFrm
+ *  Frames to be transmitted, one segment each
+ * @param[in] u16FrmCnt
+ *  Number of frames
+ *
+ * @retval 0 if success, error code otherwise
+ */
+uint16_t
+Ipb_IntfEthTransmissionM(uint16_t u16Id, const Ipb_TFrameIov *ptFrm, uint16_t u16FrmCnt);
+
+/**
+ * Discard pending datagrams
+ *
+ * @param[in] u16Id
+ *  Identification of the IPB instance
+ */
+void
+Ipb_IntfEthDiscardData(uint16_t u16Id);
+
 #endif /* IPB_USR_H */
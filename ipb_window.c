@@ -0,0 +1,223 @@
+/**
+ * @file ipb_window.c
+ * @brief This file contains the pipelined (sliding window) request
+ *        mode of the ingenia protocol bus (IPB)
+ *
+ * @note Requests are encoded and sent with the instance Send function,
+ *  replies are received with its Read function. Interface state
+ *  machines are therefore used for reception only.
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_window.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Finds the oldest request in flight matching a reply
+ *
+ * @retval slot index, IPB_WINDOW_MAX_SZ if none
+ */
+static uint16_t
+Ipb_WindowMatch(const Ipb_TWindow* ptWindow, uint16_t u16SubNode, uint16_t u16Addr);
+
+/**
+ * Completes the request of a slot and frees it
+ */
+static void
+Ipb_WindowComplete(Ipb_TWindow* ptWindow, uint16_t u16Slot, Ipb_EStatus eStatus);
+
+void Ipb_WindowInit(Ipb_TWindow* ptWindow, Ipb_TInst* ptInst, uint16_t u16Size, uint32_t u32Timeout,
+                    void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx)
+{
+    memset((void*)ptWindow->ptSlot, 0, sizeof(ptWindow->ptSlot));
+    ptWindow->ptInst = ptInst;
+    ptWindow->u16Size = (u16Size > (uint16_t)IPB_WINDOW_MAX_SZ) ? (uint16_t)IPB_WINDOW_MAX_SZ : u16Size;
+    if (ptWindow->u16Size == (uint16_t)0U)
+    {
+        ptWindow->u16Size = (uint16_t)1U;
+    }
+    ptWindow->u16Pend = (uint16_t)0U;
+    ptWindow->u32Seq = (uint32_t)0UL;
+    ptWindow->u32Timeout = u32Timeout;
+    ptWindow->OnDone = OnDone;
+    ptWindow->pvCtx = pvCtx;
+    ptWindow->u32Unmatched = (uint32_t)0UL;
+    ptWindow->u32Expired = (uint32_t)0UL;
+}
+
+Ipb_EStatus Ipb_WindowSubmit(Ipb_TWindow* ptWindow, Ipb_TMsg* ptMsg)
+{
+    Ipb_EStatus eRet = IPB_STANDBY;
+    int32_t i32Sz;
+
+    if (ptWindow->u16Pend < ptWindow->u16Size)
+    {
+        eRet = IPB_ERROR;
+        i32Sz = Ipb_FrameEncode(ptWindow->pu16Tx, (uint16_t)IPB_FRM_MAX_DATA_SZ, ptMsg->u16SubNode,
+                                ptMsg->u16Addr, ptMsg->u16Cmd, ptMsg->pu16Data, ptMsg->u16Size);
+        if ((i32Sz > 0L)
+            && (ptWindow->ptInst->tIntf.Send(&ptWindow->ptInst->tIntf, ptWindow->pu16Tx, (uint16_t)i32Sz)
+                == IPB_SUCCESS))
+        {
+            for (uint16_t u16Slot = 0U; u16Slot < IPB_WINDOW_MAX_SZ; ++u16Slot)
+            {
+                if (ptWindow->ptSlot[u16Slot].ptMsg == NULL)
+                {
+                    ptWindow->ptSlot[u16Slot].ptMsg = ptMsg;
+                    ptWindow->ptSlot[u16Slot].u32Seq = ptWindow->u32Seq++;
+                    ptWindow->ptSlot[u16Slot].u32Millis = Ipb_GetMillis();
+                    ptWindow->u16Pend++;
+                    break;
+                }
+            }
+            eRet = IPB_SUCCESS;
+        }
+
+        ptMsg->eStatus = IPB_ERROR;
+        if (eRet == IPB_SUCCESS)
+        {
+            ptMsg->eStatus = (ptMsg->u16Cmd == IPB_REQ_READ) ? IPB_READ_ANSWER : IPB_WRITE_ANSWER;
+        }
+    }
+
+    return eRet;
+}
+
+uint16_t Ipb_WindowPoll(Ipb_TWindow* ptWindow)
+{
+    uint16_t u16Done = (uint16_t)0U;
+    Ipb_TIntf* ptIntf = &ptWindow->ptInst->tIntf;
+    Ipb_TMsg* ptRx = &ptWindow->tRx;
+    Ipb_EStatus eRet;
+    uint32_t u32Millis;
+
+    /** Collect every reply already received */
+    while (ptWindow->u16Pend > (uint16_t)0U)
+    {
+        eRet = ptIntf->Read(ptIntf, &ptRx->u16SubNode, &ptRx->u16Addr, &ptRx->u16Cmd, ptRx->pu16Data,
+                            &ptRx->u16Size);
+        if (eRet == IPB_STANDBY)
+        {
+            /** State machine restarts after the previous reply */
+            continue;
+        }
+        if (eRet != IPB_SUCCESS)
+        {
+            break;
+        }
+
+        uint16_t u16Slot = Ipb_WindowMatch(ptWindow, ptRx->u16SubNode, ptRx->u16Addr);
+        if (u16Slot < IPB_WINDOW_MAX_SZ)
+        {
+            Ipb_TMsg* ptMsg = ptWindow->ptSlot[u16Slot].ptMsg;
+
+            ptMsg->u16Cmd = ptRx->u16Cmd;
+            ptMsg->u16Size = ptRx->u16Size;
+            memcpy((void*)ptMsg->pu16Data, (const void*)ptRx->pu16Data, (ptRx->u16Size * sizeof(uint16_t)));
+            Ipb_WindowComplete(ptWindow, u16Slot, IPB_SUCCESS);
+            u16Done++;
+        }
+        else
+        {
+            ptWindow->u32Unmatched++;
+        }
+    }
+
+    /** Expire requests without reply */
+    u32Millis = Ipb_GetMillis();
+    for (uint16_t u16Slot = 0U; (u16Slot < IPB_WINDOW_MAX_SZ) && (ptWindow->u16Pend > (uint16_t)0U); ++u16Slot)
+    {
+        if ((ptWindow->ptSlot[u16Slot].ptMsg != NULL)
+            && ((u32Millis - ptWindow->ptSlot[u16Slot].u32Millis) >= ptWindow->u32Timeout))
+        {
+            ptWindow->u32Expired++;
+            Ipb_WindowComplete(ptWindow, u16Slot, IPB_ERROR);
+            u16Done++;
+        }
+    }
+
+    return u16Done;
+}
+
+void Ipb_WindowWait(Ipb_TWindow* ptWindow)
+{
+    uint32_t u32LeftMs = IPB_DFLT_TIMEOUT;
+    uint32_t u32Millis = Ipb_GetMillis();
+
+    /** Wake up at the latest when the oldest request expires */
+    for (uint16_t u16Slot = 0U; u16Slot < IPB_WINDOW_MAX_SZ; ++u16Slot)
+    {
+        if (ptWindow->ptSlot[u16Slot].ptMsg != NULL)
+        {
+            uint32_t u32ElapsedMs = u32Millis - ptWindow->ptSlot[u16Slot].u32Millis;
+            uint32_t u32SlotMs = (u32ElapsedMs < ptWindow->u32Timeout) ? (ptWindow->u32Timeout - u32ElapsedMs)
+                                                                        : (uint32_t)0UL;
+
+            if (u32SlotMs < u32LeftMs)
+            {
+                u32LeftMs = u32SlotMs;
+            }
+        }
+    }
+
+    if ((ptWindow->ptInst->eWait != IPB_WAIT_SPIN) && (u32LeftMs > (uint32_t)0UL))
+    {
+        (void)Ipb_IntfWait(ptWindow->ptInst->tIntf.u16Id, (u32LeftMs * (uint32_t)1000UL));
+    }
+}
+
+uint16_t Ipb_WindowFlush(Ipb_TWindow* ptWindow)
+{
+    uint16_t u16Done = (uint16_t)0U;
+    uint16_t u16Polled;
+
+    while (ptWindow->u16Pend > (uint16_t)0U)
+    {
+        u16Polled = Ipb_WindowPoll(ptWindow);
+        if ((u16Polled == (uint16_t)0U) && (ptWindow->u16Pend > (uint16_t)0U))
+        {
+            Ipb_WindowWait(ptWindow);
+        }
+        u16Done += u16Polled;
+    }
+
+    return u16Done;
+}
+
+static uint16_t Ipb_WindowMatch(const Ipb_TWindow* ptWindow, uint16_t u16SubNode, uint16_t u16Addr)
+{
+    uint16_t u16Match = (uint16_t)IPB_WINDOW_MAX_SZ;
+
+    for (uint16_t u16Slot = 0U; u16Slot < IPB_WINDOW_MAX_SZ; ++u16Slot)
+    {
+        const Ipb_TWindowSlot* ptSlot = &ptWindow->ptSlot[u16Slot];
+
+        if ((ptSlot->ptMsg != NULL) && (ptSlot->ptMsg->u16SubNode == u16SubNode)
+            && (ptSlot->ptMsg->u16Addr == u16Addr)
+            && ((u16Match == (uint16_t)IPB_WINDOW_MAX_SZ)
+                || ((int32_t)(ptSlot->u32Seq - ptWindow->ptSlot[u16Match].u32Seq) < 0L)))
+        {
+            u16Match = u16Slot;
+        }
+    }
+
+    return u16Match;
+}
+
+static void Ipb_WindowComplete(Ipb_TWindow* ptWindow, uint16_t u16Slot, Ipb_EStatus eStatus)
+{
+    Ipb_TMsg* ptMsg = ptWindow->ptSlot[u16Slot].ptMsg;
+
+    ptWindow->ptSlot[u16Slot].ptMsg = NULL;
+    ptWindow->u16Pend--;
+    ptMsg->eStatus = eStatus;
+
+    if (ptWindow->OnDone != NULL)
+    {
+        ptWindow->OnDone(ptWindow->pvCtx, ptMsg);
+    }
+}
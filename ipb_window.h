@@ -0,0 +1,143 @@
+/**
+ * @file ipb_window.h
+ * @brief This file contains the pipelined (sliding window) request
+ *        mode of the ingenia protocol bus (IPB)
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#ifndef IPB_WINDOW_H
+#define IPB_WINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ipb.h"
+
+/** Max number of requests in flight of a window */
+#ifndef IPB_WINDOW_MAX_SZ
+#define IPB_WINDOW_MAX_SZ       16U
+#endif
+
+/** Request in flight */
+typedef struct
+{
+    /** Request, loaded with the reply on completion. NULL if slot is free */
+    Ipb_TMsg* ptMsg;
+    /** Submission order, oldest request is matched first */
+    uint32_t u32Seq;
+    /** Submission time in milliseconds */
+    uint32_t u32Millis;
+} Ipb_TWindowSlot;
+
+typedef struct Ipb_TWindow Ipb_TWindow;
+
+/** Sliding window of requests of an instance */
+struct Ipb_TWindow
+{
+    /** Instance the window sends through, not used by anybody else meanwhile */
+    Ipb_TInst* ptInst;
+    /** Requests in flight */
+    Ipb_TWindowSlot ptSlot[IPB_WINDOW_MAX_SZ];
+    /** Max number of requests in flight, up to IPB_WINDOW_MAX_SZ */
+    uint16_t u16Size;
+    /** Number of requests in flight */
+    uint16_t u16Pend;
+    /** Next submission order */
+    uint32_t u32Seq;
+    /** Max time in milliseconds a request waits for its reply */
+    uint32_t u32Timeout;
+    /** Reply being received */
+    Ipb_TMsg tRx;
+    /** Encoded request */
+    uint16_t pu16Tx[IPB_FRM_MAX_DATA_SZ];
+    /** Completion callback, may be NULL */
+    void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg);
+    /** User context of the callback */
+    void* pvCtx;
+    /** Number of replies not matching any request in flight */
+    uint32_t u32Unmatched;
+    /** Number of requests expired without reply */
+    uint32_t u32Expired;
+};
+
+/**
+ * Initialises a window on an instance
+ *
+ * @note Replies are matched to the oldest request in flight with the
+ *  same subnode and address, so requests to different registers may
+ *  complete in any order. A reply arriving after its request expired
+ *  may be matched to a newer request of the same register.
+ *
+ * @param[out] ptWindow
+ *  Window instance
+ * @param[in] ptInst
+ *  Instance used to send and receive
+ * @param[in] u16Size
+ *  Max number of requests in flight, 1 behaves as stop and wait
+ * @param[in] u32Timeout
+ *  Max time in milliseconds a request waits for its reply
+ * @param[in] OnDone
+ *  Callback called for each completed request, may be NULL
+ * @param[in] pvCtx
+ *  User context passed to the callback
+ */
+void
+Ipb_WindowInit(Ipb_TWindow* ptWindow, Ipb_TInst* ptInst, uint16_t u16Size, uint32_t u32Timeout,
+               void (*OnDone)(void* pvCtx, Ipb_TMsg* ptMsg), void* pvCtx);
+
+/**
+ * Sends a request without waiting for its reply
+ *
+ * @note Message must remain valid until completed. Meanwhile its status
+ *  is IPB_READ_ANSWER or IPB_WRITE_ANSWER, on completion it is
+ *  IPB_SUCCESS with the reply loaded, or IPB_ERROR if expired.
+ *
+ * @param[in] ptWindow
+ *  Window instance
+ * @param[in/out] ptMsg
+ *  Request to be send and load with reply
+ *
+ * @retval IPB_SUCCESS if sent, IPB_STANDBY if window is full,
+ *  IPB_ERROR otherwise
+ */
+Ipb_EStatus
+Ipb_WindowSubmit(Ipb_TWindow* ptWindow, Ipb_TMsg* ptMsg);
+
+/**
+ * Collects the replies already received and expires late requests
+ *
+ * @param[in] ptWindow
+ *  Window instance
+ *
+ * @retval number of completed requests
+ */
+uint16_t
+Ipb_WindowPoll(Ipb_TWindow* ptWindow);
+
+/**
+ * Waits for replies up to the expiry of the oldest request in flight
+ *
+ * @note Callers polling until a request completes, e.g. while the
+ *  window is full, wait with it between polls instead of spinning.
+ *  Instances set to IPB_WAIT_SPIN return at once.
+ *
+ * @param[in] ptWindow
+ *  Window instance
+ */
+void
+Ipb_WindowWait(Ipb_TWindow* ptWindow);
+
+/**
+ * Polls the window until all requests in flight complete, waiting
+ * with Ipb_WindowWait while none does
+ *
+ * @param[in] ptWindow
+ *  Window instance
+ *
+ * @retval number of completed requests
+ */
+uint16_t
+Ipb_WindowFlush(Ipb_TWindow* ptWindow);
+
+#endif /* IPB_WINDOW_H */
@@ -0,0 +1,34 @@
+/**
+ * @file ipb_dict_usr.h
+ * @brief Dictionary of the simulated drive used by the tests
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2019. All rights reserved.
+ */
+
+#ifndef IPB_DICT_USR_H
+#define IPB_DICT_USR_H
+
+#include "ipb_dict.h"
+
+/** Dictionary of node 1, defined by the test */
+extern TIpbDictEntry ptIpbNode1Dict[];
+extern uint16_t u16IpbNode1Size;
+
+/** Mandatory defines link from ipblib to the test dictionary */
+#define DICT_IDX_0_NODE         (int16_t)1
+#define DICT_IDX_1_NODE         (int16_t)-1 /** Not used */
+#define DICT_IDX_2_NODE         (int16_t)-1 /** Not used */
+#define DICT_IDX_3_NODE         (int16_t)-1 /** Not used */
+
+#define DICT_IDX_0_DO_POINTER   (TIpbDictEntry*)ptIpbNode1Dict
+#define DICT_IDX_1_DO_POINTER   (TIpbDictEntry*)NULL
+#define DICT_IDX_2_DO_POINTER   (TIpbDictEntry*)NULL
+#define DICT_IDX_3_DO_POINTER   (TIpbDictEntry*)NULL
+
+#define DICT_IDX_0_SIZE_POINTER          &u16IpbNode1Size
+#define DICT_IDX_1_SIZE_POINTER          NULL
+#define DICT_IDX_2_SIZE_POINTER          NULL
+#define DICT_IDX_3_SIZE_POINTER          NULL
+
+#endif /* IPB_DICT_USR_H */
@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# Builds and runs the regression tests against the simulated drive, from
+# any directory. Exits with non zero status if a build or a test fails,
+# so CI can gate on it without a drive on the bench.
+#
+#   test/run_tests.sh              optimised build, gates the round trip
+#   CFLAGS="-O1 -g -fsanitize=address,undefined" test/run_tests.sh
+#
+# Set TEST_SIM_MAX_RT_NS to change the gated round trip, e.g. on slow
+# CI runners: CFLAGS="-O2 -DTEST_SIM_MAX_RT_NS=20000UL".
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+if [ -z "$OUT" ]; then
+    OUT=$(mktemp -d)
+    trap 'rm -rf "$OUT"' EXIT
+fi
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--O2}
+
+cd "$ROOT"
+
+$CC $CFLAGS -Wall -Itest -I. test/test_sim.c ipb_sim.c ipb_dict.c ipb.c ipb_intf.c \
+    ipb_frame.c ipb_crc.c ipb_parser.c ipb_pool.c ipb_port.c ipb_usr.c \
+    ipb_linux.c -o "$OUT/test_sim"
+$CC $CFLAGS -Wall -I. test/test_rxring.c ipb_rxring.c ipb_frame.c ipb_crc.c \
+    -o "$OUT/test_rxring"
+
+"$OUT/test_sim"
+"$OUT/test_rxring"
@@ -0,0 +1,332 @@
+/**
+ * @file test_rxring.c
+ * @brief Regression tests of the circular reception buffer of the
+ *        ingenia protocol bus (IPB)
+ *
+ * @note Random config and extended frames mixed with garbage and header
+ *  bit flips are fed in random chunks through both fill modes, while up
+ *  to TEST_RING_HELD views are held. Every intact frame must be decoded
+ *  with its header and data and every corrupted one skipped. A DMA
+ *  writer overrunning held views is checked last. Exits with 0 if every
+ *  check passes. Build and run from the repository root:
+ *
+ *  gcc -O2 -I. test/test_rxring.c ipb_rxring.c ipb_frame.c ipb_crc.c -o test_rxring
+ *  ./test_rxring
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb_rxring.h"
+#include "ipb_crc.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Number of frames of the random stream */
+#define TEST_RING_FRM_NUM       20000U
+
+/** Max number of views held at once */
+#define TEST_RING_HELD          4U
+
+/** Size of the ring buffer in bytes, power of 2 */
+#define TEST_RING_SZ_BY         4096U
+
+/** Frame expected from the stream */
+typedef struct
+{
+    uint16_t u16SubNode;
+    uint16_t u16Addr;
+    uint16_t u16Cmd;
+    uint16_t u16Sz;
+    uint16_t pu16Data[IPB_MAX_DATA_SZ];
+    /** Header corrupted, the frame must be skipped */
+    bool isBad;
+} TTestFrame;
+
+/** Expected frames */
+static TTestFrame ptExp[TEST_RING_FRM_NUM];
+
+/** Received byte stream */
+static uint8_t pu8Stream[TEST_RING_FRM_NUM * IPB_FRM_MAX_DATA_SZ];
+
+/** Size of the received byte stream */
+static uint32_t u32StreamSz;
+
+/** Random generator state */
+static uint32_t u32Rand = 12345UL;
+
+/** Number of failed checks */
+static uint32_t u32Failed;
+
+static uint32_t TestRand(void)
+{
+    /** Xorshift, reproducible on every platform */
+    u32Rand ^= u32Rand << 13;
+    u32Rand ^= u32Rand >> 17;
+    u32Rand ^= u32Rand << 5;
+
+    return u32Rand;
+}
+
+static void TestCheck(bool isOk, const char* pcName)
+{
+    printf("%s %s\n", (isOk != false) ? "ok  " : "FAIL", pcName);
+    if (isOk == false)
+    {
+        u32Failed++;
+    }
+}
+
+static void TestBuildStream(bool isErr)
+{
+    static Ipb_TFrame tFrame;
+
+    u32StreamSz = 0UL;
+    for (uint32_t u32Idx = 0UL; u32Idx < TEST_RING_FRM_NUM; ++u32Idx)
+    {
+        TTestFrame* ptFrm = &ptExp[u32Idx];
+        uint32_t u32SzBy;
+
+        ptFrm->u16SubNode = (uint16_t)(TestRand() & IPB_FRM_NODE_MASK);
+        ptFrm->u16Addr = (uint16_t)(TestRand() & 0xFFFU);
+        ptFrm->u16Cmd = (uint16_t)(1U + (TestRand() % 6U));
+        if ((TestRand() % 4U) == 0U)
+        {
+            ptFrm->u16Sz = (uint16_t)(5U + (TestRand() % (IPB_MAX_DATA_SZ - 20U)));
+        }
+        else
+        {
+            ptFrm->u16Sz = (uint16_t)(TestRand() % 5U);
+        }
+        for (uint16_t u16Idx = 0U; u16Idx < ptFrm->u16Sz; ++u16Idx)
+        {
+            ptFrm->pu16Data[u16Idx] = (uint16_t)TestRand();
+        }
+        ptFrm->isBad = false;
+
+        (void)Ipb_FrameCreate(&tFrame, ptFrm->u16SubNode, ptFrm->u16Addr, (uint8_t)ptFrm->u16Cmd,
+                              ptFrm->pu16Data, ptFrm->u16Sz, true);
+        u32SzBy = (uint32_t)Ipb_FrameGetEncodedSz(tFrame.pu16Buf) * sizeof(uint16_t);
+
+        /** Garbage between frames */
+        if ((TestRand() % 10U) == 0U)
+        {
+            for (uint32_t u32Cnt = TestRand() % 7U; u32Cnt > 0UL; --u32Cnt)
+            {
+                pu8Stream[u32StreamSz++] = (uint8_t)TestRand();
+            }
+        }
+
+        memcpy((void*)&pu8Stream[u32StreamSz], (const void*)tFrame.pu16Buf, u32SzBy);
+        /** Flips in the bytes covered by the header CRC */
+        if ((isErr != false) && ((TestRand() % 50U) == 0U))
+        {
+            pu8Stream[u32StreamSz + (TestRand() % IPB_FRM_CRC_DATA_SZ_BY)] ^= (uint8_t)(1U << (TestRand() % 8U));
+            ptFrm->isBad = true;
+        }
+        u32StreamSz += u32SzBy;
+    }
+}
+
+/**
+ * Checks a decoded view against the next intact expected frame
+ *
+ * @retval true if it matches
+ */
+static bool TestMatch(const Ipb_TFrameView* ptView, uint32_t* pu32Idx)
+{
+    uint16_t pu16Data[IPB_MAX_DATA_SZ];
+    uint16_t pu16Exp[IPB_MAX_DATA_SZ] = { 0U };
+    const TTestFrame* ptFrm;
+    uint16_t u16Sz;
+    uint16_t u16ExpSz;
+    bool isOk = false;
+
+    while ((*pu32Idx < TEST_RING_FRM_NUM) && (ptExp[*pu32Idx].isBad != false))
+    {
+        (*pu32Idx)++;
+    }
+
+    if (*pu32Idx < TEST_RING_FRM_NUM)
+    {
+        ptFrm = &ptExp[*pu32Idx];
+        (*pu32Idx)++;
+
+        /** Config frames always carry their four words */
+        u16ExpSz = (ptFrm->u16Sz > 4U) ? ptFrm->u16Sz : 4U;
+        memcpy((void*)pu16Exp, (const void*)ptFrm->pu16Data, ptFrm->u16Sz * sizeof(uint16_t));
+        u16Sz = Ipb_RxRingCopyData(ptView, pu16Data, IPB_MAX_DATA_SZ);
+
+        isOk = (ptView->u16SubNode == ptFrm->u16SubNode) && (ptView->u16Addr == ptFrm->u16Addr)
+               && (ptView->u8Cmd == ptFrm->u16Cmd) && (ptView->isExt == (ptFrm->u16Sz > 4U))
+               && (u16Sz == u16ExpSz)
+               && (memcmp((const void*)pu16Data, (const void*)pu16Exp, u16Sz * sizeof(uint16_t)) == 0);
+    }
+
+    return isOk;
+}
+
+static void TestStream(bool isDma, bool isErr)
+{
+    static uint8_t pu8Buf[TEST_RING_SZ_BY];
+    Ipb_TRxRing tRing;
+    Ipb_TFrameView ptHeld[TEST_RING_HELD];
+    uint32_t u32HeldCnt = 0UL;
+    uint32_t u32Pos = 0UL;
+    uint32_t u32DmaPos = 0UL;
+    uint32_t u32Idx = 0UL;
+    uint32_t u32Good = 0UL;
+    uint32_t u32Matched = 0UL;
+    uint32_t u32Decoded = 0UL;
+    char pcName[128];
+
+    (void)Ipb_RxRingInit(&tRing, pu8Buf, TEST_RING_SZ_BY);
+    TestBuildStream(isErr);
+
+    while ((u32Pos < u32StreamSz) || (u32HeldCnt > 0UL))
+    {
+        uint32_t u32Chunk = 1UL + (TestRand() % 300UL);
+        uint32_t u32Rel;
+
+        if (u32Chunk > (u32StreamSz - u32Pos))
+        {
+            u32Chunk = u32StreamSz - u32Pos;
+        }
+
+        if (isDma != false)
+        {
+            /** The writer never overruns held bytes here */
+            uint32_t u32Room = TEST_RING_SZ_BY - (tRing.u32WrBy - tRing.u32RelBy);
+
+            if (u32Chunk > u32Room)
+            {
+                u32Chunk = u32Room;
+            }
+            for (uint32_t u32Cnt = 0UL; u32Cnt < u32Chunk; ++u32Cnt)
+            {
+                pu8Buf[u32DmaPos] = pu8Stream[u32Pos++];
+                u32DmaPos = (u32DmaPos + 1UL) & (TEST_RING_SZ_BY - 1UL);
+            }
+            Ipb_RxRingSetPos(&tRing, u32DmaPos);
+        }
+        else
+        {
+            uint8_t* pu8Dst;
+            uint32_t u32Space = Ipb_RxRingSpace(&tRing, &pu8Dst);
+
+            if (u32Chunk > u32Space)
+            {
+                u32Chunk = u32Space;
+            }
+            memcpy((void*)pu8Dst, (const void*)&pu8Stream[u32Pos], u32Chunk);
+            u32Pos += u32Chunk;
+            Ipb_RxRingCommit(&tRing, u32Chunk);
+        }
+
+        while ((u32HeldCnt < TEST_RING_HELD) && (Ipb_RxRingNext(&tRing, &ptHeld[u32HeldCnt]) != false))
+        {
+            u32HeldCnt++;
+            u32Decoded++;
+            if ((TestRand() % 3U) == 0U)
+            {
+                break;
+            }
+        }
+
+        /** Views are released in order, all of them once the stream ends */
+        u32Rel = (u32Pos >= u32StreamSz) ? u32HeldCnt : (TestRand() % (u32HeldCnt + 1UL));
+        for (uint32_t u32Cnt = 0UL; u32Cnt < u32Rel; ++u32Cnt)
+        {
+            if (TestMatch(&ptHeld[u32Cnt], &u32Idx) != false)
+            {
+                u32Matched++;
+            }
+            Ipb_RxRingRelease(&tRing, &ptHeld[u32Cnt]);
+        }
+        memmove((void*)ptHeld, (const void*)&ptHeld[u32Rel], (u32HeldCnt - u32Rel) * sizeof(ptHeld[0]));
+        u32HeldCnt -= u32Rel;
+
+        if ((u32Pos >= u32StreamSz) && (u32HeldCnt == 0UL) && (Ipb_RxRingNext(&tRing, &ptHeld[0]) != false))
+        {
+            u32HeldCnt = 1UL;
+            u32Decoded++;
+        }
+    }
+
+    for (uint32_t u32Cnt = 0UL; u32Cnt < TEST_RING_FRM_NUM; ++u32Cnt)
+    {
+        u32Good += (ptExp[u32Cnt].isBad == false) ? 1UL : 0UL;
+    }
+    (void)snprintf(pcName, sizeof(pcName), "%s%s: %lu intact, %lu decoded, %lu matched, %lu crc errors",
+                   (isDma != false) ? "dma" : "read", (isErr != false) ? " with bit flips" : "",
+                   (unsigned long)u32Good, (unsigned long)u32Decoded, (unsigned long)u32Matched,
+                   (unsigned long)tRing.u32CrcErr);
+    TestCheck(((u32Decoded == u32Good) && (u32Matched == u32Good) && (tRing.u32Held == 0UL)
+               && (tRing.u32RelBy == tRing.u32WrBy) && (tRing.u32Overruns == 0UL)), pcName);
+}
+
+/** Writes config frames at the DMA position */
+static void TestDmaFrames(uint8_t* pu8Buf, uint32_t u32SzBy, uint32_t* pu32Pos, const Ipb_TFrame* ptFrame,
+                          uint32_t u32Cnt)
+{
+    for (uint32_t u32Idx = 0UL; u32Idx < u32Cnt; ++u32Idx)
+    {
+        for (uint32_t u32By = 0UL; u32By < IPB_FRM_CFG_SZ_BY; ++u32By)
+        {
+            pu8Buf[*pu32Pos & (u32SzBy - 1UL)] = ((const uint8_t*)ptFrame->pu16Buf)[u32By];
+            (*pu32Pos)++;
+        }
+    }
+}
+
+static void TestOverrun(void)
+{
+    static uint8_t pu8Buf[256];
+    static Ipb_TFrame tFrame;
+    uint16_t pu16Data[4] = { 1U, 2U, 3U, 4U };
+    Ipb_TRxRing tRing;
+    Ipb_TFrameView tOld;
+    Ipb_TFrameView tNew;
+    uint32_t u32Pos = 0UL;
+    uint32_t u32RelBy;
+    bool isOk;
+
+    (void)Ipb_RxRingInit(&tRing, pu8Buf, sizeof(pu8Buf));
+    (void)Ipb_FrameCreate(&tFrame, 2U, 0x11U, IPB_REP_ACK, pu16Data, 4U, true);
+
+    TestDmaFrames(pu8Buf, sizeof(pu8Buf), &u32Pos, &tFrame, 2UL);
+    Ipb_RxRingSetPos(&tRing, u32Pos & (sizeof(pu8Buf) - 1UL));
+    isOk = Ipb_RxRingNext(&tRing, &tOld);
+
+    /** The writer laps the held view, but not the whole buffer */
+    TestDmaFrames(pu8Buf, sizeof(pu8Buf), &u32Pos, &tFrame, 17UL);
+    Ipb_RxRingSetPos(&tRing, u32Pos & (sizeof(pu8Buf) - 1UL));
+    isOk = isOk && (tRing.u32Overruns == 1UL) && (Ipb_RxRingIsValid(&tRing, &tOld) == false);
+    TestCheck(isOk, "overrun of a held view");
+
+    /** Releasing the stale view must keep the newer one held */
+    isOk = Ipb_RxRingNext(&tRing, &tNew) && (Ipb_RxRingIsValid(&tRing, &tNew) != false);
+    u32RelBy = tRing.u32RelBy;
+    Ipb_RxRingRelease(&tRing, &tOld);
+    isOk = isOk && (tRing.u32Held == 1UL) && (tRing.u32RelBy == u32RelBy);
+    Ipb_RxRingRelease(&tRing, &tNew);
+    isOk = isOk && (tRing.u32Held == 0UL);
+    TestCheck(isOk, "release of a stale view");
+}
+
+int main(void)
+{
+    Ipb_CrcInit();
+
+    TestStream(false, false);
+    TestStream(true, false);
+    TestStream(false, true);
+    TestStream(true, true);
+    TestOverrun();
+
+    printf("%lu failed\n", (unsigned long)u32Failed);
+
+    return (u32Failed == 0UL) ? 0 : 1;
+}
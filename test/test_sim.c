@@ -0,0 +1,324 @@
+/**
+ * @file test_sim.c
+ * @brief Regression tests of the ingenia protocol bus (IPB) requests
+ *        against the simulated drive of ipb_sim.c
+ *
+ * @note Blocking requests are checked on UART, USB and ETHERNET
+ *  instances, then the link model: latency, bandwidth and bit errors.
+ *  The ideal read round trip is gated against TEST_SIM_MAX_RT_NS, so a
+ *  slower request path fails the run. Exits with 0 if every check
+ *  passes. Build and run from the repository root:
+ *
+ *  gcc -O2 -Itest -I. test/test_sim.c ipb_sim.c ipb_dict.c ipb.c ipb_intf.c \
+ *      ipb_frame.c ipb_crc.c ipb_parser.c ipb_pool.c ipb_port.c ipb_usr.c \
+ *      ipb_linux.c -o test_sim
+ *  ./test_sim
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2018. All rights reserved.
+ */
+
+#include "ipb.h"
+#include "ipb_sim.h"
+#include "ipb_crc.h"
+#include "ipb_usr.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Max mean ideal read round trip in nanoseconds */
+#ifndef TEST_SIM_MAX_RT_NS
+#define TEST_SIM_MAX_RT_NS      10000UL
+#endif
+
+/** Time in microseconds timed requests may take over the modelled one */
+#ifndef TEST_SIM_SLACK_US
+#define TEST_SIM_SLACK_US       500UL
+#endif
+
+/** Request timeout in milliseconds */
+#define TEST_SIM_TIMEOUT_MS     100UL
+
+/** Size in words of the extended register */
+#define TEST_SIM_BIG_SZ         200U
+
+/** Register addresses of node 1 */
+#define TEST_SIM_ADDR_CTRL      0x010U
+#define TEST_SIM_ADDR_BIG       0x020U
+#define TEST_SIM_ADDR_RO        0x030U
+
+/** Registers of node 1 */
+static uint16_t u16Ctrl;
+static uint16_t pu16Big[TEST_SIM_BIG_SZ];
+
+/** Number of failed checks */
+static uint32_t u32Failed;
+
+static uint8_t TestReadCtrl(uint16_t* pu16Data, uint16_t* pu16DataSz)
+{
+    pu16Data[0] = u16Ctrl;
+    *pu16DataSz = 1U;
+
+    return NO_ERROR;
+}
+
+static uint8_t TestWriteCtrl(uint16_t* pu16Data, uint16_t* pu16DataSz)
+{
+    uint8_t u8Ret = WRITE_ERROR;
+
+    if (*pu16DataSz >= 1U)
+    {
+        u16Ctrl = pu16Data[0];
+        u8Ret = NO_ERROR;
+    }
+
+    return u8Ret;
+}
+
+static uint8_t TestReadBig(uint16_t* pu16Data, uint16_t* pu16DataSz)
+{
+    memcpy((void*)pu16Data, (const void*)pu16Big, sizeof(pu16Big));
+    *pu16DataSz = TEST_SIM_BIG_SZ;
+
+    return NO_ERROR;
+}
+
+static uint8_t TestWriteBig(uint16_t* pu16Data, uint16_t* pu16DataSz)
+{
+    uint8_t u8Ret = WRITE_ERROR;
+
+    if (*pu16DataSz == TEST_SIM_BIG_SZ)
+    {
+        memcpy((void*)pu16Big, (const void*)pu16Data, sizeof(pu16Big));
+        u8Ret = NO_ERROR;
+    }
+
+    return u8Ret;
+}
+
+/** Dictionary of node 1, see test/ipb_dict_usr.h */
+TIpbDictEntry ptIpbNode1Dict[] =
+{
+    { TEST_SIM_ADDR_CTRL, TestReadCtrl, TestWriteCtrl, NULL, 0U, 0U, 16U },
+    { TEST_SIM_ADDR_BIG, TestReadBig, TestWriteBig, NULL, 0U, 0U, (uint16_t)(TEST_SIM_BIG_SZ * 16U) },
+    { TEST_SIM_ADDR_RO, TestReadCtrl, NULL, NULL, 0U, 0U, 16U }
+};
+uint16_t u16IpbNode1Size = (uint16_t)(sizeof(ptIpbNode1Dict) / sizeof(ptIpbNode1Dict[0]));
+
+static void TestCheck(bool isOk, const char* pcName)
+{
+    printf("%s %s\n", (isOk != false) ? "ok  " : "FAIL", pcName);
+    if (isOk == false)
+    {
+        u32Failed++;
+    }
+}
+
+/**
+ * Sends a request and waits for its reply
+ *
+ * @retval status of the reply, the reply is loaded in ptMsg
+ */
+static Ipb_EStatus TestRequest(Ipb_TInst* ptInst, Ipb_TMsg* ptMsg, uint16_t u16SubNode, uint16_t u16Addr,
+                               uint16_t u16Cmd, const uint16_t* pu16Data, uint16_t u16Size)
+{
+    Ipb_EStatus eRet = IPB_ERROR;
+
+    ptMsg->u16SubNode = u16SubNode;
+    ptMsg->u16Addr = u16Addr;
+    ptMsg->u16Cmd = u16Cmd;
+    ptMsg->u16Size = u16Size;
+    if (u16Size > 0U)
+    {
+        memcpy((void*)ptMsg->pu16Data, (const void*)pu16Data, u16Size * sizeof(uint16_t));
+    }
+
+    if (Ipb_Write(ptInst, ptMsg, TEST_SIM_TIMEOUT_MS) == IPB_SUCCESS)
+    {
+        eRet = Ipb_Read(ptInst, ptMsg, TEST_SIM_TIMEOUT_MS);
+    }
+
+    return eRet;
+}
+
+static void TestRequests(Ipb_TSim* ptSim, TIpbDictInst* ptDict, Ipb_EIntf eIntf, const char* pcIntf)
+{
+    static Ipb_TInst tInst;
+    static Ipb_TMsg tMsg;
+    static Ipb_TMsg ptBatch[4];
+    static uint16_t pu16BatchBuf[4U * IPB_FRM_MAX_DATA_SZ];
+    uint16_t pu16Data[TEST_SIM_BIG_SZ];
+    Ipb_TSimCfg tCfg = { 0UL, 0UL, 0UL, 1UL };
+    char pcName[96];
+    uint32_t u32Bad = 0UL;
+    uint32_t u32StartUs;
+    uint32_t u32RtNs;
+    bool isOk;
+
+    (void)Ipb_SimOpen(ptSim, 0U, (eIntf == ETHERNET_BASED), NULL);
+    (void)Ipb_SimSetDict(ptSim, 1U, ptDict);
+    Ipb_InitId(&tInst, eIntf, IPB_BLOCKING, 0U);
+
+    for (uint16_t u16Idx = 0U; u16Idx < 1000U; ++u16Idx)
+    {
+        if ((TestRequest(&tInst, &tMsg, 1U, TEST_SIM_ADDR_CTRL, IPB_REQ_WRITE, &u16Idx, 1U) != IPB_SUCCESS)
+            || (tMsg.u16Cmd != IPB_REP_ACK) || (u16Ctrl != u16Idx))
+        {
+            u32Bad++;
+        }
+        if ((TestRequest(&tInst, &tMsg, 1U, TEST_SIM_ADDR_CTRL, IPB_REQ_READ, NULL, 0U) != IPB_SUCCESS)
+            || (tMsg.pu16Data[0] != u16Idx))
+        {
+            u32Bad++;
+        }
+    }
+    (void)snprintf(pcName, sizeof(pcName), "%s config write and read", pcIntf);
+    TestCheck((u32Bad == 0UL), pcName);
+
+    for (uint16_t u16Idx = 0U; u16Idx < TEST_SIM_BIG_SZ; ++u16Idx)
+    {
+        pu16Big[u16Idx] = (uint16_t)(u16Idx * 3U);
+        pu16Data[u16Idx] = (uint16_t)(u16Idx + 7U);
+    }
+    isOk = (TestRequest(&tInst, &tMsg, 1U, TEST_SIM_ADDR_BIG, IPB_REQ_READ, NULL, 0U) == IPB_SUCCESS)
+           && (tMsg.u16Size == TEST_SIM_BIG_SZ)
+           && (memcmp((const void*)tMsg.pu16Data, (const void*)pu16Big, sizeof(pu16Big)) == 0);
+    isOk = isOk
+           && (TestRequest(&tInst, &tMsg, 1U, TEST_SIM_ADDR_BIG, IPB_REQ_WRITE, pu16Data, TEST_SIM_BIG_SZ)
+               == IPB_SUCCESS)
+           && (tMsg.u16Cmd == IPB_REP_ACK)
+           && (memcmp((const void*)pu16Big, (const void*)pu16Data, sizeof(pu16Big)) == 0);
+    (void)snprintf(pcName, sizeof(pcName), "%s extended write and read", pcIntf);
+    TestCheck(isOk, pcName);
+
+    (void)TestRequest(&tInst, &tMsg, 1U, TEST_SIM_ADDR_RO, IPB_REQ_WRITE, pu16Data, 1U);
+    (void)snprintf(pcName, sizeof(pcName), "%s write error reply", pcIntf);
+    TestCheck((tMsg.u16Cmd == IPB_REP_WRITE_ERROR), pcName);
+
+    (void)TestRequest(&tInst, &tMsg, 2U, TEST_SIM_ADDR_CTRL, IPB_REQ_READ, NULL, 0U);
+    (void)snprintf(pcName, sizeof(pcName), "%s missing node reply", pcIntf);
+    TestCheck((tMsg.u16Cmd == IPB_REP_ERROR), pcName);
+
+    /** Extended batch bigger than the copy buffer used for bit errors */
+    tCfg.u32BitErrBits = 0xFFFFFFFFUL;
+    Ipb_SimSetCfg(ptSim, &tCfg);
+    for (uint16_t u16Idx = 0U; u16Idx < 4U; ++u16Idx)
+    {
+        ptBatch[u16Idx].u16SubNode = 1U;
+        ptBatch[u16Idx].u16Addr = TEST_SIM_ADDR_BIG;
+        ptBatch[u16Idx].u16Cmd = IPB_REQ_WRITE;
+        ptBatch[u16Idx].u16Size = TEST_SIM_BIG_SZ;
+        memcpy((void*)ptBatch[u16Idx].pu16Data, (const void*)pu16Data, sizeof(pu16Data));
+        ptBatch[u16Idx].pu16Data[0] = u16Idx;
+    }
+    isOk = (Ipb_WriteBatch(&tInst, ptBatch, 4U, pu16BatchBuf, (uint16_t)(sizeof(pu16BatchBuf) / sizeof(uint16_t)),
+                           TEST_SIM_TIMEOUT_MS) == IPB_SUCCESS)
+           && (pu16Big[0] == 3U);
+    (void)snprintf(pcName, sizeof(pcName), "%s extended batch with bit errors enabled", pcIntf);
+    TestCheck(isOk, pcName);
+    Ipb_SimSetCfg(ptSim, NULL);
+
+    u32StartUs = Ipb_GetMicros();
+    for (uint32_t u32Idx = 0UL; u32Idx < 100000UL; ++u32Idx)
+    {
+        (void)TestRequest(&tInst, &tMsg, 1U, TEST_SIM_ADDR_CTRL, IPB_REQ_READ, NULL, 0U);
+    }
+    u32RtNs = (Ipb_GetMicros() - u32StartUs) / 100UL;
+    (void)snprintf(pcName, sizeof(pcName), "%s ideal read round trip %lu ns", pcIntf, (unsigned long)u32RtNs);
+    TestCheck((u32RtNs <= TEST_SIM_MAX_RT_NS), pcName);
+
+    Ipb_SimClose(ptSim);
+}
+
+/**
+ * Times config reads over a modelled link
+ *
+ * @retval mean round trip in microseconds
+ */
+static uint32_t TestTimedReads(Ipb_TInst* ptInst, uint32_t u32Cnt)
+{
+    static Ipb_TMsg tMsg;
+    uint32_t u32StartUs = Ipb_GetMicros();
+
+    for (uint32_t u32Idx = 0UL; u32Idx < u32Cnt; ++u32Idx)
+    {
+        (void)TestRequest(ptInst, &tMsg, 1U, TEST_SIM_ADDR_CTRL, IPB_REQ_READ, NULL, 0U);
+    }
+
+    return (Ipb_GetMicros() - u32StartUs) / u32Cnt;
+}
+
+static void TestLink(Ipb_TSim* ptSim, TIpbDictInst* ptDict)
+{
+    static Ipb_TInst tInst;
+    static Ipb_TMsg tMsg;
+    Ipb_TSimCfg tCfg = { 100UL, 0UL, 0UL, 1234UL };
+    char pcName[96];
+    uint32_t u32Us;
+    uint32_t u32ExpUs;
+    uint32_t u32Ok = 0UL;
+    uint32_t u32Lost = 0UL;
+    uint32_t u32Wrong = 0UL;
+
+    Ipb_InitId(&tInst, UART_BASED, IPB_BLOCKING, 0U);
+    (void)Ipb_SimOpen(ptSim, 0U, false, &tCfg);
+    (void)Ipb_SimSetDict(ptSim, 1U, ptDict);
+
+    u32Us = TestTimedReads(&tInst, 2000UL);
+    (void)snprintf(pcName, sizeof(pcName), "latency 100 us, read %lu us", (unsigned long)u32Us);
+    TestCheck(((u32Us >= tCfg.u32LatencyUs) && (u32Us <= (tCfg.u32LatencyUs + TEST_SIM_SLACK_US))), pcName);
+
+    /** 115200 baud, 14 bytes each way */
+    tCfg.u32LatencyUs = 0UL;
+    tCfg.u32BytesPerSec = 11520UL;
+    Ipb_SimSetCfg(ptSim, &tCfg);
+    u32ExpUs = (28UL * 1000000UL) / tCfg.u32BytesPerSec;
+    u32Us = TestTimedReads(&tInst, 200UL);
+    (void)snprintf(pcName, sizeof(pcName), "11520 B/s, read %lu us for %lu us", (unsigned long)u32Us,
+                   (unsigned long)u32ExpUs);
+    TestCheck(((u32Us >= (u32ExpUs - 1UL)) && (u32Us <= (u32ExpUs + TEST_SIM_SLACK_US))), pcName);
+
+    /** Corrupted frames must fail their CRC, never deliver wrong data */
+    tCfg.u32BytesPerSec = 0UL;
+    tCfg.u32BitErrBits = 2000UL;
+    Ipb_SimSetCfg(ptSim, &tCfg);
+    for (uint16_t u16Idx = 0U; u16Idx < 2000U; ++u16Idx)
+    {
+        if (TestRequest(&tInst, &tMsg, 1U, TEST_SIM_ADDR_CTRL, IPB_REQ_READ, NULL, 0U) != IPB_SUCCESS)
+        {
+            u32Lost++;
+        }
+        else if (tMsg.pu16Data[0] != u16Ctrl)
+        {
+            u32Wrong++;
+        }
+        else
+        {
+            u32Ok++;
+        }
+    }
+    (void)snprintf(pcName, sizeof(pcName), "1 bit error in 2000, %lu ok %lu failed %lu wrong",
+                   (unsigned long)u32Ok, (unsigned long)u32Lost, (unsigned long)u32Wrong);
+    TestCheck(((u32Wrong == 0UL) && (u32Lost > 0UL) && (ptSim->u32BitErrs > 0UL)), pcName);
+
+    Ipb_SimClose(ptSim);
+}
+
+int main(void)
+{
+    static Ipb_TSim tSim;
+    static TIpbDictInst tDict;
+
+    Ipb_CrcInit();
+    Ipb_DictInit(&tDict, (int16_t)1);
+
+    TestRequests(&tSim, &tDict, UART_BASED, "uart");
+    TestRequests(&tSim, &tDict, USB_BASED, "usb");
+    TestRequests(&tSim, &tDict, ETHERNET_BASED, "ethernet");
+    TestLink(&tSim, &tDict);
+
+    printf("%lu failed\n", (unsigned long)u32Failed);
+
+    return (u32Failed == 0UL) ? 0 : 1;
+}
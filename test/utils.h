@@ -0,0 +1,16 @@
+/**
+ * @file utils.h
+ * @brief Firmware utilities used by ipb_dict.c, reduced to what the
+ *        tests need
+ *
+ * @author  Firmware department
+ * @copyright Ingenia Motion Control (c) 2019. All rights reserved.
+ */
+
+#ifndef UTILS_H
+#define UTILS_H
+
+/** Number of bits in a byte */
+#define BYTE_TO_BITS            8U
+
+#endif /* UTILS_H */